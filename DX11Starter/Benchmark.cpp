@@ -0,0 +1,235 @@
+#include "Benchmark.h"
+#include "FrameTimeStats.h"
+#include "PathHelpers.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// Without the profiler there are no markers, so no per-section timings
+#ifdef ENABLE_PROFILER
+static const bool ProfilerEnabled = true;
+#else
+static const bool ProfilerEnabled = false;
+#endif
+
+// --------------------------------------------------------
+// Option values, which must be the whole argument and above
+// zero.  Anything else is reported and leaves the default.
+// --------------------------------------------------------
+static void ParseCount(const char* option, const std::string& text, unsigned int& value)
+{
+	char* end = nullptr;
+	errno = 0;
+	unsigned long parsed = strtoul(text.c_str(), &end, 10);
+	if (text.empty() || text[0] == '-' || end == text.c_str() || *end != '\0' || errno == ERANGE || parsed == 0 || parsed > 0xFFFFFFFFul)
+	{
+		printf("Ignoring %s \"%s\" (expected a whole number above zero), using %u\n", option, text.c_str(), value);
+		return;
+	}
+	value = (unsigned int)parsed;
+}
+
+static void ParseSeconds(const char* option, const std::string& text, float& value)
+{
+	char* end = nullptr;
+	errno = 0;
+	float parsed = strtof(text.c_str(), &end);
+	if (end == text.c_str() || *end != '\0' || errno == ERANGE || !std::isfinite(parsed) || parsed <= 0.0f)
+	{
+		printf("Ignoring %s \"%s\" (expected seconds above zero), using %g\n", option, text.c_str(), value);
+		return;
+	}
+	value = parsed;
+}
+
+// --------------------------------------------------------
+// Splits the command line on spaces (respecting quotes)
+// and picks out the benchmark options
+// --------------------------------------------------------
+BenchmarkSettings BenchmarkSettings::FromCommandLine(const char* commandLine)
+{
+	BenchmarkSettings settings;
+	settings.CameraPathFile = FixPath(L"../../Assets/CameraPaths/flythrough.txt");
+	settings.ReportFile = FixPath(L"benchmark_report.json");
+	if (!commandLine)
+		return settings;
+
+	std::vector<std::string> args;
+	std::string current;
+	bool quoted = false;
+	for (const char* c = commandLine; *c; c++)
+	{
+		if (*c == '"')
+			quoted = !quoted;
+		else if (*c == ' ' && !quoted)
+		{
+			if (!current.empty()) args.push_back(current);
+			current.clear();
+		}
+		else
+			current += *c;
+	}
+	if (!current.empty()) args.push_back(current);
+
+	for (size_t i = 0; i < args.size(); i++)
+	{
+		bool hasValue = i + 1 < args.size() && args[i + 1][0] != '-';
+
+		if (args[i] == "-benchmark")
+		{
+			settings.Enabled = true;
+			if (hasValue) settings.CameraPathFile = NarrowToWide(args[++i]);
+		}
+		else if (args[i] == "-frames" && hasValue)
+			ParseCount("-frames", args[++i], settings.FrameCount);
+		else if (args[i] == "-timestep" && hasValue)
+			ParseSeconds("-timestep", args[++i], settings.FixedTimestep);
+		else if (args[i] == "-report" && hasValue)
+			settings.ReportFile = NarrowToWide(args[++i]);
+		else if (args[i] == "-headless")
+			settings.Headless = true;
+		else if (args[i] == "-warp")
+			settings.UseWarp = true;
+	}
+
+	return settings;
+}
+
+
+Benchmark::Benchmark(const BenchmarkSettings& settings) :
+	settings(settings)
+{
+	cameraPathLoaded = cameraPath.LoadFromFile(settings.CameraPathFile);
+	frames.reserve(settings.FrameCount);
+	if (!ProfilerEnabled)
+		printf("Profiler compiled out (ENABLE_PROFILER isn't defined) - the report will have no per-section timings.\n");
+}
+
+Benchmark::~Benchmark()
+{
+}
+
+void Benchmark::UpdateCamera(float totalTime, std::shared_ptr<Camera> camera)
+{
+	if (cameraPathLoaded)
+	{
+		DirectX::XMFLOAT3 position;
+		DirectX::XMFLOAT3 rotation;
+		cameraPath.Evaluate(totalTime, position, rotation);
+		camera->GetTransform()->SetPosition(position);
+		camera->GetTransform()->SetRotation(rotation);
+	}
+
+	camera->UpdateViewMatrix();
+}
+
+void Benchmark::RecordFrame(float cpuMilliseconds, unsigned int drawCalls, unsigned int triangles)
+{
+	if (IsFinished())
+		return;
+
+	BenchmarkFrame frame;
+	frame.Frame = (unsigned int)frames.size();
+	frame.CPUMilliseconds = cpuMilliseconds;
+	frame.DrawCalls = drawCalls;
+	frame.Triangles = triangles;
+	Profiler::GetInstance().GetLastFrameSections(frame.Sections);
+	frames.push_back(frame);
+}
+
+bool Benchmark::IsFinished()
+{
+	return frames.size() >= settings.FrameCount;
+}
+
+unsigned int Benchmark::GetRecordedFrameCount()
+{
+	return (unsigned int)frames.size();
+}
+
+bool Benchmark::HasCameraPath()
+{
+	return cameraPathLoaded;
+}
+
+// --------------------------------------------------------
+// Writes the settings, a summary (frame time percentiles)
+// and every recorded frame as JSON
+// --------------------------------------------------------
+bool Benchmark::WriteReport()
+{
+	std::ofstream file(settings.ReportFile);
+	if (!file.is_open())
+		return false;
+
+	FrameTimeStats stats;
+	for (auto& f : frames)
+		stats.AddFrame(f.CPUMilliseconds / 1000.0f);
+	FrameTimeSummary summary;
+	stats.Calculate(summary);
+
+	auto writeString = [&file](const std::string& str)
+	{
+		file << '"';
+		for (char c : str)
+		{
+			if (c == '"' || c == '\\') file << '\\';
+			file << c;
+		}
+		file << '"';
+	};
+
+	file << "{\n";
+	file << "  \"settings\": {\n";
+	file << "    \"cameraPath\": "; writeString(WideToNarrow(settings.CameraPathFile)); file << ",\n";
+	file << "    \"cameraPathLoaded\": " << (cameraPathLoaded ? "true" : "false") << ",\n";
+	file << "    \"frames\": " << settings.FrameCount << ",\n";
+	file << "    \"timestep\": " << settings.FixedTimestep << ",\n";
+	file << "    \"headless\": " << (settings.Headless ? "true" : "false") << ",\n";
+	file << "    \"warp\": " << (settings.UseWarp ? "true" : "false") << ",\n";
+	file << "    \"profilerEnabled\": " << (ProfilerEnabled ? "true" : "false") << "\n";
+	file << "  },\n";
+
+	file << "  \"summary\": {\n";
+	file << "    \"frames\": " << summary.FrameCount << ",\n";
+	file << "    \"averageMs\": " << summary.Average << ",\n";
+	file << "    \"p50Ms\": " << summary.P50 << ",\n";
+	file << "    \"p95Ms\": " << summary.P95 << ",\n";
+	file << "    \"p99Ms\": " << summary.P99 << ",\n";
+	file << "    \"maxMs\": " << summary.Max << "\n";
+	file << "  },\n";
+
+	file << "  \"frames\": [\n";
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		const BenchmarkFrame& f = frames[i];
+		file << "    { \"frame\": " << f.Frame
+			<< ", \"cpuMs\": " << f.CPUMilliseconds
+			<< ", \"drawCalls\": " << f.DrawCalls
+			<< ", \"triangles\": " << f.Triangles;
+
+		// Sections are left out entirely (not written empty) when
+		// they were compiled out - see settings.profilerEnabled
+		if (!ProfilerEnabled)
+		{
+			file << " }" << (i + 1 < frames.size() ? ",\n" : "\n");
+			continue;
+		}
+
+		file << ", \"sections\": {";
+		for (size_t s = 0; s < f.Sections.size(); s++)
+		{
+			file << (s > 0 ? ", " : " ");
+			writeString(f.Sections[s].Name);
+			file << ": " << f.Sections[s].Milliseconds;
+		}
+		file << (f.Sections.empty() ? "} }" : " } }") << (i + 1 < frames.size() ? ",\n" : "\n");
+	}
+	file << "  ]\n";
+	file << "}\n";
+
+	return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Camera.h"
+#include "CameraPath.h"
+#include "Profiler.h"
+
+// --------------------------------------------------------
+// Benchmark mode options, usually from the command line:
+//
+//   -benchmark [cameraPath.txt]   Turn on benchmark mode
+//   -frames N                     Frames to record (default 1000)
+//   -timestep seconds             Fixed delta time (default 1/60)
+//   -report file.json             Where to write the results
+//   -headless                     Never show the window
+//   -warp                         Use the WARP software rasterizer
+// --------------------------------------------------------
+struct BenchmarkSettings
+{
+	bool Enabled = false;
+	std::wstring CameraPathFile;
+	std::wstring ReportFile;
+	unsigned int FrameCount = 1000;
+	float FixedTimestep = 1.0f / 60.0f;
+	bool Headless = false;
+	bool UseWarp = false;
+
+	static BenchmarkSettings FromCommandLine(const char* commandLine);
+};
+
+// --------------------------------------------------------
+// Everything recorded for a single benchmark frame
+// --------------------------------------------------------
+struct BenchmarkFrame
+{
+	unsigned int Frame;
+	float CPUMilliseconds;	// Wall clock time of the whole frame
+	unsigned int DrawCalls;
+	unsigned int Triangles;
+	std::vector<ProfileSection> Sections;
+};
+
+// --------------------------------------------------------
+// Drives the camera along a scripted path and records
+// per-frame timings, then writes them out as JSON.
+//
+// The game supplies a fixed timestep (see DXCore), so two
+// runs of the same path see exactly the same frames.
+// --------------------------------------------------------
+class Benchmark
+{
+public:
+	Benchmark(const BenchmarkSettings& settings);
+	~Benchmark();
+
+	// Places the camera where the path says it should be
+	void UpdateCamera(float totalTime, std::shared_ptr<Camera> camera);
+
+	// Records the previous (fully finished) frame
+	void RecordFrame(float cpuMilliseconds, unsigned int drawCalls, unsigned int triangles);
+
+	bool IsFinished();
+	unsigned int GetRecordedFrameCount();
+	bool HasCameraPath();
+
+	bool WriteReport();
+
+private:
+	BenchmarkSettings settings;
+	CameraPath cameraPath;
+	bool cameraPathLoaded;
+	std::vector<BenchmarkFrame> frames;
+};
@@ -0,0 +1,37 @@
+struct VertexToPixel
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+Texture2D Pixels : register(t0);
+Texture2D Bloom : register(t1);
+SamplerState ClampSampler : register(s0);
+
+cbuffer ExternalData : register(b0)
+{
+    float2 bloomPixelSize;  // One texel of the (half size) bloom, in UVs
+    float bloomIntensity;
+}
+
+// --------------------------------------------------------
+// Adds the bloom pyramid's result back onto the image,
+// doing its last dual filter upsample on the way
+// --------------------------------------------------------
+float4 main(VertexToPixel input) : SV_TARGET
+{
+    float2 halfPixel = bloomPixelSize * 0.5f;
+    float3 bloom = 0;
+    bloom += Bloom.Sample(ClampSampler, input.uv + float2(-bloomPixelSize.x, 0.0f)).rgb;
+    bloom += Bloom.Sample(ClampSampler, input.uv + float2(bloomPixelSize.x, 0.0f)).rgb;
+    bloom += Bloom.Sample(ClampSampler, input.uv + float2(0.0f, -bloomPixelSize.y)).rgb;
+    bloom += Bloom.Sample(ClampSampler, input.uv + float2(0.0f, bloomPixelSize.y)).rgb;
+    bloom += Bloom.Sample(ClampSampler, input.uv + float2(-halfPixel.x, -halfPixel.y)).rgb * 2.0f;
+    bloom += Bloom.Sample(ClampSampler, input.uv + float2(halfPixel.x, -halfPixel.y)).rgb * 2.0f;
+    bloom += Bloom.Sample(ClampSampler, input.uv + float2(-halfPixel.x, halfPixel.y)).rgb * 2.0f;
+    bloom += Bloom.Sample(ClampSampler, input.uv + float2(halfPixel.x, halfPixel.y)).rgb * 2.0f;
+    bloom /= 12.0f;
+    
+    float4 color = Pixels.Sample(ClampSampler, input.uv);
+    return float4(color.rgb + bloom * bloomIntensity, color.a);
+}
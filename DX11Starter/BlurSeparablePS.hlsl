@@ -0,0 +1,28 @@
+struct VertexToPixel
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+Texture2D Pixels : register(t0);
+SamplerState ClampSampler : register(s0);
+
+cbuffer ExternalData : register(b0)
+{
+    int blurRadius;
+    float2 pixelStep;   // One texel along the blur direction, in UVs
+}
+
+// --------------------------------------------------------
+// One direction of a box blur - running it horizontally and
+// then vertically gives the same result as the full 2D box
+// in 2(2r+1) samples instead of (2r+1)^2
+// --------------------------------------------------------
+float4 main(VertexToPixel input) : SV_TARGET
+{
+    float4 total = 0;
+    for (int i = -blurRadius; i <= blurRadius; i++)
+        total += Pixels.Sample(ClampSampler, input.uv + i * pixelStep);
+    
+    return total / (2 * blurRadius + 1);
+}
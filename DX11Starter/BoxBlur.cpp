@@ -0,0 +1,196 @@
+#include "BoxBlur.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <xmmintrin.h>
+
+static void Resize(BlurImage& image, unsigned int width, unsigned int height)
+{
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height * 4);
+}
+
+static int Clamp(int value, int last)
+{
+	return std::max(0, std::min(value, last));
+}
+
+void BoxBlurBruteForce(const BlurImage& source, BlurImage& result, int radius)
+{
+	Resize(result, source.Width, source.Height);
+	int width = (int)source.Width;
+	int height = (int)source.Height;
+	__m128 scale = _mm_set1_ps(1.0f / ((2 * radius + 1) * (2 * radius + 1)));
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			__m128 total = _mm_setzero_ps();
+			for (int dy = -radius; dy <= radius; dy++)
+			{
+				const float* row = &source.Pixels[(size_t)Clamp(y + dy, height - 1) * width * 4];
+				for (int dx = -radius; dx <= radius; dx++)
+					total = _mm_add_ps(total, _mm_loadu_ps(row + Clamp(x + dx, width - 1) * 4));
+			}
+			_mm_storeu_ps(&result.Pixels[((size_t)y * width + x) * 4], _mm_mul_ps(total, scale));
+		}
+	}
+}
+
+// --------------------------------------------------------
+// The vertical pass walks whole rows at a time (adding each
+// source row into a row of totals) so it stays cache friendly
+// --------------------------------------------------------
+void BoxBlurSeparable(const BlurImage& source, BlurImage& result, int radius)
+{
+	Resize(result, source.Width, source.Height);
+	int width = (int)source.Width;
+	int height = (int)source.Height;
+	__m128 scale = _mm_set1_ps(1.0f / (2 * radius + 1));
+
+	// Horizontal
+	BlurImage rows;
+	Resize(rows, source.Width, source.Height);
+	for (int y = 0; y < height; y++)
+	{
+		const float* row = &source.Pixels[(size_t)y * width * 4];
+		float* out = &rows.Pixels[(size_t)y * width * 4];
+		for (int x = 0; x < width; x++)
+		{
+			__m128 total = _mm_setzero_ps();
+			for (int dx = -radius; dx <= radius; dx++)
+				total = _mm_add_ps(total, _mm_loadu_ps(row + Clamp(x + dx, width - 1) * 4));
+			_mm_storeu_ps(out + x * 4, _mm_mul_ps(total, scale));
+		}
+	}
+
+	// Vertical
+	std::vector<float> totals((size_t)width * 4);
+	for (int y = 0; y < height; y++)
+	{
+		std::fill(totals.begin(), totals.end(), 0.0f);
+		for (int dy = -radius; dy <= radius; dy++)
+		{
+			const float* row = &rows.Pixels[(size_t)Clamp(y + dy, height - 1) * width * 4];
+			for (int x = 0; x < width * 4; x += 4)
+				_mm_storeu_ps(&totals[x], _mm_add_ps(_mm_loadu_ps(&totals[x]), _mm_loadu_ps(row + x)));
+		}
+
+		float* out = &result.Pixels[(size_t)y * width * 4];
+		for (int x = 0; x < width * 4; x += 4)
+			_mm_storeu_ps(out + x, _mm_mul_ps(_mm_loadu_ps(&totals[x]), scale));
+	}
+}
+
+// --------------------------------------------------------
+// Running sums - along each row, then down all the columns
+// at once (one running total per column)
+// --------------------------------------------------------
+void BoxBlurSlidingWindow(const BlurImage& source, BlurImage& result, int radius)
+{
+	Resize(result, source.Width, source.Height);
+	int width = (int)source.Width;
+	int height = (int)source.Height;
+	__m128 scale = _mm_set1_ps(1.0f / (2 * radius + 1));
+
+	// Horizontal
+	BlurImage rows;
+	Resize(rows, source.Width, source.Height);
+	for (int y = 0; y < height; y++)
+	{
+		const float* row = &source.Pixels[(size_t)y * width * 4];
+		float* out = &rows.Pixels[(size_t)y * width * 4];
+
+		__m128 total = _mm_setzero_ps();
+		for (int dx = -radius; dx <= radius; dx++)
+			total = _mm_add_ps(total, _mm_loadu_ps(row + Clamp(dx, width - 1) * 4));
+
+		for (int x = 0; x < width; x++)
+		{
+			_mm_storeu_ps(out + x * 4, _mm_mul_ps(total, scale));
+			total = _mm_add_ps(total, _mm_loadu_ps(row + std::min(x + radius + 1, width - 1) * 4));
+			total = _mm_sub_ps(total, _mm_loadu_ps(row + std::max(x - radius, 0) * 4));
+		}
+	}
+
+	// Vertical
+	std::vector<float> totals((size_t)width * 4, 0.0f);
+	for (int dy = -radius; dy <= radius; dy++)
+	{
+		const float* row = &rows.Pixels[(size_t)Clamp(dy, height - 1) * width * 4];
+		for (int x = 0; x < width * 4; x += 4)
+			_mm_storeu_ps(&totals[x], _mm_add_ps(_mm_loadu_ps(&totals[x]), _mm_loadu_ps(row + x)));
+	}
+	for (int y = 0; y < height; y++)
+	{
+		float* out = &result.Pixels[(size_t)y * width * 4];
+		const float* entering = &rows.Pixels[(size_t)std::min(y + radius + 1, height - 1) * width * 4];
+		const float* leaving = &rows.Pixels[(size_t)std::max(y - radius, 0) * width * 4];
+		for (int x = 0; x < width * 4; x += 4)
+		{
+			__m128 total = _mm_loadu_ps(&totals[x]);
+			_mm_storeu_ps(out + x, _mm_mul_ps(total, scale));
+			total = _mm_add_ps(total, _mm_loadu_ps(entering + x));
+			_mm_storeu_ps(&totals[x], _mm_sub_ps(total, _mm_loadu_ps(leaving + x)));
+		}
+	}
+}
+
+float GetMaxDifference(const BlurImage& a, const BlurImage& b)
+{
+	if (a.Width != b.Width || a.Height != b.Height)
+		return INFINITY;
+
+	float maxDifference = 0.0f;
+	for (size_t i = 0; i < a.Pixels.size(); i++)
+		maxDifference = std::max(maxDifference, fabsf(a.Pixels[i] - b.Pixels[i]));
+	return maxDifference;
+}
+
+// --------------------------------------------------------
+// The test image has hard edges (checkers) and noise, so
+// any mistake at the borders or in the window shows up
+// --------------------------------------------------------
+BoxBlurBenchmarkResults RunBoxBlurBenchmark(unsigned int width, unsigned int height, int radius)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	BoxBlurBenchmarkResults results = {};
+	results.Width = width;
+	results.Height = height;
+	results.Radius = radius;
+
+	BlurImage source;
+	Resize(source, width, height);
+	unsigned int seed = 12345;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			float checker = ((x / 16 + y / 16) & 1) ? 1.0f : 0.0f;
+			float* pixel = &source.Pixels[((size_t)y * width + x) * 4];
+			for (int c = 0; c < 4; c++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				pixel[c] = checker * 0.75f + (seed >> 8) / 16777216.0f * 0.25f;
+			}
+		}
+	}
+
+	BlurImage bruteForce, separable, slidingWindow;
+	Clock::time_point start = Clock::now();
+	BoxBlurBruteForce(source, bruteForce, radius);
+	Clock::time_point bruteForceEnd = Clock::now();
+	BoxBlurSeparable(source, separable, radius);
+	Clock::time_point separableEnd = Clock::now();
+	BoxBlurSlidingWindow(source, slidingWindow, radius);
+	Clock::time_point slidingWindowEnd = Clock::now();
+
+	results.BruteForceMs = std::chrono::duration<double, std::milli>(bruteForceEnd - start).count();
+	results.SeparableMs = std::chrono::duration<double, std::milli>(separableEnd - bruteForceEnd).count();
+	results.SlidingWindowMs = std::chrono::duration<double, std::milli>(slidingWindowEnd - separableEnd).count();
+	results.SeparableMaxError = GetMaxDifference(bruteForce, separable);
+	results.SlidingWindowMaxError = GetMaxDifference(bruteForce, slidingWindow);
+	return results;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// A plain RGBA float image, rows top to bottom
+// --------------------------------------------------------
+struct BlurImage
+{
+	unsigned int Width;
+	unsigned int Height;
+	std::vector<float> Pixels;	// 4 floats per pixel
+};
+
+// --------------------------------------------------------
+// Results of RunBoxBlurBenchmark()
+// --------------------------------------------------------
+struct BoxBlurBenchmarkResults
+{
+	unsigned int Width;
+	unsigned int Height;
+	int Radius;
+	double BruteForceMs;
+	double SeparableMs;
+	double SlidingWindowMs;
+	float SeparableMaxError;		// Largest channel difference from the brute force result
+	float SlidingWindowMaxError;
+};
+
+// --------------------------------------------------------
+// CPU versions of the post process box blurs, one per GPU
+// variant, with edges repeated like a clamp sampler:
+//
+//  - Brute force: the full (2r+1)^2 box per pixel, as in
+//    BlurPixelShader.hlsl - the "golden" result
+//  - Separable: a horizontal then a vertical (2r+1) pass,
+//    as in BlurSeparablePS.hlsl
+//  - Sliding window: running sums along rows and then
+//    columns, as in BoxBlurCS.hlsl - cost doesn't depend
+//    on the radius at all
+//
+// Each pixel's 4 channels are one SSE vector.  No graphics
+// API involved, so all of these run (and can be compared)
+// on any machine.
+// --------------------------------------------------------
+void BoxBlurBruteForce(const BlurImage& source, BlurImage& result, int radius);
+void BoxBlurSeparable(const BlurImage& source, BlurImage& result, int radius);
+void BoxBlurSlidingWindow(const BlurImage& source, BlurImage& result, int radius);
+
+// Largest difference between any two matching channels
+float GetMaxDifference(const BlurImage& a, const BlurImage& b);
+
+// Times each variant on a generated image and checks the fast
+// ones against brute force
+BoxBlurBenchmarkResults RunBoxBlurBenchmark(unsigned int width, unsigned int height, int radius);
@@ -0,0 +1,41 @@
+Texture2D Pixels : register(t0);
+RWTexture2D<float4> Output : register(u0);
+
+cbuffer ExternalData : register(b0)
+{
+    int blurRadius;
+    int lineCount;      // Rows (horizontal pass) or columns (vertical pass)
+    int lineLength;     // Pixels along each one
+    int2 direction;     // (1, 0) for horizontal, (0, 1) for vertical
+}
+
+// --------------------------------------------------------
+// One direction of a box blur as a sliding window: each
+// thread walks a whole row (or column), adding the pixel
+// entering the window and subtracting the one leaving it,
+// so the cost per pixel doesn't depend on the radius.
+// Edges repeat, like a clamp sampler.
+// --------------------------------------------------------
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    int index = (int)id.x;
+    if (index >= lineCount)
+        return;
+    
+    int2 start = direction.x ? int2(0, index) : int2(index, 0);
+    int last = lineLength - 1;
+    
+    // First window, centered on pixel 0
+    float4 total = 0;
+    for (int i = -blurRadius; i <= blurRadius; i++)
+        total += Pixels[start + direction * clamp(i, 0, last)];
+    
+    float scale = 1.0f / (2 * blurRadius + 1);
+    for (int x = 0; x < lineLength; x++)
+    {
+        Output[start + direction * x] = total * scale;
+        total += Pixels[start + direction * min(x + blurRadius + 1, last)];
+        total -= Pixels[start + direction * max(x - blurRadius, 0)];
+    }
+}
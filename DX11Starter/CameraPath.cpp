@@ -0,0 +1,94 @@
+#include "CameraPath.h"
+#include <fstream>
+#include <sstream>
+
+using namespace DirectX;
+
+CameraPath::CameraPath()
+{
+}
+
+CameraPath::~CameraPath()
+{
+}
+
+// --------------------------------------------------------
+// Reads keys from a text file.  Blank lines and lines
+// starting with # are skipped.  Keys must be in time order.
+// --------------------------------------------------------
+bool CameraPath::LoadFromFile(const std::wstring& path)
+{
+	keys.clear();
+
+	std::ifstream file(path);
+	if (!file.is_open())
+		return false;
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream values(line);
+		Key key = {};
+		if (!(values >> key.Time >> key.Position.x >> key.Position.y >> key.Position.z >> key.Rotation.x >> key.Rotation.y))
+			continue;
+
+		if (!keys.empty() && key.Time <= keys.back().Time)
+			continue;
+
+		keys.push_back(key);
+	}
+
+	return !keys.empty();
+}
+
+void CameraPath::Evaluate(float time, XMFLOAT3& position, XMFLOAT3& rotation)
+{
+	if (keys.empty())
+		return;
+
+	// Before the first or after the last key?
+	if (keys.size() == 1 || time <= keys.front().Time)
+	{
+		position = keys.front().Position;
+		rotation = keys.front().Rotation;
+		return;
+	}
+	if (time >= keys.back().Time)
+	{
+		position = keys.back().Position;
+		rotation = keys.back().Rotation;
+		return;
+	}
+
+	// Find the segment [i, i+1] containing this time
+	size_t i = 0;
+	while (time > keys[i + 1].Time)
+		i++;
+
+	// Neighbors for the spline, repeating the end keys
+	const Key& k0 = keys[i > 0 ? i - 1 : i];
+	const Key& k1 = keys[i];
+	const Key& k2 = keys[i + 1];
+	const Key& k3 = keys[i + 2 < keys.size() ? i + 2 : i + 1];
+	float t = (time - k1.Time) / (k2.Time - k1.Time);
+
+	XMStoreFloat3(&position, XMVectorCatmullRom(
+		XMLoadFloat3(&k0.Position), XMLoadFloat3(&k1.Position),
+		XMLoadFloat3(&k2.Position), XMLoadFloat3(&k3.Position), t));
+	XMStoreFloat3(&rotation, XMVectorCatmullRom(
+		XMLoadFloat3(&k0.Rotation), XMLoadFloat3(&k1.Rotation),
+		XMLoadFloat3(&k2.Rotation), XMLoadFloat3(&k3.Rotation), t));
+}
+
+float CameraPath::GetDuration()
+{
+	return keys.empty() ? 0.0f : keys.back().Time;
+}
+
+unsigned int CameraPath::GetKeyCount()
+{
+	return (unsigned int)keys.size();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// A camera fly-through, loaded from a text file with one
+// key per line:
+//
+//   # time  x  y  z  pitch  yaw
+//   0.0   0.0  0.5  -4.0   0.0  0.0
+//   2.5   3.0  1.0  -2.0   0.1  -0.8
+//
+// Positions and angles are interpolated with a Catmull-Rom
+// spline through the keys, so the path is smooth and the
+// same time always gives the same camera.
+// --------------------------------------------------------
+class CameraPath
+{
+public:
+	CameraPath();
+	~CameraPath();
+
+	bool LoadFromFile(const std::wstring& path);
+
+	// Camera position & pitch/yaw/roll at the given time
+	// (clamped to the first and last keys)
+	void Evaluate(float time, DirectX::XMFLOAT3& position, DirectX::XMFLOAT3& rotation);
+
+	float GetDuration();
+	unsigned int GetKeyCount();
+
+private:
+	struct Key
+	{
+		float Time;
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT3 Rotation;
+	};
+	std::vector<Key> keys;
+};
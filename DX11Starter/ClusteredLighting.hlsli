@@ -0,0 +1,101 @@
+#ifndef __GGP_CLUSTERED_LIGHTING__
+#define __GGP_CLUSTERED_LIGHTING__
+
+#include "ShaderIncludes.hlsli"
+#include "Shadows.hlsli"
+
+// Froxel grid info for this frame (see LightClusters.h)
+cbuffer ClusterData : register(b1)
+{
+    float4 clusterDepthPlane;   // dot(float4(worldPos, 1), plane) = view depth
+    float2 screenSize;
+    float clusterNear;          // Where the exponential slices start
+    float clusterDepthScale;    // (slices - 1) / log(far / clusterNear)
+    uint3 clusterCounts;
+    int useObjectLights;        // Per-object lists instead of clusters?
+}
+
+// This object's strongest lights (see LightGrid.h), packed
+// four to a register - at most MAX_OBJECT_LIGHTS (8)
+cbuffer ObjectLightData : register(b2)
+{
+    uint4 objectLightIndices[2];
+    int objectLightCount;
+}
+
+// All of the frame's lights (used by both the clusters and
+// the per-object lists), each cluster's range in the index
+// list, and the index list itself
+StructuredBuffer<Light> ClusterLights;
+StructuredBuffer<uint2> ClusterRanges;
+StructuredBuffer<uint> ClusterLightIndices;
+
+// Finds the cluster a pixel falls in - must match LightClusters::GetSlice()
+uint GetClusterIndex(float2 pixel, float3 worldPos)
+{
+    float depth = dot(float4(worldPos, 1.0f), clusterDepthPlane);
+    uint slice = 0;
+    if (depth >= clusterNear)
+        slice = min(clusterCounts.z - 1, 1 + (uint)(log(depth / clusterNear) * clusterDepthScale));
+    
+    uint2 tile = min(clusterCounts.xy - 1, (uint2)(pixel / screenSize * clusterCounts.xy));
+    return tile.x + tile.y * clusterCounts.x + slice * clusterCounts.x * clusterCounts.y;
+}
+
+// One point or spot light, shadowed if it has a tile in the shadow atlas
+float3 ShadowedLocalLight(Light light, float3 normal, float3 viewVector, float roughness, float3 surfaceColor, float3 specularColor, float3 worldPos, float metalness)
+{
+    float3 result;
+    int shadowIndex = light.ShadowIndex;
+    if (light.Type == LIGHT_TYPE_SPOT)
+    {
+        result = SpotLight(normal, light, viewVector, roughness, surfaceColor, specularColor, worldPos, metalness);
+    }
+    else
+    {
+        result = PointLight(normal, light, viewVector, roughness, surfaceColor, specularColor, worldPos, metalness);
+        
+        // Point lights have six infos in a row, one per cube face
+        if (shadowIndex >= 0)
+            shadowIndex += GetCubeFace(worldPos - light.Position);
+    }
+    
+    return result * ShadowAmount(shadowIndex, worldPos);
+}
+
+// Total point & spot lighting from just the lights in this pixel's cluster
+float3 ClusteredLights(float2 pixel, float3 normal, float3 viewVector, float roughness, float3 surfaceColor, float3 specularColor, float3 worldPos, float metalness)
+{
+    uint2 range = ClusterRanges[GetClusterIndex(pixel, worldPos)];
+    
+    float3 total = float3(0.0f, 0.0f, 0.0f);
+    for (uint i = 0; i < range.y; i++)
+    {
+        Light light = ClusterLights[ClusterLightIndices[range.x + i]];
+        total += ShadowedLocalLight(light, normal, viewVector, roughness, surfaceColor, specularColor, worldPos, metalness);
+    }
+    return total;
+}
+
+// Total point & spot lighting from this object's own light list
+float3 ObjectLights(float3 normal, float3 viewVector, float roughness, float3 surfaceColor, float3 specularColor, float3 worldPos, float metalness)
+{
+    float3 total = float3(0.0f, 0.0f, 0.0f);
+    for (int i = 0; i < objectLightCount; i++)
+    {
+        Light light = ClusterLights[objectLightIndices[i / 4][i % 4]];
+        total += ShadowedLocalLight(light, normal, viewVector, roughness, surfaceColor, specularColor, worldPos, metalness);
+    }
+    return total;
+}
+
+// Point & spot lighting from whichever light assignment is active
+float3 LocalLights(float2 pixel, float3 normal, float3 viewVector, float roughness, float3 surfaceColor, float3 specularColor, float3 worldPos, float metalness)
+{
+    if (useObjectLights)
+        return ObjectLights(normal, viewVector, roughness, surfaceColor, specularColor, worldPos, metalness);
+    
+    return ClusteredLights(pixel, normal, viewVector, roughness, surfaceColor, specularColor, worldPos, metalness);
+}
+
+#endif
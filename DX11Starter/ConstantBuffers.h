@@ -0,0 +1,136 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+
+#include "Lights.h"
+#include "ShaderReflection.h"
+#include "SphericalHarmonics.h"
+
+// --------------------------------------------------------
+// C++ mirrors of the HLSL constant buffers, for copying a
+// whole buffer at once with ISimpleShader::SetBuffer().
+//
+// HLSL packs cbuffers in 16 byte registers: a field that
+// would cross into the next register starts on it instead,
+// and arrays, structs & matrices always start on one.  C++
+// doesn't, so the structs below have explicit padding - and
+// every field is checked against where HLSL would put it,
+// so a missing (or extra) pad is a build error instead of
+// garbage on screen.  Keep these in sync with the shaders.
+//
+// The asserts only know the packing rules, not the shaders,
+// so each struct also lists the variable every field should
+// be - ISimpleShader::CheckBuffer() compares those with the
+// reflected offsets when the shader's loaded.
+// --------------------------------------------------------
+
+// Where HLSL puts a field of the given size that follows
+// one ending at previousEnd
+constexpr size_t HLSLPackOffset(size_t previousEnd, size_t size, bool startsRegister)
+{
+	return (startsRegister || previousEnd / 16 != (previousEnd + size - 1) / 16)
+		? (previousEnd + 15) / 16 * 16
+		: previousEnd;
+}
+
+#define CBUFFER_FIRST(type, field) \
+	static_assert(offsetof(type, field) == 0, #type "::" #field " should be the first field")
+#define CBUFFER_FIELD(type, field, previous, startsRegister) \
+	static_assert(offsetof(type, field) == HLSLPackOffset(offsetof(type, previous) + sizeof(type::previous), sizeof(type::field), startsRegister), \
+		#type "::" #field " isn't where HLSL packing puts it")
+#define CBUFFER_SIZE(type, last) \
+	static_assert(sizeof(type) == (offsetof(type, last) + sizeof(type::last) + 15) / 16 * 16, \
+		#type " isn't a whole number of registers")
+#define CBUFFER_VARIABLE(type, field, variable) \
+	{ #type "::" #field, variable, (unsigned int)offsetof(type, field), (unsigned int)sizeof(type::field) }
+
+// Light (Lights.h) is an array element in the pixel shaders'
+// cbuffers and a structured buffer element for the clusters
+CBUFFER_FIRST(Light, Type);
+CBUFFER_FIELD(Light, Direction, Type, false);
+CBUFFER_FIELD(Light, Range, Direction, false);
+CBUFFER_FIELD(Light, Position, Range, false);
+CBUFFER_FIELD(Light, Intensity, Position, false);
+CBUFFER_FIELD(Light, Color, Intensity, false);
+CBUFFER_FIELD(Light, SpotFalloff, Color, false);
+CBUFFER_FIELD(Light, ShadowIndex, SpotFalloff, false);
+CBUFFER_FIELD(Light, Padding, ShadowIndex, false);
+CBUFFER_SIZE(Light, Padding);
+
+// --------------------------------------------------------
+// ExternalData in VertexShader.hlsl & VertexShader_NormalMap.hlsl
+// --------------------------------------------------------
+struct VertexShaderData
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 View;
+	DirectX::XMFLOAT4X4 Projection;
+	DirectX::XMFLOAT4X4 WorldInvTranspose;
+};
+
+CBUFFER_FIRST(VertexShaderData, World);
+CBUFFER_FIELD(VertexShaderData, View, World, true);
+CBUFFER_FIELD(VertexShaderData, Projection, View, true);
+CBUFFER_FIELD(VertexShaderData, WorldInvTranspose, Projection, true);
+CBUFFER_SIZE(VertexShaderData, WorldInvTranspose);
+
+static const ShaderBufferField VertexShaderDataFields[] =
+{
+	CBUFFER_VARIABLE(VertexShaderData, World, "world"),
+	CBUFFER_VARIABLE(VertexShaderData, View, "view"),
+	CBUFFER_VARIABLE(VertexShaderData, Projection, "projection"),
+	CBUFFER_VARIABLE(VertexShaderData, WorldInvTranspose, "worldInvTranspose"),
+};
+
+// --------------------------------------------------------
+// ExternalData in PixelShader.hlsl (and every variant of it)
+// --------------------------------------------------------
+struct PBRPixelShaderData
+{
+	DirectX::XMFLOAT4 ColorTint;
+	float Roughness;
+	DirectX::XMFLOAT3 CameraPosition;
+	AmbientSH Ambient;
+	float NumLights;
+	DirectX::XMFLOAT2 UVOffset;
+	float Padding0;
+	DirectX::XMFLOAT2 UVScale;
+	DirectX::XMFLOAT2 Padding1;
+	Light Lights[MAX_LIGHTS];
+	DirectX::XMFLOAT3 FogColor;
+	float StartFog;
+	float FullFog;
+	int Fog;
+	DirectX::XMFLOAT2 Padding2;
+};
+
+CBUFFER_FIRST(PBRPixelShaderData, ColorTint);
+CBUFFER_FIELD(PBRPixelShaderData, Roughness, ColorTint, false);
+CBUFFER_FIELD(PBRPixelShaderData, CameraPosition, Roughness, false);
+CBUFFER_FIELD(PBRPixelShaderData, Ambient, CameraPosition, true);
+CBUFFER_FIELD(PBRPixelShaderData, NumLights, Ambient, false);
+CBUFFER_FIELD(PBRPixelShaderData, UVOffset, NumLights, false);
+CBUFFER_FIELD(PBRPixelShaderData, UVScale, UVOffset, false);
+CBUFFER_FIELD(PBRPixelShaderData, Lights, UVScale, true);
+CBUFFER_FIELD(PBRPixelShaderData, FogColor, Lights, false);
+CBUFFER_FIELD(PBRPixelShaderData, StartFog, FogColor, false);
+CBUFFER_FIELD(PBRPixelShaderData, FullFog, StartFog, false);
+CBUFFER_FIELD(PBRPixelShaderData, Fog, FullFog, false);
+CBUFFER_SIZE(PBRPixelShaderData, Fog);
+
+static const ShaderBufferField PBRPixelShaderDataFields[] =
+{
+	CBUFFER_VARIABLE(PBRPixelShaderData, ColorTint, "colorTint"),
+	CBUFFER_VARIABLE(PBRPixelShaderData, Roughness, "roughness"),
+	CBUFFER_VARIABLE(PBRPixelShaderData, CameraPosition, "cameraPosition"),
+	CBUFFER_VARIABLE(PBRPixelShaderData, Ambient, "ambientSH"),
+	CBUFFER_VARIABLE(PBRPixelShaderData, NumLights, "numLights"),
+	CBUFFER_VARIABLE(PBRPixelShaderData, UVOffset, "uvOffset"),
+	CBUFFER_VARIABLE(PBRPixelShaderData, UVScale, "uvScale"),
+	CBUFFER_VARIABLE(PBRPixelShaderData, Lights, "lights"),
+	CBUFFER_VARIABLE(PBRPixelShaderData, FogColor, "fogColor"),
+	CBUFFER_VARIABLE(PBRPixelShaderData, StartFog, "startFog"),
+	CBUFFER_VARIABLE(PBRPixelShaderData, FullFog, "fullFog"),
+	CBUFFER_VARIABLE(PBRPixelShaderData, Fog, "fog"),
+};
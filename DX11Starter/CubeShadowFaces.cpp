@@ -0,0 +1,99 @@
+#include "CubeShadowFaces.h"
+#include <cmath>
+
+using namespace DirectX;
+
+static const float InvSqrt2 = 0.70710678f;
+
+unsigned int GetCubeFace(const XMFLOAT3& direction)
+{
+	float x = fabsf(direction.x);
+	float y = fabsf(direction.y);
+	float z = fabsf(direction.z);
+	if (x >= y && x >= z)
+		return direction.x >= 0.0f ? 0 : 1;
+	if (y >= z)
+		return direction.y >= 0.0f ? 2 : 3;
+	return direction.z >= 0.0f ? 4 : 5;
+}
+
+void GetCubeFaceBasis(unsigned int face, XMFLOAT3& forward, XMFLOAT3& up)
+{
+	float sign = (face & 1) ? -1.0f : 1.0f;
+	forward = XMFLOAT3(0, 0, 0);
+	up = XMFLOAT3(0, 1, 0);
+	switch (face / 2)
+	{
+	case 0: forward.x = sign; break;
+	case 1: forward.y = sign; up = XMFLOAT3(0, 0, -sign); break;
+	default: forward.z = sign; break;
+	}
+}
+
+// --------------------------------------------------------
+// A face's frustum is the set of points leaning along its
+// axis more than either other axis, so each face is four
+// planes through the light at 45 degrees.  A sphere reaches
+// the face if it isn't entirely behind any of them - which
+// can let in a few spheres just off the frustum's corners,
+// but never misses one.
+// --------------------------------------------------------
+unsigned int GetCubeFaceMask(const XMFLOAT3& lightPosition, float range, const BoundingSphere& sphere)
+{
+	float c[3] = {
+		sphere.Center.x - lightPosition.x,
+		sphere.Center.y - lightPosition.y,
+		sphere.Center.z - lightPosition.z };
+	float r = sphere.Radius;
+
+	// Out of range, or right on top of the light?
+	float distance = sqrtf(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+	if (distance - r >= range)
+		return 0;
+	if (distance <= r)
+		return CUBE_FACES_ALL;
+
+	unsigned int mask = 0;
+	for (unsigned int axis = 0; axis < 3; axis++)
+	{
+		float a = c[(axis + 1) % 3];
+		float b = c[(axis + 2) % 3];
+		for (unsigned int side = 0; side < 2; side++)
+		{
+			float u = side == 0 ? c[axis] : -c[axis];
+			if ((u - a) * InvSqrt2 >= -r && (u + a) * InvSqrt2 >= -r &&
+				(u - b) * InvSqrt2 >= -r && (u + b) * InvSqrt2 >= -r)
+				mask |= 1u << (axis * 2 + side);
+		}
+	}
+	return mask;
+}
+
+void CullCubeFaces(
+	const XMFLOAT3& lightPosition,
+	float range,
+	const std::vector<BoundingSphere>& casterBounds,
+	const std::vector<unsigned char>& casterDynamic,
+	CubeFaceCasters& result)
+{
+	result.Mask = 0;
+	result.DynamicMask = 0;
+	for (unsigned int f = 0; f < CUBE_FACE_COUNT; f++)
+		result.Casters[f].clear();
+
+	for (size_t i = 0; i < casterBounds.size(); i++)
+	{
+		unsigned int mask = GetCubeFaceMask(lightPosition, range, casterBounds[i]);
+		if (mask == 0)
+			continue;
+
+		result.Mask |= mask;
+		if (casterDynamic[i])
+			result.DynamicMask |= mask;
+		for (unsigned int f = 0; f < CUBE_FACE_COUNT; f++)
+		{
+			if (mask & (1u << f))
+				result.Casters[f].push_back((unsigned int)i);
+		}
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+
+// Faces of a point light's shadow "cube", each looking down
+// one axis: +X, -X, +Y, -Y, +Z, -Z
+#define CUBE_FACE_COUNT		6
+#define CUBE_FACES_ALL		0x3F
+
+// --------------------------------------------------------
+// Which casters each face of one point light can see
+// --------------------------------------------------------
+struct CubeFaceCasters
+{
+	unsigned int Mask;		// Bit per face with at least one caster
+	unsigned int DynamicMask;	// Bit per face with at least one moving caster
+	std::vector<unsigned int> Casters[CUBE_FACE_COUNT];	// Indices into the caster list
+};
+
+// --------------------------------------------------------
+// CPU side of point light shadows - picking faces, their
+// matrices, and which casters land in each.  A face is a
+// 90 degree frustum out to the light's range, so a caster
+// only needs drawing into the faces it actually overlaps
+// (usually one or two), and faces with no casters at all
+// don't need a shadow map.
+// --------------------------------------------------------
+// The face a direction from the light falls in - the axis it
+// leans along most (must match GetCubeFace() in Shadows.hlsli)
+unsigned int GetCubeFace(const DirectX::XMFLOAT3& direction);
+
+// Look & up directions for a face's view matrix
+void GetCubeFaceBasis(unsigned int face, DirectX::XMFLOAT3& forward, DirectX::XMFLOAT3& up);
+
+// Bit per face whose frustum (within range of the light) the sphere reaches
+unsigned int GetCubeFaceMask(const DirectX::XMFLOAT3& lightPosition, float range, const DirectX::BoundingSphere& sphere);
+
+// Sorts the casters into the faces they reach
+void CullCubeFaces(
+	const DirectX::XMFLOAT3& lightPosition,
+	float range,
+	const std::vector<DirectX::BoundingSphere>& casterBounds,
+	const std::vector<unsigned char>& casterDynamic,
+	CubeFaceCasters& result);
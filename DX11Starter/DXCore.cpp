@@ -1,5 +1,6 @@
 #include "DXCore.h"
 #include "Input.h"
+#include "Profiler.h"
 
 #include <dxgi1_5.h>
 #include <WindowsX.h>
@@ -58,7 +59,12 @@ DXCore::DXCore(
 	deltaTime(0),
 	startTime(0),
 	totalTime(0),
-	hWnd(0)
+	hWnd(0),
+	threadedSimulation(false),
+	headless(false),
+	useWarp(false),
+	fixedTimestep(0.0f),
+	fixedFrameCount(0)
 {
 	// Save a static reference to this object.
 	//  - Since the OS-level message function must be a non-member (global) function, 
@@ -82,6 +88,9 @@ DXCore::~DXCore()
 	// - If we weren't using smart pointers, we'd need to call
 	//   Release() on each Direct3D object created in DXCore
 
+	// Make sure the simulation thread isn't still running
+	simulation.Stop();
+
 	// Delete input manager singleton
 	delete& Input::GetInstance();
 }
@@ -157,7 +166,8 @@ HRESULT DXCore::InitWindow()
 
 	// The window exists but is not visible yet
 	// We need to tell Windows to show it, and how to show it
-	ShowWindow(hWnd, SW_SHOW);
+	// (unless we're running headless, where it stays hidden)
+	ShowWindow(hWnd, headless ? SW_HIDE : SW_SHOW);
 
 	// Initialize the input manager now that we definitely have a window
 	Input::GetInstance().Initialize(hWnd);
@@ -226,7 +236,7 @@ HRESULT DXCore::InitDirect3D()
 	// Attempt to initialize Direct3D
 	hr = D3D11CreateDeviceAndSwapChain(
 		0,							// Video adapter (physical GPU) to use, or null for default
-		D3D_DRIVER_TYPE_HARDWARE,	// We want to use the hardware (GPU)
+		useWarp ? D3D_DRIVER_TYPE_WARP : D3D_DRIVER_TYPE_HARDWARE,	// We want to use the hardware (GPU), unless asked not to
 		0,							// Used when doing software rendering
 		deviceFlags,				// Any special options
 		0,							// Optional array of possible verisons we want as fallbacks
@@ -411,9 +421,17 @@ HRESULT DXCore::Run()
 	currentTime = now;
 	previousTime = now;
 
+	// Name this thread for the profiler before
+	// any other thread can start using it
+	PROFILE_THREAD("Main");
+
 	// Give subclass a chance to initialize
 	Init();
 
+	// Start the simulation thread, which sleeps until
+	// it's handed a frame (see SimulationThread::Kick())
+	simulation.Start([this](float dt, float tt) { Update(dt, tt); });
+
 	// Our overall game and message loop
 	MSG msg = {};
 	while (msg.message != WM_QUIT)
@@ -428,6 +446,8 @@ HRESULT DXCore::Run()
 		}
 		else
 		{
+			PROFILE_FRAME();
+
 			// Update timer and title bar (if necessary)
 			UpdateTimer();
 			if(titleBarStats)
@@ -436,9 +456,25 @@ HRESULT DXCore::Run()
 			// Update the input manager
 			Input::GetInstance().Update();
 
+			// Main-thread-only work (UI) happens before the
+			// simulation, so the two never touch state at once
+			UpdateUI(deltaTime, totalTime);
+
 			// The game loop
-			Update(deltaTime, totalTime);
-			Draw(deltaTime, totalTime);
+			if (threadedSimulation)
+			{
+				// Simulate this frame on the other thread while the
+				// most recently published frame is drawn here, so a
+				// frame costs max(update, draw) instead of the sum
+				simulation.Kick(deltaTime, totalTime);
+				Draw(deltaTime, totalTime);
+				simulation.Wait();
+			}
+			else
+			{
+				Update(deltaTime, totalTime);
+				Draw(deltaTime, totalTime);
+			}
 
 			// Frame is over, notify the input manager
 			Input::GetInstance().EndOfFrame();
@@ -447,6 +483,7 @@ HRESULT DXCore::Run()
 
 	// We'll end up here once we get a WM_QUIT message,
 	// which usually comes from the user closing the window
+	simulation.Stop();
 	return (HRESULT)msg.wParam;
 }
 
@@ -482,6 +519,18 @@ void DXCore::UpdateTimer()
 
 	// Save current time for next frame
 	previousTime = currentTime;
+
+	// Keep every frame for the frame time stats
+	frameTimes.AddFrame(deltaTime);
+
+	// Deterministic clock - the game sees the same times
+	// every run, regardless of how long frames really take
+	if (fixedTimestep > 0.0f)
+	{
+		deltaTime = fixedTimestep;
+		totalTime = (float)fixedFrameCount * fixedTimestep;
+		fixedFrameCount++;
+	}
 }
 
 
@@ -5,6 +5,9 @@
 #include <string>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 
+#include "FrameTimeStats.h"
+#include "SimulationThread.h"
+
 // We can include the correct library files here
 // instead of in Visual Studio settings if we want
 #pragma comment(lib, "d3d11.lib")
@@ -46,6 +49,10 @@ public:
 	virtual void Update(float deltaTime, float totalTime) = 0;
 	virtual void Draw(float deltaTime, float totalTime) = 0;
 
+	// Called on the main thread before Update() each frame, for
+	// anything that must not run on the simulation thread (UI, etc.)
+	virtual void UpdateUI(float deltaTime, float totalTime) {}
+
 protected:
 	HINSTANCE		hInstance;		// The handle to the application
 	HWND			hWnd;			// The handle to the window itself
@@ -66,6 +73,18 @@ protected:
 	bool deviceSupportsTearing;
 	BOOL isFullscreen; // Due to alt+enter key combination (must be BOOL typedef)
 
+	// Should Update() run on its own thread, overlapped with the
+	// previous frame's Draw()?  Can be toggled at any time.
+	bool threadedSimulation;
+
+	// Every frame's delta time, for percentiles & histograms
+	FrameTimeStats frameTimes;
+
+	// Benchmark/automation options - set these before InitWindow()
+	bool headless;			// Keep the window hidden
+	bool useWarp;			// Software rasterizer instead of the GPU
+	float fixedTimestep;	// If > 0, every frame advances by exactly this much
+
 	// DirectX related objects and variables
 	D3D_FEATURE_LEVEL		dxFeatureLevel;
 	Microsoft::WRL::ComPtr<IDXGISwapChain>		swapChain;
@@ -86,6 +105,7 @@ private:
 	__int64 startTime;
 	__int64 currentTime;
 	__int64 previousTime;
+	unsigned long long fixedFrameCount;
 
 	// FPS calculation
 	int fpsFrameCount;
@@ -93,5 +113,8 @@ private:
 
 	void UpdateTimer();			// Updates the timer for this frame
 	void UpdateTitleBarStats();	// Puts debug info in the title bar
+
+	// Runs Update() when the simulation is threaded
+	SimulationThread simulation;
 };
 
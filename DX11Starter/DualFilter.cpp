@@ -0,0 +1,271 @@
+#include "DualFilter.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <xmmintrin.h>
+
+static void Resize(BlurImage& image, unsigned int width, unsigned int height)
+{
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height * 4);
+}
+
+// --------------------------------------------------------
+// Bilinear sample at a position in texels (0, 0 being the
+// top left corner), clamped at the edges like ClampSampler
+// --------------------------------------------------------
+static __m128 Sample(const BlurImage& image, float x, float y)
+{
+	x -= 0.5f;
+	y -= 0.5f;
+	float fx = floorf(x);
+	float fy = floorf(y);
+	int lastX = (int)image.Width - 1;
+	int lastY = (int)image.Height - 1;
+	int x0 = std::max(0, std::min((int)fx, lastX));
+	int x1 = std::max(0, std::min((int)fx + 1, lastX));
+	int y0 = std::max(0, std::min((int)fy, lastY));
+	int y1 = std::max(0, std::min((int)fy + 1, lastY));
+	__m128 tx = _mm_set1_ps(x - fx);
+	__m128 ty = _mm_set1_ps(y - fy);
+
+	const float* row0 = &image.Pixels[(size_t)y0 * image.Width * 4];
+	const float* row1 = &image.Pixels[(size_t)y1 * image.Width * 4];
+	__m128 a = _mm_loadu_ps(row0 + x0 * 4);
+	__m128 b = _mm_loadu_ps(row0 + x1 * 4);
+	__m128 c = _mm_loadu_ps(row1 + x0 * 4);
+	__m128 d = _mm_loadu_ps(row1 + x1 * 4);
+	__m128 top = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), tx));
+	__m128 bottom = _mm_add_ps(c, _mm_mul_ps(_mm_sub_ps(d, c), tx));
+	return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), ty));
+}
+
+void DualFilterDownsample(const BlurImage& source, BlurImage& result, float threshold)
+{
+	unsigned int width = std::max(source.Width / 2, 1u);
+	unsigned int height = std::max(source.Height / 2, 1u);
+	Resize(result, width, height);
+
+	// Output texel centers, in input texels
+	float scaleX = (float)source.Width / width;
+	float scaleY = (float)source.Height / height;
+	__m128 four = _mm_set1_ps(4.0f);
+	__m128 eighth = _mm_set1_ps(1.0f / 8.0f);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		float v = (y + 0.5f) * scaleY;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			float u = (x + 0.5f) * scaleX;
+			__m128 total = _mm_mul_ps(Sample(source, u, v), four);
+			total = _mm_add_ps(total, Sample(source, u - 1.0f, v - 1.0f));
+			total = _mm_add_ps(total, Sample(source, u + 1.0f, v - 1.0f));
+			total = _mm_add_ps(total, Sample(source, u - 1.0f, v + 1.0f));
+			total = _mm_add_ps(total, Sample(source, u + 1.0f, v + 1.0f));
+			total = _mm_mul_ps(total, eighth);
+
+			float* out = &result.Pixels[((size_t)y * width + x) * 4];
+			_mm_storeu_ps(out, total);
+			if (threshold > 0.0f)
+			{
+				float brightness = std::max(out[0], std::max(out[1], out[2]));
+				float scale = std::max(brightness - threshold, 0.0f) / std::max(brightness, 0.0001f);
+				out[0] *= scale;
+				out[1] *= scale;
+				out[2] *= scale;
+			}
+			out[3] = 1.0f;
+		}
+	}
+}
+
+void DualFilterUpsample(const BlurImage& source, BlurImage& result, unsigned int width, unsigned int height)
+{
+	Resize(result, width, height);
+
+	// Output texel centers, in input texels
+	float scaleX = (float)source.Width / width;
+	float scaleY = (float)source.Height / height;
+	__m128 two = _mm_set1_ps(2.0f);
+	__m128 twelfth = _mm_set1_ps(1.0f / 12.0f);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		float v = (y + 0.5f) * scaleY;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			float u = (x + 0.5f) * scaleX;
+			__m128 edges = Sample(source, u - 1.0f, v);
+			edges = _mm_add_ps(edges, Sample(source, u + 1.0f, v));
+			edges = _mm_add_ps(edges, Sample(source, u, v - 1.0f));
+			edges = _mm_add_ps(edges, Sample(source, u, v + 1.0f));
+			__m128 corners = Sample(source, u - 0.5f, v - 0.5f);
+			corners = _mm_add_ps(corners, Sample(source, u + 0.5f, v - 0.5f));
+			corners = _mm_add_ps(corners, Sample(source, u - 0.5f, v + 0.5f));
+			corners = _mm_add_ps(corners, Sample(source, u + 0.5f, v + 0.5f));
+			__m128 total = _mm_mul_ps(_mm_add_ps(edges, _mm_mul_ps(corners, two)), twelfth);
+
+			float* out = &result.Pixels[((size_t)y * width + x) * 4];
+			_mm_storeu_ps(out, total);
+			out[3] = 1.0f;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Down the pyramid and back up to the given size, landing on
+// exactly the same sizes as the way down
+// --------------------------------------------------------
+static void RunPyramid(const BlurImage& source, BlurImage& result, unsigned int levels, float threshold)
+{
+	std::vector<BlurImage> pyramid(levels);
+	for (unsigned int i = 0; i < levels; i++)
+		DualFilterDownsample(i == 0 ? source : pyramid[i - 1], pyramid[i], i == 0 ? threshold : 0.0f);
+
+	for (unsigned int i = levels - 1; i-- > 0; )
+		DualFilterUpsample(pyramid[i + 1], pyramid[i], pyramid[i].Width, pyramid[i].Height);
+	DualFilterUpsample(pyramid[0], result, source.Width, source.Height);
+}
+
+void DualFilterBlur(const BlurImage& source, BlurImage& result, unsigned int levels)
+{
+	if (levels == 0)
+		result = source;
+	else
+		RunPyramid(source, result, levels, 0.0f);
+}
+
+void DualFilterBloom(const BlurImage& source, BlurImage& result, unsigned int levels, float threshold, float intensity)
+{
+	if (levels == 0)
+	{
+		result = source;
+		return;
+	}
+
+	BlurImage bloom;
+	RunPyramid(source, bloom, levels, threshold);
+
+	// Composite, leaving alpha alone
+	Resize(result, source.Width, source.Height);
+	__m128 scale = _mm_setr_ps(intensity, intensity, intensity, 0.0f);
+	for (size_t i = 0; i < result.Pixels.size(); i += 4)
+	{
+		__m128 color = _mm_loadu_ps(&source.Pixels[i]);
+		_mm_storeu_ps(&result.Pixels[i], _mm_add_ps(color, _mm_mul_ps(_mm_loadu_ps(&bloom.Pixels[i]), scale)));
+	}
+}
+
+static float GetMeanColor(const BlurImage& image)
+{
+	double total = 0.0;
+	for (size_t i = 0; i < image.Pixels.size(); i++)
+	{
+		if (i % 4 != 3)
+			total += image.Pixels[i];
+	}
+	return image.Pixels.empty() ? 0.0f : (float)(total / (image.Pixels.size() / 4 * 3));
+}
+
+DualFilterBenchmarkResults RunDualFilterBenchmark(unsigned int width, unsigned int height, unsigned int levels, float threshold)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	DualFilterBenchmarkResults results = {};
+	results.Width = width;
+	results.Height = height;
+	results.Levels = levels;
+
+	// Checkers & noise, as in RunBoxBlurBenchmark()
+	BlurImage source;
+	Resize(source, width, height);
+	unsigned int seed = 12345;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			float checker = ((x / 16 + y / 16) & 1) ? 1.0f : 0.0f;
+			float* pixel = &source.Pixels[((size_t)y * width + x) * 4];
+			for (int c = 0; c < 4; c++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				pixel[c] = checker * 0.75f + (seed >> 8) / 16777216.0f * 0.25f;
+			}
+		}
+	}
+
+	BlurImage blurred, bloomed;
+	Clock::time_point start = Clock::now();
+	DualFilterBlur(source, blurred, levels);
+	Clock::time_point blurEnd = Clock::now();
+	DualFilterBloom(source, bloomed, levels, threshold, 1.0f);
+	Clock::time_point bloomEnd = Clock::now();
+
+	results.BlurMs = std::chrono::duration<double, std::milli>(blurEnd - start).count();
+	results.BloomMs = std::chrono::duration<double, std::milli>(bloomEnd - blurEnd).count();
+	results.BlurMeanChange = GetMeanColor(blurred) - GetMeanColor(source);
+	return results;
+}
+
+// --------------------------------------------------------
+// One fullscreen-style pass of the cost model
+// --------------------------------------------------------
+static void AddPass(PostProcessCost& cost,
+	unsigned long long inputPixels,
+	unsigned long long outputPixels,
+	unsigned long long samplesPerPixel,
+	unsigned int bytesPerPixel)
+{
+	cost.Passes++;
+	cost.Samples += outputPixels * samplesPerPixel;
+	cost.SampledBytes += outputPixels * samplesPerPixel * bytesPerPixel;
+	cost.MemoryBytes += (inputPixels + outputPixels) * bytesPerPixel;
+}
+
+static unsigned long long GetLevelPixels(unsigned int width, unsigned int height, unsigned int level)
+{
+	return (unsigned long long)std::max(width >> level, 1u) * std::max(height >> level, 1u);
+}
+
+PostProcessCost GetDualFilterBlurCost(unsigned int width, unsigned int height, unsigned int levels, unsigned int bytesPerPixel)
+{
+	PostProcessCost cost = {};
+	for (unsigned int i = 1; i <= levels; i++)
+		AddPass(cost, GetLevelPixels(width, height, i - 1), GetLevelPixels(width, height, i), 5, bytesPerPixel);
+	for (unsigned int i = levels; i-- > 0; )
+		AddPass(cost, GetLevelPixels(width, height, i + 1), GetLevelPixels(width, height, i), 8, bytesPerPixel);
+	return cost;
+}
+
+PostProcessCost GetBloomCost(unsigned int width, unsigned int height, unsigned int levels, unsigned int bytesPerPixel)
+{
+	// Same pyramid, but the last upsample also reads the image
+	// (the composite pass) - one more sample per pixel, and
+	// one more full size read
+	PostProcessCost cost = GetDualFilterBlurCost(width, height, levels, bytesPerPixel);
+	if (levels > 0)
+	{
+		unsigned long long pixels = GetLevelPixels(width, height, 0);
+		cost.Samples += pixels;
+		cost.SampledBytes += pixels * bytesPerPixel;
+		cost.MemoryBytes += pixels * bytesPerPixel;
+	}
+	return cost;
+}
+
+PostProcessCost GetBoxBlurCost(unsigned int width, unsigned int height, int radius, unsigned int bytesPerPixel)
+{
+	PostProcessCost cost = {};
+	unsigned long long pixels = (unsigned long long)width * height;
+	unsigned long long taps = (unsigned long long)(2 * radius + 1) * (2 * radius + 1);
+	AddPass(cost, pixels, pixels, taps, bytesPerPixel);
+	return cost;
+}
+
+PostProcessCost GetSeparableBlurCost(unsigned int width, unsigned int height, int radius, unsigned int bytesPerPixel)
+{
+	PostProcessCost cost = {};
+	unsigned long long pixels = (unsigned long long)width * height;
+	AddPass(cost, pixels, pixels, 2 * radius + 1, bytesPerPixel);
+	AddPass(cost, pixels, pixels, 2 * radius + 1, bytesPerPixel);
+	return cost;
+}
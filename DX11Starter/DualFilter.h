@@ -0,0 +1,55 @@
+#pragma once
+
+#include "BoxBlur.h"
+
+// --------------------------------------------------------
+// Rough cost of a post process effect, for comparing them
+// without a GPU
+// --------------------------------------------------------
+struct PostProcessCost
+{
+	unsigned int Passes;
+	unsigned long long Samples;			// Texture samples (bilinear taps count once)
+	unsigned long long SampledBytes;	// Samples x bytes per texel - texture cache traffic
+	unsigned long long MemoryBytes;		// Each pass reading its input & writing its output once
+};
+
+// --------------------------------------------------------
+// Results of RunDualFilterBenchmark()
+// --------------------------------------------------------
+struct DualFilterBenchmarkResults
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int Levels;
+	double BlurMs;
+	double BloomMs;
+	float BlurMeanChange;	// Average brightness change - the filters should keep it
+};
+
+// --------------------------------------------------------
+// CPU versions of the dual filter (Kawase style) pyramid in
+// DualFilterDownPS.hlsl / DualFilterUpPS.hlsl, with the same
+// taps and bilinear clamp sampling.  Each downsample halves
+// the size, so a wide blur costs a few cheap passes over ever
+// smaller images instead of one huge kernel at full size:
+//
+//  - Blur: down "levels" times, then back up to full size
+//  - Bloom: the first downsample keeps only what's above the
+//    threshold, and the result is added back to the image
+//
+// Each pixel's 4 channels are one SSE vector.
+// --------------------------------------------------------
+void DualFilterDownsample(const BlurImage& source, BlurImage& result, float threshold);
+void DualFilterUpsample(const BlurImage& source, BlurImage& result, unsigned int width, unsigned int height);
+void DualFilterBlur(const BlurImage& source, BlurImage& result, unsigned int levels);
+void DualFilterBloom(const BlurImage& source, BlurImage& result, unsigned int levels, float threshold, float intensity);
+
+// Times the blur & bloom on a generated image
+DualFilterBenchmarkResults RunDualFilterBenchmark(unsigned int width, unsigned int height, unsigned int levels, float threshold);
+
+// Cost models - the pyramid vs. the box blurs it replaces
+PostProcessCost GetDualFilterBlurCost(unsigned int width, unsigned int height, unsigned int levels, unsigned int bytesPerPixel);
+PostProcessCost GetBloomCost(unsigned int width, unsigned int height, unsigned int levels, unsigned int bytesPerPixel);
+PostProcessCost GetBoxBlurCost(unsigned int width, unsigned int height, int radius, unsigned int bytesPerPixel);
+PostProcessCost GetSeparableBlurCost(unsigned int width, unsigned int height, int radius, unsigned int bytesPerPixel);
@@ -0,0 +1,39 @@
+struct VertexToPixel
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+Texture2D Pixels : register(t0);
+SamplerState ClampSampler : register(s0);
+
+cbuffer ExternalData : register(b0)
+{
+    float2 pixelSize;   // One texel of the (bigger) input, in UVs
+    float threshold;    // Bloom's bright pass - 0 keeps everything
+}
+
+// --------------------------------------------------------
+// Dual filter downsample (must match DualFilter.cpp): the
+// center plus four diagonal bilinear taps one input texel
+// out, weighted 4:1:1:1:1.  Each tap averages a 2x2 block,
+// so every output texel covers 4x4 input texels in just 5
+// samples.
+// --------------------------------------------------------
+float4 main(VertexToPixel input) : SV_TARGET
+{
+    float3 total = Pixels.Sample(ClampSampler, input.uv).rgb * 4.0f;
+    total += Pixels.Sample(ClampSampler, input.uv + float2(-pixelSize.x, -pixelSize.y)).rgb;
+    total += Pixels.Sample(ClampSampler, input.uv + float2(pixelSize.x, -pixelSize.y)).rgb;
+    total += Pixels.Sample(ClampSampler, input.uv + float2(-pixelSize.x, pixelSize.y)).rgb;
+    total += Pixels.Sample(ClampSampler, input.uv + float2(pixelSize.x, pixelSize.y)).rgb;
+    total /= 8.0f;
+    
+    // Bright pass, keeping just the part of each color above the threshold
+    if (threshold > 0.0f)
+    {
+        float brightness = max(total.r, max(total.g, total.b));
+        total *= max(brightness - threshold, 0.0f) / max(brightness, 0.0001f);
+    }
+    return float4(total, 1.0f);
+}
@@ -0,0 +1,34 @@
+struct VertexToPixel
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+Texture2D Pixels : register(t0);
+SamplerState ClampSampler : register(s0);
+
+cbuffer ExternalData : register(b0)
+{
+    float2 pixelSize;   // One texel of the (smaller) input, in UVs
+}
+
+// --------------------------------------------------------
+// Dual filter upsample (must match DualFilter.cpp): four
+// taps one input texel out along the axes, plus four
+// diagonal taps half a texel out at double weight - a tent
+// over the input in 8 samples
+// --------------------------------------------------------
+float4 main(VertexToPixel input) : SV_TARGET
+{
+    float2 halfPixel = pixelSize * 0.5f;
+    float3 total = 0;
+    total += Pixels.Sample(ClampSampler, input.uv + float2(-pixelSize.x, 0.0f)).rgb;
+    total += Pixels.Sample(ClampSampler, input.uv + float2(pixelSize.x, 0.0f)).rgb;
+    total += Pixels.Sample(ClampSampler, input.uv + float2(0.0f, -pixelSize.y)).rgb;
+    total += Pixels.Sample(ClampSampler, input.uv + float2(0.0f, pixelSize.y)).rgb;
+    total += Pixels.Sample(ClampSampler, input.uv + float2(-halfPixel.x, -halfPixel.y)).rgb * 2.0f;
+    total += Pixels.Sample(ClampSampler, input.uv + float2(halfPixel.x, -halfPixel.y)).rgb * 2.0f;
+    total += Pixels.Sample(ClampSampler, input.uv + float2(-halfPixel.x, halfPixel.y)).rgb * 2.0f;
+    total += Pixels.Sample(ClampSampler, input.uv + float2(halfPixel.x, halfPixel.y)).rgb * 2.0f;
+    return float4(total / 12.0f, 1.0f);
+}
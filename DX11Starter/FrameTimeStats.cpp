@@ -0,0 +1,109 @@
+#include "FrameTimeStats.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <vector>
+
+FrameTimeStats::FrameTimeStats() :
+	totalFrames(0)
+{
+	for (unsigned int i = 0; i < Capacity; i++)
+		frameTimes[i] = 0.0f;
+}
+
+// --------------------------------------------------------
+// Records one frame (delta time in seconds)
+// --------------------------------------------------------
+void FrameTimeStats::AddFrame(float deltaTime)
+{
+	frameTimes[totalFrames % Capacity] = deltaTime * 1000.0f;
+	totalFrames++;
+}
+
+void FrameTimeStats::Reset()
+{
+	totalFrames = 0;
+}
+
+unsigned int FrameTimeStats::GetFrameCount()
+{
+	return (unsigned int)(totalFrames < Capacity ? totalFrames : Capacity);
+}
+
+unsigned long long FrameTimeStats::GetTotalFrameCount()
+{
+	return totalFrames;
+}
+
+float FrameTimeStats::GetFrameTime(unsigned int index)
+{
+	unsigned long long first = totalFrames - GetFrameCount();
+	return frameTimes[(first + index) % Capacity];
+}
+
+float FrameTimeStats::GetBinStart(unsigned int bin)
+{
+	return 0.25f * powf(2.0f, bin * 0.5f);
+}
+
+// --------------------------------------------------------
+// Calculates percentiles, max & histogram.  Uses
+// nth_element on a copy, so it's O(n) per call - cheap
+// enough to run every frame for a few thousand frames.
+// --------------------------------------------------------
+void FrameTimeStats::Calculate(FrameTimeSummary& summary)
+{
+	summary = {};
+	unsigned int count = GetFrameCount();
+	summary.FrameCount = count;
+	if (count == 0)
+		return;
+
+	std::vector<float> sorted(count);
+	double total = 0.0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		float ms = GetFrameTime(i);
+		sorted[i] = ms;
+		total += ms;
+
+		// Two bins per doubling, starting at 0.25ms
+		int bin = ms > 0.25f ? (int)floorf(2.0f * log2f(ms / 0.25f)) : 0;
+		bin = std::min(std::max(bin, 0), (int)FrameTimeSummary::HistogramBins - 1);
+		summary.Histogram[bin] += 1.0f;
+	}
+	summary.Average = (float)(total / count);
+
+	// Nearest-rank percentiles
+	auto percentile = [&sorted, count](float p)
+	{
+		unsigned int rank = (unsigned int)ceilf(p * count);
+		unsigned int index = rank > 0 ? rank - 1 : 0;
+		std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+		return sorted[index];
+	};
+	summary.P50 = percentile(0.50f);
+	summary.P95 = percentile(0.95f);
+	summary.P99 = percentile(0.99f);
+	summary.Max = *std::max_element(sorted.begin(), sorted.end());
+}
+
+bool FrameTimeStats::ExportCSV(const std::wstring& path)
+{
+	// Only MSVC's streams take wide paths (the tests build elsewhere)
+#ifdef _MSC_VER
+	std::ofstream file(path);
+#else
+	std::ofstream file(std::string(path.begin(), path.end()));
+#endif
+	if (!file.is_open())
+		return false;
+
+	file << "frame,milliseconds\n";
+	unsigned int count = GetFrameCount();
+	unsigned long long first = totalFrames - count;
+	for (unsigned int i = 0; i < count; i++)
+		file << (first + i) << "," << GetFrameTime(i) << "\n";
+
+	return true;
+}
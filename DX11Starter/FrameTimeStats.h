@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+
+// --------------------------------------------------------
+// Rolling statistics over the most recent frame times,
+// all in milliseconds
+// --------------------------------------------------------
+struct FrameTimeSummary
+{
+	static const unsigned int HistogramBins = 20;
+
+	unsigned int FrameCount;	// How many frames these stats cover
+	float Average;
+	float P50;
+	float P95;
+	float P99;
+	float Max;
+
+	// Frame counts per log-scale bucket (see FrameTimeStats::GetBinStart())
+	float Histogram[HistogramBins];
+};
+
+// --------------------------------------------------------
+// Records every frame's delta time into a fixed-size ring,
+// so long-tail frames (stutters) show up instead of being
+// averaged away like in the title bar stats.
+// --------------------------------------------------------
+class FrameTimeStats
+{
+public:
+	static const unsigned int Capacity = 4096;
+
+	FrameTimeStats();
+
+	void AddFrame(float deltaTime);
+	void Reset();
+
+	unsigned int GetFrameCount();				// Frames currently in the ring
+	unsigned long long GetTotalFrameCount();	// Frames ever recorded
+	float GetFrameTime(unsigned int index);		// In ms, 0 = oldest in the ring
+
+	// Percentiles & histogram over the whole ring
+	void Calculate(FrameTimeSummary& summary);
+
+	// Histogram buckets double every two bins, starting at 0.25ms
+	// (the last bin also holds anything slower)
+	static float GetBinStart(unsigned int bin);
+
+	// One line per frame in the ring: frame number, milliseconds
+	bool ExportCSV(const std::wstring& path);
+
+private:
+	float frameTimes[Capacity];	// Milliseconds
+	unsigned long long totalFrames;
+};
@@ -3,11 +3,12 @@
 #include "Input.h"
 #include "PathHelpers.h"
 #include "Mesh.h"
+#include "JobSystem.h"
+#include "Profiler.h"
 #include <vector>
 #include <math.h>
 #include <string>
-
-#include "WICTextureLoader.h"
+#include <chrono>
 
 #include "ImGui/imgui.h"
 #include "ImGui/imgui_impl_dx11.h"
@@ -27,20 +28,31 @@ using namespace DirectX;
 // Direct3D itself, and our window, are not ready at this point!
 //
 // hInstance - the application's OS-level handle (unique ID)
+// benchmarkSettings - benchmark mode options (off by default)
 // --------------------------------------------------------
-Game::Game(HINSTANCE hInstance)
+Game::Game(HINSTANCE hInstance, const BenchmarkSettings& benchmarkSettings)
 	: DXCore(
 		hInstance,			// The application's handle
 		L"DirectX Game",	// Text for the window's title bar (as a wide-character string)
 		1280,				// Width of the window's client area
 		720,				// Height of the window's client area
 		false,				// Sync the framerate to the monitor refresh? (lock framerate)
-		true)				// Show extra stats (fps) in title bar?
+		true),				// Show extra stats (fps) in title bar?
+	benchmarkSettings(benchmarkSettings)
 {
 #if defined(DEBUG) || defined(_DEBUG)
 	CreateConsoleWindow(500, 120, 32, 120);
 	printf("Console window created successfully.  Feel free to printf() here.\n");
 #endif
+
+	// Benchmark mode runs on a fixed clock, as fast as possible
+	if (benchmarkSettings.Enabled)
+	{
+		headless = benchmarkSettings.Headless;
+		useWarp = benchmarkSettings.UseWarp;
+		fixedTimestep = benchmarkSettings.FixedTimestep;
+		vsync = false;
+	}
 }
 
 // --------------------------------------------------------
@@ -62,6 +74,10 @@ Game::~Game()
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
 
+	// Stop the worker threads (Run() has already stopped the
+	// simulation thread by now), then the profiler they write to
+	delete &JobSystem::GetInstance();
+	delete &Profiler::GetInstance();
 }
 
 // --------------------------------------------------------
@@ -70,15 +86,33 @@ Game::~Game()
 // --------------------------------------------------------
 void Game::Init()
 {
+	// Start the worker threads
+	JobSystem::GetInstance().Initialize();
+
 	// Initialization helpers
-	InitShadows();
-	InitPostProcessing();
 	LoadShaders();
+	printf("Loaded %u shaders in %.1f ms (%u reflected from sidecars)\n",
+		ISimpleShader::LoadStats.Loaded, ISimpleShader::LoadStats.Milliseconds, ISimpleShader::LoadStats.FromSidecar);
+	InitPostProcessing();
+	InitShadows();
 	CreateGeometry();
 	LoadMaterials();
 	CreateEntities();
 	CreateLights();
 	CreateCameras();
+	lightClusters = std::make_shared<LightClusters>(device, context);
+
+	// Set up the scripted camera for benchmark mode
+	if (benchmarkSettings.Enabled)
+	{
+		benchmark = std::make_shared<Benchmark>(benchmarkSettings);
+		if (!benchmark->HasCameraPath())
+			printf("Benchmark camera path not found - using a fixed camera.\n");
+	}
+
+	// Make sure there's a valid snapshot to draw before
+	// the first simulation step has been published
+	PublishSnapshot(0.0f, 0.0f);
 
 	// Initialize ImGui itself & platform/renderer backends
 	IMGUI_CHECKVERSION();
@@ -102,91 +136,190 @@ void Game::Init()
 // --------------------------------------------------------
 void Game::InitShadows()
 {
-	// Create the shadow map texture
-	D3D11_TEXTURE2D_DESC shadowDesc = {};
-	shadowDesc.Width = shadowMapResolution; 
-	shadowDesc.Height = shadowMapResolution; 
-	shadowDesc.ArraySize = 1;
-	shadowDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
-	shadowDesc.CPUAccessFlags = 0;
-	shadowDesc.Format = DXGI_FORMAT_R32_TYPELESS;
-	shadowDesc.MipLevels = 1;
-	shadowDesc.MiscFlags = 0;
-	shadowDesc.SampleDesc.Count = 1;
-	shadowDesc.SampleDesc.Quality = 0;
-	shadowDesc.Usage = D3D11_USAGE_DEFAULT;
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> shadowTexture;
-	device->CreateTexture2D(&shadowDesc, 0, shadowTexture.GetAddressOf());
-
-	// Create the depth/stencil view
-	D3D11_DEPTH_STENCIL_VIEW_DESC shadowDSDesc = {};
-	shadowDSDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	shadowDSDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	shadowDSDesc.Texture2D.MipSlice = 0;
-	device->CreateDepthStencilView(
-		shadowTexture.Get(),
-		&shadowDSDesc,
-		shadowDSV.GetAddressOf());
-
-	// Create the SRV for the shadow map
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MipLevels = 1;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	device->CreateShaderResourceView(
-		shadowTexture.Get(),
-		&srvDesc,
-		shadowSRV.GetAddressOf());
-
-	// Set up the rasterizer state for depth biasing
-	D3D11_RASTERIZER_DESC shadowRastDesc = {};
-	shadowRastDesc.FillMode = D3D11_FILL_SOLID;
-	shadowRastDesc.CullMode = D3D11_CULL_BACK;
-	shadowRastDesc.DepthClipEnable = true;
-	shadowRastDesc.DepthBias = 1000; // Min. precision units, not world units!
-	shadowRastDesc.SlopeScaledDepthBias = 1.0f; // Bias more based on slope
-	device->CreateRasterizerState(&shadowRastDesc, &shadowRasterizer);
-
-	// Set up the sampler for softer shadows
-	D3D11_SAMPLER_DESC shadowSampDesc = {};
-	shadowSampDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
-	shadowSampDesc.ComparisonFunc = D3D11_COMPARISON_LESS;
-	shadowSampDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
-	shadowSampDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
-	shadowSampDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
-	shadowSampDesc.BorderColor[0] = 1.0f;
-	device->CreateSamplerState(&shadowSampDesc, &shadowSampler);
-
-	// Set up the light projection matrix
-	float lightProjectionSize = 12.0f;
-	XMMATRIX lightProjection = XMMatrixOrthographicLH(
-		lightProjectionSize,
-		lightProjectionSize,
-		1.0f,
-		100.0f);
-	XMStoreFloat4x4(&lightProjectionMatrix, lightProjection);
-
+	// One atlas for every shadowed light, cleared & copied with the
+	// fullscreen triangle (so this needs the shaders loaded first)
+	shadowAtlas = std::make_shared<ShadowAtlas>(device, context, shadowAtlasSize, ppVS, PS_ShadowCopy);
 }
 
 // --------------------------------------------------------
-// Calculates the light view matrix of the given light
+// Set up the post processing chain - each effect is a stage
+// (or a few), and the chain finds them targets as needed
 // --------------------------------------------------------
-void Game::UpdateLightViewMatrix(Light light)
+void Game::InitPostProcessing()
 {
-	XMVECTOR lightDirection = XMLoadFloat3(&light.Direction);
-	XMMATRIX lightView = XMMatrixLookToLH(
-		lightDirection * -1.0f * 7.0f,
-		lightDirection,
-		XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)
-		);
-	XMStoreFloat4x4(&lightViewMatrix, lightView);
+	postChain = std::make_shared<PostProcessChain>(device, context, ppVS, PS_PostCopy);
+
+	// Dual filter passes, shared by bloom and the wide blur - each
+	// reads the level above (or below) through a bilinear sampler
+	auto downsample = [this](bool brightPass)
+	{
+		return [this, brightPass](const PostProcessPass& pass)
+		{
+			PS_DualFilterDown->SetShader();
+			PS_DualFilterDown->SetShaderResourceView("Pixels", pass.Inputs[0].SRV);
+			PS_DualFilterDown->SetSamplerState("ClampSampler", ppSampler.Get());
+			PS_DualFilterDown->SetFloat2("pixelSize", XMFLOAT2(1.0f / pass.Inputs[0].Width, 1.0f / pass.Inputs[0].Height));
+			PS_DualFilterDown->SetFloat("threshold", brightPass ? bloomThreshold : 0.0f);
+			PS_DualFilterDown->CopyAllBufferData();
+			context->Draw(3, 0);
+		};
+	};
+	auto upsample = [this](const PostProcessPass& pass)
+	{
+		PS_DualFilterUp->SetShader();
+		PS_DualFilterUp->SetShaderResourceView("Pixels", pass.Inputs[0].SRV);
+		PS_DualFilterUp->SetSamplerState("ClampSampler", ppSampler.Get());
+		PS_DualFilterUp->SetFloat2("pixelSize", XMFLOAT2(1.0f / pass.Inputs[0].Width, 1.0f / pass.Inputs[0].Height));
+		PS_DualFilterUp->CopyAllBufferData();
+		context->Draw(3, 0);
+	};
+
+	// Bloom - bright pass on the way down to 1/2 size, down the rest
+	// of the pyramid, back up to 1/2, then the composite's own last
+	// upsample adds it onto the scene
+	for (int level = 1; level <= MAX_PYRAMID_LEVELS; level++)
+	{
+		PostProcessStage stage = {};
+		stage.Name = "Bloom Down " + std::to_string(level);
+		stage.Inputs.push_back(level == 1 ? "Scene" : "Previous");
+		stage.Divisor = 1u << level;
+		stage.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		stage.Execute = downsample(level == 1);
+		postChain->AddStage(stage);
+	}
+	for (int level = MAX_PYRAMID_LEVELS - 1; level >= 1; level--)
+	{
+		PostProcessStage stage = {};
+		stage.Name = "Bloom Up " + std::to_string(level);
+		stage.Inputs.push_back("Previous");
+		stage.Divisor = 1u << level;
+		stage.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		stage.Execute = upsample;
+		postChain->AddStage(stage);
+	}
+	{
+		PostProcessStage stage = {};
+		stage.Name = "Bloom Composite";
+		stage.Inputs.push_back("Scene");
+		stage.Inputs.push_back("Previous");
+		stage.Divisor = 1;
+		stage.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		stage.Execute = [this](const PostProcessPass& pass)
+		{
+			PS_BloomComposite->SetShader();
+			PS_BloomComposite->SetShaderResourceView("Pixels", pass.Inputs[0].SRV);
+			PS_BloomComposite->SetShaderResourceView("Bloom", pass.Inputs[1].SRV);
+			PS_BloomComposite->SetSamplerState("ClampSampler", ppSampler.Get());
+			PS_BloomComposite->SetFloat2("bloomPixelSize", XMFLOAT2(1.0f / pass.Inputs[1].Width, 1.0f / pass.Inputs[1].Height));
+			PS_BloomComposite->SetFloat("bloomIntensity", bloomIntensity);
+			PS_BloomComposite->CopyAllBufferData();
+			context->Draw(3, 0);
+		};
+		postChain->AddStage(stage);
+	}
+
+	// Separable blur - horizontal, then vertical
+	for (int i = 0; i < 2; i++)
+	{
+		bool horizontal = i == 0;
+		PostProcessStage stage = {};
+		stage.Name = horizontal ? "Blur Horizontal" : "Blur Vertical";
+		stage.Inputs.push_back(horizontal ? "Previous" : "Blur Horizontal");
+		stage.Divisor = 1;
+		stage.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		stage.Execute = [this, horizontal](const PostProcessPass& pass)
+		{
+			PS_BlurSeparable->SetShader();
+			PS_BlurSeparable->SetShaderResourceView("Pixels", pass.Inputs[0].SRV);
+			PS_BlurSeparable->SetSamplerState("ClampSampler", ppSampler.Get());
+			PS_BlurSeparable->SetInt("blurRadius", blurRadius);
+			PS_BlurSeparable->SetFloat2("pixelStep", horizontal ?
+				XMFLOAT2(1.0f / pass.Inputs[0].Width, 0.0f) :
+				XMFLOAT2(0.0f, 1.0f / pass.Inputs[0].Height));
+			PS_BlurSeparable->CopyAllBufferData();
+			context->Draw(3, 0);
+		};
+		postChain->AddStage(stage);
+	}
+
+	// Sliding window blur - rows, then columns, in compute shaders
+	for (int i = 0; i < 2; i++)
+	{
+		bool horizontal = i == 0;
+		PostProcessStage stage = {};
+		stage.Name = horizontal ? "Blur Rows" : "Blur Columns";
+		stage.Compute = true;
+		stage.Inputs.push_back(horizontal ? "Previous" : "Blur Rows");
+		stage.Divisor = 1;
+		stage.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		stage.Execute = [this, horizontal](const PostProcessPass& pass)
+		{
+			int direction[2] = { horizontal ? 1 : 0, horizontal ? 0 : 1 };
+			unsigned int lineCount = horizontal ? pass.Height : pass.Width;
+			CS_BoxBlur->SetShader();
+			CS_BoxBlur->SetShaderResourceView("Pixels", pass.Inputs[0].SRV);
+			CS_BoxBlur->SetUnorderedAccessView("Output", pass.OutputUAV);
+			CS_BoxBlur->SetInt("blurRadius", blurRadius);
+			CS_BoxBlur->SetInt("lineCount", (int)lineCount);
+			CS_BoxBlur->SetInt("lineLength", horizontal ? (int)pass.Width : (int)pass.Height);
+			CS_BoxBlur->SetData("direction", direction, sizeof(direction));
+			CS_BoxBlur->CopyAllBufferData();
+			CS_BoxBlur->DispatchByThreads(lineCount, 1, 1);
+		};
+		postChain->AddStage(stage);
+	}
+
+	// Dual filter blur - down the pyramid and all the way back up
+	for (int level = 1; level <= MAX_PYRAMID_LEVELS; level++)
+	{
+		PostProcessStage stage = {};
+		stage.Name = "Dual Blur Down " + std::to_string(level);
+		stage.Inputs.push_back("Previous");
+		stage.Divisor = 1u << level;
+		stage.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		stage.Execute = downsample(false);
+		postChain->AddStage(stage);
+	}
+	for (int level = MAX_PYRAMID_LEVELS - 1; level >= 0; level--)
+	{
+		PostProcessStage stage = {};
+		stage.Name = "Dual Blur Up " + std::to_string(level);
+		stage.Inputs.push_back("Previous");
+		stage.Divisor = 1u << level;
+		stage.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		stage.Execute = upsample;
+		postChain->AddStage(stage);
+	}
+
+	// The original single pass box blur
+	{
+		PostProcessStage stage = {};
+		stage.Name = "Blur Brute Force";
+		stage.Inputs.push_back("Previous");
+		stage.Divisor = 1;
+		stage.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+		stage.Execute = [this](const PostProcessPass& pass)
+		{
+			ppPS->SetShader();
+			ppPS->SetShaderResourceView("Pixels", pass.Inputs[0].SRV);
+			ppPS->SetSamplerState("ClampSampler", ppSampler.Get());
+			ppPS->SetInt("blurRadius", blurRadius);
+			ppPS->SetFloat("pixelWidth", 1.0f / pass.Inputs[0].Width);
+			ppPS->SetFloat("pixelHeight", 1.0f / pass.Inputs[0].Height);
+			ppPS->CopyAllBufferData();
+			context->Draw(3, 0);
+		};
+		postChain->AddStage(stage);
+	}
+
+	ResizePostProcessing();
 }
 
 // --------------------------------------------------------
-// Set up resources required for post processing effects
+// (Re)creates the scene's color target at the window size,
+// and lets the chain re-plan its own targets to match
 // --------------------------------------------------------
-void Game::InitPostProcessing()
+void Game::ResizePostProcessing()
 {
 	// Create the render target description
 	D3D11_TEXTURE2D_DESC textureDesc = {};
@@ -214,6 +347,8 @@ void Game::InitPostProcessing()
 
 	// Create the Shader Resource View
 	device->CreateShaderResourceView(ppTexture.Get(), 0, ppSRV.ReleaseAndGetAddressOf());
+
+	postChain->Resize(windowWidth, windowHeight);
 }
 
 // --------------------------------------------------------
@@ -223,15 +358,32 @@ void Game::InitPostProcessing()
 // --------------------------------------------------------
 void Game::LoadShaders()
 {
+	PROFILE_FUNCTION();
 	vertexShader = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"VertexShader.cso").c_str());
 	pixelShader = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PixelShader.cso").c_str());
 	VS_NormalMap = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"VertexShader_NormalMap.cso").c_str());
 	PS_NormalMap = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PixelShader_NormalMap.cso").c_str());
+
+	// The buffers copied in whole have to line up with their C++
+	// mirrors - a shader that doesn't is logged & left invalid
+	vertexShader->CheckBuffer<VertexShaderData>("ExternalData", VertexShaderDataFields);
+	VS_NormalMap->CheckBuffer<VertexShaderData>("ExternalData", VertexShaderDataFields);
+	pixelShader->CheckBuffer<PBRPixelShaderData>("ExternalData", PBRPixelShaderDataFields);
+	PS_NormalMap->CheckBuffer<PBRPixelShaderData>("ExternalData", PBRPixelShaderDataFields);
+
+	shaderVariants = std::make_shared<ShaderVariantCache>(device, context, pixelShader, PS_NormalMap);
 	VS_Sky = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"SkyVertexShader.cso").c_str());
 	PS_Sky = std::make_shared<SimplePixelShader>(device, context, FixPath(L"SkyPixelShader.cso").c_str());
 	VS_Shadow = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"ShadowVertexShader.cso").c_str());
+	PS_ShadowCopy = std::make_shared<SimplePixelShader>(device, context, FixPath(L"ShadowCopyPS.cso").c_str());
 	ppVS = std::make_shared<SimpleVertexShader>(device, context, FixPath(L"FullscreenVertexShader.cso").c_str());
 	ppPS = std::make_shared<SimplePixelShader>(device, context, FixPath(L"BlurPixelShader.cso").c_str());
+	PS_BlurSeparable = std::make_shared<SimplePixelShader>(device, context, FixPath(L"BlurSeparablePS.cso").c_str());
+	CS_BoxBlur = std::make_shared<SimpleComputeShader>(device, context, FixPath(L"BoxBlurCS.cso").c_str());
+	PS_PostCopy = std::make_shared<SimplePixelShader>(device, context, FixPath(L"PostCopyPS.cso").c_str());
+	PS_DualFilterDown = std::make_shared<SimplePixelShader>(device, context, FixPath(L"DualFilterDownPS.cso").c_str());
+	PS_DualFilterUp = std::make_shared<SimplePixelShader>(device, context, FixPath(L"DualFilterUpPS.cso").c_str());
+	PS_BloomComposite = std::make_shared<SimplePixelShader>(device, context, FixPath(L"BloomCompositePS.cso").c_str());
 	customShaders.push_back(std::make_shared<SimplePixelShader>(device, context, FixPath(L"CustomPS.cso").c_str()));
 }
 
@@ -241,6 +393,7 @@ void Game::LoadShaders()
 // --------------------------------------------------------
 void Game::CreateGeometry()
 {
+	PROFILE_FUNCTION();
 	#pragma region /* Old Mesh Code */
 	/*
 	// Big rectangle
@@ -327,102 +480,54 @@ void Game::CreateGeometry()
 // --------------------------------------------------------
 void Game::LoadMaterials()
 {
+	PROFILE_FUNCTION();
 	#pragma region Loading Texture Images
 
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srvBasic;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Basic/Basic_albedo.png").c_str(),
-		nullptr, srvBasic.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv1Albedo;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Cobblestone/cobblestone_albedo.png").c_str(),
-		nullptr, srv1Albedo.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv1Normal;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Cobblestone/cobblestone_normals.png").c_str(),
-		nullptr, srv1Normal.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv1Roughness;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Cobblestone/cobblestone_roughness.png").c_str(),
-		nullptr, srv1Roughness.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv1Metal;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Cobblestone/cobblestone_metal.png").c_str(),
-		nullptr, srv1Metal.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv2Albedo;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Bronze/bronze_albedo.png").c_str(),
-		nullptr, srv2Albedo.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv2Normal;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Bronze/bronze_normals.png").c_str(),
-		nullptr, srv2Normal.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv2Roughness;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Bronze/bronze_roughness.png").c_str(),
-		nullptr, srv2Roughness.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv2Metal;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Bronze/bronze_metal.png").c_str(),
-		nullptr, srv2Metal.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv3Albedo;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Wood/wood_albedo.png").c_str(),
-		nullptr, srv3Albedo.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv3Normal;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Wood/wood_normals.png").c_str(),
-		nullptr, srv3Normal.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv3Roughness;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Wood/wood_roughness.png").c_str(),
-		nullptr, srv3Roughness.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv3Metal;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Wood/wood_metal.png").c_str(),
-		nullptr, srv3Metal.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv4Albedo;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Scratched/scratched_albedo.png").c_str(),
-		nullptr, srv4Albedo.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv4Normal;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Scratched/scratched_normals.png").c_str(),
-		nullptr, srv4Normal.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv4Roughness;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Scratched/scratched_roughness.png").c_str(),
-		nullptr, srv4Roughness.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv4Metal;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Scratched/scratched_metal.png").c_str(),
-		nullptr, srv4Metal.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv5Albedo;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Rough/rough_albedo.png").c_str(),
-		nullptr, srv5Albedo.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv5Normal;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Rough/rough_normals.png").c_str(),
-		nullptr, srv5Normal.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv5Roughness;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Rough/rough_roughness.png").c_str(),
-		nullptr, srv5Roughness.GetAddressOf());
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv5Metal;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/Rough/rough_metal.png").c_str(),
-		nullptr, srv5Metal.GetAddressOf());
-
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srvRamp;
-	CreateWICTextureFromFile(device.Get(), context.Get(),
-		FixPath(L"../../Assets/Textures/ramp.png").c_str(),
-		nullptr, srvRamp.GetAddressOf());
+	// Everything is requested up front, then decoded (or loaded
+	// already cooked) in parallel by LoadAll() - duplicates share
+	// a texture, and the usage picks the block compression
+	// (see TextureManager.h)
+	textureManager = std::make_shared<TextureManager>(device, context);
+
+	// Each material's roughness & metalness (& occlusion, if it has
+	// one) are packed into one ORM texture first, next to the .exe
+	// with the cooked DDS files (see TexturePacking.h)
+	ormPack = PackORMTextures(FixPath(L"../../Assets/Textures/"), FixPath(L""));
+	printf("Packed %u ORM textures in %.1f ms (%u up to date, %u failed)\n",
+		ormPack.Packed, ormPack.TotalMs, ormPack.UpToDate, ormPack.Failed);
+
+	std::shared_ptr<Texture> texBasic = textureManager->Request(FixPath(L"../../Assets/Textures/Basic/Basic_albedo.png"), TEXTURE_USAGE_COLOR);
+
+	std::shared_ptr<Texture> tex1Albedo = textureManager->Request(FixPath(L"../../Assets/Textures/Cobblestone/cobblestone_albedo.png"), TEXTURE_USAGE_COLOR);
+	std::shared_ptr<Texture> tex1Normal = textureManager->Request(FixPath(L"../../Assets/Textures/Cobblestone/cobblestone_normals.png"), TEXTURE_USAGE_NORMAL);
+	std::shared_ptr<Texture> tex1ORM = textureManager->Request(FixPath(L"cobblestone_orm.png"), TEXTURE_USAGE_PACKED);
+
+	std::shared_ptr<Texture> tex2Albedo = textureManager->Request(FixPath(L"../../Assets/Textures/Bronze/bronze_albedo.png"), TEXTURE_USAGE_COLOR);
+	std::shared_ptr<Texture> tex2Normal = textureManager->Request(FixPath(L"../../Assets/Textures/Bronze/bronze_normals.png"), TEXTURE_USAGE_NORMAL);
+	std::shared_ptr<Texture> tex2ORM = textureManager->Request(FixPath(L"bronze_orm.png"), TEXTURE_USAGE_PACKED);
+
+	std::shared_ptr<Texture> tex3Albedo = textureManager->Request(FixPath(L"../../Assets/Textures/Wood/wood_albedo.png"), TEXTURE_USAGE_COLOR);
+	std::shared_ptr<Texture> tex3Normal = textureManager->Request(FixPath(L"../../Assets/Textures/Wood/wood_normals.png"), TEXTURE_USAGE_NORMAL);
+	std::shared_ptr<Texture> tex3ORM = textureManager->Request(FixPath(L"wood_orm.png"), TEXTURE_USAGE_PACKED);
+
+	std::shared_ptr<Texture> tex4Albedo = textureManager->Request(FixPath(L"../../Assets/Textures/Scratched/scratched_albedo.png"), TEXTURE_USAGE_COLOR);
+	std::shared_ptr<Texture> tex4Normal = textureManager->Request(FixPath(L"../../Assets/Textures/Scratched/scratched_normals.png"), TEXTURE_USAGE_NORMAL);
+	std::shared_ptr<Texture> tex4ORM = textureManager->Request(FixPath(L"scratched_orm.png"), TEXTURE_USAGE_PACKED);
+
+	std::shared_ptr<Texture> tex5Albedo = textureManager->Request(FixPath(L"../../Assets/Textures/Rough/rough_albedo.png"), TEXTURE_USAGE_COLOR);
+	std::shared_ptr<Texture> tex5Normal = textureManager->Request(FixPath(L"../../Assets/Textures/Rough/rough_normals.png"), TEXTURE_USAGE_NORMAL);
+	std::shared_ptr<Texture> tex5ORM = textureManager->Request(FixPath(L"rough_orm.png"), TEXTURE_USAGE_PACKED);
+
+	std::shared_ptr<Texture> texRamp = textureManager->Request(FixPath(L"../../Assets/Textures/ramp.png"));
+
+	textureManager->LoadAll();
+	const TextureLoadStats& textureStats = textureManager->GetStats();
+	printf("Loaded %u textures in %.1f ms (%u files, %u unique images, %u cooked, %u from cache)\n",
+		textureStats.Requested, textureStats.TotalMs, textureStats.Files, textureStats.Images, textureStats.Cooked, textureStats.FromCache);
+
+	StreamingSettings streamingSettings;
+	streamingSettings.BudgetBytes = (unsigned long long)textureBudgetMB * 1024 * 1024;
+	textureStreamer = std::make_shared<TextureStreamer>(device, context, *textureManager, streamingSettings);
 
 	#pragma endregion
 
@@ -442,50 +547,51 @@ void Game::LoadMaterials()
 	materials.push_back(std::make_shared<Material>(0.9f, 0.2f, 0.2f, 1.0f, 0.1f, vertexShader, pixelShader)); // Red
 	materials.push_back(std::make_shared<Material>(0.145f, 0.878f, 0.365f, 1.0f, 0.9f, vertexShader, customShaders[0])); // Rainbow
 	for (int i = 0; i < 2; i++) {
-		materials[i]->AddTextureSRV("Albedo", srvBasic);
-		materials[i]->AddTextureSRV("RoughnessMap", srvBasic);
+		materials[i]->AddTexture("Albedo", texBasic);
+		materials[i]->AddTexture("RoughnessMap", texBasic);
 		materials[i]->AddSampler("BasicSampler", sampler);
 	}
 
 	// Create textured materials
 	materials.push_back(std::make_shared<Material>(1.0f, 1.0f, 1.0f, 1.0f, 0.0f, VS_NormalMap, PS_NormalMap)); // Cobblestone
-	materials[2]->AddTextureSRV("Albedo", srv1Albedo);
-	materials[2]->AddTextureSRV("NormalMap", srv1Normal);
-	materials[2]->AddTextureSRV("RoughnessMap", srv1Roughness);
-	materials[2]->AddTextureSRV("MetalnessMap", srv1Metal);
+	materials[2]->AddTexture("Albedo", tex1Albedo);
+	materials[2]->AddTexture("NormalMap", tex1Normal);
+	materials[2]->AddTexture("ORMMap", tex1ORM);
 	materials[2]->AddSampler("BasicSampler", sampler);
 
 	materials.push_back(std::make_shared<Material>(1.0f, 1.0f, 1.0f, 1.0f, 0.0f, VS_NormalMap, PS_NormalMap)); // Bronze
-	materials[3]->AddTextureSRV("Albedo", srv2Albedo);
-	materials[3]->AddTextureSRV("NormalMap", srv2Normal);
-	materials[3]->AddTextureSRV("RoughnessMap", srv2Normal);
-	materials[3]->AddTextureSRV("MetalnessMap", srv2Metal);
+	materials[3]->AddTexture("Albedo", tex2Albedo);
+	materials[3]->AddTexture("NormalMap", tex2Normal);
+	materials[3]->AddTexture("ORMMap", tex2ORM);
 	materials[3]->AddSampler("BasicSampler", sampler);
 
 	materials.push_back(std::make_shared<Material>(1.0f, 1.0f, 1.0f, 1.0f, 0.0f, VS_NormalMap, PS_NormalMap)); // Wood
-	materials[4]->AddTextureSRV("Albedo", srv3Albedo);
-	materials[4]->AddTextureSRV("NormalMap", srv3Normal);
-	materials[4]->AddTextureSRV("RoughnessMap", srv3Normal);
-	materials[4]->AddTextureSRV("MetalnessMap", srv3Metal);
+	materials[4]->AddTexture("Albedo", tex3Albedo);
+	materials[4]->AddTexture("NormalMap", tex3Normal);
+	materials[4]->AddTexture("ORMMap", tex3ORM);
 	materials[4]->AddSampler("BasicSampler", sampler);
 
 	materials.push_back(std::make_shared<Material>(1.0f, 1.0f, 1.0f, 1.0f, 1.0f, VS_NormalMap, PS_NormalMap)); // Scratched
-	materials[5]->AddTextureSRV("Albedo", srv4Albedo);
-	materials[5]->AddTextureSRV("NormalMap", srv4Normal);
-	materials[5]->AddTextureSRV("RoughnessMap", srv4Normal);
-	materials[5]->AddTextureSRV("MetalnessMap", srv4Metal);
+	materials[5]->AddTexture("Albedo", tex4Albedo);
+	materials[5]->AddTexture("NormalMap", tex4Normal);
+	materials[5]->AddTexture("ORMMap", tex4ORM);
 	materials[5]->AddSampler("BasicSampler", sampler);
 
 	materials.push_back(std::make_shared<Material>(1.0f, 1.0f, 1.0f, 1.0f, 0.0f, VS_NormalMap, PS_NormalMap)); // Rough
-	materials[6]->AddTextureSRV("Albedo", srv5Albedo);
-	materials[6]->AddTextureSRV("NormalMap", srv5Normal);
-	materials[6]->AddTextureSRV("RoughnessMap", srv5Normal);
-	materials[6]->AddTextureSRV("MetalnessMap", srv5Metal);
+	materials[6]->AddTexture("Albedo", tex5Albedo);
+	materials[6]->AddTexture("NormalMap", tex5Normal);
+	materials[6]->AddTexture("ORMMap", tex5ORM);
 	materials[6]->AddSampler("BasicSampler", sampler);
 
 	// Add ramp for cel shading
 	for (int i = 0; i < materials.size(); i++) {
-		materials[i]->AddTextureSRV("Ramp", srvRamp);
+		materials[i]->AddTexture("Ramp", texRamp);
+	}
+
+	// Everything but the custom shader picks a compiled variant
+	materials[0]->SetShaderVariants(shaderVariants, 0);
+	for (int i = 2; i < materials.size(); i++) {
+		materials[i]->SetShaderVariants(shaderVariants, SHADER_FEATURE_NORMALMAP);
 	}
 
 	// Create sky box
@@ -497,6 +603,7 @@ void Game::LoadMaterials()
 		FixPath(L"../../Assets/Textures/Skies/Cold Sunset/front.png").c_str(),
 		FixPath(L"../../Assets/Textures/Skies/Cold Sunset/back.png").c_str()
 		);
+	sky->BakeLighting(IBLBakeSettings(), true);
 }
 
 
@@ -549,6 +656,10 @@ void Game::CreateEntities()
 	entities[10]->GetTransform()->SetPosition(-1.5f, -0.5f, 11.0f);
 	entities[10]->GetTransform()->SetScale(0.5f, 3.0f, 0.5f);
 
+	// The ones Update() animates
+	for (int i = 0; i <= 4; i++)
+		entities[i]->SetDynamic(true);
+
 	/*
 	entities.push_back(std::make_shared<GameEntity>(meshes[0], materials[1])); // Cube duplicate (for shader testing)
 	entities[6]->GetTransform()->SetPosition(+0.8f, -0.5f, -1.5f);
@@ -571,7 +682,6 @@ void Game::CreateLights()
 	lights[0].Direction = XMFLOAT3(0.0f, -2.0f, 1.0f);
 	lights[0].Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
 	lights[0].Intensity = 1.0f;
-	UpdateLightViewMatrix(lights[0]);
 
 	// Added directional
 	lights.push_back(Light{});
@@ -584,6 +694,34 @@ void Game::CreateLights()
 	lights[2].Direction = XMFLOAT3(1.0f, 1.0f, 2.3f);
 	lights[2].Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
 	lights[2].Intensity = 1.0f;
+
+	// Spot lights on the pillars, which share the shadow atlas
+	// with the directional lights
+	lights.push_back(Light{});
+	lights[3].Type = LIGHT_TYPE_SPOT;
+	lights[3].Position = XMFLOAT3(0.0f, 2.0f, 4.0f);
+	lights[3].Direction = XMFLOAT3(0.3f, -1.0f, 0.2f);
+	lights[3].Range = 8.0f;
+	lights[3].SpotFalloff = 12.0f;
+	lights[3].Color = XMFLOAT3(1.0f, 0.8f, 0.6f);
+	lights[3].Intensity = 2.0f;
+
+	lights.push_back(Light{});
+	lights[4].Type = LIGHT_TYPE_SPOT;
+	lights[4].Position = XMFLOAT3(-1.0f, 1.5f, -1.5f);
+	lights[4].Direction = XMFLOAT3(0.5f, -1.0f, 0.6f);
+	lights[4].Range = 6.0f;
+	lights[4].SpotFalloff = 20.0f;
+	lights[4].Color = XMFLOAT3(0.6f, 0.8f, 1.0f);
+	lights[4].Intensity = 1.5f;
+
+	// Point light between the pillars, shadowed per cube face
+	lights.push_back(Light{});
+	lights[5].Type = LIGHT_TYPE_POINT;
+	lights[5].Position = XMFLOAT3(1.5f, 1.0f, 0.0f);
+	lights[5].Range = 5.0f;
+	lights[5].Color = XMFLOAT3(1.0f, 0.9f, 0.7f);
+	lights[5].Intensity = 1.5f;
 }
 
 
@@ -620,6 +758,10 @@ void Game::OnResize()
 	for (int i = 0; i < cameras.size(); i++) {
 		cameras[i]->UpdateProjectionMatrix((float)this->windowWidth / this->windowHeight);
 	}
+
+	// Post process targets follow the window (once they exist)
+	if (postChain)
+		ResizePostProcessing();
 }
 
 // --------------------------------------------------------
@@ -661,12 +803,186 @@ void Game::BuildUI()
 	{
 		ImGui::Text("Frame Rate: %f fps", ImGui::GetIO().Framerate);
 		ImGui::Text("Window Client Size: %dx%d", windowWidth, windowHeight);
+		ImGui::Text("Draw Calls: %u   Triangles: %u", drawCallCount, triangleCount);
+		ImGui::Text("Shaders: %u loaded in %.1f ms (%u reflected from sidecars)",
+			ISimpleShader::LoadStats.Loaded, ISimpleShader::LoadStats.Milliseconds, ISimpleShader::LoadStats.FromSidecar);
+		if (benchmark)
+			ImGui::Text("Benchmark: frame %u of %u", benchmark->GetRecordedFrameCount(), benchmarkSettings.FrameCount);
 		ImGui::ColorEdit4("Background Color", bgColor);
 		ImGui::Spacing();
 		if (ImGui::Button("Show ImGui Demo Window")) {
 			showDemoUI = !showDemoUI;
 		}
 
+		ImGui::Spacing();
+		ImGui::Checkbox("Threaded Simulation", &threadedSimulation);
+		const SceneSnapshot& scene = sceneSnapshots.GetReadBuffer();
+		ImGui::Text("Drawn Sim Frame: %llu (checksum %08X)", scene.FrameIndex, scene.Checksum());
+
+		ImGui::TreePop();
+	}
+
+	// --------------------------------------------
+	// FRAME TIMES - percentiles, histogram, CSV export
+	// --------------------------------------------
+	if (ImGui::TreeNode("Frame Times"))
+	{
+		FrameTimeSummary summary;
+		frameTimes.Calculate(summary);
+
+		ImGui::Text("Last %u frames:", summary.FrameCount);
+		ImGui::Text("Average: %.3f ms", summary.Average);
+		ImGui::Text("p50: %.3f ms   p95: %.3f ms", summary.P50, summary.P95);
+		ImGui::Text("p99: %.3f ms   Max: %.3f ms", summary.P99, summary.Max);
+
+		// Most recent frames, oldest on the left
+		float recent[256];
+		unsigned int recentCount = min(frameTimes.GetFrameCount(), 256u);
+		unsigned int offset = frameTimes.GetFrameCount() - recentCount;
+		for (unsigned int i = 0; i < recentCount; i++)
+			recent[i] = frameTimes.GetFrameTime(offset + i);
+		ImGui::PlotLines("Frame Time (ms)", recent, recentCount, 0, 0, 0.0f, summary.Max, ImVec2(0, 60));
+
+		// Log-scale histogram - hover a bar to see its range
+		ImGui::PlotHistogram("Histogram", summary.Histogram, FrameTimeSummary::HistogramBins, 0, 0, 0.0f, FLT_MAX, ImVec2(0, 60));
+		if (ImGui::IsItemHovered())
+		{
+			ImGui::BeginTooltip();
+			for (unsigned int i = 0; i < FrameTimeSummary::HistogramBins; i++)
+			{
+				if (summary.Histogram[i] > 0)
+					ImGui::Text("%7.2f ms+: %.0f", FrameTimeStats::GetBinStart(i), summary.Histogram[i]);
+			}
+			ImGui::EndTooltip();
+		}
+
+		if (ImGui::Button("Export CSV"))
+		{
+			frameTimes.ExportCSV(FixPath(L"frame_times.csv"));
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Reset"))
+		{
+			frameTimes.Reset();
+		}
+
+		ImGui::TreePop();
+	}
+
+	// --------------------------------------------
+	// JOB SYSTEM - worker threads, culling, benchmark
+	// --------------------------------------------
+	if (ImGui::TreeNode("Job System"))
+	{
+		JobSystem& jobs = JobSystem::GetInstance();
+		ImGui::Text("Worker Threads: %u", jobs.GetWorkerCount());
+		ImGui::Checkbox("Frustum Culling", &frustumCulling);
+
+		const SceneSnapshot& scene = sceneSnapshots.GetReadBuffer();
+		unsigned int visible = 0;
+		for (size_t i = 0; i < scene.Visible.size(); i++)
+			visible += scene.Visible[i];
+		ImGui::Text("Visible Entities: %u / %u", visible, (unsigned int)scene.Visible.size());
+
+		ImGui::Spacing();
+		if (ImGui::Button("Run Benchmark"))
+		{
+			jobBenchmark = jobs.RunBenchmark();
+		}
+		if (jobBenchmark.EmptyJobCount > 0)
+		{
+			ImGui::Text("Empty Jobs: %.0f jobs/sec", jobBenchmark.EmptyJobsPerSecond);
+			ImGui::Text("Fork/Join Latency: %.2f us", jobBenchmark.ForkJoinMicroseconds);
+			ImGui::Text("Parallel For (%u items): %.2f us", jobBenchmark.EmptyJobCount, jobBenchmark.ParallelForMicroseconds);
+		}
+
+		ImGui::TreePop();
+	}
+
+	// --------------------------------------------
+	// STRESS TEST - generated entities and timings
+	// --------------------------------------------
+	if (ImGui::TreeNode("Stress Test"))
+	{
+		const char* distributions[] = { "Grid", "Random", "Clusters" };
+		const char* motions[] = { "Static", "Spin", "Orbit", "Bob" };
+
+		ImGui::SliderInt("Entities", &stressSettings.EntityCount, 0, 1000000, "%d", ImGuiSliderFlags_Logarithmic);
+		ImGui::Combo("Distribution", &stressSettings.Distribution, distributions, IM_ARRAYSIZE(distributions));
+		ImGui::Combo("Motion", &stressSettings.Motion, motions, IM_ARRAYSIZE(motions));
+		ImGui::DragFloat("Extent", &stressSettings.Extent, 0.5f, 1.0f, 1000.0f);
+		ImGui::DragFloat("Motion Speed", &stressSettings.MotionSpeed, 0.01f, 0.0f, 10.0f);
+		ImGui::SliderInt("Point Lights", &stressSettings.PointLightCount, 0, 4096);
+		int seed = (int)stressSettings.Seed;
+		if (ImGui::InputInt("Seed", &seed))
+			stressSettings.Seed = (unsigned int)seed;
+
+		if (ImGui::Button("Generate"))
+		{
+			stressScene.Generate(stressSettings, meshes, materials, entities, lights);
+			entityListVersion++;
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Clear"))
+		{
+			stressScene.Clear(entities, lights);
+			entityListVersion++;
+		}
+		ImGui::SameLine();
+		if (!stressScene.IsSweeping())
+		{
+			if (ImGui::Button("Run Sweep"))
+				stressScene.StartSweep(stressSettings);
+		}
+		else if (ImGui::Button("Stop Sweep"))
+			stressScene.StopSweep();
+
+		ImGui::Text("Generated: %u entities", stressScene.GetEntityCount());
+		ImGui::Text("Update: %.3f ms  Cull: %.3f ms  Submit: %.3f ms", updateMs, cullMs, submitMs);
+
+		// Average times at each entity count, plus the cost per
+		// 1000 entities (which stays flat if things scale linearly)
+		const std::vector<StressTimingSample>& timings = stressScene.GetTimings();
+		if (!timings.empty() && ImGui::BeginTable("StressTimings", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Entities");
+			ImGui::TableSetupColumn("Update ms");
+			ImGui::TableSetupColumn("Cull ms");
+			ImGui::TableSetupColumn("Submit ms");
+			ImGui::TableSetupColumn("Total ms / 1k");
+			ImGui::TableHeadersRow();
+			for (auto& s : timings)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%u", s.EntityCount);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", s.UpdateMs);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", s.CullMs);
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", s.SubmitMs);
+				ImGui::TableNextColumn(); ImGui::Text("%.4f", s.EntityCount > 0 ? (s.UpdateMs + s.CullMs + s.SubmitMs) * 1000.0f / s.EntityCount : 0.0f);
+			}
+			ImGui::EndTable();
+		}
+
+		if (timings.size() > 1)
+		{
+			std::vector<float> update, cull, submit;
+			for (auto& s : timings)
+			{
+				update.push_back(s.UpdateMs);
+				cull.push_back(s.CullMs);
+				submit.push_back(s.SubmitMs);
+			}
+			ImGui::PlotLines("Update", update.data(), (int)update.size(), 0, 0, 0.0f, FLT_MAX, ImVec2(0, 50));
+			ImGui::PlotLines("Cull", cull.data(), (int)cull.size(), 0, 0, 0.0f, FLT_MAX, ImVec2(0, 50));
+			ImGui::PlotLines("Submit", submit.data(), (int)submit.size(), 0, 0, 0.0f, FLT_MAX, ImVec2(0, 50));
+		}
+
+		if (ImGui::Button("Export CSV"))
+			stressScene.ExportTimingsCSV(FixPath(L"stress_timings.csv"));
+		ImGui::SameLine();
+		if (ImGui::Button("Reset Timings"))
+			stressScene.ClearTimings();
+
 		ImGui::TreePop();
 	}
 
@@ -689,7 +1005,9 @@ void Game::BuildUI()
 	
 	if (ImGui::TreeNode("Scene Entities"))
 	{
-		for (int i = 0; i < entities.size(); i++)
+		// Stress scenes can have far too many to list
+		int listedEntities = min((int)entities.size(), 1000);
+		for (int i = 0; i < listedEntities; i++)
 		{
 			std::string title = "Entity ";
 			title.append(std::to_string(i)).append(" (").append(entities[i]->GetMesh()->GetName()).append(")");
@@ -725,6 +1043,8 @@ void Game::BuildUI()
 				ImGui::TreePop();
 			}
 		}
+		if ((int)entities.size() > listedEntities)
+			ImGui::Text("... and %d more", (int)entities.size() - listedEntities);
 
 		ImGui::TreePop();
 
@@ -770,7 +1090,7 @@ void Game::BuildUI()
 	{
 		int dirLights = 0;
 		int pointLights = 0;
-		XMFLOAT3 oldDir = lights[0].Direction;
+		int spotLights = 0;
 		for (int i = 0; i < (int)lights.size(); i++)
 		{
 			// Get the title
@@ -787,6 +1107,12 @@ void Game::BuildUI()
 				title.append("Point Light #");
 				title.append(std::to_string(pointLights));
 			}
+			else if (lights[i].Type == 2)
+			{
+				spotLights++;
+				title.append("Spot Light #");
+				title.append(std::to_string(spotLights));
+			}
 
 			if (ImGui::TreeNode(title.c_str()))
 			{
@@ -826,17 +1152,393 @@ void Game::BuildUI()
 				{
 					ImGui::DragFloat("Range", &lights[i].Range, 0.1f, 0.0f, 10000.0f);
 				}
+				if (lights[i].Type == 2)
+				{
+					ImGui::DragFloat("Spot Falloff", &lights[i].SpotFalloff, 0.1f, 0.0f, 256.0f);
+				}
 
 				ImGui::TreePop();
 			}
 		}
 
-		if (lights[0].Direction.x != oldDir.x ||
-			lights[0].Direction.y != oldDir.y ||
-			lights[0].Direction.z != oldDir.z) {
-			UpdateLightViewMatrix(lights[0]);
+		// How point & spot lights are assigned, and stats for
+		// the last published frame
+		const SceneSnapshot& scene = sceneSnapshots.GetReadBuffer();
+		ImGui::Spacing();
+		int assignment = perObjectLights ? 1 : 0;
+		ImGui::RadioButton("Clustered", &assignment, 0);
+		ImGui::SameLine();
+		ImGui::RadioButton("Per Object (Top K)", &assignment, 1);
+		perObjectLights = assignment == 1;
+
+		if (scene.PerObjectLights)
+		{
+			ImGui::SliderInt("Lights Per Object", &objectLightLimit, 1, MAX_OBJECT_LIGHTS);
+
+			unsigned int listed = 0;
+			unsigned int objects = 0;
+			for (size_t i = 0; i < scene.ObjectLights.size(); i++)
+			{
+				if (!scene.Visible[i]) continue;
+				listed += scene.ObjectLights[i].Count;
+				objects++;
+			}
+			ImGui::Text("Light Grid: %u cells, %u entries", lightGrid.GetCellCount(), lightGrid.GetEntryCount());
+			ImGui::Text("Average Lights Per Visible Object: %.2f", objects > 0 ? (float)listed / objects : 0.0f);
+		}
+		else
+		{
+			unsigned int busiestCluster = 0;
+			for (auto& range : scene.ClusterRanges)
+				busiestCluster = max(busiestCluster, range.Count);
+			ImGui::Text("Clusters: %u x %u x %u", LightClusters::CountX, LightClusters::CountY, LightClusters::CountZ);
+			ImGui::Text("Cluster Light Indices: %u", (unsigned int)scene.ClusterLightIndices.size());
+			ImGui::Text("Most Lights In One Cluster: %u", busiestCluster);
+		}
+
+		// The CPU copy of the lighting functions (ShadingReference.h)
+		ImGui::Spacing();
+		if (ImGui::Button("Run CPU Shading Check"))
+		{
+			shadingCheck = RunShadingReferenceCheck(100000);
+		}
+		if (shadingCheck.SampleCount > 0)
+		{
+			ImGui::Text("Golden Values: %u of %u wrong", shadingCheck.GoldenFailures, shadingCheck.GoldenCount);
+			ImGui::Text("%u samples, 5 lights", shadingCheck.SampleCount);
+			ImGui::Text("One at a Time: %.2f ms", shadingCheck.ScalarMs);
+			ImGui::Text("%u Wide: %.2f ms (max error %g)", shadingCheck.BatchWidth, shadingCheck.BatchMs, shadingCheck.BatchMaxError);
+		}
+
+		ImGui::TreePop();
+	}
+
+	// --------------------------------------------
+	// SKY LIGHTING - baked image based lighting or SH ambient
+	// --------------------------------------------
+
+	if (ImGui::TreeNode("Sky Lighting"))
+	{
+		ImGui::Combo("Ambient", &ambientMode, "None\0Spherical Harmonics\0Image Based Lighting\0");
+		ImGui::SliderFloat("Intensity", &skyLightingIntensity, 0.0f, 2.0f);
+
+		const IBLBakeResult& lighting = sky->GetLighting();
+		ImGui::Text("Source Hash: %016llx", lighting.SourceHash);
+		if (lighting.FromCache)
+			ImGui::Text("Loaded from cache");
+		else
+			ImGui::Text("Baked: specular %.1f ms, irradiance %.1f ms, BRDF %.1f ms",
+				lighting.SpecularMs, lighting.IrradianceMs, lighting.LookUpMs);
+		ImGui::Text("Specular: %u x %u, %u mips", lighting.Specular[0].Size, lighting.Specular[0].Size, (unsigned int)lighting.Specular.size());
+		ImGui::Text("Irradiance: %u x %u", lighting.Irradiance.Size, lighting.Irradiance.Size);
+		if (ImGui::Button("Rebake (Skip Cache)"))
+		{
+			sky->BakeLighting(IBLBakeSettings(), false);
+		}
+
+		// Bake times at a few specular sizes
+		if (ImGui::Button("Run Bake Benchmark"))
+		{
+			skyLightingBenchmark = RunIBLBenchmark(sky->GetLightingSource());
+		}
+		if (!skyLightingBenchmark.Rows.empty())
+		{
+			ImGui::Text("Source %u x %u, %u threads", skyLightingBenchmark.SourceSize, skyLightingBenchmark.SourceSize, skyLightingBenchmark.ThreadCount);
+			for (const IBLBenchmarkRow& row : skyLightingBenchmark.Rows)
+			{
+				ImGui::BulletText("%u: specular %.1f ms, irradiance %.1f ms, BRDF %.1f ms",
+					row.SpecularSize, row.SpecularMs, row.IrradianceMs, row.LookUpMs);
+			}
+		}
+
+		// The SH version, and how close it gets to integrating
+		// the sky directly
+		ImGui::Text("SH Projection: %.2f ms", sky->GetAmbientMs());
+		if (ImGui::Button("Reproject SH"))
+		{
+			sky->ProjectAmbient();
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Run SH Reference Check"))
+		{
+			ambientCheck = RunSHReferenceCheck(sky->GetLightingSource());
+		}
+		if (ambientCheck.NormalCount > 0)
+		{
+			ImGui::Text("Projection %.2f ms, brute force %.1f ms", ambientCheck.ProjectMs, ambientCheck.BruteForceMs);
+			ImGui::Text("Coefficient error: %g", ambientCheck.CoefficientError);
+			ImGui::Text("Irradiance error (%u normals): %.2f%%", ambientCheck.NormalCount, ambientCheck.IrradianceError * 100.0f);
+		}
+
+		ImGui::TreePop();
+	}
+
+	// --------------------------------------------
+	// SHADER VARIANTS - features compiled in or out
+	// --------------------------------------------
+
+	if (ImGui::TreeNode("Shader Variants"))
+	{
+		bool useVariants = shaderVariants->GetEnabled();
+		if (ImGui::Checkbox("Use Compiled Variants", &useVariants))
+			shaderVariants->SetEnabled(useVariants);
+		ImGui::Checkbox("Shadows", &shadowsInShaders);
+		ImGui::Checkbox("Cel Shading", &celShading);
+
+		ImGui::Text("This frame: %ls (+ normal mapped)", ShaderVariantCache::GetFileName(frameShaderFeatures).c_str());
+		ImGui::Text("Loaded: %u, missing: %u", shaderVariants->GetLoadedCount(), shaderVariants->GetMissingCount());
+
+		ImGui::TreePop();
+	}
+
+	// --------------------------------------------
+	// TEXTURES - startup loading & deduplication
+	// --------------------------------------------
+
+	if (ImGui::TreeNode("Textures"))
+	{
+		const TextureLoadStats& stats = textureManager->GetStats();
+		ImGui::Text("Requested: %u, files: %u, unique images: %u", stats.Requested, stats.Files, stats.Images);
+		if (stats.Failed > 0)
+			ImGui::Text("Failed: %u", stats.Failed);
+		ImGui::Text("Startup load: %.1f ms", stats.TotalMs);
+		ImGui::Text("  Read & hash: %.1f ms", stats.ReadMs);
+		ImGui::Text("  Decode: %.1f ms", stats.DecodeMs);
+		ImGui::Text("  Upload: %.1f ms", stats.UploadMs);
+		ImGui::Text("Cooked: %u, from cache: %u", stats.Cooked, stats.FromCache);
+		ImGui::Text("GPU memory: %.1f MB (%.1f MB as RGBA8)", stats.Bytes / (1024.0 * 1024.0), stats.UncompressedBytes / (1024.0 * 1024.0));
+
+		ImGui::Spacing();
+		if (ImGui::BeginTable("TextureList", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("File");
+			ImGui::TableSetupColumn("Format");
+			ImGui::TableSetupColumn("KB");
+			ImGui::TableSetupColumn("PSNR");
+			ImGui::TableHeadersRow();
+			for (const std::shared_ptr<Texture>& texture : textureManager->GetTextures())
+			{
+				size_t slash = texture->Path.find_last_of(L"\\/");
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%ls", texture->Path.c_str() + (slash == std::wstring::npos ? 0 : slash + 1));
+				ImGui::TableNextColumn(); ImGui::Text("%s", TextureManager::GetFormatName(texture->Format));
+				ImGui::TableNextColumn(); ImGui::Text("%.0f", texture->Bytes / 1024.0);
+				ImGui::TableNextColumn();
+				if (texture->FromCache)
+					ImGui::Text("(cached)");
+				else if (texture->PSNR > 0.0f)
+					ImGui::Text("%.1f dB", texture->PSNR);
+				else
+					ImGui::Text("-");
+			}
+			ImGui::EndTable();
+		}
+
+		ImGui::Spacing();
+		if (ImGui::Button("Run Loading Benchmark"))
+			textureBenchmark = textureManager->RunBenchmark();
+		if (textureBenchmark.Requested > 0)
+		{
+			ImGui::Text("One at a time (%u loads): %.1f ms", textureBenchmark.Requested, textureBenchmark.SerialMs);
+			ImGui::Text("Texture manager: %.1f ms (%.1fx)", textureBenchmark.Manager.TotalMs,
+				textureBenchmark.SerialMs / textureBenchmark.Manager.TotalMs);
+		}
+
+		if (ImGui::Button("Run Compression Benchmark"))
+			compressionBenchmark = textureManager->RunCompressionBenchmark();
+		if (!compressionBenchmark.Rows.empty())
+		{
+			ImGui::Text("%ux%u, %u threads", compressionBenchmark.Width, compressionBenchmark.Height, compressionBenchmark.ThreadCount);
+			for (const TextureCompressionBenchmarkRow& row : compressionBenchmark.Rows)
+			{
+				ImGui::Text("%s: %.1f ms (1 thread: %.1f ms), %.1f MP/s, %.1f dB", GetCodecName(row.Codec),
+					row.MultiThreadMs, row.SingleThreadMs, row.MegapixelsPerSecond, row.PSNR);
+			}
+		}
+
+		// What packing each material's ORM texture saves the normal
+		// mapped shader, per pixel & in memory
+		ImGui::Spacing();
+		ImGui::Text("ORM textures: %u packed, %u up to date, %u failed (%.1f ms, %u threads)",
+			ormPack.Packed, ormPack.UpToDate, ormPack.Failed, ormPack.TotalMs, ormPack.ThreadCount);
+		if (!ormPack.Rows.empty() && ImGui::BeginTable("ORMTextures", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Material");
+			ImGui::TableSetupColumn("Size");
+			ImGui::TableSetupColumn("Samples");
+			ImGui::TableSetupColumn("Bytes / Pixel");
+			ImGui::TableSetupColumn("KB");
+			ImGui::TableHeadersRow();
+			unsigned long long separateBytes = 0;
+			unsigned long long packedBytes = 0;
+			for (const ORMPackRow& row : ormPack.Rows)
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%ls%s", row.Name.c_str(), row.Failed ? " (failed)" : "");
+				ImGui::TableNextColumn(); ImGui::Text("%ux%u", row.Width, row.Height);
+				ImGui::TableNextColumn(); ImGui::Text("%u -> 1", row.Maps);
+				ImGui::TableNextColumn(); ImGui::Text("%.1f -> %.1f", row.SeparateBytesPerPixel, row.PackedBytesPerPixel);
+				ImGui::TableNextColumn(); ImGui::Text("%.0f -> %.0f", row.SeparateBytes / 1024.0, row.PackedBytes / 1024.0);
+				if (!row.Failed)
+				{
+					separateBytes += row.SeparateBytes;
+					packedBytes += row.PackedBytes;
+				}
+			}
+			ImGui::EndTable();
+			ImGui::Text("Samples saved per pixel: %u over %u materials, memory: %.1f MB -> %.1f MB", ormPack.SamplesSaved,
+				(unsigned int)ormPack.Rows.size(), separateBytes / (1024.0 * 1024.0), packedBytes / (1024.0 * 1024.0));
+		}
+		if (ImGui::Button("Repack ORM Textures (Used Next Run)"))
+			ormPack = PackORMTextures(FixPath(L"../../Assets/Textures/"), FixPath(L""), true);
+
+		if (ImGui::Button("Run Mip Benchmark"))
+			mipBenchmark = textureManager->RunMipBenchmark();
+		if (!mipBenchmark.Rows.empty())
+		{
+			ImGui::Text("%ux%u, %u threads", mipBenchmark.Width, mipBenchmark.Height, mipBenchmark.ThreadCount);
+			for (const MipGenerationBenchmarkRow& row : mipBenchmark.Rows)
+			{
+				ImGui::Text("%s (%s): %.1f ms (1 thread: %.1f ms), %.1f MP/s, 1x1 off by %.2f", GetMipFilterName(row.Filter),
+					row.Linear ? "linear" : "gamma", row.MultiThreadMs, row.SingleThreadMs, row.MegapixelsPerSecond, row.AverageError);
+			}
+		}
+
+		ImGui::TreePop();
+	}
+
+	// --------------------------------------------
+	// TEXTURE STREAMING - resident vs. requested mips
+	// --------------------------------------------
+
+	if (ImGui::TreeNode("Texture Streaming"))
+	{
+		const TextureResidency& residency = textureStreamer->GetResidency();
+		StreamingSettings streamingSettings = textureStreamer->GetSettings();
+		bool budgetChanged = ImGui::SliderInt("Budget (MB)", &textureBudgetMB, 1, 128);
+		bool biasChanged = ImGui::SliderFloat("Mip Bias", &textureMipBias, -2.0f, 4.0f);
+		if (budgetChanged || biasChanged)
+		{
+			streamingSettings.BudgetBytes = (unsigned long long)textureBudgetMB * 1024 * 1024;
+			streamingSettings.MipBias = textureMipBias;
+			textureStreamer->SetSettings(streamingSettings);
+		}
+
+		const TextureStreamingStats& stats = textureStreamer->GetStats();
+		ImGui::Text("Streamed textures: %u, uses this frame: %u", (unsigned int)residency.GetTextures().size(), (unsigned int)textureUses.size());
+		ImGui::Text("Committed: %.1f MB, requested: %.1f MB, everything: %.1f MB",
+			residency.GetCommittedBytes() / (1024.0 * 1024.0),
+			residency.GetRequestedBytes() / (1024.0 * 1024.0),
+			residency.GetFullBytes() / (1024.0 * 1024.0));
+		ImGui::Text("Loads: %llu (%llu failed, %.1f MB, %.2f ms each), evictions: %llu",
+			stats.Loads, stats.FailedLoads, stats.LoadedBytes / (1024.0 * 1024.0), stats.LoadMs, stats.Evictions);
+
+		// Each texture's top mip on the GPU against what was asked for
+		ImGui::Spacing();
+		if (ImGui::BeginTable("StreamedTextures", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("File");
+			ImGui::TableSetupColumn("Resident");
+			ImGui::TableSetupColumn("Requested");
+			ImGui::TableSetupColumn("Loading");
+			ImGui::TableSetupColumn("Last Used");
+			ImGui::TableHeadersRow();
+			const std::vector<StreamedTexture>& textures = residency.GetTextures();
+			for (unsigned int i = 0; i < textures.size(); i++)
+			{
+				const StreamedTexture& texture = textures[i];
+				const std::wstring& path = textureStreamer->GetPath(i);
+				size_t slash = path.find_last_of(L"\\/");
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%ls", path.c_str() + (slash == std::wstring::npos ? 0 : slash + 1));
+				ImGui::TableNextColumn(); ImGui::Text("%u (%u)", texture.Resident, max(1u, texture.Desc.Width >> texture.Resident));
+				ImGui::TableNextColumn(); ImGui::Text("%u (%u)", texture.Requested, max(1u, texture.Desc.Width >> texture.Requested));
+				ImGui::TableNextColumn();
+				if (texture.Loading != texture.Resident)
+					ImGui::Text("%u", texture.Loading);
+				else
+					ImGui::Text("-");
+				ImGui::TableNextColumn(); ImGui::Text("%llu ago", residency.GetFrame() - texture.LastUsed);
+			}
+			ImGui::EndTable();
+		}
+
+		// The same textures & uses, along synthetic camera paths
+		ImGui::Spacing();
+		if (ImGui::Button("Run Streaming Simulation"))
+		{
+			StreamingScene streamingScene = textureStreamer->MakeScene(textureUses, textureView.FieldOfView, textureView.Aspect, textureView.ScreenHeight);
+			streamingSimulation = RunStreamingSimulation(streamingScene, streamingSettings);
+		}
+		if (!streamingSimulation.Rows.empty())
+		{
+			ImGui::Text("Budget: %.1f MB of %.1f MB", streamingSimulation.BudgetBytes / (1024.0 * 1024.0), streamingSimulation.FullBytes / (1024.0 * 1024.0));
+			for (const StreamingSimulationResult& row : streamingSimulation.Rows)
+			{
+				ImGui::Text("%s: %u loads (%.1f MB), %u evictions, peak %.1f MB, %u frames over", GetStreamingPathName(row.Path),
+					row.Loads, row.LoadedBytes / (1024.0 * 1024.0), row.Evictions, row.PeakBytes / (1024.0 * 1024.0), row.FramesOverBudget);
+				ImGui::Text("  %.0f%% sharp, %.2f mips short on average (worst %u), %.1f us / update",
+					row.SharpUses * 100.0f, row.AverageDeficit, row.WorstDeficit, row.UpdateMicroseconds);
+			}
+		}
+
+		ImGui::TreePop();
+	}
+
+	// --------------------------------------------
+	// SHADOWS - atlas tiles, update budget & caching
+	// --------------------------------------------
+
+	if (ImGui::TreeNode("Shadows"))
+	{
+		const ShadowAtlasAllocator& allocator = shadowAtlas->GetAllocator();
+		ImGui::Checkbox("Cache Static Casters", &shadowCaching);
+		ImGui::SliderInt("Always Updated Tiles", &shadowAlwaysUpdate, 0, 8);
+		ImGui::SliderInt("Update Budget (Tiles / Frame)", &shadowUpdateBudget, 0, 16);
+		ImGui::SliderInt("Cube Face Budget (Faces / Frame)", &shadowFaceBudget, 0, 24);
+
+		ImGui::Text("Atlas: %u x %u, %u tiles (%u dropped), %u layouts",
+			allocator.GetAtlasSize(), allocator.GetAtlasSize(),
+			(unsigned int)allocator.GetTiles().size(), allocator.GetDroppedCount(), allocator.GetLayoutVersion());
+		ImGui::Text("Tiles Drawn Last Frame: %u", shadowAtlas->GetTilesDrawn());
+		unsigned long long staticRedraws = shadowAtlas->GetStaticRedraws();
+		unsigned long long staticSkips = shadowAtlas->GetStaticSkips();
+		ImGui::Text("Static Tile Redraws: %llu", staticRedraws);
+		ImGui::Text("Static Tile Redraws Skipped: %llu", staticSkips);
+		ImGui::Text("Skip Rate: %.1f%%", staticRedraws + staticSkips > 0 ? 100.0 * staticSkips / (staticRedraws + staticSkips) : 0.0);
+		if (ImGui::Button("Reset Counters"))
+			shadowAtlas->ResetCounters();
+
+		// Each tile, most important first
+		static const char* faceNames[] = { "+X", "-X", "+Y", "-Y", "+Z", "-Z" };
+		if (!allocator.GetTiles().empty() && ImGui::BeginTable("ShadowTiles", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+		{
+			ImGui::TableSetupColumn("Light");
+			ImGui::TableSetupColumn("Face");
+			ImGui::TableSetupColumn("Importance");
+			ImGui::TableSetupColumn("Size");
+			ImGui::TableSetupColumn("Position");
+			ImGui::TableSetupColumn("Age");
+			ImGui::TableHeadersRow();
+			for (auto& tile : allocator.GetTiles())
+			{
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn(); ImGui::Text("%u", tile.LightIndex);
+				ImGui::TableNextColumn();
+				if (tile.Face >= 0)
+					ImGui::Text("%s", faceNames[tile.Face]);
+				else
+					ImGui::TextUnformatted("-");
+				ImGui::TableNextColumn(); ImGui::Text("%.3f", tile.Importance);
+				ImGui::TableNextColumn(); ImGui::Text("%u", tile.Size);
+				ImGui::TableNextColumn(); ImGui::Text("%u, %u", tile.X, tile.Y);
+				ImGui::TableNextColumn(); ImGui::Text("%u", tile.Age);
+			}
+			ImGui::EndTable();
 		}
 
+		ImGui::Image((void*)shadowAtlas->GetSRV().Get(), ImVec2(256, 256));
+
 		ImGui::TreePop();
 	}
 
@@ -846,9 +1548,76 @@ void Game::BuildUI()
 
 	if (ImGui::TreeNode("Post-Processing"))
 	{
-		if (ImGui::TreeNode("Box Blur")) 
+		if (ImGui::TreeNode("Chain"))
+		{
+			const RenderTargetPool& pool = postChain->GetPool();
+			for (const PostProcessStage& stage : postChain->GetStages())
+				ImGui::BulletText("%s%s", stage.Name.c_str(), stage.Enabled ? "" : " (off)");
+			ImGui::Text("Passes Last Frame: %u", postChain->GetPassCount());
+			ImGui::Text("Targets: %u textures for %u outputs",
+				(unsigned int)pool.GetSlots().size(), (unsigned int)pool.GetAssignments().size());
+			ImGui::Text("Target Memory: %.1f MB (%.1f MB unpooled)",
+				pool.GetPooledBytes() / (1024.0 * 1024.0), pool.GetUnpooledBytes() / (1024.0 * 1024.0));
+			ImGui::Text("Textures Created: %u", postChain->GetTexturesCreated());
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Blur")) 
 		{
 			ImGui::SliderInt("Blur Radius ", &blurRadius, 0, 10);
+			ImGui::Combo("Blur Mode", &blurMode, "Separable (2 passes)\0Sliding Window (Compute)\0Brute Force (1 pass)\0Dual Filter (Pyramid)\0");
+			if (blurMode == BLUR_MODE_DUAL_FILTER)
+				ImGui::SliderInt("Dual Filter Levels", &dualBlurLevels, 0, MAX_PYRAMID_LEVELS);
+
+			// What each would cost at 4K (R8G8B8A8 box blurs, half float pyramid)
+			PostProcessCost boxCost = GetBoxBlurCost(3840, 2160, blurRadius, 4);
+			PostProcessCost separableCost = GetSeparableBlurCost(3840, 2160, blurRadius, 4);
+			PostProcessCost dualCost = GetDualFilterBlurCost(3840, 2160, (unsigned int)dualBlurLevels, 8);
+			ImGui::Text("Cost at 4K (samples / sampled MB / memory MB):");
+			ImGui::BulletText("Brute Force: %.1fM / %.0f / %.0f", boxCost.Samples / 1e6, boxCost.SampledBytes / 1e6, boxCost.MemoryBytes / 1e6);
+			ImGui::BulletText("Separable: %.1fM / %.0f / %.0f", separableCost.Samples / 1e6, separableCost.SampledBytes / 1e6, separableCost.MemoryBytes / 1e6);
+			ImGui::BulletText("Dual Filter (%d levels): %.1fM / %.0f / %.0f", dualBlurLevels, dualCost.Samples / 1e6, dualCost.SampledBytes / 1e6, dualCost.MemoryBytes / 1e6);
+
+			// The same blurs on the CPU, checked against brute force
+			ImGui::Spacing();
+			if (ImGui::Button("Run CPU Blur Benchmark"))
+			{
+				blurBenchmark = RunBoxBlurBenchmark(640, 360, blurRadius);
+			}
+			if (blurBenchmark.Width > 0)
+			{
+				ImGui::Text("%u x %u, radius %d", blurBenchmark.Width, blurBenchmark.Height, blurBenchmark.Radius);
+				ImGui::Text("Brute Force: %.2f ms", blurBenchmark.BruteForceMs);
+				ImGui::Text("Separable: %.2f ms (max error %g)", blurBenchmark.SeparableMs, blurBenchmark.SeparableMaxError);
+				ImGui::Text("Sliding Window: %.2f ms (max error %g)", blurBenchmark.SlidingWindowMs, blurBenchmark.SlidingWindowMaxError);
+			}
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Bloom"))
+		{
+			ImGui::Checkbox("Bloom", &bloomEnabled);
+			ImGui::SliderInt("Mip Levels", &bloomLevels, 1, MAX_PYRAMID_LEVELS);
+			ImGui::SliderFloat("Threshold", &bloomThreshold, 0.0f, 1.0f);
+			ImGui::SliderFloat("Intensity", &bloomIntensity, 0.0f, 4.0f);
+
+			PostProcessCost bloomCost = GetBloomCost(3840, 2160, (unsigned int)bloomLevels, 8);
+			ImGui::Text("Cost at 4K: %u passes, %.1fM samples, %.0f MB sampled, %.0f MB memory",
+				bloomCost.Passes, bloomCost.Samples / 1e6, bloomCost.SampledBytes / 1e6, bloomCost.MemoryBytes / 1e6);
+
+			// The same pyramid on the CPU
+			if (ImGui::Button("Run CPU Dual Filter Benchmark"))
+			{
+				dualFilterBenchmark = RunDualFilterBenchmark(640, 360, (unsigned int)bloomLevels, bloomThreshold);
+			}
+			if (dualFilterBenchmark.Width > 0)
+			{
+				ImGui::Text("%u x %u, %u levels", dualFilterBenchmark.Width, dualFilterBenchmark.Height, dualFilterBenchmark.Levels);
+				ImGui::Text("Blur: %.2f ms (mean change %g)", dualFilterBenchmark.BlurMs, dualFilterBenchmark.BlurMeanChange);
+				ImGui::Text("Bloom: %.2f ms", dualFilterBenchmark.BloomMs);
+			}
 
 			ImGui::TreePop();
 		}
@@ -968,6 +1737,9 @@ void Game::BuildUI()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	PROFILE_FUNCTION();
+	auto updateStart = std::chrono::high_resolution_clock::now();
+
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::GetInstance().KeyDown(VK_ESCAPE))
 		Quit();
@@ -989,12 +1761,220 @@ void Game::Update(float deltaTime, float totalTime)
 	else 
 		entities[1]->GetTransform()->MoveAbsolute(-0.02f * deltaTime, -0.04f * deltaTime, 0.0f);
 
-	// Update camera
-	cameras[activeCameraIndex]->Update(deltaTime);
+	// Update camera (from the scripted path when benchmarking)
+	if (benchmark)
+		benchmark->UpdateCamera(totalTime, cameras[activeCameraIndex]);
+	else
+		cameras[activeCameraIndex]->Update(deltaTime);
 
-	// Refresh UI
+	// Generated stress entities
+	stressScene.Animate(totalTime, entities);
+	updateMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - updateStart).count();
+
+	// Hand the results off to the renderer
+	PublishSnapshot(deltaTime, totalTime);
+}
+
+// --------------------------------------------------------
+// Refresh the UI - always runs on the main thread, before
+// this frame's Update()
+// --------------------------------------------------------
+void Game::UpdateUI(float deltaTime, float totalTime)
+{
+	PROFILE_FUNCTION();
 	UpdateImGui(deltaTime, totalTime);
 	BuildUI();
+	Profiler::GetInstance().BuildUI();
+
+	if (benchmark)
+		UpdateBenchmark();
+
+	// Stress timings & sweep steps (the sim thread is idle here)
+	if (stressScene.GetEntityCount() > 0)
+		stressScene.RecordTiming(updateMs, cullMs, submitMs);
+	StressSceneSettings next;
+	if (stressScene.UpdateSweep(next))
+	{
+		stressSettings = next;
+		stressScene.Generate(stressSettings, meshes, materials, entities, lights);
+		entityListVersion++;
+	}
+}
+
+// --------------------------------------------------------
+// Records the previous frame (which has fully finished by
+// the time the UI runs) and ends the run once enough frames
+// have been recorded
+// --------------------------------------------------------
+void Game::UpdateBenchmark()
+{
+	if (benchmark->IsFinished())
+		return;
+
+	// Skip the very first frame, which includes loading
+	unsigned int recordedFrames = frameTimes.GetFrameCount();
+	if (frameTimes.GetTotalFrameCount() < 2 || recordedFrames == 0)
+		return;
+
+	float frameMs = frameTimes.GetFrameTime(recordedFrames - 1);
+	benchmark->RecordFrame(frameMs, drawCallCount, triangleCount);
+
+	if (benchmark->IsFinished())
+	{
+		bool written = benchmark->WriteReport();
+		printf("Benchmark finished (%u frames), report %s %ls\n",
+			benchmark->GetRecordedFrameCount(),
+			written ? "written to" : "could not be written to",
+			benchmarkSettings.ReportFile.c_str());
+		Quit();
+	}
+}
+
+// --------------------------------------------------------
+// Copies everything Draw() needs out of the live scene and
+// publishes it.  Draw() never reads the live transforms,
+// camera or lights directly, so it can run at the same
+// time as the next Update().
+// --------------------------------------------------------
+void Game::PublishSnapshot(float deltaTime, float totalTime)
+{
+	PROFILE_FUNCTION();
+	auto cullStart = std::chrono::high_resolution_clock::now();
+	SceneSnapshot& scene = sceneSnapshots.GetWriteBuffer();
+	scene.FrameIndex = simulationFrame++;
+	scene.DeltaTime = deltaTime;
+	scene.TotalTime = totalTime;
+
+	// Camera
+	std::shared_ptr<Camera> camera = cameras[activeCameraIndex];
+	scene.CameraView = camera->GetViewMatrix();
+	scene.CameraProjection = camera->GetProjectionMatrix();
+	scene.CameraPosition = camera->GetTransform()->GetPosition();
+
+	// World space view frustum for culling
+	BoundingFrustum frustum;
+	BoundingFrustum::CreateFromMatrix(frustum, XMLoadFloat4x4(&scene.CameraProjection));
+	frustum.Transform(frustum, XMMatrixInverse(0, XMLoadFloat4x4(&scene.CameraView)));
+
+	// Spatial index for picking each entity's strongest lights
+	bool objectLights = perObjectLights;
+	unsigned int lightLimit = (unsigned int)objectLightLimit;
+	if (objectLights)
+		lightGrid.Build(lights);
+
+	// Entity transforms, culling & light lists, spread across the
+	// workers (every entity has its own transform, so no sharing)
+	unsigned int entityCount = (unsigned int)entities.size();
+	scene.WorldMatrices.resize(entityCount);
+	scene.WorldInvTransposeMatrices.resize(entityCount);
+	scene.Visible.resize(entityCount);
+	scene.EntityBounds.resize(entityCount);
+	scene.ObjectLights.resize(entityCount);
+	casterBounds.resize(entityCount);
+	casterDynamic.resize(entityCount);
+	bool cull = frustumCulling;
+	std::atomic<unsigned long long> staticVersionSum(0);
+	JobSystem::GetInstance().ParallelFor(entityCount, [&](unsigned int begin, unsigned int end)
+	{
+		unsigned long long versionSum = 0;
+		for (unsigned int i = begin; i < end; i++)
+		{
+			std::shared_ptr<Transform> transform = entities[i]->GetTransform();
+			casterDynamic[i] = entities[i]->IsDynamic();
+			if (!casterDynamic[i])
+				versionSum += transform->GetVersion();
+
+			scene.WorldMatrices[i] = transform->GetWorldMatrix();
+			scene.WorldInvTransposeMatrices[i] = transform->GetWorldInverseTransposeMatrix();
+
+			BoundingSphere& bounds = casterBounds[i];
+			entities[i]->GetMesh()->GetBounds().Transform(bounds, XMLoadFloat4x4(&scene.WorldMatrices[i]));
+			scene.Visible[i] = !cull || frustum.Intersects(bounds);
+			scene.EntityBounds[i] = bounds;
+
+			scene.ObjectLights[i].Count = 0;
+			if (objectLights && scene.Visible[i])
+				lightGrid.Query(bounds, lightLimit, scene.ObjectLights[i]);
+		}
+		staticVersionSum += versionSum;
+	}, 64);
+
+	// Versions only ever go up, so the sum changes whenever any
+	// static transform does
+	scene.StaticShadowKey = staticVersionSum.load();
+	scene.StaticShadowKey = scene.StaticShadowKey * 31 + entityListVersion;
+
+	// Lights, and which of them get shadow atlas tiles this frame
+	scene.Lights = lights;
+	shadowAtlas->Prepare(
+		scene.Lights,
+		scene.CameraPosition,
+		frustum,
+		scene.StaticShadowKey,
+		(unsigned int)max(0, shadowAlwaysUpdate),
+		(unsigned int)max(0, shadowUpdateBudget),
+		(unsigned int)max(0, shadowFaceBudget),
+		casterBounds,
+		casterDynamic,
+		scene.ShadowViews,
+		scene.ShadowInfos);
+	scene.PerObjectLights = objectLights;
+	if (objectLights)
+	{
+		ClusterRange empty = {};
+		scene.ClusterRanges.assign(LightClusters::ClusterCount, empty);
+		scene.ClusterLightIndices.clear();
+	}
+	else
+	{
+		lightClusters->Bin(scene.Lights, scene.CameraView, scene.CameraProjection, scene.ClusterRanges, scene.ClusterLightIndices);
+	}
+
+	cullMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cullStart).count();
+	sceneSnapshots.Publish();
+}
+
+// --------------------------------------------------------
+// Every texture of every visible entity's material, with
+// the entity's bounds, for the streamer to size mips from
+// --------------------------------------------------------
+void Game::UpdateTextureStreaming(const SceneSnapshot& scene)
+{
+	size_t count = min(entities.size(), min(scene.Visible.size(), scene.EntityBounds.size()));
+	textureUses.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!scene.Visible[i])
+			continue;
+
+		std::shared_ptr<Material> material = entities[i]->GetMaterial();
+		XMFLOAT2 uvScale = material->GetUVScale();
+		for (auto& t : material->GetTextures())
+		{
+			int index = textureStreamer->Find(t.second.get());
+			if (index < 0)
+				continue;
+
+			TextureUse use = {};
+			use.Texture = (unsigned int)index;
+			use.Center = scene.EntityBounds[i].Center;
+			use.Radius = scene.EntityBounds[i].Radius;
+			use.UVScale = max(uvScale.x, uvScale.y);
+			textureUses.push_back(use);
+		}
+	}
+
+	// The camera's forward is the view matrix's third column, and
+	// the projection's y scale is 1 / tan(fov / 2)
+	const XMFLOAT4X4& view = scene.CameraView;
+	const XMFLOAT4X4& projection = scene.CameraProjection;
+	textureView.Position = scene.CameraPosition;
+	textureView.Forward = XMFLOAT3(view._13, view._23, view._33);
+	textureView.FieldOfView = 2.0f * atanf(1.0f / projection._22);
+	textureView.Aspect = projection._22 / projection._11;
+	textureView.ScreenHeight = (float)windowHeight;
+
+	textureStreamer->Update(textureView, textureUses);
 }
 
 // --------------------------------------------------------
@@ -1002,6 +1982,39 @@ void Game::Update(float deltaTime, float totalTime)
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	PROFILE_FUNCTION();
+
+	// Grab the most recently simulated frame.  When the
+	// simulation is threaded this is the previous frame,
+	// since this frame's Update() is still running.
+	const SceneSnapshot& scene = sceneSnapshots.Acquire();
+	size_t drawCount = min(entities.size(), scene.WorldMatrices.size());
+
+	// Swap in streamed texture mips before anything binds them
+	UpdateTextureStreaming(scene);
+
+	// Count what this frame actually submits
+	drawCallCount = 0;
+	triangleCount = 0;
+	auto submitStart = std::chrono::high_resolution_clock::now();
+
+	// Directional lights go in each shader's cbuffer, and point
+	// & spot lights go through the light clusters (any of them
+	// can be shadowed, through their ShadowIndex)
+	Light directionalLights[MAX_LIGHTS] = {};
+	int directionalLightCount = 0;
+	for (size_t i = 0; i < scene.Lights.size() && directionalLightCount < MAX_LIGHTS; i++)
+	{
+		if (scene.Lights[i].Type == LIGHT_TYPE_DIRECTIONAL)
+			directionalLights[directionalLightCount++] = scene.Lights[i];
+	}
+
+	// Which pixel shader variants this frame needs
+	frameShaderFeatures = SHADER_FEATURE_LIGHTS(directionalLightCount);
+	if (isFog == 1) frameShaderFeatures |= SHADER_FEATURE_FOG;
+	if (shadowsInShaders) frameShaderFeatures |= SHADER_FEATURE_SHADOWS;
+	if (celShading) frameShaderFeatures |= SHADER_FEATURE_CEL;
+
 	// ----------------------------------
 	// Frame START - happens once per frame before anything else
 	// ----------------------------------
@@ -1018,94 +2031,170 @@ void Game::Draw(float deltaTime, float totalTime)
 	// Shadow Mapping
 	// ----------------------------------
 
-	context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
-	ID3D11RenderTargetView* nullRTV{};
-	context->OMSetRenderTargets(1, &nullRTV, shadowDSV.Get());
-	context->PSSetShader(0, 0, 0);
-	context->RSSetState(shadowRasterizer.Get());
+	{
+		PROFILE_SCOPE("Shadow Pass");
+		context->PSSetShader(0, 0, 0);
 
-	D3D11_VIEWPORT viewport = {};
-	viewport.Width = (float)shadowMapResolution;
-	viewport.Height = (float)shadowMapResolution;
-	viewport.MaxDepth = 1.0f;
-	context->RSSetViewports(1, &viewport);
+		// Draws either the static or the dynamic entities into one atlas
+		// tile (just the ones that reach it, for point light faces)
+		auto drawCasters = [&](const ShadowView& view, bool dynamic)
+		{
+			VS_Shadow->SetShader();
+			VS_Shadow->SetMatrix4x4("view", view.View);
+			VS_Shadow->SetMatrix4x4("projection", view.Projection);
+			size_t casterCount = view.CullCasters ? view.Casters.size() : drawCount;
+			for (size_t c = 0; c < casterCount; c++)
+			{
+				size_t i = view.CullCasters ? view.Casters[c] : c;
+				if (i >= drawCount || entities[i]->IsDynamic() != dynamic)
+					continue;
 
-	VS_Shadow->SetShader();
-	VS_Shadow->SetMatrix4x4("view", lightViewMatrix);
-	VS_Shadow->SetMatrix4x4("projection", lightProjectionMatrix);
+				VS_Shadow->SetMatrix4x4("world", scene.WorldMatrices[i]);
+				VS_Shadow->CopyAllBufferData();
+				entities[i]->GetMesh()->Draw();
 
-	// Loop and draw all entities
-	for (auto& e : entities)
-	{
-		VS_Shadow->SetMatrix4x4("world", e->GetTransform()->GetWorldMatrix());
-		VS_Shadow->CopyAllBufferData();
-		e->GetMesh()->Draw();
+				drawCallCount++;
+				triangleCount += entities[i]->GetMesh()->GetIndexCount() / 3;
+			}
+		};
+		shadowAtlas->Render(scene.ShadowViews, scene.ShadowInfos, shadowCaching, drawCasters);
+
+		D3D11_VIEWPORT viewport = {};
+		viewport.Width = (float)this->windowWidth;
+		viewport.Height = (float)this->windowHeight;
+		viewport.MaxDepth = 1.0f;
+		context->RSSetViewports(1, &viewport);
+		context->RSSetState(0);
+		context->OMSetRenderTargets(1, ppRTV.GetAddressOf(), depthBufferDSV.Get());
 	}
 
-	viewport.Width = (float)this->windowWidth;
-	viewport.Height = (float)this->windowHeight;
-	context->RSSetViewports(1, &viewport);
-	context->RSSetState(0);
-	context->OMSetRenderTargets(1, ppRTV.GetAddressOf(), depthBufferDSV.Get());
-
 
 	// ----------------------------------
 	// Draw Geometry
 	// ----------------------------------
 
-	// Call draw for each game entity
-	for (int i = 0; i < entities.size(); i++) 
 	{
-		entities[i]->GetMaterial()->GetVertexShader()->SetMatrix4x4("lightView", lightViewMatrix);
-		entities[i]->GetMaterial()->GetVertexShader()->SetMatrix4x4("lightProjection", lightProjectionMatrix);
-		entities[i]->GetMaterial()->GetPixelShader()->SetFloat3("ambient", ambientColor);
-		entities[i]->GetMaterial()->GetPixelShader()->SetFloat("numLights", (float)lights.size());
-		entities[i]->GetMaterial()->GetPixelShader()->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
-		entities[i]->GetMaterial()->GetPixelShader()->SetShaderResourceView("ShadowMap", shadowSRV);
-		entities[i]->GetMaterial()->GetPixelShader()->SetSamplerState("ShadowSampler", shadowSampler);
-		entities[i]->GetMaterial()->GetPixelShader()->SetInt("fog", isFog);
-		entities[i]->GetMaterial()->GetPixelShader()->SetFloat3("fogColor", fogColor);
-		entities[i]->GetMaterial()->GetPixelShader()->SetFloat("startFog", startFog);
-		entities[i]->GetMaterial()->GetPixelShader()->SetFloat("fullFog", fullFog);
-		entities[i]->Draw(context, cameras[activeCameraIndex], totalTime);
+		PROFILE_SCOPE("Main Pass");
+
+		// Every cluster's lights, once for the whole frame
+		lightClusters->Upload(scene.Lights, scene.ClusterRanges, scene.ClusterLightIndices);
+
+		// The PBR shaders' whole buffer (see ConstantBuffers.h), minus
+		// each material's part - copied in at once for every entity
+		PBRPixelShaderData frameData = {};
+		frameData.CameraPosition = scene.CameraPosition;
+		frameData.Ambient = sky->GetAmbient(ambientMode == AMBIENT_MODE_SH ? skyLightingIntensity : 0.0f);
+		frameData.NumLights = (float)directionalLightCount;
+		for (int l = 0; l < directionalLightCount; l++)
+			frameData.Lights[l] = directionalLights[l];
+		frameData.FogColor = fogColor;
+		frameData.StartFog = startFog;
+		frameData.FullFog = fullFog;
+		frameData.Fog = isFog;
+
+		// Call draw for each game entity
+		for (size_t i = 0; i < drawCount; i++) 
+		{
+			// Culled this frame?  (Still casts shadows above)
+			if (!scene.Visible[i])
+				continue;
+
+			std::shared_ptr<Material> material = entities[i]->GetMaterial();
+			material->SelectShaderVariant(frameShaderFeatures);
+			std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
+			if (material->UsesShaderVariants())
+			{
+				PBRPixelShaderData pixelData = frameData;
+				material->FillShaderData(pixelData);
+				ps->SetBuffer("ExternalData", pixelData);
+			}
+			else
+			{
+				ps->SetInt("fog", isFog);
+				ps->SetFloat3("fogColor", fogColor);
+				ps->SetFloat("startFog", startFog);
+				ps->SetFloat("fullFog", fullFog);
+			}
+
+			lightClusters->SetShaderData(ps, scene.CameraView, scene.CameraProjection, (float)windowWidth, (float)windowHeight);
+			ps->SetInt("useObjectLights", scene.PerObjectLights ? 1 : 0);
+			ps->SetData("objectLightIndices", scene.ObjectLights[i].Indices, sizeof(scene.ObjectLights[i].Indices));
+			ps->SetInt("objectLightCount", (int)scene.ObjectLights[i].Count);
+			shadowAtlas->SetShaderData(ps);
+			sky->SetLightingShaderData(ps, ambientMode == AMBIENT_MODE_IBL ? skyLightingIntensity : 0.0f);
+			entities[i]->Draw(
+				context,
+				scene.WorldMatrices[i],
+				scene.WorldInvTransposeMatrices[i],
+				scene.CameraView,
+				scene.CameraProjection,
+				scene.CameraPosition,
+				scene.TotalTime);
+
+			drawCallCount++;
+			triangleCount += entities[i]->GetMesh()->GetIndexCount() / 3;
+		}
 	}
 
-	sky->Draw(cameras[activeCameraIndex]);
+	submitMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - submitStart).count();
+
+	{
+		PROFILE_SCOPE("Sky");
+		sky->Draw(scene.CameraView, scene.CameraProjection);
+
+		drawCallCount++;
+		triangleCount += sky->GetMesh()->GetIndexCount() / 3;
+	}
 
 
 	// ----------------------------------
 	// Frame END - happens once per frame after drawing everything
 	// ----------------------------------
 	{
-		// Restore back buffer
-		context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), 0);
-
-		// Activate shaders 
-		ppVS->SetShader();
-		ppPS->SetShader();
-		ppPS->SetShaderResourceView("Pixels", ppSRV.Get());
-		ppPS->SetSamplerState("ClampSampler", ppSampler.Get());
-	
-		ppPS->SetInt("blurRadius", blurRadius);
-		ppPS->SetFloat("pixelWidth", 1.0f / windowWidth);
-		ppPS->SetFloat("pixelHeight", 1.0f / windowHeight);
+		{
+			PROFILE_SCOPE("Post Process");
+
+			// Only the blur that's selected (if any) runs
+			postChain->SetEnabled("Blur Horizontal", blurRadius > 0 && blurMode == BLUR_MODE_SEPARABLE);
+			postChain->SetEnabled("Blur Vertical", blurRadius > 0 && blurMode == BLUR_MODE_SEPARABLE);
+			postChain->SetEnabled("Blur Rows", blurRadius > 0 && blurMode == BLUR_MODE_SLIDING_WINDOW);
+			postChain->SetEnabled("Blur Columns", blurRadius > 0 && blurMode == BLUR_MODE_SLIDING_WINDOW);
+			postChain->SetEnabled("Blur Brute Force", blurRadius > 0 && blurMode == BLUR_MODE_BRUTE_FORCE);
+			for (int level = 0; level <= MAX_PYRAMID_LEVELS; level++)
+			{
+				std::string number = std::to_string(level);
+				bool dualBlur = blurMode == BLUR_MODE_DUAL_FILTER;
+				postChain->SetEnabled("Dual Blur Down " + number, dualBlur && level >= 1 && level <= dualBlurLevels);
+				postChain->SetEnabled("Dual Blur Up " + number, dualBlur && level < dualBlurLevels);
+				postChain->SetEnabled("Bloom Down " + number, bloomEnabled && level >= 1 && level <= bloomLevels);
+				postChain->SetEnabled("Bloom Up " + number, bloomEnabled && level >= 1 && level < bloomLevels);
+			}
+			postChain->SetEnabled("Bloom Composite", bloomEnabled);
 
-		ppPS->CopyAllBufferData();
-		
+			// Scene color through the chain, ending on the back buffer
+			postChain->Execute(ppSRV, backBufferRTV);
 
-		context->Draw(3, 0);
+			drawCallCount += postChain->GetPassCount();
+			triangleCount += postChain->GetPassCount();
+		}
 
 		// Present the back buffer to the user
 		//  - Puts the results of what we've drawn onto the window
 		//  - Without this, the user never sees anything
 		bool vsyncNecessary = vsync || !deviceSupportsTearing || isFullscreen;
 
-		ImGui::Render(); // Turns this frames UI into renderable triangles
-		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData()); // Draws it to the screen
+		{
+			PROFILE_SCOPE("ImGui");
+			ImGui::Render(); // Turns this frames UI into renderable triangles
+			ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData()); // Draws it to the screen
+		}
 
-		swapChain->Present(
-			vsyncNecessary ? 1 : 0,
-			vsyncNecessary ? 0 : DXGI_PRESENT_ALLOW_TEARING);
+		{
+			PROFILE_SCOPE("Present");
+			swapChain->Present(
+				vsyncNecessary ? 1 : 0,
+				vsyncNecessary ? 0 : DXGI_PRESENT_ALLOW_TEARING);
+		}
 
 		// Must re-bind buffers after presenting, as they become unbound
 		context->OMSetRenderTargets(1, backBufferRTV.GetAddressOf(), depthBufferDSV.Get());
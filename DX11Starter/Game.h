@@ -12,13 +12,42 @@
 #include "Material.h"
 #include "Lights.h"
 #include "Sky.h"
+#include "SceneSnapshot.h"
+#include "TripleBuffer.h"
+#include "JobSystem.h"
+#include "Benchmark.h"
+#include "StressScene.h"
+#include "LightClusters.h"
+#include "LightGrid.h"
+#include "ShadowAtlas.h"
+#include "BoxBlur.h"
+#include "DualFilter.h"
+#include "PostProcessChain.h"
+#include "ShadingReference.h"
+#include "TextureManager.h"
+#include "TextureStreamer.h"
+#include "TexturePacking.h"
+
+// Ways of doing the post process box blur (CPU versions in BoxBlur.h)
+#define BLUR_MODE_SEPARABLE			0	// Horizontal then vertical pixel shader pass
+#define BLUR_MODE_SLIDING_WINDOW	1	// Compute shader running sums, any radius for the same cost
+#define BLUR_MODE_BRUTE_FORCE		2	// The whole (2r+1)^2 box in one pass
+#define BLUR_MODE_DUAL_FILTER		3	// Down & up a half resolution pyramid (DualFilter.h)
+
+// Where the ambient light comes from - both are the sky
+#define AMBIENT_MODE_NONE			0
+#define AMBIENT_MODE_SH				1	// L2 spherical harmonics irradiance (SphericalHarmonics.h)
+#define AMBIENT_MODE_IBL			2	// Baked irradiance & specular maps (IBLBaker.h)
+
+// Deepest dual filter pyramid (blur or bloom) the post chain has stages for
+#define MAX_PYRAMID_LEVELS			8
 
 class Game 
 	: public DXCore
 {
 
 public:
-	Game(HINSTANCE hInstance);
+	Game(HINSTANCE hInstance, const BenchmarkSettings& benchmarkSettings = BenchmarkSettings());
 	~Game();
 
 	// Overridden setup and game loop methods, which
@@ -27,12 +56,22 @@ public:
 	void OnResize();
 	void Update(float deltaTime, float totalTime);
 	void Draw(float deltaTime, float totalTime);
+	void UpdateUI(float deltaTime, float totalTime);
 
 private:
 
 	// UI variables
 	float bgColor[4] = { 0.2f, 0.2f, 0.2f, 1.0f };
 	int blurRadius = 0;
+	int blurMode = BLUR_MODE_SEPARABLE;
+	BoxBlurBenchmarkResults blurBenchmark = {};
+	int dualBlurLevels = 4;
+	bool bloomEnabled = false;
+	int bloomLevels = 5;
+	float bloomThreshold = 0.8f;
+	float bloomIntensity = 1.0f;
+	DualFilterBenchmarkResults dualFilterBenchmark = {};
+	ShadingReferenceResults shadingCheck = {};
 	bool showDemoUI = false;
 	bool thisBox = false;
 	bool thatBox = false;
@@ -42,6 +81,10 @@ private:
 	std::vector<std::shared_ptr<Material>> materials;
 	std::vector<std::shared_ptr<GameEntity>> entities;
 	std::vector<Light> lights;
+	std::shared_ptr<LightClusters> lightClusters;
+	LightGrid lightGrid;
+	bool perObjectLights = false;	// Top-K lists instead of clusters
+	int objectLightLimit = 4;
 	std::vector<std::shared_ptr<Camera>> cameras;
 	int activeCameraIndex = 0;
 	std::shared_ptr<Sky> sky;
@@ -49,6 +92,7 @@ private:
 	// Initialization helper methods
 	void InitShadows();
 	void InitPostProcessing();
+	void ResizePostProcessing();
 	void LoadShaders(); 
 	void CreateGeometry();
 	void CreateEntities();
@@ -58,6 +102,31 @@ private:
 	void UpdateImGui(float deltaTime, float totalTime);
 	void BuildUI();
 
+	// Simulation -> render hand-off
+	TripleBuffer<SceneSnapshot> sceneSnapshots;
+	unsigned long long simulationFrame = 0;
+	void PublishSnapshot(float deltaTime, float totalTime);
+
+	// Job system & culling
+	bool frustumCulling = true;
+	JobSystemBenchmarkResults jobBenchmark = {};
+
+	// Benchmark mode (see Benchmark.h)
+	BenchmarkSettings benchmarkSettings;
+	std::shared_ptr<Benchmark> benchmark;
+	void UpdateBenchmark();
+
+	// Per-frame rendering stats, filled in by Draw()
+	unsigned int drawCallCount = 0;
+	unsigned int triangleCount = 0;
+
+	// Stress testing - generated entities and CPU timings
+	StressScene stressScene;
+	StressSceneSettings stressSettings;
+	float updateMs = 0.0f;	// Game::Update, minus PublishSnapshot()
+	float cullMs = 0.0f;	// PublishSnapshot()
+	float submitMs = 0.0f;	// Shadow & main pass submission
+
 	// Buffers to hold actual geometry data
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
@@ -70,30 +139,68 @@ private:
 	std::shared_ptr<SimpleVertexShader> VS_Sky;
 	std::shared_ptr<SimplePixelShader> PS_Sky;
 	std::shared_ptr<SimpleVertexShader> VS_Shadow;
+	std::shared_ptr<SimplePixelShader> PS_ShadowCopy;
 	std::vector<std::shared_ptr<SimplePixelShader>> customShaders;
-	DirectX::XMFLOAT3 ambientColor = { 0.337f, 0.357f, 0.361f };
 
-	// Shadows and shadow-related constructs
-	int shadowMapResolution = 1024;	// Ideally a power of 2
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowSRV;
-	Microsoft::WRL::ComPtr<ID3D11RasterizerState> shadowRasterizer;
-	Microsoft::WRL::ComPtr<ID3D11SamplerState> shadowSampler;
-	DirectX::XMFLOAT4X4 lightViewMatrix;
-	DirectX::XMFLOAT4X4 lightProjectionMatrix;
+	// Compiled variants of the PBR pixel shaders (see ShaderVariants.h),
+	// picked each frame from what's turned on
+	std::shared_ptr<ShaderVariantCache> shaderVariants;
+	bool shadowsInShaders = true;
+	bool celShading = false;
+	unsigned int frameShaderFeatures = 0;
+
+	// Every texture the materials use (see TextureManager.h)
+	std::shared_ptr<TextureManager> textureManager;
+	TextureLoadBenchmarkResults textureBenchmark = {};
+	TextureCompressionBenchmarkResults compressionBenchmark = {};
+	MipGenerationBenchmarkResults mipBenchmark = {};
+	ORMPackResults ormPack = {};
+
+	// Cooked textures' mips streamed in & out under a budget (see
+	// TextureStreamer.h), from what the visible entities need
+	std::shared_ptr<TextureStreamer> textureStreamer;
+	int textureBudgetMB = 16;
+	float textureMipBias = 0.0f;
+	std::vector<TextureUse> textureUses;
+	StreamingView textureView = {};
+	StreamingSimulationResults streamingSimulation = {};
+	void UpdateTextureStreaming(const SceneSnapshot& scene);
+
+	// Ambient light from the sky - image based lighting baked from
+	// it (see IBLBaker.h), or just its irradiance as SH
+	int ambientMode = AMBIENT_MODE_IBL;
+	float skyLightingIntensity = 1.0f;
+	IBLBenchmarkResults skyLightingBenchmark = {};
+	SHReferenceResults ambientCheck = {};
+
+	// Shadows - every shadowed light gets a tile of one atlas
+	// (see ShadowAtlas.h), and static casters are cached per tile
+	std::shared_ptr<ShadowAtlas> shadowAtlas;
+	int shadowAtlasSize = 4096;		// Ideally a power of 2
+	int shadowAlwaysUpdate = 2;		// Most important tiles, redrawn every frame
+	int shadowUpdateBudget = 2;		// Other tiles redrawn per frame, round robin
+	int shadowFaceBudget = 6;		// Point light cube faces redrawn per frame, round robin
+	bool shadowCaching = true;
+	unsigned int entityListVersion = 0;	// Bumped when entities are added/removed
+	std::vector<DirectX::BoundingSphere> casterBounds;	// World space, per entity (for cube face culling)
+	std::vector<unsigned char> casterDynamic;
 
 	// Post-processing effects
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> ppSampler;
 	std::shared_ptr<SimpleVertexShader> ppVS;
 	std::shared_ptr<SimplePixelShader> ppPS;
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> ppRTV;
+	std::shared_ptr<SimplePixelShader> PS_BlurSeparable;
+	std::shared_ptr<SimpleComputeShader> CS_BoxBlur;
+	std::shared_ptr<SimplePixelShader> PS_PostCopy;
+	std::shared_ptr<SimplePixelShader> PS_DualFilterDown;
+	std::shared_ptr<SimplePixelShader> PS_DualFilterUp;
+	std::shared_ptr<SimplePixelShader> PS_BloomComposite;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> ppRTV;		// The scene's color, before post processing
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ppSRV;
+	std::shared_ptr<PostProcessChain> postChain;
 	int isFog  = 0;
 	float startFog = 0.0f;
 	float fullFog = 15.0f;
 	DirectX::XMFLOAT3 fogColor = { 0.8f, 0.8f, 0.8f };
-
-	// Light matrix calculations
-	void UpdateLightViewMatrix(Light light);
 };
 
@@ -38,6 +38,11 @@ DirectX::XMFLOAT4 GameEntity::GetColorTint()
 	return colorTint;
 }
 
+bool GameEntity::IsDynamic()
+{
+	return isDynamic;
+}
+
 // ======================
 // SETTERS
 // ======================
@@ -57,11 +62,41 @@ void GameEntity::SetColorTint(float r, float g, float b, float a)
 	colorTint = { r, g, b, a };
 }
 
+void GameEntity::SetDynamic(bool dynamic)
+{
+	isDynamic = dynamic;
+}
+
 void GameEntity::Draw(
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, 
 	std::shared_ptr<Camera> camera,
 	float totalTime
 	)
+{
+	Draw(
+		context,
+		transform->GetWorldMatrix(),
+		transform->GetWorldInverseTransposeMatrix(),
+		camera->GetViewMatrix(),
+		camera->GetProjectionMatrix(),
+		camera->GetTransform()->GetPosition(),
+		totalTime);
+}
+
+// --------------------------------------------------------
+// Draws the entity using matrices captured ahead of time
+// (from a SceneSnapshot) rather than the live transform
+// and camera, which may be changing on another thread
+// --------------------------------------------------------
+void GameEntity::Draw(
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const DirectX::XMFLOAT4X4& world,
+	const DirectX::XMFLOAT4X4& worldInvTranspose,
+	const DirectX::XMFLOAT4X4& view,
+	const DirectX::XMFLOAT4X4& projection,
+	DirectX::XMFLOAT3 cameraPosition,
+	float totalTime
+	)
 {
 	// Set shaders
 	material->GetVertexShader()->SetShader();
@@ -73,18 +108,23 @@ void GameEntity::Draw(
 	// Set up data for vertex shader
 	std::shared_ptr<SimpleVertexShader> vs = material->GetVertexShader();
 
-	vs->SetMatrix4x4("world", transform->GetWorldMatrix());
-	vs->SetMatrix4x4("view", camera->GetViewMatrix());
-	vs->SetMatrix4x4("projection", camera->GetProjectionMatrix());
-	vs->SetMatrix4x4("worldInvTranspose", transform->GetWorldInverseTransposeMatrix());
+	VertexShaderData vsData = {};
+	vsData.World = world;
+	vsData.View = view;
+	vsData.Projection = projection;
+	vsData.WorldInvTranspose = worldInvTranspose;
+	vs->SetBuffer("ExternalData", vsData);
 
-	// Set up data for pixel shader
+	// Set up data for pixel shader - the PBR shaders' buffer
+	// has already been filled in whole (see ConstantBuffers.h)
 	std::shared_ptr<SimplePixelShader> ps = material->GetPixelShader();
-
-	ps->SetFloat4("colorTint", material->GetColorTint());
-	ps->SetFloat("totalTime", totalTime);
-	ps->SetFloat("roughness", material->GetRoughness());
-	ps->SetFloat3("cameraPosition", camera->GetTransform()->GetPosition());
+	if (!material->UsesShaderVariants())
+	{
+		ps->SetFloat4("colorTint", material->GetColorTint());
+		ps->SetFloat("totalTime", totalTime);
+		ps->SetFloat("roughness", material->GetRoughness());
+		ps->SetFloat3("cameraPosition", cameraPosition);
+	}
 
 	// Map/MemCopy/Unmap
 	vs->CopyAllBufferData();
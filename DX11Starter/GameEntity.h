@@ -17,16 +17,27 @@ public:
 	std::shared_ptr<Material> GetMaterial();
 
 	DirectX::XMFLOAT4 GetColorTint();
+	bool IsDynamic();
 
 	void SetMaterial(std::shared_ptr<Material> material);
 	void SetColorTint(DirectX::XMFLOAT4 color);
 	void SetColorTint(float r, float g, float b, float a);
+	void SetDynamic(bool dynamic);
 
 	void Draw(
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
 		std::shared_ptr<Camera> camera,
 		float totalTime
 	);
+	void Draw(
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		const DirectX::XMFLOAT4X4& world,
+		const DirectX::XMFLOAT4X4& worldInvTranspose,
+		const DirectX::XMFLOAT4X4& view,
+		const DirectX::XMFLOAT4X4& projection,
+		DirectX::XMFLOAT3 cameraPosition,
+		float totalTime
+	);
 
 private:
 	std::shared_ptr<Mesh> mesh;
@@ -34,4 +45,7 @@ private:
 	std::shared_ptr<Material> material;
 
 	DirectX::XMFLOAT4 colorTint = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	// Moves every frame?  (Dynamic entities skip the shadow cache)
+	bool isDynamic = false;
 };
\ No newline at end of file
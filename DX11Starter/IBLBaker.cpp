@@ -0,0 +1,539 @@
+#include "IBLBaker.h"
+#include "CubeShadowFaces.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <xmmintrin.h>
+
+using namespace DirectX;
+
+static const float Pi = 3.14159265359f;
+static const unsigned int CacheMagic = 0x314C4249;	// "IBL1"
+
+static void Resize(CubeImage& image, unsigned int size)
+{
+	image.Size = size;
+	for (int f = 0; f < 6; f++)
+		image.Faces[f].assign((size_t)size * size * 4, 0.0f);
+}
+
+// --------------------------------------------------------
+// Direction through the center of a face's texel, and back
+// (D3D's cube layout - see "Cubic Environment Mapping" in
+// the D3D docs)
+// --------------------------------------------------------
+static XMFLOAT3 GetTexelDirection(unsigned int face, float u, float v)
+{
+	float s = u * 2 - 1;
+	float t = v * 2 - 1;
+	switch (face)
+	{
+	case 0: return XMFLOAT3(1, -t, -s);
+	case 1: return XMFLOAT3(-1, -t, s);
+	case 2: return XMFLOAT3(s, 1, t);
+	case 3: return XMFLOAT3(s, -1, -t);
+	case 4: return XMFLOAT3(s, -t, 1);
+	default: return XMFLOAT3(-s, -t, -1);
+	}
+}
+
+static void GetFaceUV(const XMFLOAT3& direction, unsigned int face, float& u, float& v)
+{
+	float s, t, major;
+	switch (face)
+	{
+	case 0: s = -direction.z; t = -direction.y; major = direction.x; break;
+	case 1: s = direction.z; t = -direction.y; major = -direction.x; break;
+	case 2: s = direction.x; t = direction.z; major = direction.y; break;
+	case 3: s = direction.x; t = -direction.z; major = -direction.y; break;
+	case 4: s = direction.x; t = -direction.y; major = direction.z; break;
+	default: s = -direction.x; t = -direction.y; major = -direction.z; break;
+	}
+	u = (s / major + 1) * 0.5f;
+	v = (t / major + 1) * 0.5f;
+}
+
+// --------------------------------------------------------
+// Bilinear sample of one mip, clamped at the face's edges
+// --------------------------------------------------------
+static __m128 SampleCube(const CubeImage& image, const XMFLOAT3& direction)
+{
+	unsigned int face = GetCubeFace(direction);
+	float u, v;
+	GetFaceUV(direction, face, u, v);
+
+	int last = (int)image.Size - 1;
+	float x = std::min(std::max(u * image.Size - 0.5f, 0.0f), (float)last);
+	float y = std::min(std::max(v * image.Size - 0.5f, 0.0f), (float)last);
+	int x0 = (int)x;
+	int y0 = (int)y;
+	int x1 = std::min(x0 + 1, last);
+	int y1 = std::min(y0 + 1, last);
+	__m128 fx = _mm_set1_ps(x - x0);
+	__m128 fy = _mm_set1_ps(y - y0);
+
+	const float* pixels = &image.Faces[face][0];
+	__m128 p00 = _mm_loadu_ps(pixels + ((size_t)y0 * image.Size + x0) * 4);
+	__m128 p10 = _mm_loadu_ps(pixels + ((size_t)y0 * image.Size + x1) * 4);
+	__m128 p01 = _mm_loadu_ps(pixels + ((size_t)y1 * image.Size + x0) * 4);
+	__m128 p11 = _mm_loadu_ps(pixels + ((size_t)y1 * image.Size + x1) * 4);
+	__m128 top = _mm_add_ps(p00, _mm_mul_ps(_mm_sub_ps(p10, p00), fx));
+	__m128 bottom = _mm_add_ps(p01, _mm_mul_ps(_mm_sub_ps(p11, p01), fx));
+	return _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fy));
+}
+
+// Halves each face (2x2 box) until it's 1x1
+static void BuildMipChain(const CubeImage& source, std::vector<CubeImage>& mips)
+{
+	mips.assign(1, source);
+	while (mips.back().Size > 1)
+	{
+		const CubeImage& above = mips.back();
+		CubeImage mip;
+		Resize(mip, above.Size / 2);
+		__m128 quarter = _mm_set1_ps(0.25f);
+		for (int f = 0; f < 6; f++)
+		{
+			for (unsigned int y = 0; y < mip.Size; y++)
+			{
+				const float* row0 = &above.Faces[f][(size_t)(y * 2) * above.Size * 4];
+				const float* row1 = row0 + (size_t)above.Size * 4;
+				float* out = &mip.Faces[f][(size_t)y * mip.Size * 4];
+				for (unsigned int x = 0; x < mip.Size; x++)
+				{
+					__m128 sum = _mm_add_ps(
+						_mm_add_ps(_mm_loadu_ps(row0 + x * 8), _mm_loadu_ps(row0 + x * 8 + 4)),
+						_mm_add_ps(_mm_loadu_ps(row1 + x * 8), _mm_loadu_ps(row1 + x * 8 + 4)));
+					_mm_storeu_ps(out + x * 4, _mm_mul_ps(sum, quarter));
+				}
+			}
+		}
+		mips.push_back(mip);
+	}
+}
+
+// --------------------------------------------------------
+// Importance sampling
+// --------------------------------------------------------
+static float RadicalInverse(unsigned int bits)
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return bits * 2.3283064365386963e-10f;
+}
+
+// Half vector around +Z for the GGX distribution (roughness is
+// squared first, like D_GGX() in the shaders)
+static XMFLOAT3 ImportanceSampleGGX(float x, float y, float roughness)
+{
+	float a = roughness * roughness;
+	float phi = 2 * Pi * x;
+	float cosTheta = sqrtf((1 - y) / (1 + (a * a - 1) * y));
+	float sinTheta = sqrtf(1 - cosTheta * cosTheta);
+	return XMFLOAT3(sinTheta * cosf(phi), sinTheta * sinf(phi), cosTheta);
+}
+
+// --------------------------------------------------------
+// Directions around +Z (padded to a multiple of four with
+// zero weights), each with its weight and the source mip
+// whose texels cover about as much of the sphere as it does
+// --------------------------------------------------------
+struct SampleSet
+{
+	std::vector<float> X, Y, Z, Weight, Mip;
+	float TotalWeight;
+};
+
+static void AddSample(SampleSet& set, const XMFLOAT3& direction, float weight, float mip)
+{
+	set.X.push_back(direction.x);
+	set.Y.push_back(direction.y);
+	set.Z.push_back(direction.z);
+	set.Weight.push_back(weight);
+	set.Mip.push_back(mip);
+	set.TotalWeight += weight;
+}
+
+static void PadSamples(SampleSet& set)
+{
+	while (set.X.size() % 4 != 0)
+		AddSample(set, XMFLOAT3(0, 0, 1), 0.0f, 0.0f);
+}
+
+// Mip whose texels' solid angle matches a sample of the given pdf
+// (no extra bias - a mip higher blurs the bake well away from the
+// true integral, see IBLBakerTests)
+static float GetSampleMip(float pdf, unsigned int sampleCount, unsigned int sourceSize)
+{
+	float texelSolidAngle = 4 * Pi / (6.0f * sourceSize * sourceSize);
+	float sampleSolidAngle = 1.0f / (sampleCount * pdf + 0.0001f);
+	return std::max(0.5f * log2f(sampleSolidAngle / texelSolidAngle), 0.0f);
+}
+
+// Reflections off a GGX surface, with n = v = r
+static void GetSpecularSamples(float roughness, unsigned int sampleCount, unsigned int sourceSize, unsigned int outputSize, SampleSet& set)
+{
+	set = SampleSet();
+	set.TotalWeight = 0.0f;
+
+	// Mirror - just resample the source at the output's size
+	if (roughness <= 0.0f)
+	{
+		AddSample(set, XMFLOAT3(0, 0, 1), 1.0f, log2f((float)sourceSize / outputSize));
+		PadSamples(set);
+		return;
+	}
+
+	float a = roughness * roughness;
+	for (unsigned int i = 0; i < sampleCount; i++)
+	{
+		XMFLOAT3 h = ImportanceSampleGGX((float)i / sampleCount, RadicalInverse(i), roughness);
+		XMFLOAT3 l(2 * h.z * h.x, 2 * h.z * h.y, 2 * h.z * h.z - 1);
+		if (l.z <= 0.0f)
+			continue;
+
+		// pdf = D * NdotH / (4 * VdotH), and NdotH = VdotH here
+		float denom = h.z * h.z * (a * a - 1) + 1;
+		float D = a * a / (Pi * denom * denom);
+		AddSample(set, l, l.z, GetSampleMip(D / 4, sampleCount, sourceSize));
+	}
+	PadSamples(set);
+}
+
+// Cosine weighted hemisphere - with a cosine pdf, the plain
+// average of the samples is the cosine weighted average
+static void GetIrradianceSamples(unsigned int sampleCount, unsigned int sourceSize, SampleSet& set)
+{
+	set = SampleSet();
+	set.TotalWeight = 0.0f;
+	for (unsigned int i = 0; i < sampleCount; i++)
+	{
+		float phi = 2 * Pi * (i + 0.5f) / sampleCount;
+		float r = sqrtf(RadicalInverse(i));
+		float z = sqrtf(std::max(1 - r * r, 0.0f));
+		AddSample(set, XMFLOAT3(r * cosf(phi), r * sinf(phi), z), 1.0f, GetSampleMip(z / Pi, sampleCount, sourceSize));
+	}
+	PadSamples(set);
+}
+
+// --------------------------------------------------------
+// Filters the source into one output cube.  Each texel turns
+// the sample set from +Z to its own direction (four samples
+// at a time), then fetches & weights each of them.
+// --------------------------------------------------------
+static void FilterCube(const std::vector<CubeImage>& sourceMips, const SampleSet& set, unsigned int size, CubeImage& result)
+{
+	Resize(result, size);
+	float lastMip = (float)(sourceMips.size() - 1);
+	__m128 inverseTotal = _mm_set1_ps(set.TotalWeight > 0.0f ? 1.0f / set.TotalWeight : 0.0f);
+
+	JobSystem::GetInstance().ParallelFor(6 * size, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int row = begin; row < end; row++)
+		{
+			unsigned int face = row / size;
+			unsigned int y = row % size;
+			for (unsigned int x = 0; x < size; x++)
+			{
+				// Tangent frame around this texel's direction
+				XMFLOAT3 n = GetTexelDirection(face, (x + 0.5f) / size, (y + 0.5f) / size);
+				float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+				n = XMFLOAT3(n.x / length, n.y / length, n.z / length);
+				XMFLOAT3 up = fabsf(n.z) < 0.999f ? XMFLOAT3(0, 0, 1) : XMFLOAT3(1, 0, 0);
+				XMFLOAT3 t(up.y * n.z - up.z * n.y, up.z * n.x - up.x * n.z, up.x * n.y - up.y * n.x);
+				length = sqrtf(t.x * t.x + t.y * t.y + t.z * t.z);
+				t = XMFLOAT3(t.x / length, t.y / length, t.z / length);
+				XMFLOAT3 b(n.y * t.z - n.z * t.y, n.z * t.x - n.x * t.z, n.x * t.y - n.y * t.x);
+
+				__m128 total = _mm_setzero_ps();
+				for (size_t s = 0; s < set.X.size(); s += 4)
+				{
+					__m128 sx = _mm_loadu_ps(&set.X[s]);
+					__m128 sy = _mm_loadu_ps(&set.Y[s]);
+					__m128 sz = _mm_loadu_ps(&set.Z[s]);
+					float wx[4], wy[4], wz[4];
+					_mm_storeu_ps(wx, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.x), sx), _mm_mul_ps(_mm_set1_ps(b.x), sy)), _mm_mul_ps(_mm_set1_ps(n.x), sz)));
+					_mm_storeu_ps(wy, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.y), sx), _mm_mul_ps(_mm_set1_ps(b.y), sy)), _mm_mul_ps(_mm_set1_ps(n.y), sz)));
+					_mm_storeu_ps(wz, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t.z), sx), _mm_mul_ps(_mm_set1_ps(b.z), sy)), _mm_mul_ps(_mm_set1_ps(n.z), sz)));
+
+					for (int lane = 0; lane < 4; lane++)
+					{
+						float weight = set.Weight[s + lane];
+						if (weight <= 0.0f)
+							continue;
+
+						unsigned int mip = (unsigned int)std::min(set.Mip[s + lane] + 0.5f, lastMip);
+						__m128 color = SampleCube(sourceMips[mip], XMFLOAT3(wx[lane], wy[lane], wz[lane]));
+						total = _mm_add_ps(total, _mm_mul_ps(color, _mm_set1_ps(weight)));
+					}
+				}
+				_mm_storeu_ps(&result.Faces[face][((size_t)y * size + x) * 4], _mm_mul_ps(total, inverseTotal));
+			}
+		}
+	});
+}
+
+// --------------------------------------------------------
+// The split sum's second half: for each NdotV (across) and
+// roughness (down), the scale & bias to apply to F0.  Uses
+// the IBL remapping of k (a / 2), not the direct light one.
+// Entirely SSE, four samples at a time.
+// --------------------------------------------------------
+static void BakeLookUp(unsigned int size, unsigned int sampleCount, std::vector<float>& lookUp)
+{
+	lookUp.assign((size_t)size * size * 2, 0.0f);
+	sampleCount = (sampleCount + 3) / 4 * 4;
+
+	// The sample pattern doesn't depend on the texel
+	std::vector<float> cosPhi(sampleCount), sinPhi(sampleCount), ys(sampleCount);
+	for (unsigned int i = 0; i < sampleCount; i++)
+	{
+		float phi = 2 * Pi * i / sampleCount;
+		cosPhi[i] = cosf(phi);
+		sinPhi[i] = sinf(phi);
+		ys[i] = RadicalInverse(i);
+	}
+
+	JobSystem::GetInstance().ParallelFor(size, [&](unsigned int begin, unsigned int end)
+	{
+		__m128 zero = _mm_setzero_ps();
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 two = _mm_set1_ps(2.0f);
+		for (unsigned int y = begin; y < end; y++)
+		{
+			float roughness = (y + 0.5f) / size;
+			float a = roughness * roughness;
+			__m128 a2MinusOne = _mm_set1_ps(a * a - 1);
+			__m128 k = _mm_set1_ps(a / 2);
+			__m128 oneMinusK = _mm_sub_ps(one, k);
+
+			for (unsigned int x = 0; x < size; x++)
+			{
+				float NdotV = (x + 0.5f) / size;
+				__m128 vx = _mm_set1_ps(sqrtf(1 - NdotV * NdotV));
+				__m128 vz = _mm_set1_ps(NdotV);
+				__m128 gv = _mm_div_ps(vz, _mm_add_ps(_mm_mul_ps(vz, oneMinusK), k));
+
+				__m128 scale = zero;
+				__m128 bias = zero;
+				for (unsigned int s = 0; s < sampleCount; s += 4)
+				{
+					// Half vector (ImportanceSampleGGX), then the light vector
+					__m128 sy = _mm_loadu_ps(&ys[s]);
+					__m128 cosTheta = _mm_sqrt_ps(_mm_div_ps(_mm_sub_ps(one, sy), _mm_add_ps(one, _mm_mul_ps(a2MinusOne, sy))));
+					__m128 sinTheta = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(cosTheta, cosTheta)), zero));
+					__m128 hx = _mm_mul_ps(sinTheta, _mm_loadu_ps(&cosPhi[s]));
+					__m128 hz = cosTheta;
+					__m128 VdotH = _mm_max_ps(_mm_add_ps(_mm_mul_ps(vx, hx), _mm_mul_ps(vz, hz)), zero);
+					__m128 NdotL = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(two, VdotH), hz), vz);
+
+					// G_Smith * VdotH / (NdotH * NdotV), only where the light is above the surface
+					__m128 gl = _mm_div_ps(NdotL, _mm_add_ps(_mm_mul_ps(NdotL, oneMinusK), k));
+					__m128 visibility = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(gv, gl), VdotH), _mm_mul_ps(hz, vz));
+					visibility = _mm_and_ps(visibility, _mm_cmpgt_ps(NdotL, zero));
+
+					// (1 - VdotH)^5
+					__m128 fc = _mm_sub_ps(one, VdotH);
+					__m128 fc2 = _mm_mul_ps(fc, fc);
+					fc = _mm_mul_ps(_mm_mul_ps(fc2, fc2), fc);
+
+					scale = _mm_add_ps(scale, _mm_mul_ps(_mm_sub_ps(one, fc), visibility));
+					bias = _mm_add_ps(bias, _mm_mul_ps(fc, visibility));
+				}
+
+				float scales[4], biases[4];
+				_mm_storeu_ps(scales, scale);
+				_mm_storeu_ps(biases, bias);
+				float* out = &lookUp[((size_t)y * size + x) * 2];
+				out[0] = (scales[0] + scales[1] + scales[2] + scales[3]) / sampleCount;
+				out[1] = (biases[0] + biases[1] + biases[2] + biases[3]) / sampleCount;
+			}
+		}
+	});
+}
+
+void BakeIBL(const CubeImage& source, const IBLBakeSettings& settings, IBLBakeResult& result)
+{
+	PROFILE_FUNCTION();
+	typedef std::chrono::high_resolution_clock Clock;
+
+	std::vector<CubeImage> sourceMips;
+	BuildMipChain(source, sourceMips);
+
+	// Specular, roughness evenly spaced down the mips
+	Clock::time_point start = Clock::now();
+	unsigned int mipCount = std::max(1u, settings.SpecularMips);
+	result.Specular.resize(mipCount);
+	SampleSet samples;
+	for (unsigned int mip = 0; mip < mipCount; mip++)
+	{
+		unsigned int size = std::max(1u, settings.SpecularSize >> mip);
+		float roughness = mipCount > 1 ? (float)mip / (mipCount - 1) : 0.0f;
+		GetSpecularSamples(roughness, settings.SpecularSamples, source.Size, size, samples);
+		FilterCube(sourceMips, samples, size, result.Specular[mip]);
+	}
+	Clock::time_point specularEnd = Clock::now();
+
+	GetIrradianceSamples(settings.IrradianceSamples, source.Size, samples);
+	FilterCube(sourceMips, samples, settings.IrradianceSize, result.Irradiance);
+	Clock::time_point irradianceEnd = Clock::now();
+
+	result.LookUpSize = settings.LookUpSize;
+	BakeLookUp(settings.LookUpSize, settings.LookUpSamples, result.LookUp);
+	Clock::time_point lookUpEnd = Clock::now();
+
+	result.SourceHash = HashIBLSource(source, settings);
+	result.FromCache = false;
+	result.SpecularMs = std::chrono::duration<double, std::milli>(specularEnd - start).count();
+	result.IrradianceMs = std::chrono::duration<double, std::milli>(irradianceEnd - specularEnd).count();
+	result.LookUpMs = std::chrono::duration<double, std::milli>(lookUpEnd - irradianceEnd).count();
+}
+
+// --------------------------------------------------------
+// 64 bit FNV-1a over the source texels, the settings and
+// the bake version
+// --------------------------------------------------------
+static void HashBytes(unsigned long long& hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+}
+
+unsigned long long HashIBLSource(const CubeImage& source, const IBLBakeSettings& settings)
+{
+	unsigned long long hash = 14695981039346656037ull;
+	unsigned int header[] = {
+		IBL_BAKE_VERSION, source.Size,
+		settings.SpecularSize, settings.SpecularMips, settings.SpecularSamples,
+		settings.IrradianceSize, settings.IrradianceSamples,
+		settings.LookUpSize, settings.LookUpSamples };
+	HashBytes(hash, header, sizeof(header));
+	for (int f = 0; f < 6; f++)
+		HashBytes(hash, source.Faces[f].data(), source.Faces[f].size() * sizeof(float));
+	return hash;
+}
+
+// --------------------------------------------------------
+// Cache file: magic, hash, then each cube (size, 6 faces)
+// and the look up table (size, texels)
+// --------------------------------------------------------
+static bool ReadCube(std::ifstream& file, CubeImage& cube, unsigned int expectedSize)
+{
+	unsigned int size = 0;
+	file.read((char*)&size, sizeof(size));
+	if (!file || size != expectedSize)
+		return false;
+
+	Resize(cube, size);
+	for (int f = 0; f < 6; f++)
+		file.read((char*)cube.Faces[f].data(), cube.Faces[f].size() * sizeof(float));
+	return (bool)file;
+}
+
+static void WriteCube(std::ofstream& file, const CubeImage& cube)
+{
+	file.write((const char*)&cube.Size, sizeof(cube.Size));
+	for (int f = 0; f < 6; f++)
+		file.write((const char*)cube.Faces[f].data(), cube.Faces[f].size() * sizeof(float));
+}
+
+bool LoadIBLCache(const std::wstring& path, unsigned long long hash, const IBLBakeSettings& settings, IBLBakeResult& result)
+{
+	// Only MSVC's streams take wide paths (the tests build elsewhere)
+#ifdef _MSC_VER
+	std::ifstream file(path, std::ios::binary);
+#else
+	std::ifstream file(std::string(path.begin(), path.end()), std::ios::binary);
+#endif
+	if (!file.is_open())
+		return false;
+
+	unsigned int magic = 0;
+	unsigned long long fileHash = 0;
+	unsigned int mipCount = 0;
+	file.read((char*)&magic, sizeof(magic));
+	file.read((char*)&fileHash, sizeof(fileHash));
+	file.read((char*)&mipCount, sizeof(mipCount));
+	if (!file || magic != CacheMagic || fileHash != hash || mipCount != std::max(1u, settings.SpecularMips))
+		return false;
+
+	IBLBakeResult loaded = {};
+	loaded.Specular.resize(mipCount);
+	for (unsigned int mip = 0; mip < mipCount; mip++)
+	{
+		if (!ReadCube(file, loaded.Specular[mip], std::max(1u, settings.SpecularSize >> mip)))
+			return false;
+	}
+	if (!ReadCube(file, loaded.Irradiance, settings.IrradianceSize))
+		return false;
+
+	file.read((char*)&loaded.LookUpSize, sizeof(loaded.LookUpSize));
+	if (!file || loaded.LookUpSize != settings.LookUpSize)
+		return false;
+	loaded.LookUp.resize((size_t)loaded.LookUpSize * loaded.LookUpSize * 2);
+	file.read((char*)loaded.LookUp.data(), loaded.LookUp.size() * sizeof(float));
+	if (!file)
+		return false;
+
+	loaded.SourceHash = hash;
+	loaded.FromCache = true;
+	result = std::move(loaded);
+	return true;
+}
+
+bool SaveIBLCache(const std::wstring& path, const IBLBakeResult& result)
+{
+#ifdef _MSC_VER
+	std::ofstream file(path, std::ios::binary);
+#else
+	std::ofstream file(std::string(path.begin(), path.end()), std::ios::binary);
+#endif
+	if (!file.is_open())
+		return false;
+
+	unsigned int mipCount = (unsigned int)result.Specular.size();
+	file.write((const char*)&CacheMagic, sizeof(CacheMagic));
+	file.write((const char*)&result.SourceHash, sizeof(result.SourceHash));
+	file.write((const char*)&mipCount, sizeof(mipCount));
+	for (const CubeImage& mip : result.Specular)
+		WriteCube(file, mip);
+	WriteCube(file, result.Irradiance);
+	file.write((const char*)&result.LookUpSize, sizeof(result.LookUpSize));
+	file.write((const char*)result.LookUp.data(), result.LookUp.size() * sizeof(float));
+	return (bool)file;
+}
+
+IBLBenchmarkResults RunIBLBenchmark(const CubeImage& source)
+{
+	IBLBenchmarkResults results = {};
+	results.SourceSize = source.Size;
+	results.ThreadCount = JobSystem::GetInstance().GetThreadCount();
+
+	// The other maps scale along with the specular one
+	const unsigned int sizes[] = { 32, 64, 128, 256 };
+	for (unsigned int size : sizes)
+	{
+		IBLBakeSettings settings;
+		settings.SpecularSize = size;
+		settings.IrradianceSize = std::max(8u, size / 4);
+		settings.LookUpSize = size;
+
+		IBLBakeResult result;
+		BakeIBL(source, settings, result);
+
+		IBLBenchmarkRow row = { size, result.SpecularMs, result.IrradianceMs, result.LookUpMs };
+		results.Rows.push_back(row);
+	}
+	return results;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Bump whenever the baked results would change, so old cache
+// files are ignored
+#define IBL_BAKE_VERSION	2
+
+// --------------------------------------------------------
+// A cube of linear RGBA float faces, in D3D's order:
+// +X, -X, +Y, -Y, +Z, -Z (rows top to bottom)
+// --------------------------------------------------------
+struct CubeImage
+{
+	unsigned int Size;
+	std::vector<float> Faces[6];	// 4 floats per texel
+};
+
+// --------------------------------------------------------
+// How big & how well sampled each baked map is
+// --------------------------------------------------------
+struct IBLBakeSettings
+{
+	unsigned int SpecularSize = 128;		// Top mip - roughness 0
+	unsigned int SpecularMips = 6;			// Roughness 0 to 1, evenly spaced
+	unsigned int SpecularSamples = 64;
+	unsigned int IrradianceSize = 32;
+	unsigned int IrradianceSamples = 256;
+	unsigned int LookUpSize = 128;
+	unsigned int LookUpSamples = 256;
+};
+
+// --------------------------------------------------------
+// Everything the shaders need for image based lighting
+// (see ImageBasedLighting.hlsli)
+// --------------------------------------------------------
+struct IBLBakeResult
+{
+	std::vector<CubeImage> Specular;	// One per mip
+	CubeImage Irradiance;
+	unsigned int LookUpSize;
+	std::vector<float> LookUp;			// 2 floats per texel: F0 scale & bias, for (NdotV, roughness)
+
+	unsigned long long SourceHash;
+	bool FromCache;
+	double SpecularMs;
+	double IrradianceMs;
+	double LookUpMs;
+};
+
+// --------------------------------------------------------
+// Results of RunIBLBenchmark() - one bake per specular size
+// --------------------------------------------------------
+struct IBLBenchmarkRow
+{
+	unsigned int SpecularSize;
+	double SpecularMs;
+	double IrradianceMs;
+	double LookUpMs;
+};
+
+struct IBLBenchmarkResults
+{
+	unsigned int SourceSize;
+	unsigned int ThreadCount;
+	std::vector<IBLBenchmarkRow> Rows;
+};
+
+// --------------------------------------------------------
+// CPU baker for split-sum image based lighting:
+//
+//  - Specular: the sky convolved with GGX at a range of
+//    roughnesses, one per mip (assuming n = v = r)
+//  - Irradiance: the cosine weighted average of the sky
+//    around each normal
+//  - Look up table: the rest of the split sum, which only
+//    depends on NdotV and roughness
+//
+// The cubes are importance sampled from a mip chain of the
+// source, picking the mip by each sample's pdf, so a few
+// dozen samples are enough for a smooth result.  Rows are
+// spread across the job system, and the samples are rotated
+// into place (or, for the look up table, evaluated entirely)
+// four at a time with SSE.
+// --------------------------------------------------------
+void BakeIBL(const CubeImage& source, const IBLBakeSettings& settings, IBLBakeResult& result);
+
+// Hash of the source pixels & settings, for naming the cache
+unsigned long long HashIBLSource(const CubeImage& source, const IBLBakeSettings& settings);
+
+// Baked results on disk, keyed by HashIBLSource() - loading
+// fails (returns false) if the file is missing or stale
+bool LoadIBLCache(const std::wstring& path, unsigned long long hash, const IBLBakeSettings& settings, IBLBakeResult& result);
+bool SaveIBLCache(const std::wstring& path, const IBLBakeResult& result);
+
+// Bakes (without the cache) at several specular sizes
+IBLBenchmarkResults RunIBLBenchmark(const CubeImage& source);
@@ -0,0 +1,38 @@
+#ifndef __GGP_IMAGE_BASED_LIGHTING__
+#define __GGP_IMAGE_BASED_LIGHTING__
+
+#include "ShaderIncludes.hlsli"
+
+// Lighting baked from the sky on the CPU (see IBLBaker.h)
+cbuffer ImageBasedLightingData : register(b3)
+{
+    float iblIntensity;         // Zero turns it off
+    float iblSpecularMipCount;  // Roughness 0 to 1, evenly spaced down the mips
+}
+
+TextureCube IBLSpecular;
+TextureCube IBLIrradiance;
+Texture2D IBLLookUp;            // F0 scale & bias for (NdotV, roughness)
+SamplerState IBLSampler;
+
+// Light from the whole sky - split sum specular (prefiltered sky
+// times the look up table's take on F0) plus irradiance diffuse
+float3 SkyLight(float3 normal, float3 viewVector, float roughness, float3 surfaceColor, float3 specularColor, float metalness)
+{
+    if (iblIntensity <= 0.0f)
+        return float3(0, 0, 0);
+    
+    float NdotV = saturate(dot(normal, viewVector));
+    float3 reflection = reflect(-viewVector, normal);
+    
+    float3 prefiltered = IBLSpecular.SampleLevel(IBLSampler, reflection, roughness * (iblSpecularMipCount - 1)).rgb;
+    float2 scaleBias = IBLLookUp.SampleLevel(IBLSampler, float2(NdotV, roughness), 0).rg;
+    float3 specularAmount = specularColor * scaleBias.x + scaleBias.y;
+    
+    float3 irradiance = IBLIrradiance.SampleLevel(IBLSampler, normal, 0).rgb;
+    float3 diffuse = DiffuseEnergyConserve(irradiance, specularAmount, metalness) * surfaceColor;
+    
+    return (diffuse + prefiltered * specularAmount) * iblIntensity;
+}
+
+#endif
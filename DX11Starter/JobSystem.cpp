@@ -0,0 +1,527 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+// Singleton requirement
+JobSystem* JobSystem::instance;
+
+// Which ThreadData slot the calling thread owns (-1 until assigned,
+// InlineThread if they'd all been handed out by then), and which
+// Initialize() it was handed out by - the slot is stale once the
+// job system's been shut down or recreated since
+static const int InlineThread = -2;
+static thread_local int threadIndex = -1;
+static thread_local unsigned int threadGeneration = 0;
+static std::atomic<unsigned int> lastGeneration(0);
+
+// Jobs for threads without a slot, which run them right away
+static thread_local std::unique_ptr<Job[]> inlineJobPool;
+static thread_local unsigned int inlineNextJob = 0;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ WORK-STEALING QUEUE -------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// Based on "Correct and Efficient Work-Stealing for Weak Memory
+// Models" (Le, Pop, Cohen & Zappa Nardelli, 2013), with a fixed
+// capacity instead of a growable circular array
+
+WorkStealingQueue::WorkStealingQueue() :
+	top(0),
+	bottom(0)
+{
+	for (long long i = 0; i < Capacity; i++)
+		entries[i].store(nullptr, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+// Owner only - adds a job to the private end.  Returns
+// false if the queue is full.
+// --------------------------------------------------------
+bool WorkStealingQueue::Push(Job* job)
+{
+	long long b = bottom.load(std::memory_order_relaxed);
+	long long t = top.load(std::memory_order_acquire);
+	if (b - t >= Capacity)
+		return false;
+
+	entries[b & (Capacity - 1)].store(job, std::memory_order_relaxed);
+	bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+// --------------------------------------------------------
+// Owner only - takes the most recently pushed job
+// --------------------------------------------------------
+Job* WorkStealingQueue::Pop()
+{
+	long long b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long t = top.load(std::memory_order_relaxed);
+
+	// Empty?
+	if (t > b)
+	{
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = entries[b & (Capacity - 1)].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		// Last item - race any thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = nullptr;
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+// --------------------------------------------------------
+// Any thread - takes the oldest job from the public end
+// --------------------------------------------------------
+Job* WorkStealingQueue::Steal()
+{
+	long long t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long b = bottom.load(std::memory_order_acquire);
+	if (t >= b)
+		return nullptr;
+
+	Job* job = entries[t & (Capacity - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return nullptr; // Lost the race to another thief (or the owner)
+
+	return job;
+}
+
+long long WorkStealingQueue::Size() const
+{
+	long long b = bottom.load(std::memory_order_relaxed);
+	long long t = top.load(std::memory_order_relaxed);
+	return b > t ? b - t : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ JOB SYSTEM ----------------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------
+// Thread data is allocated with its own alignment (the
+// queue's indices sit on separate cache lines)
+// --------------------------------------------------------
+void* JobSystem::ThreadData::operator new(size_t size)
+{
+#ifdef _MSC_VER
+	void* memory = _aligned_malloc(size, alignof(ThreadData));
+#else
+	void* memory = nullptr;
+	if (posix_memalign(&memory, alignof(ThreadData), size) != 0)
+		memory = nullptr;
+#endif
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void JobSystem::ThreadData::operator delete(void* memory)
+{
+#ifdef _MSC_VER
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+
+JobSystem::JobSystem() :
+	nextExternalThread(0),
+	generation(0),
+	running(false),
+	queuedJobs(0),
+	sleepingWorkers(0)
+{
+}
+
+JobSystem::~JobSystem()
+{
+	Shutdown();
+
+	// So GetInstance() makes a new one, rather than handing
+	// out this one after it's deleted
+	if (instance == this)
+		instance = nullptr;
+}
+
+// --------------------------------------------------------
+// Creates the per-thread queues and starts the workers
+// --------------------------------------------------------
+void JobSystem::Initialize(unsigned int workerCount)
+{
+	if (running)
+		return;
+
+	if (workerCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	// External slots first, then one per worker
+	generation = ++lastGeneration;
+	unsigned int slotCount = MaxExternalThreads + workerCount;
+	for (unsigned int i = 0; i < slotCount; i++)
+	{
+		ThreadData* data = new ThreadData();
+		data->JobPool.reset(new Job[JobPoolSize]);
+		data->RandomState = 0x9E3779B9u * (i + 1);
+		threadData.push_back(data);
+	}
+
+	running = true;
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		workers.push_back(std::thread(&JobSystem::WorkerLoop, this, MaxExternalThreads + i));
+	}
+}
+
+// --------------------------------------------------------
+// Stops and joins the workers.  Any jobs still queued
+// are abandoned, so wait on them first.
+// --------------------------------------------------------
+void JobSystem::Shutdown()
+{
+	if (!running)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+	sleepCV.notify_all();
+
+	for (auto& w : workers)
+		w.join();
+	workers.clear();
+
+	for (auto data : threadData)
+		delete data;
+	threadData.clear();
+	nextExternalThread = 0;
+}
+
+// --------------------------------------------------------
+// Body of each worker thread
+// --------------------------------------------------------
+void JobSystem::WorkerLoop(unsigned int index)
+{
+	threadIndex = (int)index;
+	threadGeneration = generation;
+
+	std::string name = "Worker " + std::to_string(index - MaxExternalThreads);
+	PROFILE_THREAD(name.c_str());
+
+	int idleSpins = 0;
+	while (running.load(std::memory_order_relaxed))
+	{
+		Job* job = GetJob();
+		if (job)
+		{
+			Execute(job);
+			idleSpins = 0;
+			continue;
+		}
+
+		// Spin briefly (new work usually shows up quickly
+		// mid-frame) before going to sleep
+		if (++idleSpins < 64)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingWorkers++;
+		sleepCV.wait_for(lock, std::chrono::milliseconds(1), [this] {
+			return queuedJobs.load() > 0 || !running.load(); });
+		sleepingWorkers--;
+		idleSpins = 0;
+	}
+}
+
+// --------------------------------------------------------
+// Gets the calling thread's slot, handing out an external
+// slot the first time a non-worker thread shows up (since
+// the last Initialize() - older slots are gone).
+//
+// Slots are owner-only, so once they've all been handed out
+// any more threads get none (null) and run their jobs inline,
+// from a pool of their own - correct, just not parallel.
+// Bump MaxExternalThreads if that matters.
+// --------------------------------------------------------
+JobSystem::ThreadData* JobSystem::GetThreadData()
+{
+	// Not initialized yet, so everything runs inline
+	if (threadData.empty())
+		return nullptr;
+
+	if (threadIndex == -1 || threadGeneration != generation)
+	{
+		unsigned int slot = nextExternalThread.fetch_add(1);
+		threadIndex = slot < MaxExternalThreads ? (int)slot : InlineThread;
+		threadGeneration = generation;
+	}
+
+	return threadIndex == InlineThread ? nullptr : threadData[threadIndex];
+}
+
+// --------------------------------------------------------
+// Grabs the next job from the calling thread's pool.  The
+// pool is a ring, so a thread must never have more than
+// JobPoolSize jobs alive at once.
+// --------------------------------------------------------
+Job* JobSystem::AllocateJob()
+{
+	ThreadData* data = GetThreadData();
+	if (!data)
+	{
+		if (!inlineJobPool)
+			inlineJobPool.reset(new Job[JobPoolSize]);
+		return &inlineJobPool[inlineNextJob++ & (JobPoolSize - 1)];
+	}
+
+	Job* job = &data->JobPool[data->NextJob & (JobPoolSize - 1)];
+	data->NextJob++;
+	return job;
+}
+
+Job* JobSystem::CreateJob(JobFunction function)
+{
+	return CreateJob(function, 0, 0);
+}
+
+Job* JobSystem::CreateJob(JobFunction function, const void* data, size_t dataSize)
+{
+	Job* job = AllocateJob();
+	job->Function = function;
+	job->Parent = nullptr;
+	job->UnfinishedJobs.store(1, std::memory_order_relaxed);
+	if (data && dataSize > 0 && dataSize <= sizeof(job->Data))
+		memcpy(job->Data, data, dataSize);
+	return job;
+}
+
+Job* JobSystem::CreateChildJob(Job* parent, JobFunction function)
+{
+	return CreateChildJob(parent, function, 0, 0);
+}
+
+Job* JobSystem::CreateChildJob(Job* parent, JobFunction function, const void* data, size_t dataSize)
+{
+	// The parent can't finish until this child does
+	parent->UnfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+
+	Job* job = CreateJob(function, data, dataSize);
+	job->Parent = parent;
+	return job;
+}
+
+// --------------------------------------------------------
+// Queues a job on the calling thread's deque
+// --------------------------------------------------------
+void JobSystem::Run(Job* job)
+{
+	// Counted before the push so a thief can never see it go negative
+	queuedJobs.fetch_add(1, std::memory_order_relaxed);
+
+	// No room (or no workers, or no slot)?  Just do it now.
+	ThreadData* data = GetThreadData();
+	if (workers.empty() || !data || !data->Queue.Push(job))
+	{
+		Execute(job);
+		return;
+	}
+
+	if (sleepingWorkers.load(std::memory_order_relaxed) > 0)
+		sleepCV.notify_one();
+}
+
+// --------------------------------------------------------
+// Helps out with other jobs until the given job (and all
+// of its children) have finished
+// --------------------------------------------------------
+void JobSystem::Wait(const Job* job)
+{
+	while (!IsComplete(job))
+	{
+		Job* next = GetJob();
+		if (next)
+			Execute(next);
+		else
+			std::this_thread::yield();
+	}
+}
+
+bool JobSystem::IsComplete(const Job* job)
+{
+	return job->UnfinishedJobs.load(std::memory_order_acquire) <= 0;
+}
+
+// --------------------------------------------------------
+// Finds work: our own deque first, then steal from a
+// random other thread, then scan everyone in order
+// --------------------------------------------------------
+Job* JobSystem::GetJob()
+{
+	// Threads without a slot already ran everything they queued
+	ThreadData* slot = GetThreadData();
+	if (!slot)
+		return nullptr;
+
+	ThreadData& data = *slot;
+	Job* job = data.Queue.Pop();
+	if (job) return job;
+
+	unsigned int count = (unsigned int)threadData.size();
+
+	// Xorshift for picking a victim
+	data.RandomState ^= data.RandomState << 13;
+	data.RandomState ^= data.RandomState >> 17;
+	data.RandomState ^= data.RandomState << 5;
+	unsigned int start = data.RandomState % count;
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		ThreadData* victim = threadData[(start + i) % count];
+		if (victim == &data) continue;
+
+		job = victim->Queue.Steal();
+		if (job) return job;
+	}
+
+	return nullptr;
+}
+
+void JobSystem::Execute(Job* job)
+{
+	queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	job->Function(job, job->Data);
+	Finish(job);
+}
+
+// --------------------------------------------------------
+// Marks a job as done, and finishes its parent too if
+// this was the parent's last outstanding child
+// --------------------------------------------------------
+void JobSystem::Finish(Job* job)
+{
+	// Read the parent first - once the count hits zero the
+	// owning thread is free to recycle this job
+	Job* parent = job->Parent;
+	int unfinished = job->UnfinishedJobs.fetch_sub(1, std::memory_order_acq_rel) - 1;
+	if (unfinished == 0 && parent)
+		Finish(parent);
+}
+
+// --------------------------------------------------------
+// Splits its range in half (as children) until the range
+// is small enough, then runs the user's function on it
+// --------------------------------------------------------
+void JobSystem::ParallelForJob(Job* job, const void* data)
+{
+	const ParallelForData* range = (const ParallelForData*)data;
+	unsigned int count = range->End - range->Begin;
+
+	if (count <= range->GrainSize)
+	{
+		PROFILE_SCOPE("ParallelFor");
+		range->Invoke(range->Functor, range->Begin, range->End);
+		return;
+	}
+
+	JobSystem& jobs = JobSystem::GetInstance();
+	unsigned int mid = range->Begin + count / 2;
+
+	ParallelForData left = *range;
+	left.End = mid;
+	jobs.Run(jobs.CreateChildJob(job, &JobSystem::ParallelForJob, &left, sizeof(left)));
+
+	ParallelForData right = *range;
+	right.Begin = mid;
+	jobs.Run(jobs.CreateChildJob(job, &JobSystem::ParallelForJob, &right, sizeof(right)));
+}
+
+// --------------------------------------------------------
+// Measures the overhead of the scheduler itself:
+//  - Throughput of many empty child jobs under one parent
+//  - Latency of a single Run() + Wait() round trip
+//  - Latency of a ParallelFor with an empty body
+// --------------------------------------------------------
+JobSystemBenchmarkResults JobSystem::RunBenchmark(unsigned int emptyJobCount)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	JobSystemBenchmarkResults results = {};
+
+	// Stay under the per-thread pool size so jobs aren't recycled while alive
+	if (emptyJobCount > JobPoolSize - 1)
+		emptyJobCount = JobPoolSize - 1;
+	results.EmptyJobCount = emptyJobCount;
+
+	JobFunction empty = [](Job*, const void*) {};
+
+	// Empty job throughput
+	{
+		const int rounds = 16;
+		Clock::time_point start = Clock::now();
+		for (int r = 0; r < rounds; r++)
+		{
+			Job* root = CreateJob(empty);
+			for (unsigned int i = 0; i < emptyJobCount; i++)
+				Run(CreateChildJob(root, empty));
+			Run(root);
+			Wait(root);
+		}
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		results.EmptyJobsPerSecond = (double)emptyJobCount * rounds / seconds;
+	}
+
+	// Fork/join latency
+	{
+		const int rounds = 1000;
+		Clock::time_point start = Clock::now();
+		for (int r = 0; r < rounds; r++)
+		{
+			Job* job = CreateJob(empty);
+			Run(job);
+			Wait(job);
+		}
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		results.ForkJoinMicroseconds = seconds * 1000000.0 / rounds;
+	}
+
+	// Parallel for latency
+	{
+		const int rounds = 100;
+		std::atomic<unsigned int> sink(0);
+		Clock::time_point start = Clock::now();
+		for (int r = 0; r < rounds; r++)
+		{
+			ParallelFor(emptyJobCount, [&sink](unsigned int begin, unsigned int end) {
+				sink.fetch_add(end - begin, std::memory_order_relaxed); });
+		}
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		results.ParallelForMicroseconds = seconds * 1000000.0 / rounds;
+	}
+
+	return results;
+}
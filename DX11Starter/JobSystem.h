@@ -0,0 +1,220 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+
+// --------------------------------------------------------
+// A single unit of work for the job system.
+//
+// Jobs are allocated from per-thread pools (never new/delete),
+// so they should be short lived - created, run and waited on
+// within a frame.  Small payloads are copied into Data.
+// --------------------------------------------------------
+struct Job;
+typedef void (*JobFunction)(Job* job, const void* data);
+
+struct Job
+{
+	JobFunction Function;
+	Job* Parent;
+	std::atomic<int> UnfinishedJobs;	// This job + any children still running
+	unsigned char Data[64];				// Inline copy of the job's payload
+};
+
+// --------------------------------------------------------
+// Fixed-size Chase-Lev work-stealing deque.
+//
+// - Only the owning thread may Push() and Pop() (LIFO end)
+// - Any thread may Steal() (FIFO end)
+// --------------------------------------------------------
+class WorkStealingQueue
+{
+public:
+	static const long long Capacity = 4096; // Must be a power of 2
+
+	WorkStealingQueue();
+
+	bool Push(Job* job);
+	Job* Pop();
+	Job* Steal();
+	long long Size() const;
+
+private:
+	alignas(64) std::atomic<long long> top;
+	alignas(64) std::atomic<long long> bottom;
+	std::atomic<Job*> entries[Capacity];
+};
+
+// --------------------------------------------------------
+// Results of JobSystem::RunBenchmark()
+// --------------------------------------------------------
+struct JobSystemBenchmarkResults
+{
+	unsigned int EmptyJobCount;
+	double EmptyJobsPerSecond;		// Throughput of spawning and finishing empty child jobs
+	double ForkJoinMicroseconds;	// Average latency of Run() + Wait() on a single job
+	double ParallelForMicroseconds;	// Average latency of a ParallelFor over EmptyJobCount items
+};
+
+// --------------------------------------------------------
+// Work-stealing job scheduler for per-frame engine work.
+//
+// Every worker (and the main thread) owns a deque.  Jobs run
+// from a thread's own deque first, then get stolen from the
+// others.  Waiting on a job never blocks: the waiting thread
+// keeps executing other jobs until the one it needs is done.
+//
+// Basic usage:
+//
+//   JobSystem& jobs = JobSystem::GetInstance();
+//   jobs.ParallelFor((unsigned int)things.size(),
+//       [&](unsigned int begin, unsigned int end) {
+//           for (unsigned int i = begin; i < end; i++) { ... }
+//       });
+// --------------------------------------------------------
+class JobSystem
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static JobSystem& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new JobSystem();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	JobSystem(JobSystem const&) = delete;
+	void operator=(JobSystem const&) = delete;
+
+private:
+	static JobSystem* instance;
+	JobSystem();
+#pragma endregion
+
+public:
+	~JobSystem();
+
+	// Starts the worker threads.  A count of zero picks one
+	// worker per hardware thread, minus one for the main thread.
+	void Initialize(unsigned int workerCount = 0);
+	void Shutdown();
+
+	// Job creation & execution
+	Job* CreateJob(JobFunction function);
+	Job* CreateJob(JobFunction function, const void* data, size_t dataSize);
+	Job* CreateChildJob(Job* parent, JobFunction function);
+	Job* CreateChildJob(Job* parent, JobFunction function, const void* data, size_t dataSize);
+	void Run(Job* job);
+	void Wait(const Job* job);
+	bool IsComplete(const Job* job);
+
+	// Splits [0, count) into ranges and calls func(begin, end)
+	// on each of them in parallel.  The range is split in half
+	// recursively until it's no larger than the grain size, which
+	// adapts to the worker count unless minGrainSize is larger.
+	template<typename Func>
+	void ParallelFor(unsigned int count, const Func& func, unsigned int minGrainSize = 1);
+
+	unsigned int GetWorkerCount() { return (unsigned int)workers.size(); }
+	unsigned int GetThreadCount() { return (unsigned int)workers.size() + 1; }
+
+	// Micro-benchmark of the scheduler itself
+	JobSystemBenchmarkResults RunBenchmark(unsigned int emptyJobCount = 4000);
+
+private:
+
+	// Per-thread state.  The first few slots are handed out to
+	// non-worker threads (main, simulation, etc.) the first time
+	// they use the job system, and the workers own the rest.
+	// Threads past MaxExternalThreads get none, and run their
+	// jobs inline (see GetThreadData()).
+	//
+	// The queue's indices are cache line aligned, which plain
+	// new doesn't honor before C++17, hence the operator new.
+	struct ThreadData
+	{
+		WorkStealingQueue Queue;
+		std::unique_ptr<Job[]> JobPool;
+		unsigned int NextJob = 0;
+		unsigned int RandomState = 0;
+
+		static void* operator new(size_t size);
+		static void operator delete(void* memory);
+	};
+	static const unsigned int JobPoolSize = 4096; // Must be a power of 2
+	static const unsigned int MaxExternalThreads = 8;
+	std::atomic<unsigned int> nextExternalThread;
+
+	// Tells this Initialize() apart from any earlier one (of
+	// this or a deleted instance), so threads holding a slot
+	// from back then ask for a new one
+	unsigned int generation;
+
+	std::vector<ThreadData*> threadData;
+	std::vector<std::thread> workers;
+	std::atomic<bool> running;
+
+	// Sleeping for idle workers
+	std::mutex sleepMutex;
+	std::condition_variable sleepCV;
+	std::atomic<int> queuedJobs;
+	std::atomic<int> sleepingWorkers;
+
+	void WorkerLoop(unsigned int threadIndex);
+	ThreadData* GetThreadData();
+	Job* AllocateJob();
+	Job* GetJob();
+	void Execute(Job* job);
+	void Finish(Job* job);
+
+	// ParallelFor helpers
+	struct ParallelForData
+	{
+		const void* Functor;
+		void (*Invoke)(const void* functor, unsigned int begin, unsigned int end);
+		unsigned int Begin;
+		unsigned int End;
+		unsigned int GrainSize;
+	};
+	static void ParallelForJob(Job* job, const void* data);
+};
+
+template<typename Func>
+void JobSystem::ParallelFor(unsigned int count, const Func& func, unsigned int minGrainSize)
+{
+	if (count == 0)
+		return;
+
+	// Aim for a handful of ranges per thread so stealing can even out
+	// uneven work, but never go below the caller's minimum
+	unsigned int grain = count / (GetThreadCount() * 4);
+	if (grain < minGrainSize) grain = minGrainSize;
+	if (grain < 1) grain = 1;
+
+	// Not worth scheduling at all?
+	if (count <= grain)
+	{
+		func(0, count);
+		return;
+	}
+
+	ParallelForData data = {};
+	data.Functor = &func;
+	data.Invoke = [](const void* functor, unsigned int begin, unsigned int end) { (*(const Func*)functor)(begin, end); };
+	data.Begin = 0;
+	data.End = count;
+	data.GrainSize = grain;
+
+	Job* root = CreateJob(&JobSystem::ParallelForJob, &data, sizeof(data));
+	Run(root);
+	Wait(root);
+}
@@ -0,0 +1,277 @@
+#include "LightClusterBins.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+
+using namespace DirectX;
+
+// Depth where the exponential slices start (anything closer is slice 0)
+static const float MinClusterNear = 0.5f;
+
+// Which of count tiles a 0-1 screen position falls in
+static unsigned int GetTile(float t, unsigned int count)
+{
+	int index = (int)floorf(t * count);
+	return (unsigned int)std::max(0, std::min((int)count - 1, index));
+}
+
+LightClusterBins::LightClusterBins() :
+	boundsProjection()
+{
+	slices.resize(CountZ);
+	for (auto& s : slices)
+	{
+		s.Clusters.resize(CountX * CountY);
+		s.Near = 0.0f;
+		s.Far = 0.0f;
+		s.Total = 0;
+		s.Offset = 0;
+	}
+}
+
+// --------------------------------------------------------
+// Pulls the near & far planes back out of a (left handed,
+// perspective) projection matrix and works out the slicing
+// --------------------------------------------------------
+void LightClusterBins::GetSliceParams(
+	const XMFLOAT4X4& projection,
+	float& nearZ,
+	float& farZ,
+	float& clusterNear,
+	float& depthScale)
+{
+	nearZ = -projection._43 / projection._33;
+	farZ = projection._43 / (1.0f - projection._33);
+
+	clusterNear = std::max(nearZ, std::min(MinClusterNear, farZ * 0.5f));
+	depthScale = (CountZ - 1) / logf(farZ / clusterNear);
+}
+
+unsigned int LightClusterBins::GetSlice(float viewDepth, float clusterNear, float depthScale)
+{
+	if (viewDepth < clusterNear)
+		return 0;
+
+	unsigned int slice = 1 + (unsigned int)(logf(viewDepth / clusterNear) * depthScale);
+	return std::min(slice, CountZ - 1);
+}
+
+// --------------------------------------------------------
+// Finds the view space box around every cluster.  A tile's
+// edges are lines through the camera, so the box comes from
+// the tile corners at the slice's near & far depths.
+// --------------------------------------------------------
+void LightClusterBins::UpdateClusterBounds(const XMFLOAT4X4& projection)
+{
+	if (!clusterBounds.empty() && memcmp(&projection, &boundsProjection, sizeof(XMFLOAT4X4)) == 0)
+		return;
+
+	boundsProjection = projection;
+	clusterBounds.resize(ClusterCount);
+
+	float nearZ, farZ, clusterNear, depthScale;
+	GetSliceParams(projection, nearZ, farZ, clusterNear, depthScale);
+
+	for (unsigned int z = 0; z < CountZ; z++)
+	{
+		float sliceNear = z == 0 ? nearZ : clusterNear * expf((z - 1) / depthScale);
+		float sliceFar = z == CountZ - 1 ? farZ : clusterNear * expf(z / depthScale);
+		slices[z].Near = sliceNear;
+		slices[z].Far = sliceFar;
+
+		for (unsigned int y = 0; y < CountY; y++)
+		{
+			// Tile rows go top to bottom, like pixels
+			float ndcTop = 1.0f - 2.0f * y / CountY;
+			float ndcBottom = 1.0f - 2.0f * (y + 1) / CountY;
+
+			for (unsigned int x = 0; x < CountX; x++)
+			{
+				float ndcLeft = -1.0f + 2.0f * x / CountX;
+				float ndcRight = -1.0f + 2.0f * (x + 1) / CountX;
+
+				// View space x = (ndc - offset) * depth / scale
+				float xs[4] = {
+					(ndcLeft - projection._31) * sliceNear / projection._11,
+					(ndcRight - projection._31) * sliceNear / projection._11,
+					(ndcLeft - projection._31) * sliceFar / projection._11,
+					(ndcRight - projection._31) * sliceFar / projection._11 };
+				float ys[4] = {
+					(ndcBottom - projection._32) * sliceNear / projection._22,
+					(ndcTop - projection._32) * sliceNear / projection._22,
+					(ndcBottom - projection._32) * sliceFar / projection._22,
+					(ndcTop - projection._32) * sliceFar / projection._22 };
+
+				ClusterBounds& b = clusterBounds[x + y * CountX + z * CountX * CountY];
+				b.Min = XMFLOAT3(xs[0], ys[0], sliceNear);
+				b.Max = XMFLOAT3(xs[0], ys[0], sliceFar);
+				for (int i = 1; i < 4; i++)
+				{
+					b.Min.x = std::min(b.Min.x, xs[i]);
+					b.Max.x = std::max(b.Max.x, xs[i]);
+					b.Min.y = std::min(b.Min.y, ys[i]);
+					b.Max.y = std::max(b.Max.y, ys[i]);
+				}
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Bins every point & spot light into the clusters it touches.
+//
+//  1. Each light gets a view space sphere and the range of
+//     depth slices it spans (in parallel over lights)
+//  2. Each depth slice narrows its lights down to a range of
+//     tiles, then tests them against those clusters' boxes
+//     (in parallel over slices)
+//  3. The per-slice lists are packed into one index list
+//
+// Indices refer to the lights vector as passed in, which is
+// also what Upload() puts on the GPU.
+// --------------------------------------------------------
+void LightClusterBins::Bin(
+	const std::vector<Light>& lights,
+	const XMFLOAT4X4& view,
+	const XMFLOAT4X4& projection,
+	std::vector<ClusterRange>& ranges,
+	std::vector<unsigned int>& indices)
+{
+	PROFILE_FUNCTION();
+	UpdateClusterBounds(projection);
+
+	float nearZ, farZ, clusterNear, depthScale;
+	GetSliceParams(projection, nearZ, farZ, clusterNear, depthScale);
+
+	JobSystem& jobs = JobSystem::GetInstance();
+
+	// 1. Light bounds
+	unsigned int lightCount = (unsigned int)lights.size();
+	lightBounds.resize(lightCount);
+	jobs.ParallelFor(lightCount, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			const Light& light = lights[i];
+			LightBounds& lb = lightBounds[i];
+			lb.Clustered = false;
+			if (light.Type != LIGHT_TYPE_POINT && light.Type != LIGHT_TYPE_SPOT)
+				continue;
+
+			// Spot lights use their whole range sphere - conservative, but simple
+			const XMFLOAT3& p = light.Position;
+			lb.Center = XMFLOAT3(
+				p.x * view._11 + p.y * view._21 + p.z * view._31 + view._41,
+				p.x * view._12 + p.y * view._22 + p.z * view._32 + view._42,
+				p.x * view._13 + p.y * view._23 + p.z * view._33 + view._43);
+			lb.Radius = light.Range;
+
+			float zMin = lb.Center.z - lb.Radius;
+			float zMax = lb.Center.z + lb.Radius;
+			if (zMax < nearZ || zMin > farZ || lb.Radius <= 0.0f)
+				continue;
+
+			lb.MinZ = GetSlice(std::max(zMin, nearZ), clusterNear, depthScale);
+			lb.MaxZ = GetSlice(std::min(zMax, farZ), clusterNear, depthScale);
+			lb.Clustered = true;
+		}
+	}, 64);
+
+	// 2. Per slice lists
+	jobs.ParallelFor(CountZ, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int z = begin; z < end; z++)
+		{
+			Slice& slice = slices[z];
+			for (auto& c : slice.Clusters)
+				c.clear();
+
+			const ClusterBounds* sliceBounds = &clusterBounds[z * CountX * CountY];
+			for (unsigned int i = 0; i < lightCount; i++)
+			{
+				const LightBounds& lb = lightBounds[i];
+				if (!lb.Clustered || z < lb.MinZ || z > lb.MaxZ)
+					continue;
+
+				// Screen extents of the part of the sphere's box inside this
+				// slice - if that reaches the near plane it could cover
+				// anything, so use every tile
+				unsigned int minX = 0, maxX = CountX - 1;
+				unsigned int minY = 0, maxY = CountY - 1;
+				float depthNear = std::max(lb.Center.z - lb.Radius, slice.Near);
+				float depthFar = std::min(lb.Center.z + lb.Radius, slice.Far);
+				if (depthNear > nearZ)
+				{
+					float ndcMinX = FLT_MAX, ndcMaxX = -FLT_MAX;
+					float ndcMinY = FLT_MAX, ndcMaxY = -FLT_MAX;
+					for (int corner = 0; corner < 4; corner++)
+					{
+						float depth = (corner & 1) ? depthFar : depthNear;
+						float sign = (corner & 2) ? 1.0f : -1.0f;
+						float ndcX = (lb.Center.x + sign * lb.Radius) / depth * projection._11 + projection._31;
+						float ndcY = (lb.Center.y + sign * lb.Radius) / depth * projection._22 + projection._32;
+						ndcMinX = std::min(ndcMinX, ndcX); ndcMaxX = std::max(ndcMaxX, ndcX);
+						ndcMinY = std::min(ndcMinY, ndcY); ndcMaxY = std::max(ndcMaxY, ndcY);
+					}
+					if (ndcMaxX < -1.0f || ndcMinX > 1.0f || ndcMaxY < -1.0f || ndcMinY > 1.0f)
+						continue;
+
+					minX = GetTile((ndcMinX + 1.0f) * 0.5f, CountX);
+					maxX = GetTile((ndcMaxX + 1.0f) * 0.5f, CountX);
+					minY = GetTile((1.0f - ndcMaxY) * 0.5f, CountY);
+					maxY = GetTile((1.0f - ndcMinY) * 0.5f, CountY);
+				}
+
+				float radiusSq = lb.Radius * lb.Radius;
+				for (unsigned int y = minY; y <= maxY; y++)
+				{
+					for (unsigned int x = minX; x <= maxX; x++)
+					{
+						// Sphere vs. box: distance from the center to the closest point
+						const ClusterBounds& b = sliceBounds[x + y * CountX];
+						float dx = std::max(0.0f, std::max(b.Min.x - lb.Center.x, lb.Center.x - b.Max.x));
+						float dy = std::max(0.0f, std::max(b.Min.y - lb.Center.y, lb.Center.y - b.Max.y));
+						float dz = std::max(0.0f, std::max(b.Min.z - lb.Center.z, lb.Center.z - b.Max.z));
+						if (dx * dx + dy * dy + dz * dz <= radiusSq)
+							slice.Clusters[x + y * CountX].push_back(i);
+					}
+				}
+			}
+
+			slice.Total = 0;
+			for (auto& c : slice.Clusters)
+				slice.Total += (unsigned int)c.size();
+		}
+	}, 1);
+
+	// 3. Pack everything into one list
+	unsigned int total = 0;
+	for (auto& s : slices)
+	{
+		s.Offset = total;
+		total += s.Total;
+	}
+	ranges.resize(ClusterCount);
+	indices.resize(total);
+
+	jobs.ParallelFor(CountZ, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int z = begin; z < end; z++)
+		{
+			unsigned int offset = slices[z].Offset;
+			for (unsigned int c = 0; c < CountX * CountY; c++)
+			{
+				const std::vector<unsigned int>& list = slices[z].Clusters[c];
+				ClusterRange& range = ranges[c + z * CountX * CountY];
+				range.Offset = offset;
+				range.Count = (unsigned int)list.size();
+				if (!list.empty())
+					memcpy(&indices[offset], &list[0], sizeof(unsigned int) * list.size());
+				offset += range.Count;
+			}
+		}
+	}, 1);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+#include "Lights.h"
+
+// --------------------------------------------------------
+// Where one cluster's lights live in the index list
+// (matches the uint2 in ClusteredLighting.hlsli)
+// --------------------------------------------------------
+struct ClusterRange
+{
+	unsigned int Offset;
+	unsigned int Count;
+};
+
+// --------------------------------------------------------
+// The CPU half of clustered forward lighting (LightClusters
+// adds the GPU buffers on top) - no D3D, so it can be tested
+// on its own.
+//
+// The view frustum is cut into a grid of "froxels" - screen
+// tiles in X & Y, and exponentially spaced depth slices in Z.
+// Bin() finds which point & spot lights touch each cluster
+// and builds compact per-cluster index lists.
+// --------------------------------------------------------
+class LightClusterBins
+{
+public:
+	static const unsigned int CountX = 16;
+	static const unsigned int CountY = 9;
+	static const unsigned int CountZ = 24;
+	static const unsigned int ClusterCount = CountX * CountY * CountZ;
+
+	LightClusterBins();
+
+	// Builds the per-cluster light lists (spread across the job system)
+	void Bin(
+		const std::vector<Light>& lights,
+		const DirectX::XMFLOAT4X4& view,
+		const DirectX::XMFLOAT4X4& projection,
+		std::vector<ClusterRange>& ranges,
+		std::vector<unsigned int>& indices);
+
+	// Depth slicing, shared by the CPU binning and the shaders.  Slice 0
+	// covers [nearZ, clusterNear] and the rest are spaced exponentially
+	// out to farZ, so slices near the camera aren't paper thin.
+	static void GetSliceParams(
+		const DirectX::XMFLOAT4X4& projection,
+		float& nearZ,
+		float& farZ,
+		float& clusterNear,
+		float& depthScale);
+	static unsigned int GetSlice(float viewDepth, float clusterNear, float depthScale);
+
+	// View space bounds of every cluster (x + y * CountX + z * CountX * CountY,
+	// rows top to bottom), rebuilt only when the projection changes
+	struct ClusterBounds
+	{
+		DirectX::XMFLOAT3 Min;
+		DirectX::XMFLOAT3 Max;
+	};
+	void UpdateClusterBounds(const DirectX::XMFLOAT4X4& projection);
+	const ClusterBounds& GetClusterBounds(unsigned int cluster) const { return clusterBounds[cluster]; }
+
+private:
+	std::vector<ClusterBounds> clusterBounds;
+	DirectX::XMFLOAT4X4 boundsProjection;
+
+	// Each light's view space sphere and the depth slices it spans
+	struct LightBounds
+	{
+		DirectX::XMFLOAT3 Center;
+		float Radius;
+		unsigned int MinZ, MaxZ;
+		bool Clustered;
+	};
+	std::vector<LightBounds> lightBounds;
+
+	// Per depth slice lists, reused every frame to avoid allocations
+	struct Slice
+	{
+		std::vector<std::vector<unsigned int>> Clusters;
+		float Near;
+		float Far;
+		unsigned int Total;
+		unsigned int Offset;
+	};
+	std::vector<Slice> slices;
+};
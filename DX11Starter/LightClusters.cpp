@@ -0,0 +1,106 @@
+#include "LightClusters.h"
+#include "Profiler.h"
+#include <cstring>
+
+using namespace DirectX;
+
+LightClusters::LightClusters(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) :
+	device(device),
+	context(context),
+	lightCapacity(0),
+	rangeCapacity(0),
+	indexCapacity(0)
+{
+}
+
+LightClusters::~LightClusters()
+{
+}
+
+// --------------------------------------------------------
+// Copies data into a dynamic structured buffer, recreating
+// it (at double the size) when it's too small
+// --------------------------------------------------------
+void LightClusters::UpdateBuffer(
+	Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer,
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv,
+	unsigned int& capacity,
+	unsigned int stride,
+	const void* data,
+	unsigned int count)
+{
+	if (!buffer || count > capacity)
+	{
+		capacity = max(capacity, 64u);
+		while (capacity < count)
+			capacity *= 2;
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = capacity * stride;
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		desc.StructureByteStride = stride;
+		buffer.Reset();
+		device->CreateBuffer(&desc, 0, buffer.GetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = capacity;
+		srv.Reset();
+		device->CreateShaderResourceView(buffer.Get(), &srvDesc, srv.GetAddressOf());
+	}
+
+	if (count == 0)
+		return;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (SUCCEEDED(context->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+	{
+		memcpy(mapped.pData, data, (size_t)count * stride);
+		context->Unmap(buffer.Get(), 0);
+	}
+}
+
+void LightClusters::Upload(
+	const std::vector<Light>& lights,
+	const std::vector<ClusterRange>& ranges,
+	const std::vector<unsigned int>& indices)
+{
+	PROFILE_FUNCTION();
+	UpdateBuffer(lightBuffer, lightSRV, lightCapacity, sizeof(Light),
+		lights.empty() ? 0 : &lights[0], (unsigned int)lights.size());
+	UpdateBuffer(rangeBuffer, rangeSRV, rangeCapacity, sizeof(ClusterRange),
+		ranges.empty() ? 0 : &ranges[0], (unsigned int)ranges.size());
+	UpdateBuffer(indexBuffer, indexSRV, indexCapacity, sizeof(unsigned int),
+		indices.empty() ? 0 : &indices[0], (unsigned int)indices.size());
+}
+
+void LightClusters::SetShaderData(
+	std::shared_ptr<SimplePixelShader> shader,
+	const XMFLOAT4X4& view,
+	const XMFLOAT4X4& projection,
+	float screenWidth,
+	float screenHeight)
+{
+	float nearZ, farZ, clusterNear, depthScale;
+	GetSliceParams(projection, nearZ, farZ, clusterNear, depthScale);
+
+	// Dotting a world position with this gives its view space depth
+	XMFLOAT4 depthPlane(view._13, view._23, view._33, view._43);
+	unsigned int counts[3] = { CountX, CountY, CountZ };
+
+	shader->SetFloat4("clusterDepthPlane", depthPlane);
+	shader->SetFloat2("screenSize", XMFLOAT2(screenWidth, screenHeight));
+	shader->SetFloat("clusterNear", clusterNear);
+	shader->SetFloat("clusterDepthScale", depthScale);
+	shader->SetData("clusterCounts", counts, sizeof(counts));
+	shader->SetShaderResourceView("ClusterLights", lightSRV);
+	shader->SetShaderResourceView("ClusterRanges", rangeSRV);
+	shader->SetShaderResourceView("ClusterLightIndices", indexSRV);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+#include "LightClusterBins.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// Clustered forward lighting - the binning (LightClusterBins)
+// plus the GPU side.  Upload() puts the lights and per-cluster
+// lists into structured buffers so each pixel only loops over
+// the lights in its own cluster.
+//
+// Bin() is CPU only (and runs on the simulation thread),
+// while Upload() and SetShaderData() need the render thread.
+// --------------------------------------------------------
+class LightClusters : public LightClusterBins
+{
+public:
+	LightClusters(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+	~LightClusters();
+
+	// Copies the lights & lists to the GPU, once per frame
+	void Upload(
+		const std::vector<Light>& lights,
+		const std::vector<ClusterRange>& ranges,
+		const std::vector<unsigned int>& indices);
+
+	// Binds the buffers & grid info for one pixel shader
+	void SetShaderData(
+		std::shared_ptr<SimplePixelShader> shader,
+		const DirectX::XMFLOAT4X4& view,
+		const DirectX::XMFLOAT4X4& projection,
+		float screenWidth,
+		float screenHeight);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	// GPU side
+	Microsoft::WRL::ComPtr<ID3D11Buffer> lightBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> rangeBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> lightSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> rangeSRV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> indexSRV;
+	unsigned int lightCapacity;
+	unsigned int rangeCapacity;
+	unsigned int indexCapacity;
+
+	void UpdateBuffer(
+		Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer,
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv,
+		unsigned int& capacity,
+		unsigned int stride,
+		const void* data,
+		unsigned int count);
+};
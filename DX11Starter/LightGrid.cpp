@@ -0,0 +1,211 @@
+#include "LightGrid.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+using namespace DirectX;
+
+// Keeps the grid small even when the lights are spread out
+static const unsigned int MaxCellsPerAxis = 32;
+
+LightGrid::LightGrid() :
+	gridLightCount(0),
+	origin(0, 0, 0),
+	cellSize(1.0f),
+	dims()
+{
+}
+
+LightGrid::~LightGrid()
+{
+}
+
+// --------------------------------------------------------
+// Sizes the grid around the lights (cells about as big as
+// the average light, but never more than MaxCellsPerAxis in
+// each direction) and fills the cells with a count pass and
+// then a fill pass
+// --------------------------------------------------------
+void LightGrid::Build(const std::vector<Light>& lights)
+{
+	PROFILE_FUNCTION();
+
+	infos.resize(lights.size());
+	gridLightCount = 0;
+	XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	float totalRange = 0.0f;
+
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const Light& light = lights[i];
+		LightInfo& info = infos[i];
+		info.Position = light.Position;
+		info.Range = 0.0f;
+		info.Strength = 0.0f;
+		if ((light.Type != LIGHT_TYPE_POINT && light.Type != LIGHT_TYPE_SPOT) || light.Range <= 0.0f)
+			continue;
+
+		info.Range = light.Range;
+		info.Strength = light.Intensity * std::max(light.Color.x, std::max(light.Color.y, light.Color.z));
+
+		boundsMin.x = std::min(boundsMin.x, light.Position.x - light.Range);
+		boundsMin.y = std::min(boundsMin.y, light.Position.y - light.Range);
+		boundsMin.z = std::min(boundsMin.z, light.Position.z - light.Range);
+		boundsMax.x = std::max(boundsMax.x, light.Position.x + light.Range);
+		boundsMax.y = std::max(boundsMax.y, light.Position.y + light.Range);
+		boundsMax.z = std::max(boundsMax.z, light.Position.z + light.Range);
+		totalRange += light.Range;
+		gridLightCount++;
+	}
+
+	if (gridLightCount == 0)
+	{
+		dims[0] = dims[1] = dims[2] = 0;
+		cellStarts.clear();
+		cellLights.clear();
+		return;
+	}
+
+	// Cell size
+	float size[3] = { boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z };
+	float largest = std::max(size[0], std::max(size[1], size[2]));
+	cellSize = std::max(2.0f * totalRange / gridLightCount, largest / MaxCellsPerAxis);
+	origin = boundsMin;
+	for (int axis = 0; axis < 3; axis++)
+		dims[axis] = std::max(1u, std::min(MaxCellsPerAxis, (unsigned int)ceilf(size[axis] / cellSize)));
+
+	// Count how many lights land in each cell...
+	unsigned int cellCount = dims[0] * dims[1] * dims[2];
+	cellStarts.assign(cellCount + 1, 0);
+	unsigned int minCell[3], maxCell[3];
+	for (size_t i = 0; i < infos.size(); i++)
+	{
+		if (infos[i].Range <= 0.0f || !GetCellRange(infos[i].Position, infos[i].Range, minCell, maxCell))
+			continue;
+
+		for (unsigned int z = minCell[2]; z <= maxCell[2]; z++)
+			for (unsigned int y = minCell[1]; y <= maxCell[1]; y++)
+				for (unsigned int x = minCell[0]; x <= maxCell[0]; x++)
+					cellStarts[x + y * dims[0] + z * dims[0] * dims[1] + 1]++;
+	}
+
+	// ...turn the counts into starting offsets...
+	for (unsigned int c = 0; c < cellCount; c++)
+		cellStarts[c + 1] += cellStarts[c];
+
+	// ...and fill them in, using a copy of the offsets as cursors
+	cellLights.resize(cellStarts[cellCount]);
+	std::vector<unsigned int> cursors(cellStarts.begin(), cellStarts.end() - 1);
+	for (size_t i = 0; i < infos.size(); i++)
+	{
+		if (infos[i].Range <= 0.0f || !GetCellRange(infos[i].Position, infos[i].Range, minCell, maxCell))
+			continue;
+
+		for (unsigned int z = minCell[2]; z <= maxCell[2]; z++)
+			for (unsigned int y = minCell[1]; y <= maxCell[1]; y++)
+				for (unsigned int x = minCell[0]; x <= maxCell[0]; x++)
+					cellLights[cursors[x + y * dims[0] + z * dims[0] * dims[1]]++] = (unsigned int)i;
+	}
+}
+
+// --------------------------------------------------------
+// Which cells a sphere's box covers.  False if it misses
+// the grid entirely.
+// --------------------------------------------------------
+bool LightGrid::GetCellRange(const XMFLOAT3& center, float radius, unsigned int minCell[3], unsigned int maxCell[3]) const
+{
+	float c[3] = { center.x - origin.x, center.y - origin.y, center.z - origin.z };
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float low = floorf((c[axis] - radius) / cellSize);
+		float high = floorf((c[axis] + radius) / cellSize);
+		if (high < 0.0f || low >= (float)dims[axis])
+			return false;
+
+		minCell[axis] = (unsigned int)std::max(0.0f, low);
+		maxCell[axis] = (unsigned int)std::min((float)dims[axis] - 1, high);
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Estimates each nearby light's contribution at the point
+// of the sphere closest to it (the same falloff as the
+// shaders' Attenuate()) and keeps the strongest few.
+//
+// A light can be listed in several cells, so duplicates are
+// skipped while inserting - with so few slots that's cheaper
+// than tracking which lights have been seen.
+// --------------------------------------------------------
+void LightGrid::Query(const BoundingSphere& sphere, unsigned int maxLights, ObjectLightList& result) const
+{
+	result.Count = 0;
+	maxLights = std::min(maxLights, (unsigned int)MAX_OBJECT_LIGHTS);
+
+	unsigned int minCell[3], maxCell[3];
+	if (gridLightCount == 0 || maxLights == 0 || !GetCellRange(sphere.Center, sphere.Radius, minCell, maxCell))
+		return;
+
+	float scores[MAX_OBJECT_LIGHTS];
+	for (unsigned int z = minCell[2]; z <= maxCell[2]; z++)
+	{
+		for (unsigned int y = minCell[1]; y <= maxCell[1]; y++)
+		{
+			for (unsigned int x = minCell[0]; x <= maxCell[0]; x++)
+			{
+				unsigned int cell = x + y * dims[0] + z * dims[0] * dims[1];
+				for (unsigned int e = cellStarts[cell]; e < cellStarts[cell + 1]; e++)
+				{
+					unsigned int index = cellLights[e];
+					const LightInfo& info = infos[index];
+
+					// Does its range reach the sphere at all?
+					float dx = info.Position.x - sphere.Center.x;
+					float dy = info.Position.y - sphere.Center.y;
+					float dz = info.Position.z - sphere.Center.z;
+					float dist = std::max(0.0f, sqrtf(dx * dx + dy * dy + dz * dz) - sphere.Radius);
+					if (dist >= info.Range)
+						continue;
+
+					float att = 1.0f - dist * dist / (info.Range * info.Range);
+					float score = info.Strength * att * att;
+
+					// Already have it, or not strong enough?
+					bool duplicate = false;
+					for (unsigned int i = 0; i < result.Count && !duplicate; i++)
+						duplicate = result.Indices[i] == index;
+					if (duplicate || (result.Count == maxLights && score <= scores[maxLights - 1]))
+						continue;
+
+					// Insert in order, dropping the weakest if full
+					unsigned int slot = result.Count < maxLights ? result.Count++ : maxLights - 1;
+					while (slot > 0 && scores[slot - 1] < score)
+					{
+						scores[slot] = scores[slot - 1];
+						result.Indices[slot] = result.Indices[slot - 1];
+						slot--;
+					}
+					scores[slot] = score;
+					result.Indices[slot] = index;
+				}
+			}
+		}
+	}
+}
+
+unsigned int LightGrid::GetLightCount() const
+{
+	return gridLightCount;
+}
+
+unsigned int LightGrid::GetCellCount() const
+{
+	return dims[0] * dims[1] * dims[2];
+}
+
+unsigned int LightGrid::GetEntryCount() const
+{
+	return (unsigned int)cellLights.size();
+}
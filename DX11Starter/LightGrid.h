@@ -0,0 +1,65 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+
+#include "Lights.h"
+
+// Most point & spot lights a single object can use (must
+// match objectLightIndices in ClusteredLighting.hlsli)
+#define MAX_OBJECT_LIGHTS	8
+
+// --------------------------------------------------------
+// The strongest lights affecting one object, strongest first
+// --------------------------------------------------------
+struct ObjectLightList
+{
+	unsigned int Count;
+	unsigned int Indices[MAX_OBJECT_LIGHTS];	// Into the scene's lights
+};
+
+// --------------------------------------------------------
+// Uniform grid over the point & spot lights' range spheres,
+// for quickly finding the lights that reach an object.
+//
+// Each cell lists every light whose sphere overlaps it, all
+// packed into one array (cellStarts[c] .. cellStarts[c+1]).
+// Build() is single threaded, but Query() doesn't change
+// anything, so it's safe to call from many jobs at once.
+// --------------------------------------------------------
+class LightGrid
+{
+public:
+	LightGrid();
+	~LightGrid();
+
+	void Build(const std::vector<Light>& lights);
+
+	// Finds up to maxLights lights with the largest estimated
+	// contribution somewhere on the sphere, strongest first
+	void Query(const DirectX::BoundingSphere& sphere, unsigned int maxLights, ObjectLightList& result) const;
+
+	unsigned int GetLightCount() const;
+	unsigned int GetCellCount() const;
+	unsigned int GetEntryCount() const;
+
+private:
+	// What Query() needs from each light (indexed like the lights vector)
+	struct LightInfo
+	{
+		DirectX::XMFLOAT3 Position;
+		float Range;
+		float Strength;		// Intensity * brightest color channel
+	};
+	std::vector<LightInfo> infos;
+	unsigned int gridLightCount;
+
+	DirectX::XMFLOAT3 origin;
+	float cellSize;
+	unsigned int dims[3];
+	std::vector<unsigned int> cellStarts;
+	std::vector<unsigned int> cellLights;
+
+	bool GetCellRange(const DirectX::XMFLOAT3& center, float radius, unsigned int minCell[3], unsigned int maxCell[3]) const;
+};
@@ -5,6 +5,10 @@
 #define LIGHT_TYPE_POINT		1
 #define LIGHT_TYPE_SPOT			2
 
+// Size of the lights[] array in the pixel shaders' cbuffers, which
+// only holds directional lights (the rest are clustered)
+#define MAX_LIGHTS				5
+
 struct Light
 {
 	int Type;
@@ -14,5 +18,6 @@ struct Light
 	float Intensity;
 	DirectX::XMFLOAT3 Color;
 	float SpotFalloff;
-	DirectX::XMFLOAT3 Padding;
+	int ShadowIndex;	// Tile in the shadow atlas, filled in each frame (-1 for none)
+	DirectX::XMFLOAT2 Padding;
 };
\ No newline at end of file
@@ -18,9 +18,12 @@ int WINAPI WinMain(
 	_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF );
 #endif
 
+	// Check for benchmark mode options
+	BenchmarkSettings benchmarkSettings = BenchmarkSettings::FromCommandLine(lpCmdLine);
+
 	// Create the Game object using
 	// the app handle we got from WinMain
-	Game dxGame(hInstance);
+	Game dxGame(hInstance, benchmarkSettings);
 
 	// Result variable for function calls below
 	HRESULT hr = S_OK;
@@ -112,15 +112,61 @@ void Material::AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11Shad
 	textureSRVs.insert({ name, srv });
 }
 
+void Material::AddTexture(std::string name, std::shared_ptr<Texture> texture)
+{
+	textures.insert({ name, texture });
+}
+
+const std::unordered_map<std::string, std::shared_ptr<Texture>>& Material::GetTextures()
+{
+	return textures;
+}
+
 void Material::AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
 {
 	samplers.insert({ name, sampler });
 }
 
+void Material::SetShaderVariants(std::shared_ptr<ShaderVariantCache> variants, unsigned int features)
+{
+	shaderVariants = variants;
+	shaderFeatures = features;
+}
+
+// Materials without a variant cache keep the shader they have
+void Material::SelectShaderVariant(unsigned int frameFeatures)
+{
+	if (shaderVariants)
+		pixelShader = shaderVariants->Get(shaderFeatures | frameFeatures);
+}
+
+unsigned int Material::GetShaderFeatures()
+{
+	return shaderFeatures;
+}
+
+bool Material::UsesShaderVariants()
+{
+	return shaderVariants != nullptr;
+}
+
+void Material::FillShaderData(PBRPixelShaderData& data)
+{
+	data.ColorTint = colorTint;
+	data.Roughness = roughness;
+	data.UVOffset = uvOffset;
+	data.UVScale = uvScale;
+}
+
 void Material::PrepareMaterial()
 {
-	pixelShader->SetFloat2("uvOffset", uvOffset);
-	pixelShader->SetFloat2("uvScale", uvScale);
+	// (Already in the whole buffer for the PBR shaders)
+	if (!shaderVariants)
+	{
+		pixelShader->SetFloat2("uvOffset", uvOffset);
+		pixelShader->SetFloat2("uvScale", uvScale);
+	}
 	for (auto& t : textureSRVs) { pixelShader->SetShaderResourceView(t.first.c_str(), t.second); }
+	for (auto& t : textures) { pixelShader->SetShaderResourceView(t.first.c_str(), t.second->SRV); }
 	for (auto& s : samplers) { pixelShader->SetSamplerState(s.first.c_str(), s.second); }
 }
\ No newline at end of file
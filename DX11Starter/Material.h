@@ -2,6 +2,9 @@
 
 #include <memory>
 #include "SimpleShader.h"
+#include "ShaderVariants.h"
+#include "ConstantBuffers.h"
+#include "TextureManager.h"
 #include <DirectXMath.h>
 #include <unordered_map>
 #include <wrl/client.h>
@@ -42,9 +45,24 @@ public:
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> pixelShader);
 
 	void AddTextureSRV(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	// Bound by whatever view the texture has when the material's
+	// used, so streaming can swap it out underneath
+	void AddTexture(std::string name, std::shared_ptr<Texture> texture);
+	const std::unordered_map<std::string, std::shared_ptr<Texture>>& GetTextures();
 	void AddSampler(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 	void PrepareMaterial();
 
+	// Pixel shader from a variant cache (see ShaderVariants.h) - this
+	// material's own features (like normal mapping) plus the frame's
+	void SetShaderVariants(std::shared_ptr<ShaderVariantCache> variants, unsigned int features);
+	void SelectShaderVariant(unsigned int frameFeatures);
+	unsigned int GetShaderFeatures();
+
+	// Materials with variants use the PBR pixel shaders, whose whole
+	// buffer is set at once - this fills in the material's part
+	bool UsesShaderVariants();
+	void FillShaderData(PBRPixelShaderData& data);
+
 private:
 
 	DirectX::XMFLOAT4 colorTint;
@@ -55,7 +73,11 @@ private:
 	std::shared_ptr<SimpleVertexShader> vertexShader;
 	std::shared_ptr<SimplePixelShader> pixelShader;
 
+	std::shared_ptr<ShaderVariantCache> shaderVariants;
+	unsigned int shaderFeatures = 0;
+
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
+	std::unordered_map<std::string, std::shared_ptr<Texture>> textures;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
 
 };
\ No newline at end of file
@@ -346,6 +346,13 @@ void Mesh::CreateBuffers(
 	int numIndices,
 	Microsoft::WRL::ComPtr<ID3D11Device> device
 ) {
+	// Bounding sphere around every vertex position
+	if (numVertices > 0)
+	{
+		const Vertex* verts = (const Vertex*)vertices;
+		DirectX::BoundingSphere::CreateFromPoints(bounds, numVertices, &verts[0].Position, sizeof(Vertex));
+	}
+
 	// Create a Vertex Buffer
 	{
 		D3D11_BUFFER_DESC vbd = {};
@@ -410,6 +417,11 @@ std::string Mesh::GetName()
 	return name;
 }
 
+DirectX::BoundingSphere Mesh::GetBounds()
+{
+	return bounds;
+}
+
 
 void Mesh::Draw()
 {
@@ -3,6 +3,7 @@
 #include <d3d11.h>
 #include <wrl/client.h>
 #include <string>
+#include <DirectXCollision.h>
 
 #include "Vertex.h"
 
@@ -30,6 +31,7 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
 	int GetIndexCount();
 	std::string GetName();
+	DirectX::BoundingSphere GetBounds();
 	void Draw();
 
 private:
@@ -38,6 +40,9 @@ private:
 	int numVertices;
 	int numIndices;
 
+	// Object space bounds, for culling
+	DirectX::BoundingSphere bounds;
+
 	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
 
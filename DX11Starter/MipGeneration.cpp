@@ -0,0 +1,596 @@
+#include "MipGeneration.h"
+#include "CubeShadowFaces.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <xmmintrin.h>
+
+using namespace DirectX;
+
+static const float Pi = 3.14159265359f;
+
+// Shape of the Kaiser window, and how far the filter reaches
+// each side of a texel (in texels of the level below)
+static const float KaiserAlpha = 4.0f;
+static const float KaiserRadius = 3.0f;
+
+// Each face's center direction, and the directions its s & t
+// (texture u & v, remapped to -1 to 1) run along - D3D's layout,
+// like GetTexelDirection() in IBLBaker.cpp
+static const float FaceAxes[6][3][3] =
+{
+	{ { 1, 0, 0 }, { 0, 0, -1 }, { 0, -1, 0 } },
+	{ { -1, 0, 0 }, { 0, 0, 1 }, { 0, -1, 0 } },
+	{ { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+	{ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, -1 } },
+	{ { 0, 0, 1 }, { 1, 0, 0 }, { 0, -1, 0 } },
+	{ { 0, 0, -1 }, { -1, 0, 0 }, { 0, -1, 0 } },
+};
+
+const char* GetMipFilterName(int filter)
+{
+	return filter == MIP_FILTER_KAISER ? "Kaiser" : "Box";
+}
+
+// --------------------------------------------------------
+// One level as floats, 4 per texel (gray images fill RGB)
+// --------------------------------------------------------
+struct FloatImage
+{
+	unsigned int Width;
+	unsigned int Height;
+	std::vector<float> Pixels;
+};
+
+// --------------------------------------------------------
+// The filter along one axis: the same number of taps for
+// every texel of the level below (unused ones weigh zero),
+// each an index into the level above - already wrapped or
+// clamped - and its weight
+// --------------------------------------------------------
+struct FilterTaps
+{
+	unsigned int Count;
+	std::vector<unsigned int> Sources;
+	std::vector<float> Weights;
+};
+
+// --------------------------------------------------------
+// The sRGB curve, both ways.  Decoding is a lookup; encoding
+// searches the midpoints between each code's linear value,
+// so it rounds exactly like encoding the float would (and
+// an untouched texel always comes back as itself).
+// --------------------------------------------------------
+struct SRGBTables
+{
+	float ToLinear[256];
+	float Midpoints[255];
+
+	SRGBTables()
+	{
+		for (int i = 0; i < 256; i++)
+			ToLinear[i] = Decode(i / 255.0f);
+		for (int i = 0; i < 255; i++)
+			Midpoints[i] = Decode((i + 0.5f) / 255.0f);
+	}
+
+	static float Decode(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	unsigned char Encode(float linear) const
+	{
+		return (unsigned char)(std::upper_bound(Midpoints, Midpoints + 255, linear) - Midpoints);
+	}
+};
+
+static const SRGBTables& GetSRGBTables()
+{
+	static const SRGBTables tables;
+	return tables;
+}
+
+static unsigned char ToByte(float c)
+{
+	return (unsigned char)(std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+// Runs over rows either across the job system or right here
+template<typename Func>
+static void ForRows(unsigned int count, bool parallel, const Func& func)
+{
+	if (parallel)
+		JobSystem::GetInstance().ParallelFor(count, func);
+	else
+		func(0, count);
+}
+
+// --------------------------------------------------------
+// Kaiser windowed sinc - the sinc cuts off at the smaller
+// level's Nyquist limit, and the window tapers it to zero
+// at the radius
+// --------------------------------------------------------
+static float BesselI0(float x)
+{
+	// Power series - converges quickly for the alphas used here
+	float sum = 1.0f;
+	float term = 1.0f;
+	for (int k = 1; k < 20; k++)
+	{
+		term *= (x * 0.5f / k) * (x * 0.5f / k);
+		sum += term;
+	}
+	return sum;
+}
+
+static float Kaiser(float distance)
+{
+	float x = distance / KaiserRadius;
+	if (fabsf(x) >= 1.0f)
+		return 0.0f;
+
+	float sinc = 1.0f;
+	if (distance != 0.0f)
+	{
+		float a = Pi * distance * 0.5f;
+		sinc = sinf(a) / a;
+	}
+	return sinc * BesselI0(KaiserAlpha * sqrtf(1.0f - x * x)) / BesselI0(KaiserAlpha);
+}
+
+// --------------------------------------------------------
+// Taps for shrinking one axis from sourceSize texels to
+// size texels.  Distances are measured in texels of the
+// level above, scaled so that halving (the usual case)
+// needs no scaling - odd sizes just stretch the filter.
+// --------------------------------------------------------
+static void BuildTaps(unsigned int sourceSize, unsigned int size, int filter, bool wrap, FilterTaps& taps)
+{
+	float scale = (float)sourceSize / size;
+	float reach = filter == MIP_FILTER_KAISER ? KaiserRadius * scale * 0.5f : scale * 0.5f;
+	taps.Count = sourceSize == size ? 1 : (unsigned int)ceilf(reach * 2) + 1;
+	taps.Sources.assign((size_t)size * taps.Count, 0);
+	taps.Weights.assign((size_t)size * taps.Count, 0.0f);
+
+	for (unsigned int i = 0; i < size; i++)
+	{
+		unsigned int* sources = &taps.Sources[(size_t)i * taps.Count];
+		float* weights = &taps.Weights[(size_t)i * taps.Count];
+		if (sourceSize == size)
+		{
+			sources[0] = i;
+			weights[0] = 1.0f;
+			continue;
+		}
+
+		float center = (i + 0.5f) * scale;
+		int first = (int)floorf(center - reach);
+		float total = 0.0f;
+		for (unsigned int k = 0; k < taps.Count; k++)
+		{
+			int j = first + (int)k;
+			float weight;
+			if (filter == MIP_FILTER_KAISER)
+			{
+				weight = Kaiser((j + 0.5f - center) / (scale * 0.5f));
+			}
+			else
+			{
+				// How much of the texel lies under the box
+				float overlap = std::min(j + 1.0f, center + reach) - std::max((float)j, center - reach);
+				weight = std::max(overlap, 0.0f);
+			}
+
+			int n = (int)sourceSize;
+			sources[k] = wrap ? (unsigned int)(((j % n) + n) % n) : (unsigned int)std::min(std::max(j, 0), n - 1);
+			weights[k] = weight;
+			total += weight;
+		}
+
+		for (unsigned int k = 0; k < taps.Count; k++)
+			weights[k] /= total;
+	}
+}
+
+// --------------------------------------------------------
+// 8 bit pixels to floats, linearizing sRGB color (alpha is
+// always linear)
+// --------------------------------------------------------
+static void ToFloat(const TextureImage& image, bool sRGB, bool parallel, FloatImage& result)
+{
+	const SRGBTables& tables = GetSRGBTables();
+	result.Width = image.Width;
+	result.Height = image.Height;
+	result.Pixels.resize((size_t)image.Width * image.Height * 4);
+
+	ForRows(image.Height, parallel, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int y = begin; y < end; y++)
+		{
+			const unsigned char* in = &image.Pixels[(size_t)y * image.Width * image.Channels];
+			float* out = &result.Pixels[(size_t)y * image.Width * 4];
+			for (unsigned int x = 0; x < image.Width; x++, in += image.Channels, out += 4)
+			{
+				for (unsigned int c = 0; c < 3; c++)
+				{
+					unsigned char value = in[image.Channels == 1 ? 0 : c];
+					out[c] = sRGB ? tables.ToLinear[value] : value / 255.0f;
+				}
+				out[3] = image.Channels == 1 ? 1.0f : in[3] / 255.0f;
+			}
+		}
+	});
+}
+
+// --------------------------------------------------------
+// Shrinks a level - across each row first, then down each
+// column of that.  Across, each texel's four channels are
+// one register; down, whole rows are scaled & summed, so
+// they're just runs of floats, four at a time.  (That pass
+// is bound by memory, not math, so wider registers don't
+// help it.)
+// --------------------------------------------------------
+static void Downsample(const FloatImage& source, const MipSettings& settings, bool wrap, bool parallel, FloatImage& result)
+{
+	result.Width = std::max(1u, source.Width / 2);
+	result.Height = std::max(1u, source.Height / 2);
+	result.Pixels.resize((size_t)result.Width * result.Height * 4);
+
+	FilterTaps across, down;
+	BuildTaps(source.Width, result.Width, settings.Filter, wrap, across);
+	BuildTaps(source.Height, result.Height, settings.Filter, wrap, down);
+
+	// Across
+	std::vector<float> narrow((size_t)result.Width * source.Height * 4);
+	ForRows(source.Height, parallel, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int y = begin; y < end; y++)
+		{
+			const float* in = &source.Pixels[(size_t)y * source.Width * 4];
+			float* out = &narrow[(size_t)y * result.Width * 4];
+			for (unsigned int x = 0; x < result.Width; x++)
+			{
+				const unsigned int* sources = &across.Sources[(size_t)x * across.Count];
+				const float* weights = &across.Weights[(size_t)x * across.Count];
+				__m128 sum = _mm_setzero_ps();
+				for (unsigned int k = 0; k < across.Count; k++)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(in + sources[k] * 4), _mm_set1_ps(weights[k])));
+				_mm_storeu_ps(out + x * 4, sum);
+			}
+		}
+	});
+
+	// Down
+	unsigned int rowFloats = result.Width * 4;
+	ForRows(result.Height, parallel, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int y = begin; y < end; y++)
+		{
+			const unsigned int* sources = &down.Sources[(size_t)y * down.Count];
+			const float* weights = &down.Weights[(size_t)y * down.Count];
+			float* out = &result.Pixels[(size_t)y * rowFloats];
+			std::fill(out, out + rowFloats, 0.0f);
+
+			for (unsigned int k = 0; k < down.Count; k++)
+			{
+				const float* in = &narrow[(size_t)sources[k] * rowFloats];
+				__m128 weight = _mm_set1_ps(weights[k]);
+				for (unsigned int i = 0; i < rowFloats; i += 4)
+					_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(in + i), weight)));
+			}
+		}
+	});
+}
+
+// Share of texels whose alpha, scaled, passes the cutoff
+static float AlphaCoverage(const FloatImage& image, float cutoff, float scale)
+{
+	size_t count = (size_t)image.Width * image.Height;
+	size_t passed = 0;
+	for (size_t i = 0; i < count; i++)
+		passed += image.Pixels[i * 4 + 3] * scale >= cutoff ? 1 : 0;
+	return (float)passed / count;
+}
+
+// --------------------------------------------------------
+// Scale for a mip's alpha that lets the same share of its
+// texels through an alpha test as the top mip - found by
+// bisecting for the alpha that share lies above, which is
+// then scaled up (or down) to the cutoff
+// --------------------------------------------------------
+static float AlphaCoverageScale(const FloatImage& image, float cutoff, float coverage)
+{
+	float low = 0.0f;
+	float high = 1.0f;
+	for (int i = 0; i < 12; i++)
+	{
+		float middle = (low + high) * 0.5f;
+		if (AlphaCoverage(image, middle, 1.0f) > coverage)
+			low = middle;
+		else
+			high = middle;
+	}
+
+	float threshold = (low + high) * 0.5f;
+	return threshold > 0.0f ? cutoff / threshold : 1.0f;
+}
+
+// --------------------------------------------------------
+// Floats back to 8 bits - encoding sRGB again, putting
+// normals back to unit length and scaling alpha
+// --------------------------------------------------------
+static void ToBytes(const FloatImage& image, const MipSettings& settings, unsigned int channels, float alphaScale, bool parallel, TextureImage& result)
+{
+	const SRGBTables& tables = GetSRGBTables();
+	result.Width = image.Width;
+	result.Height = image.Height;
+	result.Channels = channels;
+	result.Pixels.resize((size_t)image.Width * image.Height * channels);
+
+	ForRows(image.Height, parallel, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int y = begin; y < end; y++)
+		{
+			const float* in = &image.Pixels[(size_t)y * image.Width * 4];
+			unsigned char* out = &result.Pixels[(size_t)y * image.Width * channels];
+			for (unsigned int x = 0; x < image.Width; x++, in += 4, out += channels)
+			{
+				float color[3] = { in[0], in[1], in[2] };
+				if (settings.NormalMap)
+				{
+					float n[3] = { color[0] * 2 - 1, color[1] * 2 - 1, color[2] * 2 - 1 };
+					float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					if (length > 0.0f)
+					{
+						for (int c = 0; c < 3; c++)
+							color[c] = n[c] / length * 0.5f + 0.5f;
+					}
+				}
+
+				for (unsigned int c = 0; c < std::min(channels, 3u); c++)
+					out[c] = settings.SRGB ? tables.Encode(color[c]) : ToByte(color[c]);
+				if (channels == 4)
+					out[3] = ToByte(in[3] * alphaScale);
+			}
+		}
+	});
+}
+
+static void GenerateMips(const TextureImage& top, const MipSettings& settings, bool parallel, std::vector<TextureImage>& mips)
+{
+	mips.clear();
+	mips.push_back(top);
+
+	FloatImage level;
+	ToFloat(top, settings.SRGB, parallel, level);
+
+	bool preserveCoverage = settings.AlphaCutoff > 0.0f && top.Channels == 4;
+	float coverage = preserveCoverage ? AlphaCoverage(level, settings.AlphaCutoff, 1.0f) : 0.0f;
+
+	while (level.Width > 1 || level.Height > 1)
+	{
+		FloatImage smaller;
+		Downsample(level, settings, settings.Wrap, parallel, smaller);
+		level = std::move(smaller);
+
+		float alphaScale = preserveCoverage ? AlphaCoverageScale(level, settings.AlphaCutoff, coverage) : 1.0f;
+		TextureImage mip;
+		ToBytes(level, settings, top.Channels, alphaScale, parallel, mip);
+		mips.push_back(std::move(mip));
+	}
+}
+
+void GenerateMips(const TextureImage& top, const MipSettings& settings, std::vector<TextureImage>& mips)
+{
+	PROFILE_FUNCTION();
+	GenerateMips(top, settings, true, mips);
+}
+
+// --------------------------------------------------------
+// Which texel of which face a direction lands in
+// --------------------------------------------------------
+static void GetCubeTexel(const float direction[3], unsigned int size, unsigned int& face, unsigned int& x, unsigned int& y)
+{
+	face = GetCubeFace(XMFLOAT3(direction[0], direction[1], direction[2]));
+	const float(*axes)[3] = FaceAxes[face];
+	float major = direction[0] * axes[0][0] + direction[1] * axes[0][1] + direction[2] * axes[0][2];
+	float s = (direction[0] * axes[1][0] + direction[1] * axes[1][1] + direction[2] * axes[1][2]) / major;
+	float t = (direction[0] * axes[2][0] + direction[1] * axes[2][1] + direction[2] * axes[2][2]) / major;
+
+	int last = (int)size - 1;
+	x = (unsigned int)std::min(std::max((int)floorf((s + 1) * 0.5f * size), 0), last);
+	y = (unsigned int)std::min(std::max((int)floorf((t + 1) * 0.5f * size), 0), last);
+}
+
+// --------------------------------------------------------
+// Averages every edge texel with the texels just across
+// its edges - one other face along an edge, two at a
+// corner.  Each neighbor is found by stepping one texel
+// past the edge, which lands in the face next door.
+// --------------------------------------------------------
+static void FixCubeSeams(FloatImage faces[6])
+{
+	unsigned int size = faces[0].Width;
+	if (size < 2)
+		return;
+
+	struct EdgeTexel
+	{
+		unsigned int Face;
+		size_t Index;
+		__m128 Value;
+	};
+	std::vector<EdgeTexel> fixed;
+	fixed.reserve((size_t)6 * size * 4);
+
+	const int steps[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+	for (unsigned int f = 0; f < 6; f++)
+	{
+		const float(*axes)[3] = FaceAxes[f];
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				bool edge[4] = { x == 0, x == size - 1, y == 0, y == size - 1 };
+				if (!edge[0] && !edge[1] && !edge[2] && !edge[3])
+				{
+					x = size - 2;	// Skip the inside of the row
+					continue;
+				}
+
+				size_t index = (size_t)y * size + x;
+				__m128 sum = _mm_loadu_ps(&faces[f].Pixels[index * 4]);
+				float count = 1.0f;
+				for (int e = 0; e < 4; e++)
+				{
+					if (!edge[e])
+						continue;
+
+					float s = (x + 0.5f + steps[e][0]) / size * 2 - 1;
+					float t = (y + 0.5f + steps[e][1]) / size * 2 - 1;
+					float direction[3];
+					for (int c = 0; c < 3; c++)
+						direction[c] = axes[0][c] + s * axes[1][c] + t * axes[2][c];
+
+					unsigned int face, nx, ny;
+					GetCubeTexel(direction, size, face, nx, ny);
+					sum = _mm_add_ps(sum, _mm_loadu_ps(&faces[face].Pixels[((size_t)ny * size + nx) * 4]));
+					count++;
+				}
+
+				EdgeTexel texel = { f, index, _mm_mul_ps(sum, _mm_set1_ps(1.0f / count)) };
+				fixed.push_back(texel);
+			}
+		}
+	}
+
+	for (const EdgeTexel& texel : fixed)
+		_mm_storeu_ps(&faces[texel.Face].Pixels[texel.Index * 4], texel.Value);
+}
+
+void GenerateCubeMips(const TextureImage faces[6], const MipSettings& settings, std::vector<TextureImage> mips[6])
+{
+	PROFILE_FUNCTION();
+
+	for (int f = 0; f < 6; f++)
+	{
+		mips[f].clear();
+		mips[f].push_back(faces[f]);
+	}
+
+	bool square = true;
+	for (int f = 0; f < 6; f++)
+		square = square && faces[f].Width == faces[0].Width && faces[f].Height == faces[0].Width;
+	if (!square)
+	{
+		// Can't line the edges up - each face on its own
+		MipSettings clamped = settings;
+		clamped.Wrap = false;
+		for (int f = 0; f < 6; f++)
+			GenerateMips(faces[f], clamped, true, mips[f]);
+		return;
+	}
+
+	bool preserveCoverage = settings.AlphaCutoff > 0.0f && faces[0].Channels == 4;
+	float coverage[6] = {};
+
+	// The top of each face is only needed as floats long
+	// enough to shrink it, so they're done one at a time
+	FloatImage levels[6];
+	for (int f = 0; f < 6; f++)
+	{
+		FloatImage top;
+		ToFloat(faces[f], settings.SRGB, true, top);
+		if (preserveCoverage)
+			coverage[f] = AlphaCoverage(top, settings.AlphaCutoff, 1.0f);
+		Downsample(top, settings, false, true, levels[f]);
+	}
+
+	while (true)
+	{
+		FixCubeSeams(levels);
+		for (int f = 0; f < 6; f++)
+		{
+			float alphaScale = preserveCoverage ? AlphaCoverageScale(levels[f], settings.AlphaCutoff, coverage[f]) : 1.0f;
+			TextureImage mip;
+			ToBytes(levels[f], settings, faces[f].Channels, alphaScale, true, mip);
+			mips[f].push_back(std::move(mip));
+		}
+
+		if (levels[0].Width == 1)
+			break;
+		for (int f = 0; f < 6; f++)
+		{
+			FloatImage smaller;
+			Downsample(levels[f], settings, false, true, smaller);
+			levels[f] = std::move(smaller);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Times each filter on the same image - once on this thread
+// alone, then spread across the job system - and checks the
+// 1x1 mip against the image's actual average color (taken
+// in linear space, as light would add up)
+// --------------------------------------------------------
+MipGenerationBenchmarkResults RunMipGenerationBenchmark(const TextureImage& source, bool sRGB)
+{
+	MipGenerationBenchmarkResults results = {};
+	results.Width = source.Width;
+	results.Height = source.Height;
+	results.ThreadCount = JobSystem::GetInstance().GetThreadCount();
+
+	const SRGBTables& tables = GetSRGBTables();
+	double average[3] = {};
+	size_t count = (size_t)source.Width * source.Height;
+	for (size_t i = 0; i < count; i++)
+	{
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			unsigned char value = source.Pixels[i * source.Channels + (source.Channels == 1 ? 0 : c)];
+			average[c] += sRGB ? tables.ToLinear[value] : value / 255.0f;
+		}
+	}
+
+	// The old way (box filtering the encoded values) first
+	const int filters[3] = { MIP_FILTER_BOX, MIP_FILTER_BOX, MIP_FILTER_KAISER };
+	const bool linear[3] = { false, true, true };
+	for (int r = 0; r < (sRGB ? 3 : 2); r++)
+	{
+		int index = sRGB ? r : r + 1;
+		MipSettings settings;
+		settings.Filter = filters[index];
+		settings.SRGB = linear[index] && sRGB;
+
+		MipGenerationBenchmarkRow row = {};
+		row.Filter = settings.Filter;
+		row.Linear = settings.SRGB;
+
+		std::vector<TextureImage> mips;
+		auto start = std::chrono::high_resolution_clock::now();
+		GenerateMips(source, settings, false, mips);
+		auto single = std::chrono::high_resolution_clock::now();
+		GenerateMips(source, settings, true, mips);
+		auto multi = std::chrono::high_resolution_clock::now();
+
+		row.SingleThreadMs = std::chrono::duration<double, std::milli>(single - start).count();
+		row.MultiThreadMs = std::chrono::duration<double, std::milli>(multi - single).count();
+
+		row.MegapixelsPerSecond = (double)source.Width * source.Height / (row.MultiThreadMs * 1000.0);
+
+		const TextureImage& last = mips.back();
+		float error = 0.0f;
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			float expected = (float)(average[c] / count);
+			float decoded = last.Pixels[last.Channels == 1 ? 0 : c] / 255.0f;
+			if (sRGB)
+				decoded = tables.ToLinear[last.Pixels[last.Channels == 1 ? 0 : c]];
+			error += fabsf(decoded - expected) * 255.0f / 3.0f;
+		}
+		row.AverageError = error;
+		results.Rows.push_back(row);
+	}
+
+	return results;
+}
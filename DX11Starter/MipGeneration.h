@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+
+#include "TextureCompression.h"
+
+// Filters each mip can be made with
+#define MIP_FILTER_BOX		0	// Average of the 2x2 texels above - fast, but a little blurry & aliased
+#define MIP_FILTER_KAISER	1	// Kaiser windowed sinc, 6 taps across - sharper, the way offline tools do it
+
+// --------------------------------------------------------
+// How a mip chain is made
+// --------------------------------------------------------
+struct MipSettings
+{
+	int Filter = MIP_FILTER_KAISER;
+	bool SRGB = false;			// Color is sRGB encoded - filtered in linear space, then encoded again
+	bool NormalMap = false;		// RGB is a unit vector - renormalized after filtering
+	bool Wrap = true;			// Filters wrap around the edges (tiling textures), or clamp to them
+	float AlphaCutoff = 0.0f;	// Above zero, each mip's alpha is scaled so the same share of texels pass an alpha test at this value
+};
+
+// --------------------------------------------------------
+// Results of RunMipGenerationBenchmark() - one row per
+// filter (plus box filtering without linearizing, for sRGB
+// images), each making the same chain
+// --------------------------------------------------------
+struct MipGenerationBenchmarkRow
+{
+	int Filter;
+	bool Linear;				// Filtered in linear space (rather than on the sRGB encoded values)
+	double SingleThreadMs;
+	double MultiThreadMs;
+	double MegapixelsPerSecond;	// Of the top mip, multithreaded
+	float AverageError;			// How far the 1x1 mip's light is from the image's average (0-255, linear)
+};
+
+struct MipGenerationBenchmarkResults
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int ThreadCount;
+	std::vector<MipGenerationBenchmarkRow> Rows;
+};
+
+const char* GetMipFilterName(int filter);
+
+// --------------------------------------------------------
+// CPU mip generation, for cooking textures and for making
+// mips at load time.  Each level is filtered from the one
+// above as floats (linear light, for sRGB images) - first
+// across, then down, four channels to an SSE register, with
+// rows spread across the job system.  Only the stored mips
+// are rounded back to 8 bits.
+//
+// mips[0] is a copy of the top; the rest go down to 1x1.
+// --------------------------------------------------------
+void GenerateMips(const TextureImage& top, const MipSettings& settings, std::vector<TextureImage>& mips);
+
+// The same for the six faces of a cube map (+X, -X, +Y, -Y,
+// +Z, -Z), which must be square & the same size.  Filters
+// clamp at each face's edges, then the texels along every
+// edge are averaged with the ones across it (three faces at
+// the corners) so no seams open up in the smaller mips.
+void GenerateCubeMips(const TextureImage faces[6], const MipSettings& settings, std::vector<TextureImage> mips[6]);
+
+// Makes the chain with each filter, on one thread & all
+MipGenerationBenchmarkResults RunMipGenerationBenchmark(const TextureImage& source, bool sRGB);
@@ -1,22 +1,40 @@
+// Features as compile time switches, so variants without them skip
+// their branches entirely (see ShaderVariants.h & ShaderVariants.targets,
+// which compile every combination).  Without PERMUTATION - the plain
+// PixelShader.cso & PixelShader_NormalMap.cso - fog and the light
+// count are decided at run time instead.
+#ifndef PERMUTATION
+#define FOG (fog == 1)
+#define SHADOWS 1
+#define CEL 0
+#define MAX_LIGHTS numLights
+#endif
+
+#ifndef NORMALMAP
+#define NORMALMAP 0
+#endif
+
 #include "ShaderIncludes.hlsli"
+#include "ClusteredLighting.hlsli"
+#include "ImageBasedLighting.hlsli"
 
 Texture2D Albedo : register(t0);
-Texture2D RoughnessMap : register(t1);
-Texture2D MetalnessMap : register(t2);
+Texture2D RoughnessMap : register(t1);  // Just without normal mapping
+Texture2D ORMMap : register(t2);        // Occlusion, roughness & metalness, packed by TexturePacking.cpp
+Texture2D NormalMap : register(t3);
 
-Texture2D ShadowMap : register(t3);
 Texture2D Ramp : register(t4);
 
 SamplerState BasicSampler : register(s0);
-SamplerComparisonState ShadowSampler : register(s1);
 
-// Struct representing data from a constant buffer
+// Struct representing data from a constant buffer - mirrored by
+// PBRPixelShaderData in ConstantBuffers.h, so keep the two in sync
 cbuffer ExternalData : register(b0)
 {
     float4 colorTint;
     float roughness;
     float3 cameraPosition;
-    float3 ambient;
+    float4 ambientSH[9];      // Sky irradiance - all zero unless it's the ambient mode
     float numLights;
     float2 uvOffset;
     float2 uvScale;
@@ -27,27 +45,19 @@ cbuffer ExternalData : register(b0)
     int fog;
 }
 
+#if NORMALMAP
+#define PIXEL_INPUT VertexToPixel_NormalMap
+#else
+#define PIXEL_INPUT VertexToPixel
+#endif
+
 // --------------------------------------------------------
 // The entry point (main method) for our pixel shader
 // --------------------------------------------------------
-float4 main(VertexToPixel input) : SV_TARGET
+float4 main(PIXEL_INPUT input) : SV_TARGET
 {
     input.normal = normalize(input.normal);
     
-    // ====== Shadows ======
-    
-    // Perspective divide
-    input.shadowMapPos /= input.shadowMapPos.w;
-    
-    // Convert the normalized device coordinates to UVs for sampling
-    float2 shadowUV = input.shadowMapPos.xy * 0.5f + 0.5f;
-    shadowUV.y = 1 - shadowUV.y; // Flip the Y
-    
-    // Compare light-to-pixel distance and closest-surface distance
-    float distToLight = input.shadowMapPos.z;
-    float shadowAmount = ShadowMap.SampleCmpLevelZero(
-        ShadowSampler, shadowUV, distToLight).r;
-    
     // ====== Textures ======
     
     // Scale UVs
@@ -58,34 +68,75 @@ float4 main(VertexToPixel input) : SV_TARGET
     float4 surfaceColor = Albedo.Sample(BasicSampler, uv) * colorTint;
     surfaceColor = float4(pow(surfaceColor.rgb, 2.2f), 1.0f);
     
+#if NORMALMAP
+    // One sample for all three
+    float3 orm = ORMMap.Sample(BasicSampler, uv).rgb;
+    float occlusion = orm.r;
+    float roughness = orm.g;
+    float metalness = orm.b;
+#else
+    float occlusion = 1.0f;
     float roughness = RoughnessMap.Sample(BasicSampler, uv).r;
     float metalness = 0.0f;
+#endif
     
     float3 specularColor = lerp(F0_NON_METAL, surfaceColor.rgb, metalness);
     
+#if NORMALMAP
+    // ====== Normals ======
+    
+    // Unpack normals
+    input.tangent = normalize(input.tangent);
+    // (Just x & y - normal maps are cooked to BC5 - so z is
+    // whatever makes it unit length)
+    float3 unpackedNormal;
+    unpackedNormal.xy = NormalMap.Sample(BasicSampler, uv).rg * 2 - 1;
+    unpackedNormal.z = sqrt(saturate(1 - dot(unpackedNormal.xy, unpackedNormal.xy)));
+    unpackedNormal = normalize(unpackedNormal);
+    
+    // Calculate TBN rotation matrix
+    float3 tangent = normalize(input.tangent - input.normal * dot(input.tangent, input.normal));
+    float3 bitangent = cross(tangent, input.normal);
+    float3x3 TBN = float3x3(input.tangent, bitangent, input.normal);
+    input.normal = mul(unpackedNormal, TBN);
+#endif
+    
     // ====== Lighting ======
     
     // Ambient, specular, direction -  same for all
     float3 v = normalize(cameraPosition - input.worldPosition);
     
-    // Calculate total lighting
+    // Calculate total lighting - directional lights come from the
+    // cbuffer, point & spot lights from this pixel's cluster (or
+    // this object's light list)
     float3 totalLight = float3(0.0f, 0.0f, 0.0f);
-    for (int i = 0; i < numLights; i++)
+    for (int i = 0; i < MAX_LIGHTS; i++)
     {
-        if (lights[i].Type == 0)
+        float3 lightResult;
+        if (CEL)
         {
-            float3 lightResult = DirectionalLight(input.normal, lights[i], v, roughness, surfaceColor.rgb, specularColor, metalness);
-            if (i == 0)
-                lightResult *= shadowAmount;
-            totalLight += lightResult;
-        }   
-        else if (lights[i].Type == 1)
-            totalLight += PointLight(input.normal, lights[i], v, roughness, surfaceColor.rgb, specularColor, input.worldPosition, metalness);
+            // Diffuse only, stepped by the ramp texture
+            float3 lightDir = -1 * normalize(lights[i].Direction);
+            float diffuse = DiffusePBR(input.normal, lightDir);
+            float celDiffuse = Ramp.Sample(BasicSampler, float2(diffuse, 0.5f)).r;
+            lightResult = celDiffuse * surfaceColor.rgb * lights[i].Intensity;
+        }
+        else
+        {
+            lightResult = DirectionalLight(input.normal, lights[i], v, roughness, surfaceColor.rgb, specularColor, metalness);
+        }
+        totalLight += lightResult * ShadowAmount(lights[i].ShadowIndex, input.worldPosition);
     }
+    totalLight += LocalLights(input.screenPosition.xy, input.normal, v, roughness, surfaceColor.rgb, specularColor, input.worldPosition, metalness);
+    
+    // Ambient from the sky (the only light occlusion blocks)
+    float3 ambient = SkyLight(input.normal, v, roughness, surfaceColor.rgb, specularColor, metalness);
+    ambient += EvaluateSH(ambientSH, input.normal) * surfaceColor.rgb * (1 - metalness);
+    totalLight += ambient * occlusion;
     
     float4 pixelColor = float4(pow(totalLight, 1.0f / 2.2f), 1.0f);
     
-    if (fog == 1)
+    if (FOG)
     {
         float dist = length(cameraPosition - input.worldPosition);
         float fogAmt = smoothstep(startFog, fullFog, dist);
@@ -97,4 +148,4 @@ float4 main(VertexToPixel input) : SV_TARGET
     {
         return pixelColor;
     }
-}
\ No newline at end of file
+}
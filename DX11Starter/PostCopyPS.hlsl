@@ -0,0 +1,17 @@
+struct VertexToPixel
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+Texture2D Pixels : register(t0);
+SamplerState ClampSampler : register(s0);
+
+// --------------------------------------------------------
+// Copies (and scales, if the sizes differ) the end of the
+// post process chain to the back buffer
+// --------------------------------------------------------
+float4 main(VertexToPixel input) : SV_TARGET
+{
+    return Pixels.Sample(ClampSampler, input.uv);
+}
@@ -0,0 +1,302 @@
+#include "PostProcessChain.h"
+#include "Profiler.h"
+
+// Enough to clear whatever a stage may have bound
+#define POST_PROCESS_MAX_BINDINGS	8
+
+PostProcessChain::PostProcessChain(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::shared_ptr<SimpleVertexShader> fullscreenVS,
+	std::shared_ptr<SimplePixelShader> copyPS) :
+	device(device),
+	context(context),
+	fullscreenVS(fullscreenVS),
+	copyPS(copyPS),
+	width(1),
+	height(1),
+	planned(false),
+	passCount(0),
+	texturesCreated(0)
+{
+}
+
+PostProcessChain::~PostProcessChain()
+{
+}
+
+void PostProcessChain::AddStage(const PostProcessStage& stage)
+{
+	stages.push_back(stage);
+	planned = false;
+}
+
+void PostProcessChain::SetEnabled(const std::string& name, bool enabled)
+{
+	for (PostProcessStage& stage : stages)
+	{
+		if (stage.Name == name)
+			stage.Enabled = enabled;
+	}
+}
+
+void PostProcessChain::Resize(unsigned int width, unsigned int height)
+{
+	this->width = max(width, 1u);
+	this->height = max(height, 1u);
+	planned = false;
+}
+
+// --------------------------------------------------------
+// Works out every enabled stage's inputs and how long its
+// output lives, then lets the pool pack the outputs into as
+// few textures as possible
+// --------------------------------------------------------
+void PostProcessChain::Plan()
+{
+	order.clear();
+	plannedEnabled.resize(stages.size());
+	for (unsigned int i = 0; i < stages.size(); i++)
+	{
+		plannedEnabled[i] = stages[i].Enabled;
+		if (stages[i].Enabled)
+			order.push_back(i);
+	}
+	unsigned int steps = (unsigned int)order.size();
+
+	// Inputs, as steps of this plan (stages that are off read
+	// whatever the previous stage made instead)
+	inputSources.assign(steps, std::vector<int>());
+	for (unsigned int s = 0; s < steps; s++)
+	{
+		for (const std::string& name : stages[order[s]].Inputs)
+		{
+			int source = (int)s - 1;
+			if (name == "Scene")
+				source = -1;
+			for (unsigned int earlier = 0; earlier < s; earlier++)
+			{
+				if (stages[order[earlier]].Name == name)
+					source = (int)earlier;
+			}
+			inputSources[s].push_back(source);
+		}
+	}
+
+	// A full size pixel stage at the end can draw to the back buffer
+	// directly - anything else gets copied there after the last step
+	bool direct = steps > 0 && !stages[order[steps - 1]].Compute && stages[order[steps - 1]].Divisor <= 1;
+
+	requests.clear();
+	outputRequests.assign(steps, -1);
+	for (unsigned int s = 0; s < steps; s++)
+	{
+		if (direct && s == steps - 1)
+			continue;
+
+		const PostProcessStage& stage = stages[order[s]];
+		unsigned int divisor = max(stage.Divisor, 1u);
+		RenderTargetRequest request = {
+			max(width / divisor, 1u),
+			max(height / divisor, 1u),
+			(unsigned int)stage.Format,
+			s,
+			s };
+		outputRequests[s] = (int)requests.size();
+		requests.push_back(request);
+	}
+	for (unsigned int s = 0; s < steps; s++)
+	{
+		for (int source : inputSources[s])
+		{
+			if (source >= 0 && outputRequests[source] >= 0)
+				requests[outputRequests[source]].LastUse = max(requests[outputRequests[source]].LastUse, s);
+		}
+	}
+	if (steps > 0 && !direct)
+		requests[outputRequests[steps - 1]].LastUse = steps;
+
+	pool.Plan(requests);
+
+	// Keep any textures that still match, make the rest
+	std::vector<Target> oldTargets;
+	oldTargets.swap(targets);
+	for (const RenderTargetSlot& slot : pool.GetSlots())
+	{
+		size_t match = oldTargets.size();
+		for (size_t t = 0; t < oldTargets.size(); t++)
+		{
+			const RenderTargetSlot& old = oldTargets[t].Slot;
+			if (old.Width == slot.Width && old.Height == slot.Height && old.Format == slot.Format)
+			{
+				match = t;
+				break;
+			}
+		}
+
+		if (match < oldTargets.size())
+		{
+			targets.push_back(oldTargets[match]);
+			targets.back().Slot = slot;
+			oldTargets.erase(oldTargets.begin() + match);
+		}
+		else
+		{
+			targets.push_back(CreateTarget(slot));
+		}
+	}
+
+	planned = true;
+}
+
+// --------------------------------------------------------
+// A pooled texture, usable by pixel & compute stages alike
+// --------------------------------------------------------
+PostProcessChain::Target PostProcessChain::CreateTarget(const RenderTargetSlot& slot)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = slot.Width;
+	desc.Height = slot.Height;
+	desc.ArraySize = 1;
+	desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	desc.Format = (DXGI_FORMAT)slot.Format;
+	desc.MipLevels = 1;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	device->CreateTexture2D(&desc, 0, texture.GetAddressOf());
+
+	Target target;
+	target.Slot = slot;
+	device->CreateRenderTargetView(texture.Get(), 0, target.RTV.GetAddressOf());
+	device->CreateShaderResourceView(texture.Get(), 0, target.SRV.GetAddressOf());
+	device->CreateUnorderedAccessView(texture.Get(), 0, target.UAV.GetAddressOf());
+	texturesCreated++;
+	return target;
+}
+
+// --------------------------------------------------------
+// What a step of the plan wrote (-1 = the scene itself)
+// --------------------------------------------------------
+PostProcessInput PostProcessChain::GetOutput(int step, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sceneSRV)
+{
+	PostProcessInput input = {};
+	if (step < 0 || outputRequests[step] < 0)
+	{
+		input.SRV = sceneSRV;
+		input.Width = width;
+		input.Height = height;
+		return input;
+	}
+
+	const Target& target = targets[pool.GetAssignments()[outputRequests[step]]];
+	input.SRV = target.SRV;
+	input.Width = target.Slot.Width;
+	input.Height = target.Slot.Height;
+	return input;
+}
+
+void PostProcessChain::Execute(
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sceneSRV,
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> output)
+{
+	PROFILE_FUNCTION();
+
+	// Anything switched on or off since the last plan?
+	bool changed = !planned || plannedEnabled.size() != stages.size();
+	for (size_t i = 0; i < stages.size() && !changed; i++)
+		changed = plannedEnabled[i] != stages[i].Enabled;
+	if (changed)
+		Plan();
+
+	ID3D11ShaderResourceView* nullSRVs[POST_PROCESS_MAX_BINDINGS] = {};
+	ID3D11UnorderedAccessView* nullUAVs[POST_PROCESS_MAX_BINDINGS] = {};
+	passCount = 0;
+	unsigned int steps = (unsigned int)order.size();
+	for (unsigned int s = 0; s < steps; s++)
+	{
+		const PostProcessStage& stage = stages[order[s]];
+
+		PostProcessPass pass;
+		for (int source : inputSources[s])
+			pass.Inputs.push_back(GetOutput(source, sceneSRV));
+
+		if (outputRequests[s] < 0)
+		{
+			pass.OutputRTV = output;
+			pass.Width = width;
+			pass.Height = height;
+		}
+		else
+		{
+			const Target& target = targets[pool.GetAssignments()[outputRequests[s]]];
+			pass.OutputRTV = target.RTV;
+			pass.OutputUAV = target.UAV;
+			pass.Width = target.Slot.Width;
+			pass.Height = target.Slot.Height;
+		}
+
+		if (stage.Compute)
+		{
+			context->OMSetRenderTargets(0, 0, 0);
+			stage.Execute(pass);
+
+			// Unbind, so the output can be read next
+			context->CSSetUnorderedAccessViews(0, POST_PROCESS_MAX_BINDINGS, nullUAVs, 0);
+			context->CSSetShaderResources(0, POST_PROCESS_MAX_BINDINGS, nullSRVs);
+		}
+		else
+		{
+			D3D11_VIEWPORT viewport = {};
+			viewport.Width = (float)pass.Width;
+			viewport.Height = (float)pass.Height;
+			viewport.MaxDepth = 1.0f;
+			context->RSSetViewports(1, &viewport);
+			context->OMSetRenderTargets(1, pass.OutputRTV.GetAddressOf(), 0);
+			fullscreenVS->SetShader();
+			stage.Execute(pass);
+
+			// Unbind, so the inputs can be drawn to next
+			context->PSSetShaderResources(0, POST_PROCESS_MAX_BINDINGS, nullSRVs);
+		}
+		passCount++;
+	}
+
+	// Copy the last output across, unless it's already there
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = (float)width;
+	viewport.Height = (float)height;
+	viewport.MaxDepth = 1.0f;
+	context->RSSetViewports(1, &viewport);
+	context->OMSetRenderTargets(1, output.GetAddressOf(), 0);
+	if (steps == 0 || outputRequests[steps - 1] >= 0)
+	{
+		fullscreenVS->SetShader();
+		copyPS->SetShader();
+		copyPS->SetShaderResourceView("Pixels", GetOutput((int)steps - 1, sceneSRV).SRV);
+		copyPS->CopyAllBufferData();
+		context->Draw(3, 0);
+		context->PSSetShaderResources(0, POST_PROCESS_MAX_BINDINGS, nullSRVs);
+		passCount++;
+	}
+}
+
+const RenderTargetPool& PostProcessChain::GetPool() const
+{
+	return pool;
+}
+
+const std::vector<PostProcessStage>& PostProcessChain::GetStages() const
+{
+	return stages;
+}
+
+unsigned int PostProcessChain::GetPassCount() const
+{
+	return passCount;
+}
+
+unsigned int PostProcessChain::GetTexturesCreated() const
+{
+	return texturesCreated;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SimpleShader.h"
+#include "RenderTargetPool.h"
+
+// --------------------------------------------------------
+// One texture a stage reads
+// --------------------------------------------------------
+struct PostProcessInput
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SRV;
+	unsigned int Width;
+	unsigned int Height;
+};
+
+// --------------------------------------------------------
+// Everything a stage needs when it runs.  Pixel stages find
+// their output already bound (with a matching viewport) and
+// the fullscreen vertex shader set; compute stages write
+// through OutputUAV themselves.
+// --------------------------------------------------------
+struct PostProcessPass
+{
+	std::vector<PostProcessInput> Inputs;
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> OutputRTV;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> OutputUAV;	// Compute stages only
+	unsigned int Width;		// Output size
+	unsigned int Height;
+};
+
+// --------------------------------------------------------
+// One effect (or one pass of an effect) in the chain
+// --------------------------------------------------------
+struct PostProcessStage
+{
+	std::string Name;
+	bool Enabled;
+	bool Compute;						// Writes through a UAV instead of as a render target
+	std::vector<std::string> Inputs;	// "Scene", "Previous" (last enabled stage) or a stage's name
+	unsigned int Divisor;				// Output is the screen size divided by this
+	DXGI_FORMAT Format;
+	std::function<void(const PostProcessPass&)> Execute;
+};
+
+// --------------------------------------------------------
+// Runs the enabled post process stages in the order they
+// were added, from the scene's color to the back buffer.
+//
+// Stage outputs are temporary targets from a pool, planned
+// (see RenderTargetPool) whenever the screen size or the set
+// of enabled stages changes - outputs that are never alive at
+// the same time share one texture, and textures from the last
+// plan are reused when they still match.  The last stage
+// draws straight to the back buffer when it can (full size
+// pixel stage), otherwise its output is copied there.
+// --------------------------------------------------------
+class PostProcessChain
+{
+public:
+	PostProcessChain(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		std::shared_ptr<SimpleVertexShader> fullscreenVS,
+		std::shared_ptr<SimplePixelShader> copyPS);
+	~PostProcessChain();
+
+	void AddStage(const PostProcessStage& stage);
+	void SetEnabled(const std::string& name, bool enabled);
+	void Resize(unsigned int width, unsigned int height);
+
+	// Runs the chain, leaving output bound as the render target
+	void Execute(
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sceneSRV,
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> output);
+
+	const RenderTargetPool& GetPool() const;
+	const std::vector<PostProcessStage>& GetStages() const;
+	unsigned int GetPassCount() const;			// Fullscreen draws & dispatches last Execute()
+	unsigned int GetTexturesCreated() const;	// Ever, across every plan
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	std::shared_ptr<SimpleVertexShader> fullscreenVS;
+	std::shared_ptr<SimplePixelShader> copyPS;
+
+	std::vector<PostProcessStage> stages;
+	unsigned int width;
+	unsigned int height;
+
+	// The current plan: enabled stages, where each one reads
+	// from (-1 = scene), and which request holds its output
+	// (-1 = straight to the back buffer)
+	void Plan();
+	bool planned;
+	std::vector<bool> plannedEnabled;
+	std::vector<unsigned int> order;
+	std::vector<std::vector<int>> inputSources;
+	std::vector<int> outputRequests;
+	std::vector<RenderTargetRequest> requests;
+	RenderTargetPool pool;
+
+	// One texture per pool slot
+	struct Target
+	{
+		RenderTargetSlot Slot;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> RTV;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SRV;
+		Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> UAV;
+	};
+	std::vector<Target> targets;
+	Target CreateTarget(const RenderTargetSlot& slot);
+	PostProcessInput GetOutput(int step, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> sceneSRV);
+
+	unsigned int passCount;
+	unsigned int texturesCreated;
+};
@@ -0,0 +1,463 @@
+#include "Profiler.h"
+#include <Windows.h>
+#include <algorithm>
+#include <fstream>
+#include <climits>
+#include <cstring>
+
+#include "ImGui/imgui.h"
+#include "PathHelpers.h"
+
+// Singleton requirement
+Profiler* Profiler::instance;
+
+// The calling thread's ring buffer (created on first use)
+static thread_local void* threadBuffer = 0;
+
+
+Profiler::Profiler() :
+	frameCount(0),
+	paused(false),
+	displayedStart(0),
+	displayedEnd(0),
+	displayedFrame(0),
+	graphMode(0),
+	zoom(1.0f)
+{
+	memset(frameStarts, 0, sizeof(frameStarts));
+
+	__int64 perfFreq = 0;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFreq);
+	secondsPerTick = 1.0 / (double)perfFreq;
+}
+
+Profiler::~Profiler()
+{
+	// Any thread still recording at this point would be
+	// writing to freed memory, so this should only happen
+	// after all other threads have stopped
+	for (auto t : threads)
+		delete t;
+}
+
+long long Profiler::GetTicks()
+{
+	__int64 now = 0;
+	QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	return now;
+}
+
+// --------------------------------------------------------
+// Gets (or creates and registers) this thread's buffer.
+// Only the very first call on each thread takes the lock.
+// --------------------------------------------------------
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer()
+{
+	if (threadBuffer)
+		return (ThreadBuffer*)threadBuffer;
+
+	ThreadBuffer* buffer = new ThreadBuffer();
+	buffer->Head = 0;
+	buffer->Depth = 0;
+	buffer->ThreadID = (unsigned int)GetCurrentThreadId();
+	buffer->Name = "Thread " + std::to_string(buffer->ThreadID);
+
+	{
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		threads.push_back(buffer);
+	}
+
+	threadBuffer = buffer;
+	return buffer;
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	buffer->Name = name;
+}
+
+void Profiler::BeginScope()
+{
+	GetThreadBuffer()->Depth++;
+}
+
+// --------------------------------------------------------
+// Finishes a marker and writes it to this thread's ring.
+// The event is filled in before the head moves, so readers
+// never see a half-written entry as "new".
+// --------------------------------------------------------
+void Profiler::EndScope(const char* name, long long start)
+{
+	long long end = GetTicks();
+	ThreadBuffer* buffer = GetThreadBuffer();
+	buffer->Depth--;
+
+	if (paused.load(std::memory_order_relaxed))
+		return;
+
+	unsigned long long head = buffer->Head.load(std::memory_order_relaxed);
+	ProfileEvent& e = buffer->Events[head & (ThreadBuffer::Capacity - 1)];
+	e.Name = name;
+	e.Start = start;
+	e.End = end;
+	e.Depth = buffer->Depth;
+	buffer->Head.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::MarkFrame()
+{
+	frameStarts[frameCount % FrameHistory] = GetTicks();
+	frameCount++;
+}
+
+// --------------------------------------------------------
+// Copies out every marker overlapping [start, end) from
+// every thread's ring buffer
+// --------------------------------------------------------
+void Profiler::Capture(long long start, long long end, std::vector<ThreadCapture>& captures)
+{
+	captures.clear();
+
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for (auto t : threads)
+	{
+		ThreadCapture capture;
+		capture.Name = t->Name;
+		capture.ThreadID = t->ThreadID;
+
+		unsigned long long head = t->Head.load(std::memory_order_acquire);
+		unsigned long long first = head > ThreadBuffer::Capacity ? head - ThreadBuffer::Capacity : 0;
+		std::vector<ProfileEvent> copy;
+		copy.reserve((size_t)(head - first));
+		for (unsigned long long i = first; i < head; i++)
+			copy.push_back(t->Events[i & (ThreadBuffer::Capacity - 1)]);
+
+		// Like a seqlock: read the head again once the copy is done
+		// (the fence keeps the copy from moving past that read).
+		// The owner may have lapped us meanwhile, and may be part
+		// way through writing event newHead, whose slot held event
+		// newHead - Capacity - so anything before newHead + 1 -
+		// Capacity can't be trusted.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		unsigned long long newHead = t->Head.load(std::memory_order_relaxed);
+		size_t skip = 0;
+		if (newHead + 1 > first + ThreadBuffer::Capacity)
+			skip = (size_t)min(newHead + 1 - ThreadBuffer::Capacity - first, (unsigned long long)copy.size());
+
+		for (size_t i = skip; i < copy.size(); i++)
+		{
+			if (copy[i].End > start && copy[i].Start < end)
+				capture.Events.push_back(copy[i]);
+		}
+
+		// Parents finish after their children, so sort back into start order
+		std::sort(capture.Events.begin(), capture.Events.end(),
+			[](const ProfileEvent& a, const ProfileEvent& b) {
+				return a.Start != b.Start ? a.Start < b.Start : a.Depth < b.Depth; });
+
+		if (!capture.Events.empty())
+			captures.push_back(capture);
+	}
+}
+
+// --------------------------------------------------------
+// Sums up each marker name over the last full frame.  The
+// current frame is still being recorded, so it's skipped.
+// --------------------------------------------------------
+void Profiler::GetLastFrameSections(std::vector<ProfileSection>& sections)
+{
+	sections.clear();
+	if (frameCount < 2)
+		return;
+
+	long long start = frameStarts[(frameCount - 2) % FrameHistory];
+	long long end = frameStarts[(frameCount - 1) % FrameHistory];
+	std::vector<ThreadCapture> captures;
+	Capture(start, end, captures);
+
+	for (auto& c : captures)
+	{
+		for (auto& e : c.Events)
+		{
+			double ms = (min(e.End, end) - max(e.Start, start)) * secondsPerTick * 1000.0;
+
+			size_t i = 0;
+			while (i < sections.size() && strcmp(sections[i].Name, e.Name) != 0)
+				i++;
+			if (i == sections.size())
+				sections.push_back({ e.Name, 0.0, 0 });
+
+			sections[i].Milliseconds += ms;
+			sections[i].Calls++;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Writes the Chrome trace-event format: one complete ("X")
+// event per marker, plus thread names and frame markers
+// --------------------------------------------------------
+bool Profiler::ExportChromeTrace(const std::wstring& path)
+{
+	std::vector<ThreadCapture> captures;
+	Capture(LLONG_MIN, LLONG_MAX, captures);
+
+	std::ofstream file(path);
+	if (!file.is_open())
+		return false;
+
+	// Times are in microseconds from the earliest marker
+	long long origin = LLONG_MAX;
+	for (auto& c : captures)
+		for (auto& e : c.Events)
+			origin = min(origin, e.Start);
+	double toMicroseconds = secondsPerTick * 1000000.0;
+
+	auto writeString = [&file](const char* str)
+	{
+		file << '"';
+		for (const char* c = str; *c; c++)
+		{
+			if (*c == '"' || *c == '\\') file << '\\';
+			file << *c;
+		}
+		file << '"';
+	};
+
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+	for (auto& c : captures)
+	{
+		if (!first) file << ",\n";
+		first = false;
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << c.ThreadID << ",\"args\":{\"name\":";
+		writeString(c.Name.c_str());
+		file << "}}";
+
+		for (auto& e : c.Events)
+		{
+			file << ",\n{\"name\":";
+			writeString(e.Name);
+			file << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << c.ThreadID
+				<< ",\"ts\":" << (e.Start - origin) * toMicroseconds
+				<< ",\"dur\":" << (e.End - e.Start) * toMicroseconds << "}";
+		}
+	}
+
+	// Frame boundaries we still know about
+	unsigned long long frames = min(frameCount, (unsigned long long)FrameHistory);
+	for (unsigned long long i = frameCount - frames; i < frameCount; i++)
+	{
+		long long start = frameStarts[i % FrameHistory];
+		if (start < origin) continue;
+		file << ",\n{\"name\":\"Frame " << i << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":"
+			<< (start - origin) * toMicroseconds << "}";
+	}
+
+	file << "\n]}\n";
+	return true;
+}
+
+// --------------------------------------------------------
+// Stable color per marker name
+// --------------------------------------------------------
+static ImU32 ColorFromName(const char* name)
+{
+	unsigned int hash = 2166136261u;
+	for (const char* c = name; *c; c++)
+	{
+		hash ^= (unsigned char)*c;
+		hash *= 16777619u;
+	}
+
+	ImVec4 color;
+	ImGui::ColorConvertHSVtoRGB((hash % 360) / 360.0f, 0.5f, 0.8f, color.x, color.y, color.z);
+	color.w = 1.0f;
+	return ImGui::GetColorU32(color);
+}
+
+// --------------------------------------------------------
+// Draws one labeled, hoverable bar
+// --------------------------------------------------------
+static void DrawBar(ImDrawList* drawList, ImVec2 topLeft, ImVec2 bottomRight, const char* name, double ms)
+{
+	drawList->AddRectFilled(topLeft, bottomRight, ColorFromName(name));
+	drawList->AddRect(topLeft, bottomRight, IM_COL32(0, 0, 0, 128));
+
+	// Label if there's room
+	ImVec2 textSize = ImGui::CalcTextSize(name);
+	if (bottomRight.x - topLeft.x > textSize.x + 4)
+	{
+		drawList->PushClipRect(topLeft, bottomRight, true);
+		drawList->AddText(ImVec2(topLeft.x + 2, topLeft.y + 1), IM_COL32(0, 0, 0, 255), name);
+		drawList->PopClipRect();
+	}
+
+	if (ImGui::IsMouseHoveringRect(topLeft, bottomRight))
+		ImGui::SetTooltip("%s\n%.3f ms", name, ms);
+}
+
+// --------------------------------------------------------
+// Timeline - every marker of the displayed frame at its
+// actual time, one lane per thread
+// --------------------------------------------------------
+void Profiler::DrawTimeline()
+{
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	float width = ImGui::GetContentRegionAvail().x * zoom;
+	float rowHeight = ImGui::GetTextLineHeight() + 2;
+	double ticksToPixels = width / (double)max(displayedEnd - displayedStart, 1LL);
+
+	for (auto& c : displayed)
+	{
+		ImGui::Text("%s", c.Name.c_str());
+
+		unsigned int maxDepth = 0;
+		for (auto& e : c.Events)
+			maxDepth = max(maxDepth, e.Depth);
+
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		for (auto& e : c.Events)
+		{
+			float x0 = origin.x + (float)((max(e.Start, displayedStart) - displayedStart) * ticksToPixels);
+			float x1 = origin.x + (float)((min(e.End, displayedEnd) - displayedStart) * ticksToPixels);
+			if (x1 - x0 < 1.0f) x1 = x0 + 1.0f;
+
+			float y = origin.y + e.Depth * rowHeight;
+			DrawBar(drawList, ImVec2(x0, y), ImVec2(x1, y + rowHeight - 1), e.Name, (e.End - e.Start) * secondsPerTick * 1000.0);
+		}
+
+		ImGui::Dummy(ImVec2(width, (maxDepth + 1) * rowHeight));
+	}
+}
+
+// --------------------------------------------------------
+// Flame graph - markers merged by call path (same name
+// under the same parent), so repeated scopes add up.
+// Widths are the share of the displayed frame.
+// --------------------------------------------------------
+void Profiler::DrawFlameGraph()
+{
+	struct Node
+	{
+		const char* Name;
+		long long Ticks;
+		std::vector<int> Children;
+	};
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	float width = ImGui::GetContentRegionAvail().x * zoom;
+	float rowHeight = ImGui::GetTextLineHeight() + 2;
+	double frameTicks = (double)max(displayedEnd - displayedStart, 1LL);
+
+	for (auto& c : displayed)
+	{
+		// Build the merged call tree for this thread
+		std::vector<Node> nodes;
+		nodes.push_back({ c.Name.c_str(), displayedEnd - displayedStart, {} });
+		std::vector<int> stack;
+		for (auto& e : c.Events)
+		{
+			while (stack.size() > e.Depth)
+				stack.pop_back();
+			int parent = stack.empty() ? 0 : stack.back();
+
+			int node = -1;
+			for (int child : nodes[parent].Children)
+				if (strcmp(nodes[child].Name, e.Name) == 0)
+					node = child;
+
+			if (node < 0)
+			{
+				node = (int)nodes.size();
+				nodes.push_back({ e.Name, 0, {} });
+				nodes[parent].Children.push_back(node);
+			}
+
+			nodes[node].Ticks += min(e.End, displayedEnd) - max(e.Start, displayedStart);
+			stack.push_back(node);
+		}
+
+		// Lay it out top down, children packed left to right
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		int maxDepth = 0;
+		struct Pending { int Node; int Depth; float X; };
+		std::vector<Pending> pending;
+		pending.push_back({ 0, 0, origin.x });
+		while (!pending.empty())
+		{
+			Pending p = pending.back();
+			pending.pop_back();
+			maxDepth = max(maxDepth, p.Depth);
+
+			const Node& n = nodes[p.Node];
+			float w = (float)(n.Ticks / frameTicks * width);
+			float y = origin.y + p.Depth * rowHeight;
+			DrawBar(drawList, ImVec2(p.X, y), ImVec2(p.X + max(w, 1.0f), y + rowHeight - 1), n.Name, n.Ticks * secondsPerTick * 1000.0);
+
+			float x = p.X;
+			for (int child : n.Children)
+			{
+				pending.push_back({ child, p.Depth + 1, x });
+				x += (float)(nodes[child].Ticks / frameTicks * width);
+			}
+		}
+
+		ImGui::Dummy(ImVec2(width, (maxDepth + 1) * rowHeight));
+		ImGui::Spacing();
+	}
+}
+
+// --------------------------------------------------------
+// Profiler window - shows the most recently completed frame
+// (or the frame that was showing when paused)
+// --------------------------------------------------------
+void Profiler::BuildUI()
+{
+	ImGui::Begin("Profiler");
+
+#ifdef ENABLE_PROFILER
+	// Grab the last full frame (the current one is still in progress)
+	if (!paused && frameCount >= 2)
+	{
+		displayedStart = frameStarts[(frameCount - 2) % FrameHistory];
+		displayedEnd = frameStarts[(frameCount - 1) % FrameHistory];
+		displayedFrame = frameCount - 2;
+		Capture(displayedStart, displayedEnd, displayed);
+	}
+
+	bool pause = paused;
+	if (ImGui::Checkbox("Pause", &pause))
+		SetPaused(pause);
+
+	ImGui::SameLine();
+	if (ImGui::Button("Export Chrome Trace"))
+	{
+		ExportChromeTrace(FixPath(L"profile_trace.json"));
+	}
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Saves profile_trace.json next to the executable");
+
+	ImGui::SameLine();
+	ImGui::RadioButton("Timeline", &graphMode, 0);
+	ImGui::SameLine();
+	ImGui::RadioButton("Flame Graph", &graphMode, 1);
+
+	ImGui::SliderFloat("Zoom", &zoom, 1.0f, 20.0f, "%.1fx", ImGuiSliderFlags_Logarithmic);
+	ImGui::Text("Frame %llu: %.3f ms", displayedFrame, (displayedEnd - displayedStart) * secondsPerTick * 1000.0);
+
+	ImGui::BeginChild("ProfilerGraph", ImVec2(0, 0), true, ImGuiWindowFlags_HorizontalScrollbar);
+	if (graphMode == 1)
+		DrawFlameGraph();
+	else
+		DrawTimeline();
+	ImGui::EndChild();
+#else
+	ImGui::Text("Profiling markers are compiled out.");
+	ImGui::Text("Define ENABLE_PROFILER to turn them on.");
+#endif
+
+	ImGui::End();
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Scoped CPU profiling markers.
+//
+// Markers only exist when ENABLE_PROFILER is defined (every
+// configuration does, so Release benchmarks get sections) -
+// otherwise every macro below expands to nothing and costs
+// nothing.
+//
+//   void Game::Update(...)
+//   {
+//       PROFILE_FUNCTION();
+//       { PROFILE_SCOPE("Animate"); ... }
+//   }
+// --------------------------------------------------------
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ENABLE_PROFILER
+	#define PROFILE_SCOPE(name)		ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+	#define PROFILE_FUNCTION()		PROFILE_SCOPE(__FUNCTION__)
+	#define PROFILE_THREAD(name)	Profiler::GetInstance().SetThreadName(name)
+	#define PROFILE_FRAME()			Profiler::GetInstance().MarkFrame()
+#else
+	#define PROFILE_SCOPE(name)
+	#define PROFILE_FUNCTION()
+	#define PROFILE_THREAD(name)
+	#define PROFILE_FRAME()
+#endif
+
+// --------------------------------------------------------
+// A single completed marker
+// --------------------------------------------------------
+struct ProfileEvent
+{
+	const char* Name;		// Must be a string literal (or otherwise outlive the profiler)
+	long long Start;		// Performance counter ticks
+	long long End;
+	unsigned int Depth;		// Nesting level on its thread
+};
+
+// --------------------------------------------------------
+// Total time spent in one marker name over a frame
+// --------------------------------------------------------
+struct ProfileSection
+{
+	const char* Name;
+	double Milliseconds;	// Summed across every call on every thread
+	unsigned int Calls;
+};
+
+// --------------------------------------------------------
+// Collects markers from every thread and shows them.
+//
+// Each thread writes to its own ring buffer, with no locks:
+// the owning thread is the only writer, and readers (the UI
+// and trace export) just copy out whatever hasn't been
+// overwritten yet.
+// --------------------------------------------------------
+class Profiler
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static Profiler& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new Profiler();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	Profiler(Profiler const&) = delete;
+	void operator=(Profiler const&) = delete;
+
+private:
+	static Profiler* instance;
+	Profiler();
+#pragma endregion
+
+public:
+	~Profiler();
+
+	// Marker recording (see ProfileScope)
+	void BeginScope();
+	void EndScope(const char* name, long long start);
+	static long long GetTicks();
+
+	// Names the calling thread in the UI and trace
+	void SetThreadName(const char* name);
+
+	// Called once per frame by the main thread, so the
+	// UI knows where frames begin and end
+	void MarkFrame();
+
+	// Stops recording (the UI keeps showing the last frame)
+	void SetPaused(bool paused) { this->paused = paused; }
+	bool IsPaused() { return paused; }
+
+	// Per-marker totals for the most recently completed frame
+	void GetLastFrameSections(std::vector<ProfileSection>& sections);
+
+	// ImGui window with the timeline and flame graph
+	void BuildUI();
+
+	// Writes every marker still in the ring buffers to a
+	// Chrome trace-event JSON file (chrome://tracing, Perfetto)
+	bool ExportChromeTrace(const std::wstring& path);
+
+private:
+
+	// Per-thread ring buffer of finished markers
+	struct ThreadBuffer
+	{
+		static const unsigned int Capacity = 16384; // Must be a power of 2
+
+		ProfileEvent Events[Capacity];
+		std::atomic<unsigned long long> Head;	// Total events ever written
+		unsigned int Depth;						// Only touched by the owning thread
+		unsigned int ThreadID;
+		std::string Name;
+	};
+
+	// A copy of one thread's markers, for display or export
+	struct ThreadCapture
+	{
+		std::string Name;
+		unsigned int ThreadID;
+		std::vector<ProfileEvent> Events;
+	};
+
+	std::mutex threadsMutex;
+	std::vector<ThreadBuffer*> threads;
+	ThreadBuffer* GetThreadBuffer();
+
+	// Frame boundaries (performance counter ticks)
+	static const unsigned int FrameHistory = 64;
+	long long frameStarts[FrameHistory];
+	unsigned long long frameCount;
+	double secondsPerTick;
+
+	std::atomic<bool> paused;
+
+	// The frame currently shown in the UI
+	std::vector<ThreadCapture> displayed;
+	long long displayedStart;
+	long long displayedEnd;
+	unsigned long long displayedFrame;
+	int graphMode;	// 0 = timeline, 1 = flame graph
+	float zoom;
+
+	void Capture(long long start, long long end, std::vector<ThreadCapture>& captures);
+	void DrawTimeline();
+	void DrawFlameGraph();
+};
+
+// --------------------------------------------------------
+// Records one marker from construction to destruction
+// --------------------------------------------------------
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name) :
+		name(name)
+	{
+		Profiler::GetInstance().BeginScope();
+		start = Profiler::GetTicks();
+	}
+
+	~ProfileScope()
+	{
+		Profiler::GetInstance().EndScope(name, start);
+	}
+
+private:
+	const char* name;
+	long long start;
+};
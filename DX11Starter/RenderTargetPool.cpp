@@ -0,0 +1,96 @@
+#include "RenderTargetPool.h"
+#include <algorithm>
+
+// The DXGI_FORMAT values GetBytesPerPixel() knows about (kept as
+// numbers so this file doesn't need the graphics headers)
+#define FORMAT_R16G16B16A16_FLOAT	10
+#define FORMAT_R11G11B10_FLOAT		26
+#define FORMAT_R8G8B8A8_UNORM		28
+
+RenderTargetPool::RenderTargetPool() :
+	unpooledBytes(0)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+}
+
+void RenderTargetPool::Plan(const std::vector<RenderTargetRequest>& requests)
+{
+	slots.clear();
+	assignments.assign(requests.size(), 0);
+	unpooledBytes = 0;
+
+	// First use order, ties in request order so plans are repeatable
+	std::vector<unsigned int> order(requests.size());
+	for (unsigned int i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&requests](unsigned int a, unsigned int b)
+	{
+		return requests[a].FirstUse < requests[b].FirstUse;
+	});
+
+	for (unsigned int i : order)
+	{
+		const RenderTargetRequest& request = requests[i];
+		unpooledBytes += (unsigned long long)request.Width * request.Height * GetBytesPerPixel(request.Format);
+
+		// A matching slot that's free by now?
+		size_t chosen = slots.size();
+		for (size_t s = 0; s < slots.size(); s++)
+		{
+			const RenderTargetSlot& slot = slots[s];
+			if (slot.Width == request.Width &&
+				slot.Height == request.Height &&
+				slot.Format == request.Format &&
+				slot.LastUse < request.FirstUse)
+			{
+				chosen = s;
+				break;
+			}
+		}
+
+		if (chosen == slots.size())
+		{
+			RenderTargetSlot slot = { request.Width, request.Height, request.Format, request.LastUse };
+			slots.push_back(slot);
+		}
+		slots[chosen].LastUse = std::max(slots[chosen].LastUse, request.LastUse);
+		assignments[i] = (unsigned int)chosen;
+	}
+}
+
+const std::vector<RenderTargetSlot>& RenderTargetPool::GetSlots() const
+{
+	return slots;
+}
+
+const std::vector<unsigned int>& RenderTargetPool::GetAssignments() const
+{
+	return assignments;
+}
+
+unsigned long long RenderTargetPool::GetPooledBytes() const
+{
+	unsigned long long bytes = 0;
+	for (const RenderTargetSlot& slot : slots)
+		bytes += (unsigned long long)slot.Width * slot.Height * GetBytesPerPixel(slot.Format);
+	return bytes;
+}
+
+unsigned long long RenderTargetPool::GetUnpooledBytes() const
+{
+	return unpooledBytes;
+}
+
+unsigned int RenderTargetPool::GetBytesPerPixel(unsigned int format)
+{
+	switch (format)
+	{
+	case FORMAT_R16G16B16A16_FLOAT: return 8;
+	case FORMAT_R11G11B10_FLOAT: return 4;
+	case FORMAT_R8G8B8A8_UNORM: return 4;
+	default: return 0;
+	}
+}
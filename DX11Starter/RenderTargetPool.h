@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// One temporary render target someone wants, and the steps
+// it's alive for (written in FirstUse, last read in LastUse)
+// --------------------------------------------------------
+struct RenderTargetRequest
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int Format;		// DXGI_FORMAT, as a plain number
+	unsigned int FirstUse;
+	unsigned int LastUse;
+};
+
+// --------------------------------------------------------
+// A real texture the requests are packed into
+// --------------------------------------------------------
+struct RenderTargetSlot
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int Format;
+	unsigned int LastUse;		// Last step anything assigned to it is alive
+};
+
+// --------------------------------------------------------
+// Decides which temporary targets can share a texture.
+//
+// Plan() hands requests out in order of first use, each to
+// the first slot of the same size & format that's free by
+// then (nothing assigned to it is still alive), and only
+// makes a new slot when none is.  For intervals that's as
+// few slots as possible: a chain of effects ping-pongs
+// between two textures no matter how many stages it has.
+//
+// No graphics API involved, so all of this can be checked
+// on the CPU alone - PostProcessChain owns the textures.
+// --------------------------------------------------------
+class RenderTargetPool
+{
+public:
+	RenderTargetPool();
+	~RenderTargetPool();
+
+	// Picks a slot for each request (see GetAssignments())
+	void Plan(const std::vector<RenderTargetRequest>& requests);
+
+	const std::vector<RenderTargetSlot>& GetSlots() const;
+	const std::vector<unsigned int>& GetAssignments() const;	// Slot per request, in request order
+
+	// Bytes the slots take vs. one texture per request
+	unsigned long long GetPooledBytes() const;
+	unsigned long long GetUnpooledBytes() const;
+
+	// Bytes per pixel of the formats the post chain uses (0 for others)
+	static unsigned int GetBytesPerPixel(unsigned int format);
+
+private:
+	std::vector<RenderTargetSlot> slots;
+	std::vector<unsigned int> assignments;
+	unsigned long long unpooledBytes;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "Lights.h"
+#include "LightClusters.h"
+#include "LightGrid.h"
+#include "ShadowAtlas.h"
+#include "SnapshotChecksum.h"
+
+// --------------------------------------------------------
+// Everything the renderer needs from one simulation step.
+//
+// The simulation fills one of these at the end of Update()
+// and publishes it, and Draw() only ever reads from the
+// published copy, so the two can safely run on different
+// threads at the same time.
+// --------------------------------------------------------
+struct SceneSnapshot
+{
+	unsigned long long FrameIndex = 0;
+	float DeltaTime = 0.0f;
+	float TotalTime = 0.0f;
+
+	// Per-entity data, indexed the same as Game::entities
+	std::vector<DirectX::XMFLOAT4X4> WorldMatrices;
+	std::vector<DirectX::XMFLOAT4X4> WorldInvTransposeMatrices;
+	std::vector<unsigned char> Visible;	// Inside the camera frustum?
+	std::vector<DirectX::BoundingSphere> EntityBounds;	// World space, for texture streaming
+
+	// Active camera
+	DirectX::XMFLOAT4X4 CameraView = {};
+	DirectX::XMFLOAT4X4 CameraProjection = {};
+	DirectX::XMFLOAT3 CameraPosition = {};
+
+	// Lighting
+	std::vector<Light> Lights;
+
+	// Changes whenever any cached static shadows could (static
+	// caster moved, entities changed) - each tile's own key
+	// adds its light's matrices & place in the atlas
+	unsigned long long StaticShadowKey = 0;
+
+	// Shadow atlas tiles to draw, and what the shaders see
+	// of them (indexed by each light's ShadowIndex)
+	std::vector<ShadowView> ShadowViews;
+	std::vector<ShadowInfo> ShadowInfos;
+
+	// Clustered point & spot lights (indices into Lights)
+	std::vector<ClusterRange> ClusterRanges;
+	std::vector<unsigned int> ClusterLightIndices;
+
+	// Or each entity's own strongest lights (also into Lights)
+	bool PerObjectLights = false;
+	std::vector<ObjectLightList> ObjectLights;
+
+	// Hash of the simulated state (see SnapshotChecksum.h)
+	unsigned int Checksum() const
+	{
+		return ChecksumSimulatedState(WorldMatrices, Lights, CameraView);
+	}
+};
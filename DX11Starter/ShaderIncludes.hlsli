@@ -16,7 +16,6 @@ struct VertexToPixel
     float2 uv : TEXCOORD;
     float3 normal : NORMAL;
     float3 worldPosition : POSITION;
-    float4 shadowMapPos : SHADOW_POSITION;
 };
 
 struct VertexToPixel_NormalMap
@@ -26,7 +25,6 @@ struct VertexToPixel_NormalMap
     float3 normal : NORMAL;
     float3 worldPosition : POSITION;
     float3 tangent : TANGENT;
-    float4 shadowMapPos : SHADOW_POSITION;
 };
 
 struct VertexToPixel_Sky
@@ -58,11 +56,13 @@ struct Light
     float Intensity;
     float3 Color;
     float SpotFalloff;  
-    float3 Padding;
+    int ShadowIndex;    // Into ShadowInfos, or -1 if it casts no shadows
+    float2 Padding;
 };
 
 
 // PBR FUNCTIONS ================
+// (copied on the CPU in ShadingReference.cpp - keep the two in sync)
 
 // Calculates diffuse amount based on energy conservation
 //
@@ -220,4 +220,30 @@ float3 PointLight(float3 normal, Light light, float3 viewVector, float roughness
     return total * Attenuate(light, worldPos);
 }
 
+// Complete lighting equation for spot lights (a point light narrowed to a cone)
+float3 SpotLight(float3 normal, Light light, float3 viewVector, float roughness, float3 surfaceColor, float3 specularColor, float3 worldPos, float metalness)
+{
+    float3 lightToPixel = normalize(worldPos - light.Position);
+    float penumbra = pow(saturate(dot(lightToPixel, normalize(light.Direction))), light.SpotFalloff);
+    
+    return PointLight(normal, light, viewVector, roughness, surfaceColor, specularColor, worldPos, metalness) * penumbra;
+}
+
+// Average light around a normal from L2 spherical harmonics, with
+// the cosine lobe already folded into the coefficients (see
+// SphericalHarmonics.h - EvaluateSH() there is the CPU copy)
+float3 EvaluateSH(float4 sh[9], float3 n)
+{
+    float3 result = sh[0].rgb * 0.282095f;
+    result += sh[1].rgb * 0.488603f * n.y;
+    result += sh[2].rgb * 0.488603f * n.z;
+    result += sh[3].rgb * 0.488603f * n.x;
+    result += sh[4].rgb * 1.092548f * n.x * n.y;
+    result += sh[5].rgb * 1.092548f * n.y * n.z;
+    result += sh[6].rgb * 0.315392f * (3.0f * n.z * n.z - 1.0f);
+    result += sh[7].rgb * 1.092548f * n.x * n.z;
+    result += sh[8].rgb * 0.546274f * (n.x * n.x - n.y * n.y);
+    return result;
+}
+
 #endif
\ No newline at end of file
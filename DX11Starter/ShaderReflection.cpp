@@ -0,0 +1,250 @@
+#include "ShaderReflection.h"
+#include <cstring>
+
+// "SRFL"
+static const unsigned int SidecarMagic = 0x4C465253;
+
+// --------------------------------------------------------
+// Fills in every table at once, sized up front so they
+// don't grow (and rehash) along the way
+// --------------------------------------------------------
+void BuildShaderReflectionTables(const ShaderReflectionData& data, ShaderReflectionTables& tables)
+{
+	size_t variableCount = 0;
+	for (const ShaderReflectionBuffer& buffer : data.Buffers)
+		variableCount += buffer.Variables.size();
+
+	tables.BufferVariables.resize(data.Buffers.size());
+	tables.BufferSizes.resize(data.Buffers.size());
+	tables.BufferTable.reserve(data.Buffers.size());
+	tables.VarTable.reserve(variableCount);
+	for (unsigned int b = 0; b < data.Buffers.size(); b++)
+	{
+		const ShaderReflectionBuffer& buffer = data.Buffers[b];
+		tables.BufferTable.insert(std::make_pair(buffer.Name, b));
+		tables.BufferSizes[b] = buffer.Size;
+
+		tables.BufferVariables[b].reserve(buffer.Variables.size());
+		for (const ShaderReflectionVariable& variable : buffer.Variables)
+		{
+			SimpleShaderVariable info = {};
+			info.ByteOffset = variable.ByteOffset;
+			info.Size = variable.Size;
+			info.ConstantBufferIndex = b;
+			tables.VarTable.insert(std::make_pair(variable.Name, info));
+			tables.BufferVariables[b].push_back(info);
+		}
+	}
+
+	tables.ShaderResourceViews.resize(data.Textures.size());
+	tables.TextureTable.reserve(data.Textures.size());
+	for (unsigned int t = 0; t < data.Textures.size(); t++)
+	{
+		tables.ShaderResourceViews[t].Index = t;
+		tables.ShaderResourceViews[t].BindIndex = data.Textures[t].BindIndex;
+		tables.TextureTable.insert(std::make_pair(data.Textures[t].Name, t));
+	}
+
+	tables.SamplerStates.resize(data.Samplers.size());
+	tables.SamplerTable.reserve(data.Samplers.size());
+	for (unsigned int s = 0; s < data.Samplers.size(); s++)
+	{
+		tables.SamplerStates[s].Index = s;
+		tables.SamplerStates[s].BindIndex = data.Samplers[s].BindIndex;
+		tables.SamplerTable.insert(std::make_pair(data.Samplers[s].Name, s));
+	}
+}
+
+std::string CheckShaderBufferLayout(const ShaderReflectionTables& tables, const std::string& bufferName, unsigned int structSize, const ShaderBufferField* fields, size_t fieldCount)
+{
+	auto buffer = tables.BufferTable.find(bufferName);
+	if (buffer == tables.BufferTable.end())
+		return "Constant buffer '" + bufferName + "' isn't in the shader";
+
+	unsigned int index = buffer->second;
+	for (size_t f = 0; f < fieldCount; f++)
+	{
+		const ShaderBufferField& field = fields[f];
+		std::string name = std::string(field.Field) + " ('" + field.Variable + "')";
+
+		auto variable = tables.VarTable.find(field.Variable);
+		if (variable == tables.VarTable.end() || variable->second.ConstantBufferIndex != index)
+			return name + " isn't in constant buffer '" + bufferName + "'";
+		if (variable->second.ByteOffset != field.ByteOffset)
+			return name + " is at byte " + std::to_string(field.ByteOffset) +
+				", but the shader has it at byte " + std::to_string(variable->second.ByteOffset);
+		if (variable->second.Size != field.Size)
+			return name + " is " + std::to_string(field.Size) +
+				" bytes, but the shader's is " + std::to_string(variable->second.Size);
+	}
+
+	if (tables.BufferSizes[index] != structSize)
+		return "The mirror of constant buffer '" + bufferName + "' is " + std::to_string(structSize) +
+			" bytes, but the shader's is " + std::to_string(tables.BufferSizes[index]);
+	return std::string();
+}
+
+unsigned long long HashShaderBytecode(const void* bytecode, size_t size)
+{
+	unsigned long long hash = 14695981039346656037ull;
+	const unsigned char* bytes = (const unsigned char*)bytecode;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------
+// Writing & reading the sidecar's fields
+// --------------------------------------------------------
+static void Write(std::vector<unsigned char>& bytes, const void* data, size_t size)
+{
+	const unsigned char* start = (const unsigned char*)data;
+	bytes.insert(bytes.end(), start, start + size);
+}
+
+static void WriteUInt(std::vector<unsigned char>& bytes, unsigned int value)
+{
+	Write(bytes, &value, sizeof(value));
+}
+
+static void WriteString(std::vector<unsigned char>& bytes, const std::string& value)
+{
+	WriteUInt(bytes, (unsigned int)value.size());
+	Write(bytes, value.data(), value.size());
+}
+
+// Reads in order from a block of memory, failing (for good)
+// as soon as anything would run off the end
+struct SidecarReader
+{
+	const unsigned char* Position;
+	const unsigned char* End;
+	bool Failed;
+
+	bool Read(void* data, size_t size)
+	{
+		if (Failed || (size_t)(End - Position) < size)
+		{
+			Failed = true;
+			return false;
+		}
+		memcpy(data, Position, size);
+		Position += size;
+		return true;
+	}
+
+	unsigned int ReadUInt()
+	{
+		unsigned int value = 0;
+		Read(&value, sizeof(value));
+		return value;
+	}
+
+	// Counts are checked against what's left, so a corrupt
+	// one can't make us allocate the world
+	unsigned int ReadCount(size_t minimumSize)
+	{
+		unsigned int count = ReadUInt();
+		if ((size_t)(End - Position) < count * minimumSize)
+			Failed = true;
+		return Failed ? 0 : count;
+	}
+
+	std::string ReadString()
+	{
+		unsigned int length = ReadCount(1);
+		std::string value((const char*)Position, length);
+		Position += length;
+		return value;
+	}
+};
+
+std::vector<unsigned char> SerializeShaderReflection(unsigned long long hash, const ShaderReflectionData& data)
+{
+	std::vector<unsigned char> bytes;
+	WriteUInt(bytes, SidecarMagic);
+	WriteUInt(bytes, SHADER_REFLECTION_VERSION);
+	Write(bytes, &hash, sizeof(hash));
+
+	WriteUInt(bytes, (unsigned int)data.Buffers.size());
+	for (const ShaderReflectionBuffer& buffer : data.Buffers)
+	{
+		WriteString(bytes, buffer.Name);
+		WriteUInt(bytes, buffer.Type);
+		WriteUInt(bytes, buffer.Size);
+		WriteUInt(bytes, buffer.BindIndex);
+		WriteUInt(bytes, (unsigned int)buffer.Variables.size());
+		for (const ShaderReflectionVariable& variable : buffer.Variables)
+		{
+			WriteString(bytes, variable.Name);
+			WriteUInt(bytes, variable.ByteOffset);
+			WriteUInt(bytes, variable.Size);
+		}
+	}
+
+	const std::vector<ShaderReflectionResource>* resourceLists[2] = { &data.Textures, &data.Samplers };
+	for (const std::vector<ShaderReflectionResource>* resources : resourceLists)
+	{
+		WriteUInt(bytes, (unsigned int)resources->size());
+		for (const ShaderReflectionResource& resource : *resources)
+		{
+			WriteString(bytes, resource.Name);
+			WriteUInt(bytes, resource.BindIndex);
+		}
+	}
+
+	return bytes;
+}
+
+bool DeserializeShaderReflection(const unsigned char* bytes, size_t size, unsigned long long hash, ShaderReflectionData& data)
+{
+	SidecarReader reader = { bytes, bytes + size, false };
+	unsigned long long fileHash = 0;
+	if (reader.ReadUInt() != SidecarMagic ||
+		reader.ReadUInt() != SHADER_REFLECTION_VERSION ||
+		!reader.Read(&fileHash, sizeof(fileHash)) ||
+		fileHash != hash)
+		return false;
+
+	// Smallest possible buffer, variable & resource, for the count checks
+	const size_t bufferSize = sizeof(unsigned int) * 5;
+	const size_t variableSize = sizeof(unsigned int) * 3;
+	const size_t resourceSize = sizeof(unsigned int) * 2;
+
+	ShaderReflectionData result;
+	result.Buffers.resize(reader.ReadCount(bufferSize));
+	for (ShaderReflectionBuffer& buffer : result.Buffers)
+	{
+		buffer.Name = reader.ReadString();
+		buffer.Type = reader.ReadUInt();
+		buffer.Size = reader.ReadUInt();
+		buffer.BindIndex = reader.ReadUInt();
+		buffer.Variables.resize(reader.ReadCount(variableSize));
+		for (ShaderReflectionVariable& variable : buffer.Variables)
+		{
+			variable.Name = reader.ReadString();
+			variable.ByteOffset = reader.ReadUInt();
+			variable.Size = reader.ReadUInt();
+		}
+	}
+
+	std::vector<ShaderReflectionResource>* resourceLists[2] = { &result.Textures, &result.Samplers };
+	for (std::vector<ShaderReflectionResource>* resources : resourceLists)
+	{
+		resources->resize(reader.ReadCount(resourceSize));
+		for (ShaderReflectionResource& resource : *resources)
+		{
+			resource.Name = reader.ReadString();
+			resource.BindIndex = reader.ReadUInt();
+		}
+	}
+
+	if (reader.Failed || reader.Position != reader.End)
+		return false;
+
+	data = std::move(result);
+	return true;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Bump whenever the sidecar layout changes, so old files are ignored
+#define SHADER_REFLECTION_VERSION	1
+
+// --------------------------------------------------------
+// Used by simple shaders to store information about
+// specific variables in constant buffers
+// --------------------------------------------------------
+struct SimpleShaderVariable
+{
+	unsigned int ByteOffset;
+	unsigned int Size;
+	unsigned int ConstantBufferIndex;
+};
+
+// --------------------------------------------------------
+// Contains info about a single SRV in a shader
+// --------------------------------------------------------
+struct SimpleSRV
+{
+	unsigned int Index;		// The raw index of the SRV
+	unsigned int BindIndex; // The register of the SRV
+};
+
+// --------------------------------------------------------
+// Contains info about a single Sampler in a shader
+// --------------------------------------------------------
+struct SimpleSampler
+{
+	unsigned int Index;		// The raw index of the Sampler
+	unsigned int BindIndex; // The register of the Sampler
+};
+
+// --------------------------------------------------------
+// Everything SimpleShader needs from D3D's shader reflection,
+// as plain data - so it can be saved next to the .cso and
+// read back without reflecting again.  Nothing here touches
+// D3D or the file system (SimpleShader.cpp reads & writes
+// the sidecar files).
+// --------------------------------------------------------
+struct ShaderReflectionVariable
+{
+	std::string Name;
+	unsigned int ByteOffset;
+	unsigned int Size;
+};
+
+struct ShaderReflectionBuffer
+{
+	std::string Name;
+	unsigned int Type;			// D3D_CBUFFER_TYPE
+	unsigned int Size;
+	unsigned int BindIndex;
+	std::vector<ShaderReflectionVariable> Variables;
+};
+
+struct ShaderReflectionResource
+{
+	std::string Name;
+	unsigned int BindIndex;
+};
+
+struct ShaderReflectionData
+{
+	std::vector<ShaderReflectionBuffer> Buffers;
+	std::vector<ShaderReflectionResource> Textures;	// Structured buffers too
+	std::vector<ShaderReflectionResource> Samplers;
+};
+
+// --------------------------------------------------------
+// The lookups SimpleShader builds from the reflected data -
+// buffer, texture & sampler tables map names to indices
+// --------------------------------------------------------
+struct ShaderReflectionTables
+{
+	std::vector<std::vector<SimpleShaderVariable>> BufferVariables;	// Per buffer, in order
+	std::vector<unsigned int> BufferSizes;
+	std::unordered_map<std::string, unsigned int> BufferTable;
+	std::unordered_map<std::string, SimpleShaderVariable> VarTable;
+	std::vector<SimpleSRV> ShaderResourceViews;
+	std::unordered_map<std::string, unsigned int> TextureTable;
+	std::vector<SimpleSampler> SamplerStates;
+	std::unordered_map<std::string, unsigned int> SamplerTable;
+};
+
+void BuildShaderReflectionTables(const ShaderReflectionData& data, ShaderReflectionTables& tables);
+
+// --------------------------------------------------------
+// One field of a C++ struct that mirrors a constant buffer,
+// and the shader variable it's meant to line up with (see
+// CBUFFER_VARIABLE in ConstantBuffers.h)
+// --------------------------------------------------------
+struct ShaderBufferField
+{
+	const char* Field;			// Like "VertexShaderData::World", for errors
+	const char* Variable;		// Its name in the shader
+	unsigned int ByteOffset;
+	unsigned int Size;
+};
+
+// Checks a mirror struct against the reflected buffer: every
+// field has to be its variable, in that buffer, at the same
+// offset & size, and the struct the buffer's size.  Returns
+// what's wrong (naming the field), or an empty string.
+std::string CheckShaderBufferLayout(const ShaderReflectionTables& tables, const std::string& bufferName, unsigned int structSize, const ShaderBufferField* fields, size_t fieldCount);
+
+// FNV-1a of the compiled shader, which keys its sidecar
+unsigned long long HashShaderBytecode(const void* bytecode, size_t size);
+
+// The sidecar format, in memory: a header (with the hash), then
+// each buffer & its variables, textures and samplers, names as
+// a length and their characters.  Reading fails (returns false)
+// on a different hash or version, or a truncated file.
+std::vector<unsigned char> SerializeShaderReflection(unsigned long long hash, const ShaderReflectionData& data);
+bool DeserializeShaderReflection(const unsigned char* bytes, size_t size, unsigned long long hash, ShaderReflectionData& data);
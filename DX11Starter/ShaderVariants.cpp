@@ -0,0 +1,97 @@
+#include "ShaderVariants.h"
+#include "ConstantBuffers.h"
+#include "PathHelpers.h"
+#include <cstdio>
+#include <cwchar>
+#include <fstream>
+
+ShaderVariantCache::ShaderVariantCache(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	std::shared_ptr<SimplePixelShader> fallback,
+	std::shared_ptr<SimplePixelShader> normalMapFallback)
+	: device(device),
+	context(context),
+	fallback(fallback),
+	normalMapFallback(normalMapFallback),
+	enabled(true),
+	loadedCount(0),
+	missingCount(0)
+{
+}
+
+ShaderVariantCache::~ShaderVariantCache()
+{
+}
+
+// --------------------------------------------------------
+// The variant for a set of features, loading it if this is
+// the first time it's been asked for
+// --------------------------------------------------------
+std::shared_ptr<SimplePixelShader> ShaderVariantCache::Get(unsigned int features)
+{
+	if (!enabled)
+		return GetFallback(features);
+
+	auto found = variants.find(features);
+	if (found != variants.end())
+		return found->second;
+
+	// Check the file's there first - SimpleShader would complain
+	std::wstring path = FixPath(GetFileName(features));
+	std::shared_ptr<SimplePixelShader> shader;
+	if (std::ifstream(path, std::ios::binary).good())
+		shader = std::make_shared<SimplePixelShader>(device, context, path.c_str());
+
+	// (and that it matches ConstantBuffers.h, or it's no use)
+	if (shader && shader->CheckBuffer<PBRPixelShaderData>("ExternalData", PBRPixelShaderDataFields))
+	{
+		loadedCount++;
+	}
+	else
+	{
+		printf("Shader variant %ls not found or invalid - using the run time version\n", path.c_str());
+		shader = GetFallback(features);
+		missingCount++;
+	}
+
+	variants[features] = shader;
+	return shader;
+}
+
+std::shared_ptr<SimplePixelShader> ShaderVariantCache::GetFallback(unsigned int features)
+{
+	return (features & SHADER_FEATURE_NORMALMAP) ? normalMapFallback : fallback;
+}
+
+std::wstring ShaderVariantCache::GetFileName(unsigned int features)
+{
+	wchar_t name[64];
+	swprintf(name, 64, L"PixelShader_f%us%un%uc%ul%u.cso",
+		(features & SHADER_FEATURE_FOG) ? 1u : 0u,
+		(features & SHADER_FEATURE_SHADOWS) ? 1u : 0u,
+		(features & SHADER_FEATURE_NORMALMAP) ? 1u : 0u,
+		(features & SHADER_FEATURE_CEL) ? 1u : 0u,
+		(features & SHADER_FEATURE_LIGHT_MASK) >> SHADER_FEATURE_LIGHT_SHIFT);
+	return name;
+}
+
+void ShaderVariantCache::SetEnabled(bool enabled)
+{
+	this->enabled = enabled;
+}
+
+bool ShaderVariantCache::GetEnabled() const
+{
+	return enabled;
+}
+
+unsigned int ShaderVariantCache::GetLoadedCount() const
+{
+	return loadedCount;
+}
+
+unsigned int ShaderVariantCache::GetMissingCount() const
+{
+	return missingCount;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "SimpleShader.h"
+
+// Features of PixelShader.hlsl, as bits of a variant's key - each
+// is a define the variant is compiled with (see ShaderVariants.targets)
+#define SHADER_FEATURE_FOG			0x01	// FOG
+#define SHADER_FEATURE_SHADOWS		0x02	// SHADOWS
+#define SHADER_FEATURE_NORMALMAP	0x04	// NORMALMAP - also needs the normal mapped vertex shader
+#define SHADER_FEATURE_CEL			0x08	// CEL - ramp shaded directional lights
+#define SHADER_FEATURE_LIGHT_SHIFT	4		// MAX_LIGHTS - directional lights in the cbuffer, 0 to 5
+#define SHADER_FEATURE_LIGHT_MASK	0x70
+
+// The key bits for a count of directional lights
+#define SHADER_FEATURE_LIGHTS(count)	((unsigned int)(count) << SHADER_FEATURE_LIGHT_SHIFT)
+
+// --------------------------------------------------------
+// Pixel shader variants, keyed by feature bitmask.  Variants
+// are compiled offline, so features that are off (and the
+// light loop's bounds) are compiled out instead of branched
+// on - a variant is loaded the first time its key is asked
+// for, and kept.
+//
+// A missing variant falls back to the plain shaders, which
+// decide fog & the light count at run time (and have no cel
+// shading).  Turning the cache off uses them for everything.
+// --------------------------------------------------------
+class ShaderVariantCache
+{
+public:
+	ShaderVariantCache(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		std::shared_ptr<SimplePixelShader> fallback,
+		std::shared_ptr<SimplePixelShader> normalMapFallback);
+	~ShaderVariantCache();
+
+	std::shared_ptr<SimplePixelShader> Get(unsigned int features);
+
+	void SetEnabled(bool enabled);
+	bool GetEnabled() const;
+	unsigned int GetLoadedCount() const;
+	unsigned int GetMissingCount() const;
+
+	// PixelShader_f#s#n#c#l#.cso
+	static std::wstring GetFileName(unsigned int features);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	std::shared_ptr<SimplePixelShader> fallback;
+	std::shared_ptr<SimplePixelShader> normalMapFallback;
+	std::unordered_map<unsigned int, std::shared_ptr<SimplePixelShader>> variants;
+
+	bool enabled;
+	unsigned int loadedCount;
+	unsigned int missingCount;
+
+	std::shared_ptr<SimplePixelShader> GetFallback(unsigned int features);
+};
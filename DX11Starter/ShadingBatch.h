@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstddef>
+
+#include "ShadingReference.h"
+
+// --------------------------------------------------------
+// The batched lighting behind ShadeSamples(), shared by
+// ShadingReference.cpp (scalar & SSE) and the files built
+// for wider instruction sets (ShadingBatchAVX2.cpp and
+// ShadingBatchAVX512.cpp, which get their own /arch in the
+// project file).
+//
+// Everything here has internal linkage and works on raw
+// arrays, so those files never emit a shared inline
+// function (std::vector's, say) that the linker could pick
+// over the plain copy and run on a CPU without AVX.
+// --------------------------------------------------------
+struct ShadingBatchArrays
+{
+	const float* NormalX; const float* NormalY; const float* NormalZ;
+	const float* ViewX; const float* ViewY; const float* ViewZ;
+	const float* PositionX; const float* PositionY; const float* PositionZ;
+	const float* Roughness;
+	const float* Metalness;
+	const float* Surface[3];
+	const float* Specular[3];
+	float* Result[3];
+};
+
+// A directional or point light, as plain numbers
+struct ShadingBatchLight
+{
+	bool Directional;
+	float ToLight[3];		// Normalized, for directional lights
+	float Position[3];		// For point lights
+	float Range;
+	float Intensity;
+	float Color[3];
+};
+
+// Each lights whole batches of its width from begin on, and
+// returns where it stopped (the leftovers are for narrower ones).
+// Only call them when the CPU has the instructions.
+size_t ShadeBatchAVX2(const ShadingBatchArrays& arrays, const ShadingBatchLight& light, size_t begin, size_t end);
+size_t ShadeBatchAVX512(const ShadingBatchArrays& arrays, const ShadingBatchLight& light, size_t begin, size_t end);
+
+// --------------------------------------------------------
+// The lighting below is written once against a float-per-
+// lane type V (Float1, Float4, ... - each file defines its
+// own, with +, -, *, /, Min, Max & Sqrt) and built at each
+// width.
+// --------------------------------------------------------
+namespace
+{
+	template<typename V>
+	struct Vector3
+	{
+		V X, Y, Z;
+	};
+
+	template<typename V>
+	Vector3<V> Load3(const float* x, const float* y, const float* z, size_t i)
+	{
+		return { V::Load(x + i), V::Load(y + i), V::Load(z + i) };
+	}
+
+	template<typename V>
+	V Dot3(const Vector3<V>& a, const Vector3<V>& b)
+	{
+		return a.X * b.X + a.Y * b.Y + a.Z * b.Z;
+	}
+
+	template<typename V>
+	Vector3<V> Normalize3(const Vector3<V>& a)
+	{
+		V length = Sqrt(Dot3(a, a));
+		return { a.X / length, a.Y / length, a.Z / length };
+	}
+
+	template<typename V>
+	V Saturate(V x)
+	{
+		return Min(Max(x, V(0.0f)), V(1.0f));
+	}
+
+	// --------------------------------------------------------
+	// DirectionalLight() or PointLight() for V::Width samples
+	// starting at i, added into the results
+	// --------------------------------------------------------
+	template<typename V>
+	void ShadeBlock(const ShadingBatchArrays& s, const ShadingBatchLight& light, size_t i)
+	{
+		Vector3<V> n = Load3<V>(s.NormalX, s.NormalY, s.NormalZ, i);
+		Vector3<V> v = Load3<V>(s.ViewX, s.ViewY, s.ViewZ, i);
+		V roughness = V::Load(s.Roughness + i);
+		V metalness = V::Load(s.Metalness + i);
+
+		// Light direction & attenuation
+		Vector3<V> l = { V(light.ToLight[0]), V(light.ToLight[1]), V(light.ToLight[2]) };
+		V attenuation(1.0f);
+		if (!light.Directional)
+		{
+			Vector3<V> p = Load3<V>(s.PositionX, s.PositionY, s.PositionZ, i);
+			Vector3<V> toLight = { V(light.Position[0]) - p.X, V(light.Position[1]) - p.Y, V(light.Position[2]) - p.Z };
+			l = Normalize3(toLight);
+
+			V dist = Sqrt(Dot3(toLight, toLight));
+			V att = Saturate(V(1.0f) - dist * dist / V(light.Range * light.Range));
+			attenuation = att * att;
+		}
+		V NdotL = Dot3(n, l);
+		V diffuse = Saturate(NdotL);
+
+		// D_GGX
+		Vector3<V> h = Normalize3(Vector3<V>{ v.X + l.X, v.Y + l.Y, v.Z + l.Z });
+		V NdotH = Saturate(Dot3(n, h));
+		V a = roughness * roughness;
+		V a2 = Max(a * a, V(SHADING_MIN_ROUGHNESS));
+		V denomToSquare = NdotH * NdotH * (a2 - V(1.0f)) + V(1.0f);
+		V D = a2 / (V(SHADING_PI) * denomToSquare * denomToSquare);
+
+		// F_Schlick's pow(1 - VdotH, 5)
+		V oneMinusVdotH = V(1.0f) - Saturate(Dot3(v, h));
+		V squared = oneMinusVdotH * oneMinusVdotH;
+		V fresnel = squared * squared * oneMinusVdotH;
+
+		// Both G_SchlickGGX terms
+		V k = (roughness + V(1.0f)) * (roughness + V(1.0f)) / V(8.0f);
+		V G = V(1.0f) / (Saturate(Dot3(n, v)) * (V(1.0f) - k) + k) / (diffuse * (V(1.0f) - k) + k);
+
+		// The rest of MicrofacetBRDF() & SpecAndTotal(), a channel at a time
+		V specularScale = D * G / V(4.0f) * Max(NdotL, V(0.0f));
+		V diffuseScale = diffuse * (V(1.0f) - metalness);
+		V lightScale = V(light.Intensity) * attenuation;
+		for (int c = 0; c < 3; c++)
+		{
+			V f0 = V::Load(s.Specular[c] + i);
+			V F = f0 + (V(1.0f) - f0) * fresnel;
+			V total = (diffuseScale * (V(1.0f) - F) * V::Load(s.Surface[c] + i) + F * specularScale) * lightScale * V(light.Color[c]);
+			(V::Load(s.Result[c] + i) + total).Store(s.Result[c] + i);
+		}
+	}
+
+	// Every whole block of V::Width samples in [begin, end)
+	template<typename V>
+	size_t ShadeBlocks(const ShadingBatchArrays& arrays, const ShadingBatchLight& light, size_t begin, size_t end)
+	{
+		size_t i = begin;
+		for (; i + V::Width <= end; i += V::Width)
+			ShadeBlock<V>(arrays, light, i);
+		return i;
+	}
+}
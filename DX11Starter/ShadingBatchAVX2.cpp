@@ -0,0 +1,32 @@
+#include "ShadingBatch.h"
+#include <immintrin.h>
+
+// --------------------------------------------------------
+// 8 samples at a time.  This file alone is built with
+// /arch:AVX2, and ShadeSamples() only calls in here once
+// it's checked the CPU (and OS) support it.
+// --------------------------------------------------------
+namespace
+{
+	struct Float8
+	{
+		static const unsigned int Width = 8;
+		__m256 v;
+		Float8(__m256 m) : v(m) {}
+		Float8(float f) : v(_mm256_set1_ps(f)) {}
+		static Float8 Load(const float* p) { return _mm256_loadu_ps(p); }
+		void Store(float* p) const { _mm256_storeu_ps(p, v); }
+	};
+	Float8 operator+(Float8 a, Float8 b) { return _mm256_add_ps(a.v, b.v); }
+	Float8 operator-(Float8 a, Float8 b) { return _mm256_sub_ps(a.v, b.v); }
+	Float8 operator*(Float8 a, Float8 b) { return _mm256_mul_ps(a.v, b.v); }
+	Float8 operator/(Float8 a, Float8 b) { return _mm256_div_ps(a.v, b.v); }
+	Float8 Min(Float8 a, Float8 b) { return _mm256_min_ps(a.v, b.v); }
+	Float8 Max(Float8 a, Float8 b) { return _mm256_max_ps(a.v, b.v); }
+	Float8 Sqrt(Float8 a) { return _mm256_sqrt_ps(a.v); }
+}
+
+size_t ShadeBatchAVX2(const ShadingBatchArrays& arrays, const ShadingBatchLight& light, size_t begin, size_t end)
+{
+	return ShadeBlocks<Float8>(arrays, light, begin, end);
+}
@@ -0,0 +1,32 @@
+#include "ShadingBatch.h"
+#include <immintrin.h>
+
+// --------------------------------------------------------
+// 16 samples at a time.  This file alone is built with
+// /arch:AVX512, and ShadeSamples() only calls in here once
+// it's checked the CPU (and OS) support AVX-512F.
+// --------------------------------------------------------
+namespace
+{
+	struct Float16
+	{
+		static const unsigned int Width = 16;
+		__m512 v;
+		Float16(__m512 m) : v(m) {}
+		Float16(float f) : v(_mm512_set1_ps(f)) {}
+		static Float16 Load(const float* p) { return _mm512_loadu_ps(p); }
+		void Store(float* p) const { _mm512_storeu_ps(p, v); }
+	};
+	Float16 operator+(Float16 a, Float16 b) { return _mm512_add_ps(a.v, b.v); }
+	Float16 operator-(Float16 a, Float16 b) { return _mm512_sub_ps(a.v, b.v); }
+	Float16 operator*(Float16 a, Float16 b) { return _mm512_mul_ps(a.v, b.v); }
+	Float16 operator/(Float16 a, Float16 b) { return _mm512_div_ps(a.v, b.v); }
+	Float16 Min(Float16 a, Float16 b) { return _mm512_min_ps(a.v, b.v); }
+	Float16 Max(Float16 a, Float16 b) { return _mm512_max_ps(a.v, b.v); }
+	Float16 Sqrt(Float16 a) { return _mm512_sqrt_ps(a.v); }
+}
+
+size_t ShadeBatchAVX512(const ShadingBatchArrays& arrays, const ShadingBatchLight& light, size_t begin, size_t end)
+{
+	return ShadeBlocks<Float16>(arrays, light, begin, end);
+}
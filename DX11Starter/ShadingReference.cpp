@@ -0,0 +1,462 @@
+#include "ShadingReference.h"
+#include "ShadingBatch.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <xmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// The HLSL intrinsics the shader functions lean on
+// --------------------------------------------------------
+static XMFLOAT3 Add(XMFLOAT3 a, XMFLOAT3 b) { return XMFLOAT3(a.x + b.x, a.y + b.y, a.z + b.z); }
+static XMFLOAT3 Subtract(XMFLOAT3 a, XMFLOAT3 b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+static XMFLOAT3 Multiply(XMFLOAT3 a, XMFLOAT3 b) { return XMFLOAT3(a.x * b.x, a.y * b.y, a.z * b.z); }
+static XMFLOAT3 Scale(XMFLOAT3 a, float s) { return XMFLOAT3(a.x * s, a.y * s, a.z * s); }
+static XMFLOAT3 OneMinus(XMFLOAT3 a) { return XMFLOAT3(1 - a.x, 1 - a.y, 1 - a.z); }
+static float Dot(XMFLOAT3 a, XMFLOAT3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static float Saturate(float x) { return std::min(std::max(x, 0.0f), 1.0f); }
+static XMFLOAT3 Normalize(XMFLOAT3 a)
+{
+	float length = sqrtf(Dot(a, a));
+	return XMFLOAT3(a.x / length, a.y / length, a.z / length);
+}
+
+
+// PBR FUNCTIONS ================ (see ShaderIncludes.hlsli for the details)
+
+XMFLOAT3 DiffuseEnergyConserve(XMFLOAT3 diffuse, XMFLOAT3 F, float metalness)
+{
+	return Scale(Multiply(diffuse, OneMinus(F)), 1 - metalness);
+}
+
+float D_GGX(XMFLOAT3 n, XMFLOAT3 h, float roughness)
+{
+	float NdotH = Saturate(Dot(n, h));
+	float NdotH2 = NdotH * NdotH;
+	float a = roughness * roughness;
+	float a2 = std::max(a * a, SHADING_MIN_ROUGHNESS);
+
+	float denomToSquare = NdotH2 * (a2 - 1) + 1;
+	return a2 / (SHADING_PI * denomToSquare * denomToSquare);
+}
+
+XMFLOAT3 F_Schlick(XMFLOAT3 v, XMFLOAT3 h, XMFLOAT3 f0)
+{
+	float VdotH = Saturate(Dot(v, h));
+	return Add(f0, Scale(OneMinus(f0), powf(1 - VdotH, 5)));
+}
+
+float G_SchlickGGX(XMFLOAT3 n, XMFLOAT3 v, float roughness)
+{
+	float k = powf(roughness + 1, 2) / 8.0f;
+	float NdotV = Saturate(Dot(n, v));
+	return 1 / (NdotV * (1 - k) + k);
+}
+
+XMFLOAT3 MicrofacetBRDF(XMFLOAT3 n, XMFLOAT3 l, XMFLOAT3 v, float roughness, XMFLOAT3 f0, XMFLOAT3& F_out)
+{
+	XMFLOAT3 h = Normalize(Add(v, l));
+
+	float D = D_GGX(n, h, roughness);
+	XMFLOAT3 F = F_Schlick(v, h, f0);
+	float G = G_SchlickGGX(n, v, roughness) * G_SchlickGGX(n, l, roughness);
+
+	F_out = F;
+
+	XMFLOAT3 specularResult = Scale(F, D * G / 4);
+	return Scale(specularResult, std::max(Dot(n, l), 0.0f));
+}
+
+float Attenuate(const Light& light, XMFLOAT3 worldPos)
+{
+	XMFLOAT3 offset = Subtract(light.Position, worldPos);
+	float dist = sqrtf(Dot(offset, offset));
+	float att = Saturate(1.0f - (dist * dist / (light.Range * light.Range)));
+	return att * att;
+}
+
+static XMFLOAT3 SpecAndTotal(
+	XMFLOAT3 normal,
+	XMFLOAT3 lightDir,
+	float diffuse,
+	float lightIntensity,
+	XMFLOAT3 lightColor,
+	XMFLOAT3 viewVector,
+	float roughness,
+	XMFLOAT3 surfaceColor,
+	XMFLOAT3 specularColor,
+	float metalness)
+{
+	XMFLOAT3 F;
+	XMFLOAT3 spec = MicrofacetBRDF(normal, lightDir, viewVector, roughness, specularColor, F);
+
+	XMFLOAT3 balancedDiff = DiffuseEnergyConserve(XMFLOAT3(diffuse, diffuse, diffuse), F, metalness);
+
+	return Multiply(Scale(Add(Multiply(balancedDiff, surfaceColor), spec), lightIntensity), lightColor);
+}
+
+XMFLOAT3 DirectionalLight(XMFLOAT3 normal, const Light& light, XMFLOAT3 viewVector, float roughness, XMFLOAT3 surfaceColor, XMFLOAT3 specularColor, float metalness)
+{
+	XMFLOAT3 lightDir = Scale(Normalize(light.Direction), -1);
+	float diffuse = Saturate(Dot(normal, lightDir));
+	return SpecAndTotal(normal, lightDir, diffuse, light.Intensity, light.Color, viewVector, roughness, surfaceColor, specularColor, metalness);
+}
+
+XMFLOAT3 PointLight(XMFLOAT3 normal, const Light& light, XMFLOAT3 viewVector, float roughness, XMFLOAT3 surfaceColor, XMFLOAT3 specularColor, XMFLOAT3 worldPos, float metalness)
+{
+	XMFLOAT3 lightDir = Normalize(Subtract(light.Position, worldPos));
+	float diffuse = Saturate(Dot(normal, lightDir));
+	XMFLOAT3 total = SpecAndTotal(normal, lightDir, diffuse, light.Intensity, light.Color, viewVector, roughness, surfaceColor, specularColor, metalness);
+	return Scale(total, Attenuate(light, worldPos));
+}
+
+XMFLOAT3 SpotLight(XMFLOAT3 normal, const Light& light, XMFLOAT3 viewVector, float roughness, XMFLOAT3 surfaceColor, XMFLOAT3 specularColor, XMFLOAT3 worldPos, float metalness)
+{
+	XMFLOAT3 lightToPixel = Normalize(Subtract(worldPos, light.Position));
+	float penumbra = powf(Saturate(Dot(lightToPixel, Normalize(light.Direction))), light.SpotFalloff);
+	return Scale(PointLight(normal, light, viewVector, roughness, surfaceColor, specularColor, worldPos, metalness), penumbra);
+}
+
+
+// BATCHES ================
+
+// --------------------------------------------------------
+// The two widths every x86 CPU can run (see ShadingBatch.h
+// for the lighting itself, and the AVX files for the rest)
+// --------------------------------------------------------
+namespace
+{
+	struct Float1
+	{
+		static const unsigned int Width = 1;
+		float v;
+		Float1(float f) : v(f) {}
+		static Float1 Load(const float* p) { return Float1(*p); }
+		void Store(float* p) const { *p = v; }
+	};
+	Float1 operator+(Float1 a, Float1 b) { return a.v + b.v; }
+	Float1 operator-(Float1 a, Float1 b) { return a.v - b.v; }
+	Float1 operator*(Float1 a, Float1 b) { return a.v * b.v; }
+	Float1 operator/(Float1 a, Float1 b) { return a.v / b.v; }
+	Float1 Min(Float1 a, Float1 b) { return std::min(a.v, b.v); }
+	Float1 Max(Float1 a, Float1 b) { return std::max(a.v, b.v); }
+	Float1 Sqrt(Float1 a) { return sqrtf(a.v); }
+
+	struct Float4
+	{
+		static const unsigned int Width = 4;
+		__m128 v;
+		Float4(__m128 m) : v(m) {}
+		Float4(float f) : v(_mm_set1_ps(f)) {}
+		static Float4 Load(const float* p) { return _mm_loadu_ps(p); }
+		void Store(float* p) const { _mm_storeu_ps(p, v); }
+	};
+	Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+	Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+	Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+	Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+	Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+	Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+	Float4 Sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+}
+
+// --------------------------------------------------------
+// What the CPU can run: AVX2 and AVX-512 need the CPU to
+// have them (cpuid) and the OS to save their registers on
+// a context switch (xgetbv)
+// --------------------------------------------------------
+static void GetCPUID(int leaf, int regs[4])
+{
+#ifdef _MSC_VER
+	__cpuidex(regs, leaf, 0);
+#else
+	__cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long GetEnabledStateMask()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int low = 0, high = 0;
+	__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return ((unsigned long long)high << 32) | low;
+#endif
+}
+
+static unsigned int DetectBatchWidth()
+{
+	int regs[4] = {};
+	GetCPUID(0, regs);
+	if (regs[0] < 7)
+		return Float4::Width;
+
+	// OSXSAVE & AVX
+	GetCPUID(1, regs);
+	if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0)
+		return Float4::Width;
+
+	// XMM & YMM state, then the three AVX-512 ones too
+	unsigned long long enabled = GetEnabledStateMask();
+	GetCPUID(7, regs);
+	bool avx2 = (regs[1] & (1 << 5)) != 0;
+	bool avx512 = (regs[1] & (1 << 16)) != 0;
+	if (avx512 && (enabled & 0xE6) == 0xE6)
+		return 16;
+	if (avx2 && (enabled & 0x6) == 0x6)
+		return 8;
+	return Float4::Width;
+}
+
+unsigned int GetShadingBatchWidth()
+{
+	static const unsigned int width = DetectBatchWidth();
+	return width;
+}
+
+void ShadeSamples(const ShadingSamples& samples, const std::vector<Light>& lights, ShadingResult& result, size_t begin, size_t end, unsigned int maxWidth)
+{
+	std::fill(result.R.begin() + begin, result.R.begin() + end, 0.0f);
+	std::fill(result.G.begin() + begin, result.G.begin() + end, 0.0f);
+	std::fill(result.B.begin() + begin, result.B.begin() + end, 0.0f);
+
+	unsigned int width = GetShadingBatchWidth();
+	if (maxWidth != 0)
+		width = std::min(width, maxWidth);
+
+	ShadingBatchArrays arrays = {
+		samples.NormalX.data(), samples.NormalY.data(), samples.NormalZ.data(),
+		samples.ViewX.data(), samples.ViewY.data(), samples.ViewZ.data(),
+		samples.PositionX.data(), samples.PositionY.data(), samples.PositionZ.data(),
+		samples.Roughness.data(),
+		samples.Metalness.data(),
+		{ samples.SurfaceR.data(), samples.SurfaceG.data(), samples.SurfaceB.data() },
+		{ samples.SpecularR.data(), samples.SpecularG.data(), samples.SpecularB.data() },
+		{ result.R.data(), result.G.data(), result.B.data() } };
+
+	for (const Light& light : lights)
+	{
+		size_t i = begin;
+		if (light.Type == LIGHT_TYPE_SPOT)
+		{
+			for (; i < end; i++)
+			{
+				XMFLOAT3 total = SpotLight(
+					XMFLOAT3(samples.NormalX[i], samples.NormalY[i], samples.NormalZ[i]),
+					light,
+					XMFLOAT3(samples.ViewX[i], samples.ViewY[i], samples.ViewZ[i]),
+					samples.Roughness[i],
+					XMFLOAT3(samples.SurfaceR[i], samples.SurfaceG[i], samples.SurfaceB[i]),
+					XMFLOAT3(samples.SpecularR[i], samples.SpecularG[i], samples.SpecularB[i]),
+					XMFLOAT3(samples.PositionX[i], samples.PositionY[i], samples.PositionZ[i]),
+					samples.Metalness[i]);
+				result.R[i] += total.x;
+				result.G[i] += total.y;
+				result.B[i] += total.z;
+			}
+			continue;
+		}
+
+		XMFLOAT3 toLight = Scale(Normalize(light.Direction), -1);
+		ShadingBatchLight batchLight = {
+			light.Type == LIGHT_TYPE_DIRECTIONAL,
+			{ toLight.x, toLight.y, toLight.z },
+			{ light.Position.x, light.Position.y, light.Position.z },
+			light.Range,
+			light.Intensity,
+			{ light.Color.x, light.Color.y, light.Color.z } };
+
+		// Widest first, then narrower ones for the leftovers
+		if (width >= 16)
+			i = ShadeBatchAVX512(arrays, batchLight, i, end);
+		if (width >= 8)
+			i = ShadeBatchAVX2(arrays, batchLight, i, end);
+		if (width >= 4)
+			i = ShadeBlocks<Float4>(arrays, batchLight, i, end);
+		ShadeBlocks<Float1>(arrays, batchLight, i, end);
+	}
+}
+
+
+// CHECKS ================
+
+static Light MakeLight(int type, XMFLOAT3 direction, XMFLOAT3 position, float range, float intensity, XMFLOAT3 color, float spotFalloff)
+{
+	Light light = {};
+	light.Type = type;
+	light.Direction = direction;
+	light.Position = position;
+	light.Range = range;
+	light.Intensity = intensity;
+	light.Color = color;
+	light.SpotFalloff = spotFalloff;
+	light.ShadowIndex = -1;
+	return light;
+}
+
+static float GetRelativeError(float value, float expected)
+{
+	return fabsf(value - expected) / std::max(1.0f, fabsf(expected));
+}
+
+// --------------------------------------------------------
+// Golden values, worked out by hand from the formulas (so
+// a change to the math in either language shows up here,
+// or as a mismatch between the two)
+// --------------------------------------------------------
+static void CheckGoldenValues(ShadingReferenceResults& results)
+{
+	const float tolerance = 1e-5f;
+	XMFLOAT3 up(0, 1, 0);
+	XMFLOAT3 white(1, 1, 1);
+	XMFLOAT3 f0(SHADING_F0_NON_METAL, SHADING_F0_NON_METAL, SHADING_F0_NON_METAL);
+	XMFLOAT3 diagonal = Normalize(XMFLOAT3(0, 1, 1.7320508f));	// 60 degrees from up
+	Light sun = MakeLight(LIGHT_TYPE_DIRECTIONAL, XMFLOAT3(0, -1, 0), XMFLOAT3(0, 0, 0), 0, 1, white, 0);
+	Light bulb = MakeLight(LIGHT_TYPE_POINT, XMFLOAT3(0, 0, 0), XMFLOAT3(0, 2, 0), 4, 1, white, 0);
+	Light spot = MakeLight(LIGHT_TYPE_SPOT, XMFLOAT3(0, -1, 0), XMFLOAT3(0, 2, 0), 4, 1, white, 8);
+	XMFLOAT3 F;
+
+	struct Golden { float Value; float Expected; };
+	Golden goldens[] =
+	{
+		{ D_GGX(up, up, 1.0f), 1.0f / SHADING_PI },					// a^2 = 1
+		{ D_GGX(up, up, 0.5f), 16.0f / SHADING_PI },				// a^2 = 1/16, denominator = pi / 256
+		{ F_Schlick(up, up, f0).x, SHADING_F0_NON_METAL },			// Head on is just f0
+		{ F_Schlick(up, XMFLOAT3(1, 0, 0), f0).x, 1.0f },			// Grazing is all reflection
+		{ F_Schlick(up, diagonal, f0).x, 0.07f },					// 0.04 + 0.96 * 0.5^5
+		{ G_SchlickGGX(up, up, 0.3f), 1.0f },
+		{ G_SchlickGGX(up, XMFLOAT3(1, 0, 0), 1.0f), 2.0f },		// k = 0.5
+		{ G_SchlickGGX(up, diagonal, 0.0f), 16.0f / 9.0f },			// k = 1/8, 0.5 * 7/8 + 1/8
+		{ MicrofacetBRDF(up, up, up, 1.0f, f0, F).x, 0.01f / SHADING_PI },
+		{ DirectionalLight(up, sun, up, 1.0f, white, f0, 0.0f).x, 0.96f + 0.01f / SHADING_PI },
+		{ DirectionalLight(up, sun, up, 1.0f, white, white, 1.0f).x, 0.25f / SHADING_PI },	// Metals have no diffuse
+		{ PointLight(up, bulb, up, 1.0f, white, f0, XMFLOAT3(0, 0, 0), 0.0f).x, (0.96f + 0.01f / SHADING_PI) * 0.5625f },	// (1 - 2^2/4^2)^2
+		{ SpotLight(up, spot, up, 1.0f, white, f0, XMFLOAT3(0, 0, 0), 0.0f).x, (0.96f + 0.01f / SHADING_PI) * 0.5625f },	// Right down the middle
+	};
+
+	results.GoldenCount = sizeof(goldens) / sizeof(goldens[0]);
+	results.GoldenFailures = 0;
+	for (const Golden& golden : goldens)
+	{
+		if (!(GetRelativeError(golden.Value, golden.Expected) <= tolerance))
+			results.GoldenFailures++;
+	}
+}
+
+ShadingReferenceResults RunShadingReferenceCheck(unsigned int sampleCount, unsigned int maxWidth)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	ShadingReferenceResults results = {};
+	results.SampleCount = sampleCount;
+	results.BatchWidth = maxWidth != 0 ? std::min(GetShadingBatchWidth(), maxWidth) : GetShadingBatchWidth();
+	CheckGoldenValues(results);
+
+	// Random surfaces scattered around a few lights of each type
+	unsigned int seed = 12345;
+	auto random = [&seed](float low, float high)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return low + (seed >> 8) / 16777216.0f * (high - low);
+	};
+	auto randomDirection = [&random]()
+	{
+		return Normalize(XMFLOAT3(random(-1, 1), random(-1, 1), random(0.1f, 1)));
+	};
+
+	ShadingSamples samples;
+	std::vector<float>* channels[] = {
+		&samples.NormalX, &samples.NormalY, &samples.NormalZ,
+		&samples.ViewX, &samples.ViewY, &samples.ViewZ,
+		&samples.PositionX, &samples.PositionY, &samples.PositionZ,
+		&samples.Roughness, &samples.Metalness,
+		&samples.SurfaceR, &samples.SurfaceG, &samples.SurfaceB,
+		&samples.SpecularR, &samples.SpecularG, &samples.SpecularB };
+	for (std::vector<float>* channel : channels)
+		channel->resize(sampleCount);
+	for (unsigned int i = 0; i < sampleCount; i++)
+	{
+		XMFLOAT3 normal = randomDirection();
+		XMFLOAT3 view = randomDirection();
+		samples.NormalX[i] = normal.x; samples.NormalY[i] = normal.y; samples.NormalZ[i] = normal.z;
+		samples.ViewX[i] = view.x; samples.ViewY[i] = view.y; samples.ViewZ[i] = view.z;
+		samples.PositionX[i] = random(-5, 5); samples.PositionY[i] = random(-5, 5); samples.PositionZ[i] = random(-1, 1);
+		samples.Roughness[i] = random(0, 1);
+		samples.Metalness[i] = random(0, 1) < 0.5f ? 0.0f : 1.0f;
+
+		// Metals use their color for specular, like the pixel shaders
+		float color[3] = { random(0, 1), random(0, 1), random(0, 1) };
+		samples.SurfaceR[i] = color[0]; samples.SurfaceG[i] = color[1]; samples.SurfaceB[i] = color[2];
+		samples.SpecularR[i] = samples.Metalness[i] > 0 ? color[0] : SHADING_F0_NON_METAL;
+		samples.SpecularG[i] = samples.Metalness[i] > 0 ? color[1] : SHADING_F0_NON_METAL;
+		samples.SpecularB[i] = samples.Metalness[i] > 0 ? color[2] : SHADING_F0_NON_METAL;
+	}
+
+	std::vector<Light> lights;
+	lights.push_back(MakeLight(LIGHT_TYPE_DIRECTIONAL, XMFLOAT3(1, -1, 1), XMFLOAT3(0, 0, 0), 0, 1, XMFLOAT3(1, 1, 0.9f), 0));
+	lights.push_back(MakeLight(LIGHT_TYPE_DIRECTIONAL, XMFLOAT3(-1, 0.5f, -1), XMFLOAT3(0, 0, 0), 0, 0.5f, XMFLOAT3(0.3f, 0.4f, 1), 0));
+	lights.push_back(MakeLight(LIGHT_TYPE_POINT, XMFLOAT3(0, 0, 0), XMFLOAT3(2, 1, 3), 6, 2, XMFLOAT3(1, 0.5f, 0.2f), 0));
+	lights.push_back(MakeLight(LIGHT_TYPE_POINT, XMFLOAT3(0, 0, 0), XMFLOAT3(-3, -2, 2), 8, 1, XMFLOAT3(0.2f, 1, 0.3f), 0));
+	lights.push_back(MakeLight(LIGHT_TYPE_SPOT, XMFLOAT3(0, 0, -1), XMFLOAT3(0, 0, 4), 10, 3, XMFLOAT3(1, 1, 1), 16));
+
+	// One sample & one light at a time, through the functions above
+	Clock::time_point start = Clock::now();
+	ShadingResult scalar;
+	scalar.R.resize(sampleCount);
+	scalar.G.resize(sampleCount);
+	scalar.B.resize(sampleCount);
+	for (unsigned int i = 0; i < sampleCount; i++)
+	{
+		XMFLOAT3 normal(samples.NormalX[i], samples.NormalY[i], samples.NormalZ[i]);
+		XMFLOAT3 view(samples.ViewX[i], samples.ViewY[i], samples.ViewZ[i]);
+		XMFLOAT3 position(samples.PositionX[i], samples.PositionY[i], samples.PositionZ[i]);
+		XMFLOAT3 surface(samples.SurfaceR[i], samples.SurfaceG[i], samples.SurfaceB[i]);
+		XMFLOAT3 specular(samples.SpecularR[i], samples.SpecularG[i], samples.SpecularB[i]);
+
+		XMFLOAT3 total(0, 0, 0);
+		for (const Light& light : lights)
+		{
+			switch (light.Type)
+			{
+			case LIGHT_TYPE_DIRECTIONAL:
+				total = Add(total, DirectionalLight(normal, light, view, samples.Roughness[i], surface, specular, samples.Metalness[i]));
+				break;
+			case LIGHT_TYPE_POINT:
+				total = Add(total, PointLight(normal, light, view, samples.Roughness[i], surface, specular, position, samples.Metalness[i]));
+				break;
+			case LIGHT_TYPE_SPOT:
+				total = Add(total, SpotLight(normal, light, view, samples.Roughness[i], surface, specular, position, samples.Metalness[i]));
+				break;
+			}
+		}
+		scalar.R[i] = total.x;
+		scalar.G[i] = total.y;
+		scalar.B[i] = total.z;
+	}
+	Clock::time_point scalarEnd = Clock::now();
+
+	ShadingResult batch;
+	batch.R.resize(sampleCount);
+	batch.G.resize(sampleCount);
+	batch.B.resize(sampleCount);
+	ShadeSamples(samples, lights, batch, 0, sampleCount, maxWidth);
+	Clock::time_point batchEnd = Clock::now();
+
+	results.ScalarMs = std::chrono::duration<double, std::milli>(scalarEnd - start).count();
+	results.BatchMs = std::chrono::duration<double, std::milli>(batchEnd - scalarEnd).count();
+	results.BatchMaxError = 0.0f;
+	for (unsigned int i = 0; i < sampleCount; i++)
+	{
+		results.BatchMaxError = std::max(results.BatchMaxError, GetRelativeError(batch.R[i], scalar.R[i]));
+		results.BatchMaxError = std::max(results.BatchMaxError, GetRelativeError(batch.G[i], scalar.G[i]));
+		results.BatchMaxError = std::max(results.BatchMaxError, GetRelativeError(batch.B[i], scalar.B[i]));
+	}
+	return results;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <vector>
+
+#include "Lights.h"
+
+// Must match the constants in ShaderIncludes.hlsli
+#define SHADING_F0_NON_METAL	0.04f
+#define SHADING_MIN_ROUGHNESS	0.0000001f
+#define SHADING_PI				3.14159265359f
+
+// --------------------------------------------------------
+// C++ copies of the PBR functions in ShaderIncludes.hlsli,
+// line for line (same names, same arguments, same order of
+// operations) so they can be used for offline bakes and to
+// check shader changes without a GPU.  Keep them in sync!
+// --------------------------------------------------------
+float D_GGX(DirectX::XMFLOAT3 n, DirectX::XMFLOAT3 h, float roughness);
+DirectX::XMFLOAT3 F_Schlick(DirectX::XMFLOAT3 v, DirectX::XMFLOAT3 h, DirectX::XMFLOAT3 f0);
+float G_SchlickGGX(DirectX::XMFLOAT3 n, DirectX::XMFLOAT3 v, float roughness);
+DirectX::XMFLOAT3 MicrofacetBRDF(DirectX::XMFLOAT3 n, DirectX::XMFLOAT3 l, DirectX::XMFLOAT3 v, float roughness, DirectX::XMFLOAT3 f0, DirectX::XMFLOAT3& F_out);
+DirectX::XMFLOAT3 DiffuseEnergyConserve(DirectX::XMFLOAT3 diffuse, DirectX::XMFLOAT3 F, float metalness);
+float Attenuate(const Light& light, DirectX::XMFLOAT3 worldPos);
+
+DirectX::XMFLOAT3 DirectionalLight(DirectX::XMFLOAT3 normal, const Light& light, DirectX::XMFLOAT3 viewVector, float roughness, DirectX::XMFLOAT3 surfaceColor, DirectX::XMFLOAT3 specularColor, float metalness);
+DirectX::XMFLOAT3 PointLight(DirectX::XMFLOAT3 normal, const Light& light, DirectX::XMFLOAT3 viewVector, float roughness, DirectX::XMFLOAT3 surfaceColor, DirectX::XMFLOAT3 specularColor, DirectX::XMFLOAT3 worldPos, float metalness);
+DirectX::XMFLOAT3 SpotLight(DirectX::XMFLOAT3 normal, const Light& light, DirectX::XMFLOAT3 viewVector, float roughness, DirectX::XMFLOAT3 surfaceColor, DirectX::XMFLOAT3 specularColor, DirectX::XMFLOAT3 worldPos, float metalness);
+
+// --------------------------------------------------------
+// A batch of surface samples to light, one array per value
+// (all the same length).  View vectors point from the
+// surface towards the eye, like viewVector in the shaders.
+// --------------------------------------------------------
+struct ShadingSamples
+{
+	std::vector<float> NormalX, NormalY, NormalZ;
+	std::vector<float> ViewX, ViewY, ViewZ;
+	std::vector<float> PositionX, PositionY, PositionZ;
+	std::vector<float> Roughness;
+	std::vector<float> Metalness;
+	std::vector<float> SurfaceR, SurfaceG, SurfaceB;
+	std::vector<float> SpecularR, SpecularG, SpecularB;
+};
+
+struct ShadingResult
+{
+	std::vector<float> R, G, B;
+};
+
+// --------------------------------------------------------
+// Lights samples [begin, end) with every light, as the pixel
+// shaders would (no shadows or ambient), overwriting those
+// entries of result (which must already be big enough).
+//
+// Directional & point lights run as many samples at once as
+// the CPU allows - 16 with AVX-512, 8 with AVX2, else 4 with
+// SSE (checked once, at run time) - and the leftovers one at
+// a time.  A maxWidth (1, 4, 8 or 16) holds it to narrower
+// paths, to compare them.  Spot lights (whose falloff needs a
+// general pow) go one at a time.  Split the range up to run
+// it across the job system.
+// --------------------------------------------------------
+void ShadeSamples(const ShadingSamples& samples, const std::vector<Light>& lights, ShadingResult& result, size_t begin, size_t end, unsigned int maxWidth = 0);
+
+// Samples per call of the widest path this CPU can run
+unsigned int GetShadingBatchWidth();
+
+// --------------------------------------------------------
+// Results of RunShadingReferenceCheck()
+// --------------------------------------------------------
+struct ShadingReferenceResults
+{
+	unsigned int GoldenCount;
+	unsigned int GoldenFailures;		// Hand-worked values the functions above got wrong
+	unsigned int SampleCount;
+	unsigned int BatchWidth;
+	float BatchMaxError;				// Largest relative difference between ShadeSamples() and the functions above
+										// (around 1e-7, or up to 1e-3 on near mirror highlights if the compiler fuses multiply-adds)
+	double ScalarMs;
+	double BatchMs;
+};
+
+// Checks the functions against values worked out by hand, then
+// times and compares the batched version on random samples
+// (no wider than maxWidth, if given)
+ShadingReferenceResults RunShadingReferenceCheck(unsigned int sampleCount, unsigned int maxWidth = 0);
@@ -0,0 +1,552 @@
+#include "ShadowAtlas.h"
+#include "Profiler.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+// Tile sizes handed out by the allocator
+static const unsigned int MaxTileSize = 2048;
+static const unsigned int MinTileSize = 128;
+
+// Directional lights cover a fixed box around the middle of the scene
+static const float DirectionalDistance = 7.0f;
+static const float DirectionalExtent = 12.0f;
+
+// Spot light & cube face frustums
+static const float LocalNearZ = 0.05f;
+static const float MinSpotAngle = XMConvertToRadians(10.0f);
+static const float MaxSpotAngle = XMConvertToRadians(160.0f);
+
+// Cube faces are worth less than a whole light, and keep their
+// tiles (and keep redrawing) this long after their casters leave
+static const float FaceImportance = 0.5f;
+static const unsigned int FaceKeepFrames = 60;
+
+// --------------------------------------------------------
+// Full cone angle where the shaders' pow(cos, falloff)
+// penumbra has dropped to 1%
+// --------------------------------------------------------
+static float GetSpotAngle(float falloff)
+{
+	float angle = MaxSpotAngle;
+	if (falloff > 0.0f)
+		angle = 2.0f * acosf(powf(0.01f, 1.0f / falloff));
+	return max(MinSpotAngle, min(MaxSpotAngle, angle));
+}
+
+// FNV-1a, 64 bit
+static void HashBytes(unsigned long long& hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+}
+
+ShadowAtlas::ShadowAtlas(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	unsigned int atlasSize,
+	std::shared_ptr<SimpleVertexShader> fullscreenVS,
+	std::shared_ptr<SimplePixelShader> copyPS) :
+	device(device),
+	context(context),
+	allocator(atlasSize, MaxTileSize, MinTileSize),
+	atlasSize(atlasSize),
+	fullscreenVS(fullscreenVS),
+	copyPS(copyPS),
+	infoCapacity(0),
+	tilesDrawn(0),
+	staticRedraws(0),
+	staticSkips(0)
+{
+	CreateTexture(atlasDSV, atlasSRV);
+	CreateTexture(staticDSV, staticSRV);
+
+	// Clearing & copying tiles writes depth no matter what's there
+	D3D11_DEPTH_STENCIL_DESC overwriteDesc = {};
+	overwriteDesc.DepthEnable = true;
+	overwriteDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	overwriteDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+	device->CreateDepthStencilState(&overwriteDesc, overwriteDepthState.GetAddressOf());
+
+	// Biased rasterizer state for the casters
+	D3D11_RASTERIZER_DESC casterDesc = {};
+	casterDesc.FillMode = D3D11_FILL_SOLID;
+	casterDesc.CullMode = D3D11_CULL_BACK;
+	casterDesc.DepthClipEnable = true;
+	casterDesc.DepthBias = 1000; // Min. precision units, not world units!
+	casterDesc.SlopeScaledDepthBias = 1.0f; // Bias more based on slope
+	device->CreateRasterizerState(&casterDesc, casterRasterizer.GetAddressOf());
+
+	// Comparison sampler for softer shadows (the shaders keep it
+	// from filtering across tile edges)
+	D3D11_SAMPLER_DESC samplerDesc = {};
+	samplerDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_MIP_LINEAR;
+	samplerDesc.ComparisonFunc = D3D11_COMPARISON_LESS;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
+	samplerDesc.BorderColor[0] = 1.0f;
+	device->CreateSamplerState(&samplerDesc, comparisonSampler.GetAddressOf());
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+}
+
+// --------------------------------------------------------
+// One atlas-sized depth texture, usable as a depth buffer
+// and as a shader resource
+// --------------------------------------------------------
+void ShadowAtlas::CreateTexture(
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView>& dsv,
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = atlasSize;
+	desc.Height = atlasSize;
+	desc.ArraySize = 1;
+	desc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	desc.Format = DXGI_FORMAT_R32_TYPELESS;
+	desc.MipLevels = 1;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	device->CreateTexture2D(&desc, 0, texture.GetAddressOf());
+
+	D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+	dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	dsvDesc.Texture2D.MipSlice = 0;
+	device->CreateDepthStencilView(texture.Get(), &dsvDesc, dsv.GetAddressOf());
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = 1;
+	srvDesc.Texture2D.MostDetailedMip = 0;
+	device->CreateShaderResourceView(texture.Get(), &srvDesc, srv.GetAddressOf());
+}
+
+// --------------------------------------------------------
+// Directional lights always want the biggest tiles, spot &
+// point lights want more the closer they are (relative to
+// their range), and ones off screen want nothing at all.
+// Point lights then ask for just the faces with casters.
+// --------------------------------------------------------
+void ShadowAtlas::Prepare(
+	std::vector<Light>& lights,
+	const XMFLOAT3& cameraPosition,
+	const BoundingFrustum& frustum,
+	unsigned long long staticSceneKey,
+	unsigned int alwaysUpdate,
+	unsigned int updateBudget,
+	unsigned int faceBudget,
+	const std::vector<BoundingSphere>& casterBounds,
+	const std::vector<unsigned char>& casterDynamic,
+	std::vector<ShadowView>& views,
+	std::vector<ShadowInfo>& infos)
+{
+	PROFILE_FUNCTION();
+
+	std::vector<ShadowRequest> lightRequests;
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		Light& light = lights[i];
+		light.ShadowIndex = -1;
+		if (light.Intensity <= 0.0f)
+			continue;
+
+		ShadowRequest request = { (unsigned int)i, -1, 0.0f, true };
+		if (light.Type == LIGHT_TYPE_DIRECTIONAL)
+		{
+			request.Importance = 1.0f;
+		}
+		else if (light.Range > 0.0f)
+		{
+			if (!frustum.Intersects(BoundingSphere(light.Position, light.Range)))
+				continue;
+
+			float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&light.Position) - XMLoadFloat3(&cameraPosition)));
+			request.Importance = distance <= light.Range ? 1.0f : light.Range / distance;
+		}
+		else
+		{
+			continue;
+		}
+		lightRequests.push_back(request);
+	}
+
+	// Only the most important ones are worth packing at all
+	if (lightRequests.size() > MaxShadowedLights)
+	{
+		std::nth_element(lightRequests.begin(), lightRequests.begin() + MaxShadowedLights, lightRequests.end(),
+			[](const ShadowRequest& a, const ShadowRequest& b) { return a.Importance > b.Importance; });
+		lightRequests.resize(MaxShadowedLights);
+	}
+
+	// Point lights that made the cut, forgetting the ones that didn't
+	std::vector<unsigned int> pointLights;
+	for (const ShadowRequest& request : lightRequests)
+	{
+		if (lights[request.LightIndex].Type == LIGHT_TYPE_POINT)
+			pointLights.push_back(request.LightIndex);
+	}
+	for (auto it = pointShadows.begin(); it != pointShadows.end(); )
+	{
+		if (std::find(pointLights.begin(), pointLights.end(), it->first) == pointLights.end())
+			it = pointShadows.erase(it);
+		else
+			++it;
+	}
+	std::vector<PointShadow*> points(pointLights.size());
+	for (size_t p = 0; p < pointLights.size(); p++)
+	{
+		auto inserted = pointShadows.insert(std::make_pair(pointLights[p], PointShadow()));
+		if (inserted.second)
+		{
+			for (unsigned int f = 0; f < CUBE_FACE_COUNT; f++)
+			{
+				inserted.first->second.IdleFrames[f] = FaceKeepFrames;
+				inserted.first->second.StillFrames[f] = FaceKeepFrames;
+			}
+		}
+		points[p] = &inserted.first->second;
+	}
+
+	// Sort the casters into each point light's faces (every
+	// light is independent, so they can be culled in parallel)
+	JobSystem::GetInstance().ParallelFor((unsigned int)points.size(), [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int p = begin; p < end; p++)
+		{
+			const Light& light = lights[pointLights[p]];
+			CullCubeFaces(light.Position, light.Range, casterBounds, casterDynamic, points[p]->Faces);
+		}
+	});
+
+	// One tile per light, or per recently used face of a point light
+	requests.clear();
+	for (const ShadowRequest& request : lightRequests)
+	{
+		if (lights[request.LightIndex].Type != LIGHT_TYPE_POINT)
+		{
+			requests.push_back(request);
+			continue;
+		}
+
+		PointShadow& point = pointShadows[request.LightIndex];
+		for (unsigned int f = 0; f < CUBE_FACE_COUNT; f++)
+		{
+			unsigned int bit = 1u << f;
+			point.IdleFrames[f] = (point.Faces.Mask & bit) ? 0 : min(point.IdleFrames[f] + 1, FaceKeepFrames);
+			point.StillFrames[f] = (point.Faces.DynamicMask & bit) ? 0 : min(point.StillFrames[f] + 1, FaceKeepFrames);
+			if (point.IdleFrames[f] >= FaceKeepFrames)
+				continue;
+
+			ShadowRequest face = {
+				request.LightIndex,
+				(int)f,
+				request.Importance * FaceImportance,
+				point.StillFrames[f] < FaceKeepFrames };
+			requests.push_back(face);
+		}
+	}
+
+	allocator.Allocate(requests);
+	allocator.Schedule(alwaysUpdate, updateBudget, faceBudget);
+
+	// Room for each shadowed light's info - one slot, or six for
+	// a point light (faces without a tile stay zeroed, and the
+	// shaders treat them as unshadowed)
+	const std::vector<ShadowTile>& tiles = allocator.GetTiles();
+	infos.clear();
+	for (const ShadowTile& tile : tiles)
+	{
+		Light& light = lights[tile.LightIndex];
+		if (light.ShadowIndex >= 0)
+			continue;
+
+		ShadowInfo empty = {};
+		light.ShadowIndex = (int)infos.size();
+		infos.resize(infos.size() + (light.Type == LIGHT_TYPE_POINT ? CUBE_FACE_COUNT : 1), empty);
+	}
+
+	// Each tile's matrices & where the shaders find it
+	views.resize(tiles.size());
+	for (size_t t = 0; t < tiles.size(); t++)
+	{
+		const ShadowTile& tile = tiles[t];
+		Light& light = lights[tile.LightIndex];
+
+		XMVECTOR direction = XMVector3Normalize(XMLoadFloat3(&light.Direction));
+		XMVECTOR up = fabsf(XMVectorGetY(direction)) > 0.99f ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(0, 1, 0, 0);
+		XMMATRIX view, projection;
+		if (light.Type == LIGHT_TYPE_DIRECTIONAL)
+		{
+			view = XMMatrixLookToLH(direction * -DirectionalDistance, direction, up);
+			projection = XMMatrixOrthographicLH(DirectionalExtent, DirectionalExtent, 1.0f, 100.0f);
+		}
+		else if (tile.Face >= 0)
+		{
+			XMFLOAT3 faceForward, faceUp;
+			GetCubeFaceBasis((unsigned int)tile.Face, faceForward, faceUp);
+			view = XMMatrixLookToLH(XMLoadFloat3(&light.Position), XMLoadFloat3(&faceForward), XMLoadFloat3(&faceUp));
+			projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, LocalNearZ, light.Range);
+		}
+		else
+		{
+			view = XMMatrixLookToLH(XMLoadFloat3(&light.Position), direction, up);
+			projection = XMMatrixPerspectiveFovLH(GetSpotAngle(light.SpotFalloff), 1.0f, LocalNearZ, light.Range);
+		}
+
+		ShadowView& shadowView = views[t];
+		shadowView.Tile = tile;
+		XMStoreFloat4x4(&shadowView.View, view);
+		XMStoreFloat4x4(&shadowView.Projection, projection);
+
+		// Faces only draw the casters that reach them
+		shadowView.CullCasters = tile.Face >= 0;
+		if (shadowView.CullCasters)
+			shadowView.Casters = pointShadows[tile.LightIndex].Faces.Casters[tile.Face];
+		else
+			shadowView.Casters.clear();
+
+		// Same scene, same matrices, same spot in the atlas = same static casters
+		shadowView.StaticKey = 14695981039346656037ull;
+		HashBytes(shadowView.StaticKey, &staticSceneKey, sizeof(staticSceneKey));
+		HashBytes(shadowView.StaticKey, &shadowView.View, sizeof(shadowView.View));
+		HashBytes(shadowView.StaticKey, &shadowView.Projection, sizeof(shadowView.Projection));
+		unsigned int rect[3] = { tile.X, tile.Y, tile.Size };
+		HashBytes(shadowView.StaticKey, rect, sizeof(rect));
+
+		ShadowInfo& info = infos[light.ShadowIndex + max(tile.Face, 0)];
+		XMStoreFloat4x4(&info.ViewProjection, XMMatrixMultiply(view, projection));
+		info.AtlasRect = XMFLOAT4(
+			(float)tile.X / atlasSize,
+			(float)tile.Y / atlasSize,
+			(float)tile.Size / atlasSize,
+			(float)tile.Size / atlasSize);
+	}
+}
+
+// --------------------------------------------------------
+// Was this view's tile last drawn with exactly this key?
+// (The key covers the tile's position, so a light that's
+// moved elsewhere in the atlas doesn't count.)
+// --------------------------------------------------------
+bool ShadowAtlas::IsCurrent(const std::unordered_map<unsigned long long, DrawnTile>& drawn, const ShadowView& view)
+{
+	auto it = drawn.find(ShadowAtlasAllocator::GetTileKey(view.Tile.LightIndex, view.Tile.Face));
+	return it != drawn.end() && it->second.Key == view.StaticKey;
+}
+
+// --------------------------------------------------------
+// Records a tile as drawn, and forgets any other tile it
+// just drew over
+// --------------------------------------------------------
+void ShadowAtlas::MarkDrawn(std::unordered_map<unsigned long long, DrawnTile>& drawn, const ShadowView& view)
+{
+	const ShadowTile& tile = view.Tile;
+	unsigned long long key = ShadowAtlasAllocator::GetTileKey(tile.LightIndex, tile.Face);
+	for (auto it = drawn.begin(); it != drawn.end(); )
+	{
+		const ShadowTile& other = it->second.Tile;
+		bool overlaps =
+			other.X < tile.X + tile.Size && tile.X < other.X + other.Size &&
+			other.Y < tile.Y + tile.Size && tile.Y < other.Y + other.Size;
+		if (overlaps && it->first != key)
+			it = drawn.erase(it);
+		else
+			++it;
+	}
+
+	DrawnTile& entry = drawn[key];
+	entry.Key = view.StaticKey;
+	entry.Tile = tile;
+}
+
+// --------------------------------------------------------
+// Resets one tile to the far plane - a viewport squashed to
+// depth 1 turns the fullscreen triangle into a "clear"
+// --------------------------------------------------------
+void ShadowAtlas::FillTile(const D3D11_VIEWPORT& tileViewport)
+{
+	D3D11_VIEWPORT viewport = tileViewport;
+	viewport.MinDepth = 1.0f;
+	viewport.MaxDepth = 1.0f;
+	context->RSSetViewports(1, &viewport);
+	context->RSSetState(0);
+	context->OMSetDepthStencilState(overwriteDepthState.Get(), 0);
+
+	fullscreenVS->SetShader();
+	context->PSSetShader(0, 0, 0);
+	context->Draw(3, 0);
+
+	context->OMSetDepthStencilState(0, 0);
+}
+
+// --------------------------------------------------------
+// Copies the current viewport's tile from the static cache
+// into the atlas (depth textures can't be partially copied
+// with CopySubresourceRegion, so it's a tiny draw instead)
+// --------------------------------------------------------
+void ShadowAtlas::CopyTile()
+{
+	context->RSSetState(0);
+	context->OMSetDepthStencilState(overwriteDepthState.Get(), 0);
+
+	fullscreenVS->SetShader();
+	copyPS->SetShader();
+	copyPS->SetShaderResourceView("StaticShadows", staticSRV);
+	copyPS->CopyAllBufferData();
+	context->Draw(3, 0);
+
+	// Unbind the cache so it can be drawn to again
+	ID3D11ShaderResourceView* nullSRV = 0;
+	context->PSSetShaderResources(0, 1, &nullSRV);
+	context->PSSetShader(0, 0, 0);
+	context->OMSetDepthStencilState(0, 0);
+}
+
+void ShadowAtlas::Render(
+	const std::vector<ShadowView>& views,
+	const std::vector<ShadowInfo>& infos,
+	bool cacheStatic,
+	const std::function<void(const ShadowView&, bool)>& drawCasters)
+{
+	// Tile info for the shaders, growing the buffer as needed
+	unsigned int count = (unsigned int)infos.size();
+	if (!infoBuffer || count > infoCapacity)
+	{
+		infoCapacity = max(infoCapacity, 16u);
+		while (infoCapacity < count)
+			infoCapacity *= 2;
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = infoCapacity * sizeof(ShadowInfo);
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		desc.StructureByteStride = sizeof(ShadowInfo);
+		infoBuffer.Reset();
+		device->CreateBuffer(&desc, 0, infoBuffer.GetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = infoCapacity;
+		infoSRV.Reset();
+		device->CreateShaderResourceView(infoBuffer.Get(), &srvDesc, infoSRV.GetAddressOf());
+	}
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	if (count > 0 && SUCCEEDED(context->Map(infoBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+	{
+		memcpy(mapped.pData, &infos[0], count * sizeof(ShadowInfo));
+		context->Unmap(infoBuffer.Get(), 0);
+	}
+
+	// Redraw the scheduled tiles, plus any that aren't what
+	// the shaders expect (the frame that moved them may have
+	// been skipped)
+	ID3D11RenderTargetView* nullRTV{};
+	tilesDrawn = 0;
+	for (const ShadowView& view : views)
+	{
+		if (!view.Tile.Update && IsCurrent(drawnTiles, view))
+			continue;
+
+		D3D11_VIEWPORT viewport = {};
+		viewport.TopLeftX = (float)view.Tile.X;
+		viewport.TopLeftY = (float)view.Tile.Y;
+		viewport.Width = (float)view.Tile.Size;
+		viewport.Height = (float)view.Tile.Size;
+		viewport.MaxDepth = 1.0f;
+
+		if (cacheStatic)
+		{
+			// Static casters, only when this tile's cache is out of date
+			if (!IsCurrent(cachedTiles, view))
+			{
+				context->OMSetRenderTargets(1, &nullRTV, staticDSV.Get());
+				FillTile(viewport);
+				context->RSSetViewports(1, &viewport);
+				context->RSSetState(casterRasterizer.Get());
+				drawCasters(view, false);
+
+				MarkDrawn(cachedTiles, view);
+				staticRedraws++;
+			}
+			else
+			{
+				staticSkips++;
+			}
+
+			context->OMSetRenderTargets(1, &nullRTV, atlasDSV.Get());
+			context->RSSetViewports(1, &viewport);
+			CopyTile();
+		}
+		else
+		{
+			context->OMSetRenderTargets(1, &nullRTV, atlasDSV.Get());
+			FillTile(viewport);
+			context->RSSetViewports(1, &viewport);
+			context->RSSetState(casterRasterizer.Get());
+			drawCasters(view, false);
+		}
+
+		// Dynamic casters on top
+		context->RSSetState(casterRasterizer.Get());
+		drawCasters(view, true);
+
+		MarkDrawn(drawnTiles, view);
+		tilesDrawn++;
+	}
+	context->RSSetState(0);
+}
+
+void ShadowAtlas::SetShaderData(std::shared_ptr<SimplePixelShader> shader)
+{
+	shader->SetShaderResourceView("ShadowAtlas", atlasSRV);
+	shader->SetShaderResourceView("ShadowInfos", infoSRV);
+	shader->SetSamplerState("ShadowSampler", comparisonSampler);
+}
+
+const ShadowAtlasAllocator& ShadowAtlas::GetAllocator() const
+{
+	return allocator;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ShadowAtlas::GetSRV()
+{
+	return atlasSRV;
+}
+
+unsigned int ShadowAtlas::GetTilesDrawn() const
+{
+	return tilesDrawn;
+}
+
+unsigned long long ShadowAtlas::GetStaticRedraws() const
+{
+	return staticRedraws;
+}
+
+unsigned long long ShadowAtlas::GetStaticSkips() const
+{
+	return staticSkips;
+}
+
+void ShadowAtlas::ResetCounters()
+{
+	staticRedraws = 0;
+	staticSkips = 0;
+}
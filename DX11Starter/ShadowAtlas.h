@@ -0,0 +1,169 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Lights.h"
+#include "SimpleShader.h"
+#include "ShadowAtlasAllocator.h"
+#include "CubeShadowFaces.h"
+
+// --------------------------------------------------------
+// What the shaders know about one shadowed light (matches
+// ShadowInfo in Shadows.hlsli), indexed by Light::ShadowIndex.
+// Point lights get six in a row, one per cube face.
+// --------------------------------------------------------
+struct ShadowInfo
+{
+	DirectX::XMFLOAT4X4 ViewProjection;
+	DirectX::XMFLOAT4 AtlasRect;	// UV offset (xy) & scale (zw) of the light's tile (zero = no tile)
+};
+
+// --------------------------------------------------------
+// What the shadow pass needs to draw one tile
+// --------------------------------------------------------
+struct ShadowView
+{
+	ShadowTile Tile;
+	DirectX::XMFLOAT4X4 View;
+	DirectX::XMFLOAT4X4 Projection;
+	unsigned long long StaticKey;	// Changes whenever the tile's static casters would
+
+	// Cube faces only draw the casters that reach them
+	bool CullCasters;
+	std::vector<unsigned int> Casters;	// Indices into the caster list given to Prepare()
+};
+
+// --------------------------------------------------------
+// One big depth texture shared by every shadowed light.
+//
+// Prepare() (simulation thread) asks the allocator for a
+// tile per directional & spot light, sized by how much of
+// the screen the light can affect, and works out each
+// light's matrices.  Render() (render thread) then redraws
+// just the tiles scheduled this frame.
+//
+// Point lights get a tile per cube face, but only for the
+// faces that something actually casts into - and those
+// faces are redrawn from their own, separate budget.
+//
+// Static casters are cached per tile in a second atlas, and
+// are only redrawn when that tile's StaticKey changes.  Each
+// redraw copies the cached tile into the real atlas and adds
+// the dynamic casters on top.
+// --------------------------------------------------------
+class ShadowAtlas
+{
+public:
+	static const unsigned int MaxShadowedLights = 64;
+
+	ShadowAtlas(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		unsigned int atlasSize,
+		std::shared_ptr<SimpleVertexShader> fullscreenVS,
+		std::shared_ptr<SimplePixelShader> copyPS);
+	~ShadowAtlas();
+
+	// Picks and schedules this frame's tiles, and sets each light's
+	// ShadowIndex (-1 when it has no tile)
+	void Prepare(
+		std::vector<Light>& lights,
+		const DirectX::XMFLOAT3& cameraPosition,
+		const DirectX::BoundingFrustum& frustum,
+		unsigned long long staticSceneKey,
+		unsigned int alwaysUpdate,
+		unsigned int updateBudget,
+		unsigned int faceBudget,
+		const std::vector<DirectX::BoundingSphere>& casterBounds,
+		const std::vector<unsigned char>& casterDynamic,
+		std::vector<ShadowView>& views,
+		std::vector<ShadowInfo>& infos);
+
+	// Redraws the scheduled (or out of date) tiles - drawCasters
+	// draws either the static or the dynamic casters for one view
+	void Render(
+		const std::vector<ShadowView>& views,
+		const std::vector<ShadowInfo>& infos,
+		bool cacheStatic,
+		const std::function<void(const ShadowView&, bool)>& drawCasters);
+
+	// Binds the atlas, tile info & comparison sampler
+	void SetShaderData(std::shared_ptr<SimplePixelShader> shader);
+
+	const ShadowAtlasAllocator& GetAllocator() const;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetSRV();
+
+	// Render thread stats
+	unsigned int GetTilesDrawn() const;		// During the last Render()
+	unsigned long long GetStaticRedraws() const;
+	unsigned long long GetStaticSkips() const;
+	void ResetCounters();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	// Simulation side
+	ShadowAtlasAllocator allocator;
+	std::vector<ShadowRequest> requests;
+
+	// Each shadowed point light's faces, and how many frames
+	// each face has gone without any casters / moving casters
+	// (faces hang on to their tiles for a while, so the atlas
+	// doesn't repack every time something wanders across a
+	// face edge, and keep redrawing for a while after the
+	// last moving caster leaves so it doesn't leave a shadow)
+	struct PointShadow
+	{
+		CubeFaceCasters Faces;
+		unsigned int IdleFrames[CUBE_FACE_COUNT];
+		unsigned int StillFrames[CUBE_FACE_COUNT];
+	};
+	std::unordered_map<unsigned int, PointShadow> pointShadows;
+
+	// The atlas, the static caster cache, and what it takes to
+	// clear or copy one tile of them
+	unsigned int atlasSize;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> atlasDSV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> atlasSRV;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> staticDSV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> staticSRV;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> overwriteDepthState;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> casterRasterizer;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> comparisonSampler;
+	std::shared_ptr<SimpleVertexShader> fullscreenVS;
+	std::shared_ptr<SimplePixelShader> copyPS;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> infoBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> infoSRV;
+	unsigned int infoCapacity;
+
+	// The key each tile was last drawn with, in the atlas and
+	// in the static cache (by light & face)
+	struct DrawnTile
+	{
+		unsigned long long Key;
+		ShadowTile Tile;
+	};
+	std::unordered_map<unsigned long long, DrawnTile> drawnTiles;
+	std::unordered_map<unsigned long long, DrawnTile> cachedTiles;
+	static bool IsCurrent(const std::unordered_map<unsigned long long, DrawnTile>& drawn, const ShadowView& view);
+	static void MarkDrawn(std::unordered_map<unsigned long long, DrawnTile>& drawn, const ShadowView& view);
+
+	void CreateTexture(
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilView>& dsv,
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+	void FillTile(const D3D11_VIEWPORT& tileViewport);
+	void CopyTile();
+
+	unsigned int tilesDrawn;
+	unsigned long long staticRedraws;
+	unsigned long long staticSkips;
+};
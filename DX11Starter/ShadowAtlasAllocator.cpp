@@ -0,0 +1,320 @@
+#include "ShadowAtlasAllocator.h"
+#include "Profiler.h"
+#include <algorithm>
+
+// ImGui compiles stb_rect_pack privately (static), so this file
+// gets its own private copy too
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "ImGui/imstb_rectpack.h"
+
+// A light keeps last frame's tile size until its importance asks for
+// something this far off (about 2^0.75 either way), so lights sitting
+// right between two sizes don't cause a repack every frame
+static const float ShrinkRatio = 0.6f;
+static const float GrowRatio = 1.7f;
+
+ShadowAtlasAllocator::ShadowAtlasAllocator(unsigned int atlasSize, unsigned int maxTileSize, unsigned int minTileSize) :
+	atlasSize(atlasSize),
+	maxTileSize(std::min(maxTileSize, atlasSize)),
+	minTileSize(std::max(1u, std::min(minTileSize, std::min(maxTileSize, atlasSize)))),
+	droppedCount(0),
+	layoutVersion(0),
+	roundRobinTile(0),
+	roundRobinFace(0)
+{
+}
+
+ShadowAtlasAllocator::~ShadowAtlasAllocator()
+{
+}
+
+// --------------------------------------------------------
+// Picks each light's size, then either keeps last frame's
+// layout (same lights, same sizes) or packs a new one
+// --------------------------------------------------------
+void ShadowAtlasAllocator::Allocate(const std::vector<ShadowRequest>& requests)
+{
+	PROFILE_FUNCTION();
+
+	// Most important first, ties broken by key so the order is stable
+	std::vector<ShadowRequest> sorted(requests);
+	std::sort(sorted.begin(), sorted.end(), [](const ShadowRequest& a, const ShadowRequest& b)
+	{
+		if (a.Importance != b.Importance)
+			return a.Importance > b.Importance;
+		return GetTileKey(a.LightIndex, a.Face) < GetTileKey(b.LightIndex, b.Face);
+	});
+
+	// Wanted sizes, with a little hysteresis
+	auto byKey = [](const Wanted& a, const Wanted& b) { return a.Key < b.Key; };
+	std::vector<unsigned int> sizes(sorted.size());
+	std::vector<Wanted> nextWanted(sorted.size());
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		unsigned int size = GetTileSize(sorted[i].Importance);
+
+		Wanted key = { GetTileKey(sorted[i].LightIndex, sorted[i].Face), 0 };
+		auto last = std::lower_bound(wanted.begin(), wanted.end(), key, byKey);
+		if (last != wanted.end() && last->Key == key.Key)
+		{
+			float ideal = std::max(sorted[i].Importance * maxTileSize, (float)minTileSize);
+			float ratio = ideal / last->Size;
+			if (ratio > ShrinkRatio && ratio < GrowRatio)
+				size = last->Size;
+		}
+
+		sizes[i] = size;
+		nextWanted[i].Key = key.Key;
+		nextWanted[i].Size = size;
+	}
+	std::sort(nextWanted.begin(), nextWanted.end(), byKey);
+
+	bool sameLayout = nextWanted.size() == wanted.size();
+	for (size_t i = 0; i < nextWanted.size() && sameLayout; i++)
+		sameLayout = nextWanted[i].Key == wanted[i].Key && nextWanted[i].Size == wanted[i].Size;
+	wanted.swap(nextWanted);
+
+	// Last frame's tiles, by key
+	std::vector<ShadowTile> oldTiles(tiles);
+	std::sort(oldTiles.begin(), oldTiles.end(), [](const ShadowTile& a, const ShadowTile& b)
+	{
+		return GetTileKey(a.LightIndex, a.Face) < GetTileKey(b.LightIndex, b.Face);
+	});
+	auto findOld = [&oldTiles](const ShadowRequest& request) -> const ShadowTile*
+	{
+		unsigned long long key = GetTileKey(request.LightIndex, request.Face);
+		auto it = std::lower_bound(oldTiles.begin(), oldTiles.end(), key,
+			[](const ShadowTile& tile, unsigned long long k) { return GetTileKey(tile.LightIndex, tile.Face) < k; });
+		return (it != oldTiles.end() && GetTileKey(it->LightIndex, it->Face) == key) ? &*it : 0;
+	};
+
+	// Nothing changed size - same tiles, just re-sorted by this frame's importance
+	if (sameLayout)
+	{
+		tiles.clear();
+		for (size_t i = 0; i < sorted.size(); i++)
+		{
+			const ShadowTile* old = findOld(sorted[i]);
+			if (!old)
+				continue;
+
+			ShadowTile tile = *old;
+			tile.Importance = sorted[i].Importance;
+			tile.Dynamic = sorted[i].Dynamic;
+			tile.Fresh = false;
+			tiles.push_back(tile);
+		}
+		return;
+	}
+
+	// Too much area to possibly fit?  Shrink without bothering to pack
+	std::vector<unsigned int> targets(sizes);
+	unsigned long long atlasArea = (unsigned long long)atlasSize * atlasSize;
+	unsigned long long area = 0;
+	for (unsigned int size : sizes)
+		area += (unsigned long long)size * size;
+	for (size_t i = sizes.size(); i-- > 0 && area > atlasArea; )
+	{
+		while (sizes[i] > minTileSize && area > atlasArea)
+		{
+			area -= (unsigned long long)sizes[i] * sizes[i] * 3 / 4;
+			sizes[i] /= 2;
+		}
+	}
+
+	// Pack, halving the least important tile that can still
+	// shrink until everything fits (or nothing else can shrink)
+	std::vector<ShadowTile> packed;
+	bool fits;
+	while (!(fits = Pack(sorted, sizes, packed)))
+	{
+		size_t shrink = sizes.size();
+		for (size_t i = sizes.size(); i-- > 0; )
+		{
+			if (sizes[i] > minTileSize)
+			{
+				shrink = i;
+				break;
+			}
+		}
+		if (shrink == sizes.size())
+			break;
+		sizes[shrink] /= 2;
+		area -= (unsigned long long)sizes[shrink] * sizes[shrink] * 3;
+	}
+
+	// Shrinking whole tiles usually overshoots, so give the
+	// leftover space back, most important first
+	bool grew = false;
+	for (size_t i = 0; i < sizes.size() && fits; i++)
+	{
+		while (sizes[i] < targets[i] && area + (unsigned long long)sizes[i] * sizes[i] * 3 <= atlasArea)
+		{
+			area += (unsigned long long)sizes[i] * sizes[i] * 3;
+			sizes[i] *= 2;
+			if (!Pack(sorted, sizes, packed))
+			{
+				sizes[i] /= 2;
+				area -= (unsigned long long)sizes[i] * sizes[i] * 3;
+				break;
+			}
+			grew = true;
+		}
+	}
+	if (grew)
+		Pack(sorted, sizes, packed);
+
+	// Anything that moved has to be redrawn before it's used
+	for (ShadowTile& tile : packed)
+	{
+		ShadowRequest request = { tile.LightIndex, tile.Face, 0.0f, false };
+		const ShadowTile* old = findOld(request);
+		tile.Fresh = !old || old->X != tile.X || old->Y != tile.Y || old->Size != tile.Size;
+		tile.Age = old ? old->Age : 0;
+	}
+
+	droppedCount = (unsigned int)(sorted.size() - packed.size());
+	tiles.swap(packed);
+	layoutVersion++;
+}
+
+// --------------------------------------------------------
+// One stb_rect_pack pass over the requests at the given
+// sizes.  True if they all fit - either way, the tiles
+// that did fit end up in packed (in request order).
+// --------------------------------------------------------
+bool ShadowAtlasAllocator::Pack(const std::vector<ShadowRequest>& requests, const std::vector<unsigned int>& sizes, std::vector<ShadowTile>& packed)
+{
+	packed.clear();
+	if (requests.empty())
+		return true;
+
+	// One node per column gives stb the most exact packing
+	std::vector<stbrp_node> nodes(atlasSize);
+	stbrp_context context;
+	stbrp_init_target(&context, (int)atlasSize, (int)atlasSize, &nodes[0], (int)nodes.size());
+
+	std::vector<stbrp_rect> rects(requests.size());
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		rects[i].id = (int)i;
+		rects[i].w = (stbrp_coord)sizes[i];
+		rects[i].h = (stbrp_coord)sizes[i];
+	}
+	bool allPacked = stbrp_pack_rects(&context, &rects[0], (int)rects.size()) != 0;
+
+	// stb hands the rects back in their original order
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		if (!rects[i].was_packed)
+			continue;
+
+		ShadowTile tile = {};
+		tile.LightIndex = requests[i].LightIndex;
+		tile.Face = requests[i].Face;
+		tile.Dynamic = requests[i].Dynamic;
+		tile.X = (unsigned int)rects[i].x;
+		tile.Y = (unsigned int)rects[i].y;
+		tile.Size = sizes[i];
+		tile.Importance = requests[i].Importance;
+		packed.push_back(tile);
+	}
+	return allPacked;
+}
+
+// --------------------------------------------------------
+// Fresh tiles always update, as do the most important light
+// tiles with moving casters.  The budgets go to the other
+// tiles with moving casters, starting after the last served.
+// --------------------------------------------------------
+void ShadowAtlasAllocator::Schedule(unsigned int alwaysUpdate, unsigned int budget, unsigned int faceBudget)
+{
+	std::vector<unsigned int> rest;
+	std::vector<unsigned int> faces;
+	unsigned int lightRank = 0;
+	for (size_t i = 0; i < tiles.size(); i++)
+	{
+		ShadowTile& tile = tiles[i];
+		bool important = tile.Face < 0 && lightRank++ < alwaysUpdate;
+		tile.Update = tile.Fresh || (important && tile.Dynamic);
+		if (tile.Update || !tile.Dynamic)
+			continue;
+
+		if (tile.Face < 0)
+			rest.push_back((unsigned int)i);
+		else
+			faces.push_back((unsigned int)i);
+	}
+
+	RoundRobin(rest, budget, roundRobinTile);
+	RoundRobin(faces, faceBudget, roundRobinFace);
+
+	for (ShadowTile& tile : tiles)
+		tile.Age = tile.Update ? 0 : tile.Age + 1;
+}
+
+// --------------------------------------------------------
+// Updates up to budget of the candidates, in key order,
+// picking up after the last one served
+// --------------------------------------------------------
+void ShadowAtlasAllocator::RoundRobin(const std::vector<unsigned int>& candidates, unsigned int budget, unsigned long long& lastKey)
+{
+	if (candidates.empty() || budget == 0)
+		return;
+
+	std::vector<unsigned int> sorted(candidates);
+	std::sort(sorted.begin(), sorted.end(), [this](unsigned int a, unsigned int b)
+	{
+		return GetTileKey(tiles[a].LightIndex, tiles[a].Face) < GetTileKey(tiles[b].LightIndex, tiles[b].Face);
+	});
+
+	size_t start = 0;
+	while (start < sorted.size() && GetTileKey(tiles[sorted[start]].LightIndex, tiles[sorted[start]].Face) <= lastKey)
+		start++;
+
+	size_t count = std::min((size_t)budget, sorted.size());
+	for (size_t i = 0; i < count; i++)
+	{
+		ShadowTile& tile = tiles[sorted[(start + i) % sorted.size()]];
+		tile.Update = true;
+		lastKey = GetTileKey(tile.LightIndex, tile.Face);
+	}
+}
+
+// --------------------------------------------------------
+// Nearest power of two (in log terms) to importance * max
+// --------------------------------------------------------
+unsigned int ShadowAtlasAllocator::GetTileSize(float importance) const
+{
+	float ideal = importance * maxTileSize;
+	unsigned int size = minTileSize;
+	while (size < maxTileSize && size * 1.41421356f < ideal)
+		size *= 2;
+	return size;
+}
+
+unsigned long long ShadowAtlasAllocator::GetTileKey(unsigned int lightIndex, int face)
+{
+	return (unsigned long long)lightIndex * 8 + (unsigned int)(face + 1);
+}
+
+const std::vector<ShadowTile>& ShadowAtlasAllocator::GetTiles() const
+{
+	return tiles;
+}
+
+unsigned int ShadowAtlasAllocator::GetAtlasSize() const
+{
+	return atlasSize;
+}
+
+unsigned int ShadowAtlasAllocator::GetDroppedCount() const
+{
+	return droppedCount;
+}
+
+unsigned int ShadowAtlasAllocator::GetLayoutVersion() const
+{
+	return layoutVersion;
+}
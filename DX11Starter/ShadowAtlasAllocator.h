@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// A light (or one cube face of a point light) that wants a
+// tile in the shadow atlas
+// --------------------------------------------------------
+struct ShadowRequest
+{
+	unsigned int LightIndex;	// Into the scene's lights
+	int Face;					// Cube face (0 - 5) of a point light, -1 for anything else
+	float Importance;			// 0 - 1, roughly how much of the screen it affects
+	bool Dynamic;				// Has moving casters, so it's worth redrawing regularly
+};
+
+// --------------------------------------------------------
+// Where one light's (or face's) shadow map lives in the atlas
+// --------------------------------------------------------
+struct ShadowTile
+{
+	unsigned int LightIndex;
+	int Face;
+	unsigned int X, Y;			// Top left texel
+	unsigned int Size;			// Tiles are square
+	float Importance;
+	unsigned int Age;			// Frames since it was last scheduled
+	bool Dynamic;
+	bool Fresh;					// Newly placed or moved, so it has to be drawn before use
+	bool Update;				// Scheduled for a redraw this frame
+};
+
+// --------------------------------------------------------
+// Hands out square tiles of one big shadow atlas.
+//
+// Allocate() sizes each light's tile by its importance
+// (powers of two between the min & max tile size) and packs
+// them with stb_rect_pack, shrinking the least important
+// tiles first when they don't all fit.  The layout is kept
+// as long as no light's wanted size changes, so tiles only
+// move (and need redrawing) when something really changed.
+//
+// Schedule() then spreads the redraws out - the most
+// important tiles update every frame, and the rest share a
+// fixed per-frame budget, round robin.  Point light faces
+// never count as "most important" (that would be six tiles
+// a light) and get a budget of their own instead.  Tiles
+// without moving casters only redraw when they're fresh -
+// anything else that changes them changes their cache key.
+//
+// Tiles are told apart by light and face, so one point
+// light can hold up to six of them.
+//
+// No graphics API involved, so all of this can be checked
+// on the CPU alone.
+// --------------------------------------------------------
+class ShadowAtlasAllocator
+{
+public:
+	ShadowAtlasAllocator(unsigned int atlasSize, unsigned int maxTileSize, unsigned int minTileSize);
+	~ShadowAtlasAllocator();
+
+	// Finds a tile for each request (most important first in GetTiles()),
+	// dropping the least important ones if even the smallest tiles won't fit
+	void Allocate(const std::vector<ShadowRequest>& requests);
+
+	// Marks which tiles redraw this frame: every fresh tile, the alwaysUpdate
+	// most important light tiles, and up to budget of the other light tiles
+	// and faceBudget of the cube faces, in light order
+	void Schedule(unsigned int alwaysUpdate, unsigned int budget, unsigned int faceBudget);
+
+	// Power of two tile size for an importance, ignoring what fits
+	unsigned int GetTileSize(float importance) const;
+
+	// Tells tiles apart by light and cube face
+	static unsigned long long GetTileKey(unsigned int lightIndex, int face);
+
+	const std::vector<ShadowTile>& GetTiles() const;
+	unsigned int GetAtlasSize() const;
+	unsigned int GetDroppedCount() const;		// Requests that got no tile
+	unsigned int GetLayoutVersion() const;		// Bumped whenever the tiles are repacked
+
+private:
+	unsigned int atlasSize;
+	unsigned int maxTileSize;
+	unsigned int minTileSize;
+
+	std::vector<ShadowTile> tiles;
+	unsigned int droppedCount;
+	unsigned int layoutVersion;
+	unsigned long long roundRobinTile;	// Last tiles served from each budget
+	unsigned long long roundRobinFace;
+
+	// Last frame's requests & wanted sizes, sorted by key, to
+	// spot when a repack is needed (and for hysteresis)
+	struct Wanted
+	{
+		unsigned long long Key;
+		unsigned int Size;
+	};
+	std::vector<Wanted> wanted;
+
+	void RoundRobin(const std::vector<unsigned int>& candidates, unsigned int budget, unsigned long long& lastKey);
+
+	bool Pack(const std::vector<ShadowRequest>& requests, const std::vector<unsigned int>& sizes, std::vector<ShadowTile>& packed);
+};
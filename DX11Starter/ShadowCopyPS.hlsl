@@ -0,0 +1,16 @@
+struct VertexToPixel
+{
+    float4 position : SV_POSITION;
+    float2 uv : TEXCOORD0;
+};
+
+Texture2D StaticShadows : register(t0);
+
+// --------------------------------------------------------
+// Copies one tile of the cached static shadows into the
+// shadow atlas (both are the same size, so it's 1:1)
+// --------------------------------------------------------
+float main(VertexToPixel input) : SV_DEPTH
+{
+    return StaticShadows.Load(int3(input.position.xy, 0)).r;
+}
@@ -0,0 +1,68 @@
+#ifndef __GGP_SHADOWS__
+#define __GGP_SHADOWS__
+
+// Zero in shader variants built without shadows (see ShaderVariants.h)
+#ifndef SHADOWS
+#define SHADOWS 1
+#endif
+
+// One shadowed light's tile of the atlas (see ShadowAtlas.h).  The
+// matrix comes straight from DirectXMath, so it's row major.
+struct ShadowInfo
+{
+    row_major float4x4 ViewProjection;
+    float4 AtlasRect;   // UV offset (xy) and scale (zw)
+};
+
+Texture2D ShadowAtlas;
+StructuredBuffer<ShadowInfo> ShadowInfos;
+SamplerComparisonState ShadowSampler;
+
+// Which face of a point light's shadow cube a direction falls in:
+// +X, -X, +Y, -Y, +Z, -Z (must match GetCubeFace() in CubeShadowFaces.cpp)
+int GetCubeFace(float3 direction)
+{
+    float3 a = abs(direction);
+    if (a.x >= a.y && a.x >= a.z)
+        return direction.x >= 0.0f ? 0 : 1;
+    if (a.y >= a.z)
+        return direction.y >= 0.0f ? 2 : 3;
+    return direction.z >= 0.0f ? 4 : 5;
+}
+
+// How lit a world position is by a light (1 = fully lit), given
+// the light's ShadowIndex - lights (or cube faces) without a tile
+// are never shadowed
+float ShadowAmount(int shadowIndex, float3 worldPos)
+{
+    if (!SHADOWS || shadowIndex < 0)
+        return 1.0f;
+    
+    ShadowInfo info = ShadowInfos[shadowIndex];
+    if (info.AtlasRect.z <= 0.0f)
+        return 1.0f;
+    
+    float4 lightPos = mul(float4(worldPos, 1.0f), info.ViewProjection);
+    if (lightPos.w <= 0.0f)
+        return 1.0f;
+    
+    // Perspective divide & NDC to UV, skipping anything outside the light's view
+    lightPos /= lightPos.w;
+    float2 uv = lightPos.xy * 0.5f + 0.5f;
+    uv.y = 1 - uv.y;
+    if (any(uv < 0.0f) || any(uv > 1.0f) || lightPos.z > 1.0f)
+        return 1.0f;
+    
+    // Into this light's tile, keeping the filter from reaching the neighbors
+    float2 atlasSize;
+    ShadowAtlas.GetDimensions(atlasSize.x, atlasSize.y);
+    float2 halfTexel = 0.5f / atlasSize;
+    float2 atlasUV = clamp(
+        info.AtlasRect.xy + uv * info.AtlasRect.zw,
+        info.AtlasRect.xy + halfTexel,
+        info.AtlasRect.xy + info.AtlasRect.zw - halfTexel);
+    
+    return ShadowAtlas.SampleCmpLevelZero(ShadowSampler, atlasUV, lightPos.z).r;
+}
+
+#endif
@@ -1,8 +1,12 @@
 #include "SimpleShader.h"
+#include "Profiler.h"
+#include <chrono>
+#include <fstream>
 
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
 bool ISimpleShader::ReportWarnings = false;
+SimpleShaderLoadStats ISimpleShader::LoadStats;
 
 // To enable error reporting, use either or both 
 // of the following lines somewhere in your program, 
@@ -57,17 +61,42 @@ void ISimpleShader::CleanUp()
 		constantBufferCount = 0;
 	}
 
-	for (unsigned int i = 0; i < shaderResourceViews.size(); i++)
-		delete shaderResourceViews[i];
-	
-	for (unsigned int i = 0; i < samplerStates.size(); i++)
-		delete samplerStates[i];
-
 	// Clean up tables
-	varTable.clear();
 	cbTable.clear();
-	samplerTable.clear();
-	textureTable.clear();
+	tables = ShaderReflectionTables();
+}
+
+// --------------------------------------------------------
+// The reflection sidecar on disk (see ShaderReflection.h
+// for the format) - loading reads the whole file at once
+// --------------------------------------------------------
+static bool LoadShaderReflection(const std::wstring& path, unsigned long long hash, ShaderReflectionData& data)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	std::streamoff size = file.tellg();
+	if (size <= 0)
+		return false;
+
+	std::vector<unsigned char> bytes((size_t)size);
+	file.seekg(0);
+	if (!file.read((char*)bytes.data(), size))
+		return false;
+
+	return DeserializeShaderReflection(bytes.data(), bytes.size(), hash, data);
+}
+
+static bool SaveShaderReflection(const std::wstring& path, unsigned long long hash, const ShaderReflectionData& data)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	std::vector<unsigned char> bytes = SerializeShaderReflection(hash, data);
+	file.write((const char*)bytes.data(), bytes.size());
+	return file.good();
 }
 
 // --------------------------------------------------------
@@ -80,6 +109,9 @@ void ISimpleShader::CleanUp()
 // --------------------------------------------------------
 bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 {
+	PROFILE_FUNCTION();
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
 	// Load the shader to a blob and ensure it worked
 	HRESULT hr = D3DReadFileToBlob(shaderFile, shaderBlob.GetAddressOf());
 	if (hr != S_OK)
@@ -109,8 +141,45 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
-	// Set up shader reflection to get information about
-	// this shader and its variables,  buffers, etc.
+	// Reflection - from the sidecar next to the .cso if it was saved
+	// for this exact bytecode, otherwise from D3D (and saved for next time)
+	ShaderReflectionData reflection;
+	unsigned long long hash = HashShaderBytecode(shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize());
+	std::wstring sidecarPath = std::wstring(shaderFile) + L".refl";
+	if (LoadShaderReflection(sidecarPath, hash, reflection))
+	{
+		LoadStats.FromSidecar++;
+	}
+	else
+	{
+		ReflectShader(reflection);
+		if (!SaveShaderReflection(sidecarPath, hash, reflection) && ReportWarnings)
+		{
+			LogWarning("SimpleShader::LoadShaderFile() - Couldn't save reflection sidecar '");
+			LogW(sidecarPath);
+			LogWarning("'.\n");
+		}
+	}
+
+	// Build the lookup tables & the buffers themselves
+	BuildShaderReflectionTables(reflection, tables);
+	CreateConstantBuffers(reflection);
+
+	LoadStats.Loaded++;
+	LoadStats.Milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	// All set
+	return true;
+}
+
+// --------------------------------------------------------
+// Uses D3D's shader reflection to get information about
+// this shader's variables, buffers, textures & samplers
+// --------------------------------------------------------
+void ISimpleShader::ReflectShader(ShaderReflectionData& reflection)
+{
+	PROFILE_FUNCTION();
+
 	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
 	D3DReflect(
 		shaderBlob->GetBufferPointer(),
@@ -122,10 +191,6 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 	D3D11_SHADER_DESC shaderDesc;
 	refl->GetDesc(&shaderDesc);
 
-	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
-	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
-	
 	// Handle bound resources (like shaders and samplers)
 	unsigned int resourceCount = shaderDesc.BoundResources;
 	for (unsigned int r = 0; r < resourceCount; r++)
@@ -135,37 +200,25 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		refl->GetResourceBindingDesc(r, &resourceDesc);
 
 		// Check the type
+		ShaderReflectionResource resource;
+		resource.Name = resourceDesc.Name;
+		resource.BindIndex = resourceDesc.BindPoint;
 		switch (resourceDesc.Type)
 		{
 		case D3D_SIT_STRUCTURED: // Treat structured buffers as texture resources
 		case D3D_SIT_TEXTURE: // A texture resource
-		{
-			// Create the SRV wrapper
-			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
-			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
-
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
-			shaderResourceViews.push_back(srv);
-		}
+			reflection.Textures.push_back(resource);
 			break;
 
 		case D3D_SIT_SAMPLER: // A sampler resource
-		{
-			// Create the sampler wrapper
-			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
-			samp->Index = (unsigned int)samplerStates.size();	// Raw index
-
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
-			samplerStates.push_back(samp);
-		}
+			reflection.Samplers.push_back(resource);
 			break;
 		}
 	}
 
 	// Loop through all constant buffers
-	for (unsigned int b = 0; b < constantBufferCount; b++)
+	reflection.Buffers.resize(shaderDesc.ConstantBuffers);
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
 	{
 		// Get this buffer
 		ID3D11ShaderReflectionConstantBuffer* cb =
@@ -175,62 +228,76 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		D3D11_SHADER_BUFFER_DESC bufferDesc;
 		cb->GetDesc(&bufferDesc);
 
-		// Save the type, which we reference when setting these buffers
-		constantBuffers[b].Type = bufferDesc.Type;
-		
 		// Get the description of the resource binding, so
 		// we know exactly how it's bound in the shader
 		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
 		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
-		
-		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
-		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
 
-		// Create this constant buffer
-		D3D11_BUFFER_DESC newBuffDesc = {};
-		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
-		newBuffDesc.ByteWidth = ((bufferDesc.Size + 15) / 16) * 16; // Quick and dirty 16-byte alignment using integer division
-		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-		newBuffDesc.CPUAccessFlags = 0;
-		newBuffDesc.MiscFlags = 0;
-		newBuffDesc.StructureByteStride = 0;
-		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
-
-		// Set up the data buffer for this constant buffer
-		constantBuffers[b].Size = bufferDesc.Size;
-		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
-		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		ShaderReflectionBuffer& buffer = reflection.Buffers[b];
+		buffer.Name = bufferDesc.Name;
+		buffer.Type = bufferDesc.Type;
+		buffer.Size = bufferDesc.Size;
+		buffer.BindIndex = bindDesc.BindPoint;
 
 		// Loop through all variables in this buffer
+		buffer.Variables.resize(bufferDesc.Variables);
 		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
 		{
 			// Get this variable
 			ID3D11ShaderReflectionVariable* var =
 				cb->GetVariableByIndex(v);
 			
-			// Get the description of the variable and its type
+			// Get the description of the variable
 			D3D11_SHADER_VARIABLE_DESC varDesc;
 			var->GetDesc(&varDesc);
 
-			// Create the variable struct
-			SimpleShaderVariable varStruct = {};
-			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
-			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
-
-			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
-			constantBuffers[b].Variables.push_back(varStruct);
+			buffer.Variables[v].Name = varDesc.Name;
+			buffer.Variables[v].ByteOffset = varDesc.StartOffset;
+			buffer.Variables[v].Size = varDesc.Size;
 		}
 	}
+}
 
-	// All set
-	return true;
+// --------------------------------------------------------
+// Creates each constant buffer and its local copy of the
+// data (needs the tables built first)
+// --------------------------------------------------------
+void ISimpleShader::CreateConstantBuffers(const ShaderReflectionData& reflection)
+{
+	// Create resource arrays
+	constantBufferCount = (unsigned int)reflection.Buffers.size();
+	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
+
+	for (unsigned int b = 0; b < constantBufferCount; b++)
+	{
+		const ShaderReflectionBuffer& buffer = reflection.Buffers[b];
+
+		// Save the type, which we reference when setting these buffers
+		constantBuffers[b].Type = (D3D_CBUFFER_TYPE)buffer.Type;
+		
+		// Set up the buffer and put its pointer in the table
+		constantBuffers[b].BindIndex = buffer.BindIndex;
+		constantBuffers[b].Name = buffer.Name;
+		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(buffer.Name, &constantBuffers[b]));
+
+		// Create this constant buffer
+		D3D11_BUFFER_DESC newBuffDesc = {};
+		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
+		newBuffDesc.ByteWidth = ((buffer.Size + 15) / 16) * 16; // Quick and dirty 16-byte alignment using integer division
+		newBuffDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		newBuffDesc.CPUAccessFlags = 0;
+		newBuffDesc.MiscFlags = 0;
+		newBuffDesc.StructureByteStride = 0;
+		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
+
+		// Set up the data buffer for this constant buffer
+		constantBuffers[b].Size = buffer.Size;
+		constantBuffers[b].LocalDataBuffer = new unsigned char[buffer.Size];
+		ZeroMemory(constantBuffers[b].LocalDataBuffer, buffer.Size);
+
+		// Its variables, in order
+		constantBuffers[b].Variables = tables.BufferVariables[b];
+	}
 }
 
 // --------------------------------------------------------
@@ -244,10 +311,10 @@ SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 {
 	// Look for the key
 	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
-		varTable.find(name);
+		tables.VarTable.find(name);
 
 	// Did we find the key?
-	if (result == varTable.end())
+	if (result == tables.VarTable.end())
 		return 0;
 
 	// Grab the result from the iterator
@@ -342,6 +409,8 @@ void ISimpleShader::SetShader()
 // --------------------------------------------------------
 void ISimpleShader::CopyAllBufferData()
 {
+	PROFILE_FUNCTION();
+
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
@@ -368,6 +437,8 @@ void ISimpleShader::CopyAllBufferData()
 // --------------------------------------------------------
 void ISimpleShader::CopyBufferData(unsigned int index)
 {
+	PROFILE_FUNCTION();
+
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
@@ -455,6 +526,52 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 	return true;
 }
 
+// --------------------------------------------------------
+// Sets an entire constant buffer by name, in one copy
+//
+// bufferName - The name of the constant buffer
+// data - The buffer's new contents, laid out the way HLSL packs it
+// size - The size of the data (this must match the buffer's size)
+//
+// Returns true if data is copied, false if the buffer doesn't
+// exist or is a different size
+// --------------------------------------------------------
+bool ISimpleShader::SetBufferData(std::string bufferName, const void* data, unsigned int size)
+{
+	SimpleConstantBuffer* cb = FindConstantBuffer(bufferName);
+	if (cb == 0 || cb->Size != size)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleShader::SetBufferData() - Constant buffer '");
+			Log(bufferName);
+			LogWarning("' not found or a different size. Ensure the C++ struct matches the buffer in the shader.\n");
+		}
+		return false;
+	}
+
+	memcpy(cb->LocalDataBuffer, data, size);
+	return true;
+}
+
+// --------------------------------------------------------
+// Checks a struct that mirrors a constant buffer, field by
+// field, against what reflection says.  Not behind
+// ReportErrors, since a mismatch is a bug in the C++ side.
+// --------------------------------------------------------
+bool ISimpleShader::CheckBufferLayout(std::string bufferName, unsigned int size, const ShaderBufferField* fields, size_t fieldCount)
+{
+	if (!shaderValid) return false;
+
+	std::string problem = CheckShaderBufferLayout(tables, bufferName, size, fields, fieldCount);
+	if (problem.empty())
+		return true;
+
+	LogError("SimpleShader::CheckBuffer() - " + problem + ". Update ConstantBuffers.h to match the shader.\n");
+	shaderValid = false;
+	return false;
+}
+
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
@@ -579,15 +696,15 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSRV*>::iterator result =
-		textureTable.find(name);
+	std::unordered_map<std::string, unsigned int>::iterator result =
+		tables.TextureTable.find(name);
 
 	// Did we find the key?
-	if (result == textureTable.end())
+	if (result == tables.TextureTable.end())
 		return 0;
 
 	// Success
-	return result->second;
+	return &tables.ShaderResourceViews[result->second];
 }
 
 
@@ -599,10 +716,10 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
 const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 {
 	// Valid index?
-	if (index >= shaderResourceViews.size()) return 0;
+	if (index >= tables.ShaderResourceViews.size()) return 0;
 
 	// Grab the bind index
-	return shaderResourceViews[index];
+	return &tables.ShaderResourceViews[index];
 }
 
 
@@ -614,15 +731,15 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
 {
 	// Look for the key
-	std::unordered_map<std::string, SimpleSampler*>::iterator result =
-		samplerTable.find(name);
+	std::unordered_map<std::string, unsigned int>::iterator result =
+		tables.SamplerTable.find(name);
 
 	// Did we find the key?
-	if (result == samplerTable.end())
+	if (result == tables.SamplerTable.end())
 		return 0;
 
 	// Success
-	return result->second;
+	return &tables.SamplerStates[result->second];
 }
 
 // --------------------------------------------------------
@@ -633,10 +750,10 @@ const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
 const SimpleSampler* ISimpleShader::GetSamplerInfo(unsigned int index)
 {
 	// Valid index?
-	if (index >= samplerStates.size()) return 0;
+	if (index >= tables.SamplerStates.size()) return 0;
 
 	// Grab the bind index
-	return samplerStates[index];
+	return &tables.SamplerStates[index];
 }
 
 
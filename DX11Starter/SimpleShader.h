@@ -11,17 +11,8 @@
 #include <vector>
 #include <string>
 
+#include "ShaderReflection.h"
 
-// --------------------------------------------------------
-// Used by simple shaders to store information about
-// specific variables in constant buffers
-// --------------------------------------------------------
-struct SimpleShaderVariable
-{
-	unsigned int ByteOffset;
-	unsigned int Size;
-	unsigned int ConstantBufferIndex;
-};
 
 // --------------------------------------------------------
 // Contains information about a specific
@@ -40,21 +31,15 @@ struct SimpleConstantBuffer
 };
 
 // --------------------------------------------------------
-// Contains info about a single SRV in a shader
+// Totals for every shader loaded so far - how many had their
+// reflection read back from a sidecar (see ShaderReflection.h)
+// instead of reflected again, and how long loading took
 // --------------------------------------------------------
-struct SimpleSRV
+struct SimpleShaderLoadStats
 {
-	unsigned int Index;		// The raw index of the SRV
-	unsigned int BindIndex; // The register of the SRV
-};
-
-// --------------------------------------------------------
-// Contains info about a single Sampler in a shader
-// --------------------------------------------------------
-struct SimpleSampler
-{
-	unsigned int Index;		// The raw index of the Sampler
-	unsigned int BindIndex; // The register of the Sampler
+	unsigned int Loaded = 0;
+	unsigned int FromSidecar = 0;
+	double Milliseconds = 0.0;
 };
 
 // --------------------------------------------------------
@@ -89,6 +74,26 @@ public:
 	bool SetMatrix4x4(std::string name, const float data[16]);
 	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
 
+	// Sets a whole constant buffer in one copy, from a struct that
+	// mirrors it (see ConstantBuffers.h) - fails if the sizes differ
+	template<typename T>
+	bool SetBuffer(std::string bufferName, const T& data)
+	{
+		static_assert(sizeof(T) % 16 == 0, "Constant buffers are a whole number of 16 byte registers");
+		return SetBufferData(bufferName, &data, sizeof(T));
+	}
+	bool SetBufferData(std::string bufferName, const void* data, unsigned int size);
+
+	// Checks a mirror struct's fields against the reflected buffer
+	// (see ConstantBuffers.h).  A mismatch is always logged, naming
+	// the field, and leaves the shader invalid.
+	template<typename T, size_t N>
+	bool CheckBuffer(std::string bufferName, const ShaderBufferField (&fields)[N])
+	{
+		return CheckBufferLayout(bufferName, sizeof(T), fields, N);
+	}
+	bool CheckBufferLayout(std::string bufferName, unsigned int size, const ShaderBufferField* fields, size_t fieldCount);
+
 	// Setting shader resources
 	virtual bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
 	virtual bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
@@ -103,11 +108,11 @@ public:
 	
 	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
-	size_t GetShaderResourceViewCount() { return textureTable.size(); }
+	size_t GetShaderResourceViewCount() { return tables.ShaderResourceViews.size(); }
 	
 	const SimpleSampler* GetSamplerInfo(std::string name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
-	size_t GetSamplerCount() { return samplerTable.size(); }
+	size_t GetSamplerCount() { return tables.SamplerStates.size(); }
 
 	// Get data about constant buffers
 	unsigned int GetBufferCount();
@@ -122,6 +127,8 @@ public:
 	static bool ReportErrors;
 	static bool ReportWarnings;
 
+	static SimpleShaderLoadStats LoadStats;
+
 protected:
 	
 	bool shaderValid;
@@ -134,15 +141,14 @@ protected:
 	
 	// Maps for variables and buffers
 	SimpleConstantBuffer*		constantBuffers; // For index-based lookup
-	std::vector<SimpleSRV*>		shaderResourceViews;
-	std::vector<SimpleSampler*>	samplerStates;
 	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
-	std::unordered_map<std::string, SimpleShaderVariable> varTable;
-	std::unordered_map<std::string, SimpleSRV*> textureTable;
-	std::unordered_map<std::string, SimpleSampler*> samplerTable;
+	ShaderReflectionTables		tables;			 // Variables, SRVs & samplers
 
-	// Initialization method
+	// Initialization methods - reflection comes from the .cso's
+	// sidecar when it's up to date, or from D3D otherwise
 	bool LoadShaderFile(LPCWSTR shaderFile);
+	void ReflectShader(ShaderReflectionData& reflection);
+	void CreateConstantBuffers(const ShaderReflectionData& reflection);
 
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob) = 0;
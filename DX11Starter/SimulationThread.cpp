@@ -0,0 +1,89 @@
+#include "SimulationThread.h"
+#include "Profiler.h"
+
+SimulationThread::SimulationThread() :
+	pending(false),
+	shutdown(false),
+	deltaTime(0),
+	totalTime(0)
+{
+}
+
+SimulationThread::~SimulationThread()
+{
+	Stop();
+}
+
+void SimulationThread::Start(const std::function<void(float, float)>& update)
+{
+	if (thread.joinable())
+		return;
+
+	this->update = update;
+	pending = false;
+	shutdown = false;
+	thread = std::thread(&SimulationThread::Loop, this);
+}
+
+// --------------------------------------------------------
+// Body of the simulation thread.  Waits until the main
+// thread hands it a frame, runs the update for that frame,
+// then signals that it's done.
+// --------------------------------------------------------
+void SimulationThread::Loop()
+{
+	PROFILE_THREAD("Simulation");
+
+	while (true)
+	{
+		float dt = 0;
+		float tt = 0;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this] { return pending || shutdown; });
+			if (shutdown)
+				return;
+
+			dt = deltaTime;
+			tt = totalTime;
+		}
+
+		update(dt, tt);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending = false;
+		}
+		cv.notify_all();
+	}
+}
+
+void SimulationThread::Kick(float deltaTime, float totalTime)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->deltaTime = deltaTime;
+		this->totalTime = totalTime;
+		pending = true;
+	}
+	cv.notify_all();
+}
+
+void SimulationThread::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	cv.wait(lock, [this] { return !pending; });
+}
+
+void SimulationThread::Stop()
+{
+	if (!thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shutdown = true;
+	}
+	cv.notify_all();
+	thread.join();
+}
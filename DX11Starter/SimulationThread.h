@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// --------------------------------------------------------
+// Runs the simulation one frame at a time on a thread of
+// its own, handed each frame by the main thread:
+//
+//   simulation.Start([this](float dt, float tt) { Update(dt, tt); });
+//   ...
+//   simulation.Kick(deltaTime, totalTime);	// Update() runs there
+//   Draw(deltaTime, totalTime);				// while this draws here
+//   simulation.Wait();						// and then both are done
+//
+// Every Kick() is paired with a Wait(), so the simulation
+// never runs ahead of the main thread, and anything the
+// main thread does outside the pair (UI, etc.) never
+// overlaps it.
+//
+// No graphics API involved, so the hand-off can be checked
+// on the CPU alone.
+// --------------------------------------------------------
+class SimulationThread
+{
+public:
+	SimulationThread();
+	~SimulationThread();
+
+	// Starts the thread, which sleeps until it's handed a frame
+	void Start(const std::function<void(float, float)>& update);
+
+	// Hands a single frame to the thread
+	void Kick(float deltaTime, float totalTime);
+
+	// Blocks until the frame handed off by Kick() has finished
+	void Wait();
+
+	// Shuts down and joins the thread (if running)
+	void Stop();
+
+private:
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::function<void(float, float)> update;
+	bool pending;
+	bool shutdown;
+	float deltaTime;
+	float totalTime;
+
+	void Loop();
+};
@@ -1,5 +1,16 @@
 #include "Sky.h"
-#include "WICTextureLoader.h"
+#include "JobSystem.h"
+#include "MipGeneration.h"
+#include "PathHelpers.h"
+#include "TextureManager.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cwchar>
+
+// Faces are shrunk to this before baking - plenty for the
+// blurry maps image based lighting needs
+static const unsigned int LightingSourceSize = 256;
 
 Sky::Sky(
 	std::shared_ptr<Mesh> mesh,
@@ -42,6 +53,11 @@ Sky::~Sky()
 
 }
 
+std::shared_ptr<Mesh> Sky::GetMesh()
+{
+	return mesh;
+}
+
 
 // --------------------------------------------------------
 // Author: Chris Cascioli
@@ -53,10 +69,11 @@ Sky::~Sky()
 // --------------------------------------------------------
 
 // --------------------------------------------------------
-// Loads six individual textures (the six faces of a cube map), then
-// creates a blank cube map and copies each of the six textures to
-// another face.  Afterwards, creates a shader resource view for
-// the cube map and cleans up all of the temporary resources.
+// Decodes the six faces of the cube map on the CPU, gives
+// them a full mip chain (filtered in linear space, with the
+// edges of each face matched up to its neighbors), then
+// creates the cube map with every mip in place.  Afterwards,
+// creates a shader resource view for the cube map.
 // --------------------------------------------------------
 Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
@@ -67,22 +84,49 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 	const wchar_t* front,
 	const wchar_t* back)
 {
-	// Load the 6 textures into an array.
-	// - We need references to the TEXTURES, not SHADER RESOURCE VIEWS!
-	// - Explicitly NOT generating mipmaps, as we don't need them for the sky!
+	// Decode the 6 images, in parallel
 	// - Order matters here!  +X, -X, +Y, -Y, +Z, -Z
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> textures[6] = {};
-	DirectX::CreateWICTextureFromFile(device.Get(), right, (ID3D11Resource**)textures[0].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(device.Get(), left, (ID3D11Resource**)textures[1].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(device.Get(), up, (ID3D11Resource**)textures[2].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(device.Get(), down, (ID3D11Resource**)textures[3].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(device.Get(), front, (ID3D11Resource**)textures[4].GetAddressOf(), 0);
-	DirectX::CreateWICTextureFromFile(device.Get(), back, (ID3D11Resource**)textures[5].GetAddressOf(), 0);
-
-	// We'll assume all of the textures are the same color format and resolution,
-	// so get the description of the first texture
-	D3D11_TEXTURE2D_DESC faceDesc = {};
-	textures[0]->GetDesc(&faceDesc);
+	const wchar_t* paths[6] = { right, left, up, down, front, back };
+	TextureImage faces[6];
+	bool sRGB[6] = {};
+	bool decoded[6] = {};
+	JobSystem::GetInstance().ParallelFor(6, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; i++)
+			decoded[i] = TextureManager::DecodeFile(paths[i], faces[i], sRGB[i]);
+	});
+
+	// Every face needs to be the same (square) size & color format
+	for (int i = 0; i < 6; i++)
+	{
+		if (!decoded[i] || faces[i].Channels != 4 || faces[i].Width != faces[0].Width || faces[i].Height != faces[0].Width || sRGB[i] != sRGB[0])
+		{
+			printf("Sky face %ls could not be loaded\n", paths[i]);
+			return nullptr;
+		}
+	}
+
+	// Mips - the sky is seen from the inside, so the seams
+	// between faces are right there on screen
+	MipSettings mipSettings;
+	mipSettings.Filter = MIP_FILTER_KAISER;
+	mipSettings.SRGB = true;
+	mipSettings.Wrap = false;
+	std::vector<TextureImage> mips[6];
+	GenerateCubeMips(faces, mipSettings, mips);
+	unsigned int mipLevels = (unsigned int)mips[0].size();
+
+	// One subresource per mip of each face, in the order
+	// D3D11CalcSubresource() numbers them
+	std::vector<D3D11_SUBRESOURCE_DATA> data((size_t)6 * mipLevels);
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		for (unsigned int m = 0; m < mipLevels; m++)
+		{
+			D3D11_SUBRESOURCE_DATA& subresource = data[D3D11CalcSubresource(m, i, mipLevels)];
+			subresource.pSysMem = mips[i][m].Pixels.data();
+			subresource.SysMemPitch = mips[i][m].Width * 4;
+		}
+	}
 
 	// Describe the resource for the cube map, which is simply 
 	// a "texture 2d array" with the TEXTURECUBE flag set.  
@@ -92,45 +136,29 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 	cubeDesc.ArraySize = 6;            // Cube map!
 	cubeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE; // We'll be using as a texture in a shader
 	cubeDesc.CPUAccessFlags = 0;       // No read back
-	cubeDesc.Format = faceDesc.Format; // Match the loaded texture's color format
-	cubeDesc.Width = faceDesc.Width;   // Match the size
-	cubeDesc.Height = faceDesc.Height; // Match the size
-	cubeDesc.MipLevels = 1;            // Only need 1
+	cubeDesc.Format = sRGB[0] ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM; // Same as the tool kit's loader would pick
+	cubeDesc.Width = faces[0].Width;   // Match the size
+	cubeDesc.Height = faces[0].Height; // Match the size
+	cubeDesc.MipLevels = mipLevels;    // Every mip, down to 1x1
 	cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE; // This should be treated as a CUBE, not 6 separate textures
-	cubeDesc.Usage = D3D11_USAGE_DEFAULT; // Standard usage
+	cubeDesc.Usage = D3D11_USAGE_IMMUTABLE; // Never changes after this
 	cubeDesc.SampleDesc.Count = 1;
 	cubeDesc.SampleDesc.Quality = 0;
 
-	// Create the final texture resource to hold the cube map
+	// Create the final texture resource to hold the cube map,
+	// filled in with every face & mip at once
 	Microsoft::WRL::ComPtr<ID3D11Texture2D> cubeMapTexture;
-	device->CreateTexture2D(&cubeDesc, 0, cubeMapTexture.GetAddressOf());
+	device->CreateTexture2D(&cubeDesc, data.data(), cubeMapTexture.GetAddressOf());
 
-	// Loop through the individual face textures and copy them,
-	// one at a time, to the cube map texure
-	for (int i = 0; i < 6; i++)
-	{
-		// Calculate the subresource position to copy into
-		unsigned int subresource = D3D11CalcSubresource(
-			0,  // Which mip (zero, since there's only one)
-			i,  // Which array element?
-			1); // How many mip levels are in the texture?
-
-		// Copy from one resource (texture) to another
-		context->CopySubresourceRegion(
-			cubeMapTexture.Get(),  // Destination resource
-			subresource,           // Dest subresource index (one of the array elements)
-			0, 0, 0,               // XYZ location of copy
-			textures[i].Get(),     // Source resource
-			0,                     // Source subresource index (we're assuming there's only one)
-			0);                    // Source subresource "box" of data to copy (zero means the whole thing)
-	}
+	// Keep a CPU copy of the faces for baking lighting
+	ReadLightingSource(faces);
+	ProjectAmbient();
 
-	// At this point, all of the faces have been copied into the 
-	// cube map texture, so we can describe a shader resource view for it
+	// Describe a shader resource view for the cube map
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.Format = cubeDesc.Format;         // Same format as texture
 	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE; // Treat this as a cube!
-	srvDesc.TextureCube.MipLevels = 1;        // Only need access to 1 mip
+	srvDesc.TextureCube.MipLevels = mipLevels; // Every mip
 	srvDesc.TextureCube.MostDetailedMip = 0;  // Index of the first mip we want to see
 
 	// Make the SRV
@@ -142,6 +170,11 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Sky::CreateCubemap(
 }
 
 void Sky::Draw(std::shared_ptr<Camera> camera)
+{
+	Draw(camera->GetViewMatrix(), camera->GetProjectionMatrix());
+}
+
+void Sky::Draw(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection)
 {
 	// Set up states
 	context->RSSetState(rasterizer.Get());
@@ -152,8 +185,8 @@ void Sky::Draw(std::shared_ptr<Camera> camera)
 	ps->SetShader();
 
 	// Set data for vertex shader
-	vs->SetMatrix4x4("view", camera->GetViewMatrix());
-	vs->SetMatrix4x4("projection", camera->GetProjectionMatrix());
+	vs->SetMatrix4x4("view", view);
+	vs->SetMatrix4x4("projection", projection);
 
 	// Set data for pixel shader
 	ps->SetShaderResourceView("CubeMap", cubeMap);
@@ -169,4 +202,188 @@ void Sky::Draw(std::shared_ptr<Camera> camera)
 	// Reset states
 	context->RSSetState(nullptr);
 	context->OMSetDepthStencilState(nullptr, 0);
-}
\ No newline at end of file
+}
+
+// --------------------------------------------------------
+// Box filters each face down to LightingSourceSize,
+// converting to linear as it goes (the shaders treat
+// texture colors as gamma 2.2)
+// --------------------------------------------------------
+void Sky::ReadLightingSource(const TextureImage faces[6])
+{
+	float toLinear[256];
+	for (int i = 0; i < 256; i++)
+		toLinear[i] = powf(i / 255.0f, 2.2f);
+
+	unsigned int width = faces[0].Width;
+	unsigned int size = width < LightingSourceSize ? width : LightingSourceSize;
+	unsigned int step = width / size;
+	float scale = 1.0f / (step * step);
+
+	lightingSource.Size = size;
+	for (int f = 0; f < 6; f++)
+	{
+		lightingSource.Faces[f].assign((size_t)size * size * 4, 0.0f);
+		for (unsigned int y = 0; y < size * step; y++)
+		{
+			const unsigned char* row = &faces[f].Pixels[(size_t)y * width * 4];
+			float* out = &lightingSource.Faces[f][(size_t)(y / step) * size * 4];
+			for (unsigned int x = 0; x < size * step; x++)
+			{
+				const unsigned char* texel = row + x * 4;
+				float* sum = out + (x / step) * 4;
+				sum[0] += toLinear[texel[0]] * scale;
+				sum[1] += toLinear[texel[1]] * scale;
+				sum[2] += toLinear[texel[2]] * scale;
+				sum[3] += texel[3] / 255.0f * scale;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Bakes the lighting maps, or loads them from a file named
+// by the hash of the source & settings next to the .exe
+// --------------------------------------------------------
+void Sky::BakeLighting(const IBLBakeSettings& settings, bool useCache)
+{
+	unsigned long long hash = HashIBLSource(lightingSource, settings);
+	wchar_t fileName[64];
+	swprintf(fileName, 64, L"SkyLighting_%016llx.ibl", hash);
+	std::wstring path = FixPath(fileName);
+
+	if (!useCache || !LoadIBLCache(path, hash, settings, lighting))
+	{
+		BakeIBL(lightingSource, settings, lighting);
+		if (!SaveIBLCache(path, lighting))
+			printf("Couldn't save sky lighting to %ls\n", path.c_str());
+	}
+
+	CreateLightingTextures();
+}
+
+// --------------------------------------------------------
+// Immutable float textures for the baked maps - the specular
+// cube's mips are its roughness levels
+// --------------------------------------------------------
+void Sky::CreateLightingTextures()
+{
+	unsigned int mipCount = (unsigned int)lighting.Specular.size();
+	std::vector<D3D11_SUBRESOURCE_DATA> data(6 * mipCount);
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (unsigned int mip = 0; mip < mipCount; mip++)
+		{
+			// Subresources go mip by mip within each face
+			D3D11_SUBRESOURCE_DATA& subresource = data[face * mipCount + mip];
+			subresource.pSysMem = lighting.Specular[mip].Faces[face].data();
+			subresource.SysMemPitch = lighting.Specular[mip].Size * sizeof(float) * 4;
+		}
+	}
+
+	D3D11_TEXTURE2D_DESC cubeDesc = {};
+	cubeDesc.Width = lighting.Specular[0].Size;
+	cubeDesc.Height = lighting.Specular[0].Size;
+	cubeDesc.MipLevels = mipCount;
+	cubeDesc.ArraySize = 6;
+	cubeDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	cubeDesc.SampleDesc.Count = 1;
+	cubeDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	cubeDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	cubeDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> specularTexture;
+	device->CreateTexture2D(&cubeDesc, &data[0], specularTexture.GetAddressOf());
+	specularIBL.Reset();
+	device->CreateShaderResourceView(specularTexture.Get(), 0, specularIBL.GetAddressOf());
+
+	// Irradiance - same again with a single mip
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		data[face].pSysMem = lighting.Irradiance.Faces[face].data();
+		data[face].SysMemPitch = lighting.Irradiance.Size * sizeof(float) * 4;
+	}
+	cubeDesc.Width = lighting.Irradiance.Size;
+	cubeDesc.Height = lighting.Irradiance.Size;
+	cubeDesc.MipLevels = 1;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> irradianceTexture;
+	device->CreateTexture2D(&cubeDesc, &data[0], irradianceTexture.GetAddressOf());
+	irradianceIBL.Reset();
+	device->CreateShaderResourceView(irradianceTexture.Get(), 0, irradianceIBL.GetAddressOf());
+
+	// Look up table
+	D3D11_TEXTURE2D_DESC lookUpDesc = {};
+	lookUpDesc.Width = lighting.LookUpSize;
+	lookUpDesc.Height = lighting.LookUpSize;
+	lookUpDesc.MipLevels = 1;
+	lookUpDesc.ArraySize = 1;
+	lookUpDesc.Format = DXGI_FORMAT_R32G32_FLOAT;
+	lookUpDesc.SampleDesc.Count = 1;
+	lookUpDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	lookUpDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA lookUpData = {};
+	lookUpData.pSysMem = lighting.LookUp.data();
+	lookUpData.SysMemPitch = lighting.LookUpSize * sizeof(float) * 2;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> lookUpTexture;
+	device->CreateTexture2D(&lookUpDesc, &lookUpData, lookUpTexture.GetAddressOf());
+	lookUpIBL.Reset();
+	device->CreateShaderResourceView(lookUpTexture.Get(), 0, lookUpIBL.GetAddressOf());
+
+	// Trilinear & clamped, so the specular mips blend
+	if (!lightingSampler)
+	{
+		D3D11_SAMPLER_DESC samplerDesc = {};
+		samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+		samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+		samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+		samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+		samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+		device->CreateSamplerState(&samplerDesc, lightingSampler.GetAddressOf());
+	}
+}
+
+void Sky::SetLightingShaderData(std::shared_ptr<SimplePixelShader> shader, float intensity)
+{
+	shader->SetFloat("iblIntensity", intensity);
+	shader->SetFloat("iblSpecularMipCount", (float)lighting.Specular.size());
+	shader->SetShaderResourceView("IBLSpecular", specularIBL);
+	shader->SetShaderResourceView("IBLIrradiance", irradianceIBL);
+	shader->SetShaderResourceView("IBLLookUp", lookUpIBL);
+	shader->SetSamplerState("IBLSampler", lightingSampler);
+}
+
+void Sky::ProjectAmbient()
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	ProjectCubeToSH(lightingSource, ambient);
+	ambientMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+AmbientSH Sky::GetAmbient(float intensity) const
+{
+	AmbientSH scaled = {};
+	for (int i = 0; i < 9; i++)
+	{
+		DirectX::XMStoreFloat4(&scaled.Coefficients[i],
+			DirectX::XMVectorScale(DirectX::XMLoadFloat4(&ambient.Coefficients[i]), intensity));
+	}
+	return scaled;
+}
+
+double Sky::GetAmbientMs() const
+{
+	return ambientMs;
+}
+
+const IBLBakeResult& Sky::GetLighting() const
+{
+	return lighting;
+}
+
+const CubeImage& Sky::GetLightingSource() const
+{
+	return lightingSource;
+}
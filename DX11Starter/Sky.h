@@ -5,6 +5,9 @@
 #include <memory>
 #include "Mesh.h"
 #include "Camera.h"
+#include "IBLBaker.h"
+#include "SphericalHarmonics.h"
+#include "TextureCompression.h"
 
 class Sky {
 
@@ -26,6 +29,23 @@ public:
 	~Sky();
 
 	void Draw(std::shared_ptr<Camera> camera);
+	void Draw(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
+
+	std::shared_ptr<Mesh> GetMesh();
+
+	// Image based lighting from this sky (see IBLBaker.h) - baked on
+	// the CPU, or loaded from the cache if it's been baked before
+	void BakeLighting(const IBLBakeSettings& settings, bool useCache);
+	void SetLightingShaderData(std::shared_ptr<SimplePixelShader> shader, float intensity);
+	const IBLBakeResult& GetLighting() const;
+	const CubeImage& GetLightingSource() const;
+
+	// The cheaper option - the sky's irradiance as L2 spherical
+	// harmonics, reprojected in a few milliseconds whenever the
+	// sky changes.  Zero intensity gives all zeros (no ambient).
+	void ProjectAmbient();
+	AmbientSH GetAmbient(float intensity) const;
+	double GetAmbientMs() const;
 
 private: 
 
@@ -42,6 +62,21 @@ private:
 	std::shared_ptr<SimplePixelShader> ps;
 	std::shared_ptr<SimpleVertexShader> vs;
 
+	// The faces again, shrunk & in linear space, to bake from
+	CubeImage lightingSource;
+	void ReadLightingSource(const TextureImage faces[6]);
+
+	// Baked maps
+	IBLBakeResult lighting;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> specularIBL;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> irradianceIBL;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> lookUpIBL;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> lightingSampler;
+	void CreateLightingTextures();
+
+	AmbientSH ambient;
+	double ambientMs;
+
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateCubemap(
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
 		const wchar_t* right,
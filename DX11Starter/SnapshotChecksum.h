@@ -0,0 +1,35 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "Lights.h"
+
+// --------------------------------------------------------
+// FNV-1a hash of a frame's simulated state (not its timing),
+// so a threaded run can be compared against a serial one.
+// Kept apart from SceneSnapshot, which needs D3D, so the
+// comparison can be tested on the CPU.
+// --------------------------------------------------------
+inline unsigned int ChecksumSimulatedState(
+	const std::vector<DirectX::XMFLOAT4X4>& worldMatrices,
+	const std::vector<Light>& lights,
+	const DirectX::XMFLOAT4X4& cameraView)
+{
+	unsigned int hash = 2166136261u;
+	auto mix = [&hash](const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 16777619u;
+		}
+	};
+
+	if (!worldMatrices.empty())
+		mix(&worldMatrices[0], sizeof(DirectX::XMFLOAT4X4) * worldMatrices.size());
+	if (!lights.empty())
+		mix(&lights[0], sizeof(Light) * lights.size());
+	mix(&cameraView, sizeof(cameraView));
+	return hash;
+}
@@ -0,0 +1,340 @@
+#include "SphericalHarmonics.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <xmmintrin.h>
+
+using namespace DirectX;
+
+static const float Pi = 3.14159265359f;
+
+// Each face's center direction, and the directions its s & t
+// (texture u & v, remapped to -1 to 1) run along - D3D's layout,
+// like GetTexelDirection() in IBLBaker.cpp
+static const float FaceAxes[6][3][3] =
+{
+	{ { 1, 0, 0 }, { 0, 0, -1 }, { 0, -1, 0 } },
+	{ { -1, 0, 0 }, { 0, 0, 1 }, { 0, -1, 0 } },
+	{ { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+	{ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, -1 } },
+	{ { 0, 0, 1 }, { 1, 0, 0 }, { 0, -1, 0 } },
+	{ { 0, 0, -1 }, { -1, 0, 0 }, { 0, -1, 0 } },
+};
+
+// --------------------------------------------------------
+// The 9 real SH basis functions for a unit direction
+// --------------------------------------------------------
+template<typename T>
+static void GetSHBasis(T x, T y, T z, T basis[9])
+{
+	basis[0] = (T)0.282095;
+	basis[1] = (T)0.488603 * y;
+	basis[2] = (T)0.488603 * z;
+	basis[3] = (T)0.488603 * x;
+	basis[4] = (T)1.092548 * x * y;
+	basis[5] = (T)1.092548 * y * z;
+	basis[6] = (T)0.315392 * (3 * z * z - 1);
+	basis[7] = (T)1.092548 * x * z;
+	basis[8] = (T)0.546274 * (x * x - y * y);
+}
+
+// Convolving with a cosine lobe scales each band by pi, 2pi/3 and
+// pi/4 - then divided by pi, to match the direct lighting (which
+// leaves the 1/pi out of its diffuse)
+static const float BandScale[9] = { 1.0f, 2.0f / 3, 2.0f / 3, 2.0f / 3, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+
+// --------------------------------------------------------
+// One face's share of the projection: 9 x RGB weighted sums
+// and the total solid angle.  Texels go four at a time - a
+// 4x4 transpose turns their RGBA into R, G & B vectors.
+// --------------------------------------------------------
+static void ProjectFace(const CubeImage& cube, unsigned int face, float sums[9][3], float& totalWeight)
+{
+	unsigned int size = cube.Size;
+	const float (*axes)[3] = FaceAxes[face];
+	const float* pixels = &cube.Faces[face][0];
+	float texelArea = (2.0f / size) * (2.0f / size);
+
+	__m128 total[9][3];
+	for (int k = 0; k < 9; k++)
+		for (int c = 0; c < 3; c++)
+			total[k][c] = _mm_setzero_ps();
+	__m128 weightTotal = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 three = _mm_set1_ps(3.0f);
+	__m128 area = _mm_set1_ps(texelArea);
+	__m128 sStep = _mm_set1_ps(4 * 2.0f / size);
+
+	unsigned int vectorWidth = size / 4 * 4;
+	for (unsigned int y = 0; y < size; y++)
+	{
+		float t = (y + 0.5f) * 2 / size - 1;
+		__m128 tt = _mm_set1_ps(t);
+		__m128 s = _mm_setr_ps(
+			0.5f * 2 / size - 1,
+			1.5f * 2 / size - 1,
+			2.5f * 2 / size - 1,
+			3.5f * 2 / size - 1);
+
+		for (unsigned int x = 0; x < vectorWidth; x += 4)
+		{
+			// Unit directions & solid angles: (1 + s^2 + t^2)^(-3/2)
+			__m128 lengthSquared = _mm_add_ps(one, _mm_add_ps(_mm_mul_ps(s, s), _mm_mul_ps(tt, tt)));
+			__m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+			__m128 weight = _mm_mul_ps(_mm_mul_ps(inverseLength, _mm_mul_ps(inverseLength, inverseLength)), area);
+			__m128 d[3];
+			for (int i = 0; i < 3; i++)
+			{
+				__m128 axis = _mm_add_ps(_mm_set1_ps(axes[0][i]), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(axes[1][i]), s), _mm_mul_ps(_mm_set1_ps(axes[2][i]), tt)));
+				d[i] = _mm_mul_ps(axis, inverseLength);
+			}
+
+			__m128 basis[9];
+			basis[0] = _mm_set1_ps(0.282095f);
+			basis[1] = _mm_mul_ps(_mm_set1_ps(0.488603f), d[1]);
+			basis[2] = _mm_mul_ps(_mm_set1_ps(0.488603f), d[2]);
+			basis[3] = _mm_mul_ps(_mm_set1_ps(0.488603f), d[0]);
+			basis[4] = _mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(d[0], d[1]));
+			basis[5] = _mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(d[1], d[2]));
+			basis[6] = _mm_mul_ps(_mm_set1_ps(0.315392f), _mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(d[2], d[2])), one));
+			basis[7] = _mm_mul_ps(_mm_set1_ps(1.092548f), _mm_mul_ps(d[0], d[2]));
+			basis[8] = _mm_mul_ps(_mm_set1_ps(0.546274f), _mm_sub_ps(_mm_mul_ps(d[0], d[0]), _mm_mul_ps(d[1], d[1])));
+
+			// RGBA x 4 -> R, G, B, A
+			const float* texel = pixels + ((size_t)y * size + x) * 4;
+			__m128 r = _mm_loadu_ps(texel);
+			__m128 g = _mm_loadu_ps(texel + 4);
+			__m128 b = _mm_loadu_ps(texel + 8);
+			__m128 a = _mm_loadu_ps(texel + 12);
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+			__m128 color[3] = { _mm_mul_ps(r, weight), _mm_mul_ps(g, weight), _mm_mul_ps(b, weight) };
+
+			for (int k = 0; k < 9; k++)
+				for (int c = 0; c < 3; c++)
+					total[k][c] = _mm_add_ps(total[k][c], _mm_mul_ps(basis[k], color[c]));
+			weightTotal = _mm_add_ps(weightTotal, weight);
+			s = _mm_add_ps(s, sStep);
+		}
+	}
+
+	// Horizontal sums
+	float lanes[4];
+	for (int k = 0; k < 9; k++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			_mm_storeu_ps(lanes, total[k][c]);
+			sums[k][c] = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		}
+	}
+	_mm_storeu_ps(lanes, weightTotal);
+	totalWeight = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+	// Leftover texels (faces that aren't a multiple of 4 wide)
+	for (unsigned int y = 0; y < size; y++)
+	{
+		for (unsigned int x = vectorWidth; x < size; x++)
+		{
+			float s = (x + 0.5f) * 2 / size - 1;
+			float t = (y + 0.5f) * 2 / size - 1;
+			float inverseLength = 1.0f / sqrtf(1 + s * s + t * t);
+			float weight = inverseLength * inverseLength * inverseLength * texelArea;
+			float d[3];
+			for (int i = 0; i < 3; i++)
+				d[i] = (axes[0][i] + axes[1][i] * s + axes[2][i] * t) * inverseLength;
+
+			float basis[9];
+			GetSHBasis(d[0], d[1], d[2], basis);
+			const float* texel = pixels + ((size_t)y * size + x) * 4;
+			for (int k = 0; k < 9; k++)
+				for (int c = 0; c < 3; c++)
+					sums[k][c] += basis[k] * texel[c] * weight;
+			totalWeight += weight;
+		}
+	}
+}
+
+void ProjectCubeToSH(const CubeImage& cube, AmbientSH& result)
+{
+	PROFILE_FUNCTION();
+
+	float sums[6][9][3];
+	float weights[6];
+	JobSystem::GetInstance().ParallelFor(6, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int face = begin; face < end; face++)
+			ProjectFace(cube, face, sums[face], weights[face]);
+	});
+
+	// The solid angles only approximately add up to 4pi, so
+	// normalize by their actual total
+	float totalWeight = 0.0f;
+	for (int f = 0; f < 6; f++)
+		totalWeight += weights[f];
+	float normalize = totalWeight > 0.0f ? 4 * Pi / totalWeight : 0.0f;
+
+	for (int k = 0; k < 9; k++)
+	{
+		float rgb[3] = {};
+		for (int f = 0; f < 6; f++)
+			for (int c = 0; c < 3; c++)
+				rgb[c] += sums[f][k][c];
+
+		float scale = normalize * BandScale[k];
+		result.Coefficients[k] = XMFLOAT4(rgb[0] * scale, rgb[1] * scale, rgb[2] * scale, 0.0f);
+	}
+}
+
+XMFLOAT3 EvaluateSH(const AmbientSH& sh, const XMFLOAT3& normal)
+{
+	float basis[9];
+	GetSHBasis(normal.x, normal.y, normal.z, basis);
+
+	XMFLOAT3 result(0, 0, 0);
+	for (int k = 0; k < 9; k++)
+	{
+		result.x += sh.Coefficients[k].x * basis[k];
+		result.y += sh.Coefficients[k].y * basis[k];
+		result.z += sh.Coefficients[k].z * basis[k];
+	}
+	return result;
+}
+
+// --------------------------------------------------------
+// Brute force versions: the projection one texel at a time
+// in double precision, and the cosine weighted average light
+// around a normal summed over every texel of the cube
+// --------------------------------------------------------
+static void ProjectSlowly(const CubeImage& cube, double coefficients[9][3], double& totalWeight)
+{
+	unsigned int size = cube.Size;
+	totalWeight = 0.0;
+	for (int k = 0; k < 9; k++)
+		for (int c = 0; c < 3; c++)
+			coefficients[k][c] = 0.0;
+
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		const float (*axes)[3] = FaceAxes[face];
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				double s = (x + 0.5) * 2 / size - 1;
+				double t = (y + 0.5) * 2 / size - 1;
+				double inverseLength = 1.0 / sqrt(1 + s * s + t * t);
+				double weight = inverseLength * inverseLength * inverseLength * (2.0 / size) * (2.0 / size);
+				double d[3];
+				for (int i = 0; i < 3; i++)
+					d[i] = (axes[0][i] + axes[1][i] * s + axes[2][i] * t) * inverseLength;
+
+				double basis[9];
+				GetSHBasis(d[0], d[1], d[2], basis);
+				const float* texel = &cube.Faces[face][((size_t)y * size + x) * 4];
+				for (int k = 0; k < 9; k++)
+					for (int c = 0; c < 3; c++)
+						coefficients[k][c] += basis[k] * texel[c] * weight;
+				totalWeight += weight;
+			}
+		}
+	}
+
+	for (int k = 0; k < 9; k++)
+		for (int c = 0; c < 3; c++)
+			coefficients[k][c] *= 4 * Pi / totalWeight * BandScale[k];
+}
+
+static XMFLOAT3 IntegrateSlowly(const CubeImage& cube, const XMFLOAT3& normal)
+{
+	unsigned int size = cube.Size;
+	double total[3] = {};
+	double totalWeight = 0.0;
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		const float (*axes)[3] = FaceAxes[face];
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				double s = (x + 0.5) * 2 / size - 1;
+				double t = (y + 0.5) * 2 / size - 1;
+				double inverseLength = 1.0 / sqrt(1 + s * s + t * t);
+				double weight = inverseLength * inverseLength * inverseLength;
+				totalWeight += weight;
+
+				double cosine = 0.0;
+				double n[3] = { normal.x, normal.y, normal.z };
+				for (int i = 0; i < 3; i++)
+					cosine += n[i] * (axes[0][i] + axes[1][i] * s + axes[2][i] * t) * inverseLength;
+				if (cosine <= 0.0)
+					continue;
+
+				const float* texel = &cube.Faces[face][((size_t)y * size + x) * 4];
+				for (int c = 0; c < 3; c++)
+					total[c] += texel[c] * cosine * weight;
+			}
+		}
+	}
+
+	// Integral over the sphere (4pi / totalWeight per unit of weight), over pi
+	double scale = 4.0 / totalWeight;
+	return XMFLOAT3((float)(total[0] * scale), (float)(total[1] * scale), (float)(total[2] * scale));
+}
+
+SHReferenceResults RunSHReferenceCheck(const CubeImage& cube)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	SHReferenceResults results = {};
+
+	Clock::time_point start = Clock::now();
+	AmbientSH sh;
+	ProjectCubeToSH(cube, sh);
+	Clock::time_point projectEnd = Clock::now();
+
+	// Coefficients, against double precision
+	double slow[9][3];
+	double totalWeight;
+	ProjectSlowly(cube, slow, totalWeight);
+	double largest = 1e-6;
+	for (int k = 0; k < 9; k++)
+		for (int c = 0; c < 3; c++)
+			largest = std::max(largest, fabs(slow[k][c]));
+	for (int k = 0; k < 9; k++)
+	{
+		float fast[3] = { sh.Coefficients[k].x, sh.Coefficients[k].y, sh.Coefficients[k].z };
+		for (int c = 0; c < 3; c++)
+			results.CoefficientError = std::max(results.CoefficientError, (float)(fabs(fast[c] - slow[k][c]) / largest));
+	}
+
+	// Irradiance over a spiral of normals covering the sphere - L2
+	// can't capture sharp detail, so this is a few percent at best
+	Clock::time_point bruteForceStart = Clock::now();
+	results.NormalCount = 32;
+	std::vector<XMFLOAT3> expected(results.NormalCount);
+	std::vector<XMFLOAT3> normals(results.NormalCount);
+	float average = 0.0f;
+	for (unsigned int i = 0; i < results.NormalCount; i++)
+	{
+		float z = 1 - (i + 0.5f) * 2 / results.NormalCount;
+		float r = sqrtf(std::max(0.0f, 1 - z * z));
+		float phi = i * 2.39996323f;
+		normals[i] = XMFLOAT3(r * cosf(phi), r * sinf(phi), z);
+		expected[i] = IntegrateSlowly(cube, normals[i]);
+		average += (expected[i].x + expected[i].y + expected[i].z) / (3.0f * results.NormalCount);
+	}
+	Clock::time_point bruteForceEnd = Clock::now();
+
+	for (unsigned int i = 0; i < results.NormalCount; i++)
+	{
+		XMFLOAT3 approximate = EvaluateSH(sh, normals[i]);
+		float difference = std::max(fabsf(approximate.x - expected[i].x),
+			std::max(fabsf(approximate.y - expected[i].y), fabsf(approximate.z - expected[i].z)));
+		results.IrradianceError = std::max(results.IrradianceError, difference / std::max(average, 1e-6f));
+	}
+
+	results.ProjectMs = std::chrono::duration<double, std::milli>(projectEnd - start).count();
+	results.BruteForceMs = std::chrono::duration<double, std::milli>(bruteForceEnd - bruteForceStart).count();
+	return results;
+}
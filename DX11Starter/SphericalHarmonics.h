@@ -0,0 +1,43 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include "IBLBaker.h"
+
+// --------------------------------------------------------
+// Irradiance as 9 RGB L2 spherical harmonic coefficients,
+// with the cosine lobe (and the divide by pi) already folded
+// in - EvaluateSH() in ShaderIncludes.hlsli turns a normal
+// straight into the average light around it.  Each is a
+// float4 so the array matches HLSL's cbuffer packing.
+// --------------------------------------------------------
+struct AmbientSH
+{
+	DirectX::XMFLOAT4 Coefficients[9];	// RGB in xyz, w unused
+};
+
+// --------------------------------------------------------
+// Results of RunSHReferenceCheck()
+// --------------------------------------------------------
+struct SHReferenceResults
+{
+	double ProjectMs;
+	double BruteForceMs;
+	unsigned int NormalCount;
+	float CoefficientError;		// Largest difference from a plain double precision projection
+	float IrradianceError;		// Largest difference from integrating the cube directly, relative to the average
+};
+
+// --------------------------------------------------------
+// Projects a cube onto L2 spherical harmonics.  Each face is
+// its own job, and walks its texels four at a time with SSE
+// (weighting each by the solid angle it covers).
+// --------------------------------------------------------
+void ProjectCubeToSH(const CubeImage& cube, AmbientSH& result);
+
+// Same math as EvaluateSH() in the shaders
+DirectX::XMFLOAT3 EvaluateSH(const AmbientSH& sh, const DirectX::XMFLOAT3& normal);
+
+// Times the projection, and checks it (and what it gives for
+// a spread of normals) against brute force integration
+SHReferenceResults RunSHReferenceCheck(const CubeImage& cube);
@@ -0,0 +1,285 @@
+#include "StressScene.h"
+#include "JobSystem.h"
+#include <fstream>
+#include <random>
+#include <cmath>
+
+using namespace DirectX;
+
+// Entity counts visited by a sweep
+static const unsigned int SweepCounts[] = {
+	1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000 };
+static const unsigned int SweepCountTotal = sizeof(SweepCounts) / sizeof(SweepCounts[0]);
+
+StressScene::StressScene() :
+	firstEntity(0),
+	firstLight(0),
+	entityCount(0),
+	lightCount(0),
+	framesSinceGenerate(0),
+	sweeping(false),
+	sweepStepStarted(false),
+	sweepStep(0)
+{
+}
+
+StressScene::~StressScene()
+{
+}
+
+// --------------------------------------------------------
+// Replaces any previously generated entities & lights with
+// a new set.  Everything is seeded, so the same settings
+// always give the same scene.
+// --------------------------------------------------------
+void StressScene::Generate(
+	const StressSceneSettings& settings,
+	const std::vector<std::shared_ptr<Mesh>>& meshes,
+	const std::vector<std::shared_ptr<Material>>& materials,
+	std::vector<std::shared_ptr<GameEntity>>& entities,
+	std::vector<Light>& lights)
+{
+	Clear(entities, lights);
+	this->settings = settings;
+	firstEntity = entities.size();
+	firstLight = lights.size();
+	framesSinceGenerate = 0;
+
+	if (meshes.empty() || materials.empty())
+		return;
+
+	std::mt19937 rng(settings.Seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::uniform_real_distribution<float> signedUnit(-1.0f, 1.0f);
+
+	// Cluster centers (only used by the clusters distribution)
+	std::vector<XMFLOAT3> clusters(16);
+	for (auto& c : clusters)
+		c = XMFLOAT3(signedUnit(rng) * settings.Extent, 0.0f, signedUnit(rng) * settings.Extent);
+
+	unsigned int count = settings.EntityCount > 0 ? (unsigned int)settings.EntityCount : 0;
+	unsigned int gridSide = (unsigned int)ceilf(sqrtf((float)count));
+	float spacing = gridSide > 1 ? settings.Extent * 2.0f / (gridSide - 1) : 0.0f;
+
+	entities.reserve(firstEntity + count);
+	motion.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMFLOAT3 pos;
+		switch (settings.Distribution)
+		{
+		case STRESS_DISTRIBUTION_GRID:
+			pos = XMFLOAT3(
+				-settings.Extent + (i % gridSide) * spacing,
+				0.0f,
+				-settings.Extent + (i / gridSide) * spacing);
+			break;
+
+		case STRESS_DISTRIBUTION_CLUSTERS:
+		{
+			const XMFLOAT3& c = clusters[i % clusters.size()];
+			float radius = settings.Extent * 0.15f * sqrtf(unit(rng));
+			float angle = unit(rng) * XM_2PI;
+			pos = XMFLOAT3(c.x + cosf(angle) * radius, signedUnit(rng) * 2.0f, c.z + sinf(angle) * radius);
+			break;
+		}
+
+		default:
+			pos = XMFLOAT3(signedUnit(rng) * settings.Extent, signedUnit(rng) * 2.0f, signedUnit(rng) * settings.Extent);
+			break;
+		}
+
+		std::shared_ptr<GameEntity> entity = std::make_shared<GameEntity>(
+			meshes[rng() % meshes.size()],
+			materials[rng() % materials.size()]);
+		entity->GetTransform()->SetPosition(pos);
+		entity->GetTransform()->SetScale(0.3f, 0.3f, 0.3f);
+		entity->SetDynamic(settings.Motion != STRESS_MOTION_STATIC);
+		entities.push_back(entity);
+
+		motion[i].Origin = pos;
+		motion[i].Phase = unit(rng) * XM_2PI;
+		motion[i].Speed = 0.5f + unit(rng);
+	}
+	entityCount = count;
+
+	// Point lights scattered over the same area
+	lightCount = settings.PointLightCount > 0 ? (unsigned int)settings.PointLightCount : 0;
+	for (unsigned int i = 0; i < lightCount; i++)
+	{
+		Light light = {};
+		light.Type = LIGHT_TYPE_POINT;
+		light.Position = XMFLOAT3(signedUnit(rng) * settings.Extent, 1.0f + unit(rng) * 2.0f, signedUnit(rng) * settings.Extent);
+		light.Range = 3.0f + unit(rng) * 5.0f;
+		light.Intensity = 1.0f;
+		light.Color = XMFLOAT3(0.3f + 0.7f * unit(rng), 0.3f + 0.7f * unit(rng), 0.3f + 0.7f * unit(rng));
+		lights.push_back(light);
+	}
+}
+
+void StressScene::Clear(std::vector<std::shared_ptr<GameEntity>>& entities, std::vector<Light>& lights)
+{
+	if (entityCount > 0 && entities.size() >= firstEntity + entityCount)
+		entities.resize(firstEntity);
+	if (lightCount > 0 && lights.size() >= firstLight + lightCount)
+		lights.resize(firstLight);
+
+	entityCount = 0;
+	lightCount = 0;
+	motion.clear();
+}
+
+// --------------------------------------------------------
+// Sets every generated entity's transform from the time,
+// so motion doesn't drift and matches between runs
+// --------------------------------------------------------
+void StressScene::Animate(float totalTime, std::vector<std::shared_ptr<GameEntity>>& entities)
+{
+	if (entityCount == 0 || settings.Motion == STRESS_MOTION_STATIC)
+		return;
+
+	float time = totalTime * settings.MotionSpeed;
+	int motionType = settings.Motion;
+	JobSystem::GetInstance().ParallelFor(entityCount, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			const MotionData& m = motion[i];
+			std::shared_ptr<Transform> transform = entities[firstEntity + i]->GetTransform();
+			float t = m.Phase + time * m.Speed;
+
+			switch (motionType)
+			{
+			case STRESS_MOTION_SPIN:
+				transform->SetRotation(t * 0.5f, t, 0.0f);
+				break;
+
+			case STRESS_MOTION_ORBIT:
+				transform->SetPosition(m.Origin.x + cosf(t), m.Origin.y, m.Origin.z + sinf(t));
+				break;
+
+			case STRESS_MOTION_BOB:
+				transform->SetPosition(m.Origin.x, m.Origin.y + sinf(t) * 0.5f, m.Origin.z);
+				break;
+			}
+		}
+	}, 256);
+}
+
+unsigned int StressScene::GetEntityCount()
+{
+	return entityCount;
+}
+
+const StressSceneSettings& StressScene::GetSettings()
+{
+	return settings;
+}
+
+// --------------------------------------------------------
+// Folds one frame's times into the running average for
+// the current entity count (after a few warmup frames,
+// since the first frames after generating are outliers)
+// --------------------------------------------------------
+void StressScene::RecordTiming(float updateMs, float cullMs, float submitMs)
+{
+	framesSinceGenerate++;
+	if (framesSinceGenerate <= WarmupFrames)
+		return;
+
+	StressTimingSample* sample = 0;
+	for (auto& s : timings)
+	{
+		if (s.EntityCount == entityCount)
+			sample = &s;
+	}
+
+	if (!sample)
+	{
+		StressTimingSample s = {};
+		s.EntityCount = entityCount;
+
+		// Keep them sorted by entity count
+		auto it = timings.begin();
+		while (it != timings.end() && it->EntityCount < entityCount)
+			it++;
+		sample = &*timings.insert(it, s);
+	}
+
+	float n = (float)sample->Frames;
+	sample->UpdateMs = (sample->UpdateMs * n + updateMs) / (n + 1);
+	sample->CullMs = (sample->CullMs * n + cullMs) / (n + 1);
+	sample->SubmitMs = (sample->SubmitMs * n + submitMs) / (n + 1);
+	sample->Frames++;
+}
+
+const std::vector<StressTimingSample>& StressScene::GetTimings()
+{
+	return timings;
+}
+
+void StressScene::ClearTimings()
+{
+	timings.clear();
+}
+
+bool StressScene::ExportTimingsCSV(const std::wstring& path)
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+		return false;
+
+	file << "entities,frames,update_ms,cull_ms,submit_ms\n";
+	for (auto& s : timings)
+		file << s.EntityCount << "," << s.Frames << "," << s.UpdateMs << "," << s.CullMs << "," << s.SubmitMs << "\n";
+
+	return true;
+}
+
+void StressScene::StartSweep(const StressSceneSettings& settings)
+{
+	this->settings = settings;
+	sweeping = true;
+	sweepStep = 0;
+	sweepStepStarted = false;
+	timings.clear();
+}
+
+void StressScene::StopSweep()
+{
+	sweeping = false;
+}
+
+bool StressScene::IsSweeping()
+{
+	return sweeping;
+}
+
+// --------------------------------------------------------
+// Moves the sweep along once enough frames have been
+// recorded at the current step
+// --------------------------------------------------------
+bool StressScene::UpdateSweep(StressSceneSettings& next)
+{
+	if (!sweeping)
+		return false;
+
+	// Still recording the current step?
+	if (sweepStepStarted)
+	{
+		if (framesSinceGenerate < WarmupFrames + SweepFramesPerStep)
+			return false;
+
+		sweepStep++;
+		if (sweepStep >= SweepCountTotal)
+		{
+			sweeping = false;
+			return false;
+		}
+	}
+
+	sweepStepStarted = true;
+	next = settings;
+	next.EntityCount = (int)SweepCounts[sweepStep];
+	return true;
+}
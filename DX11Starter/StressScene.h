@@ -0,0 +1,116 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GameEntity.h"
+#include "Lights.h"
+
+// How stress entities are spread out
+#define STRESS_DISTRIBUTION_GRID		0
+#define STRESS_DISTRIBUTION_RANDOM		1
+#define STRESS_DISTRIBUTION_CLUSTERS	2
+
+// How stress entities move
+#define STRESS_MOTION_STATIC	0
+#define STRESS_MOTION_SPIN		1
+#define STRESS_MOTION_ORBIT		2
+#define STRESS_MOTION_BOB		3
+
+// --------------------------------------------------------
+// Options for a generated stress scene
+// --------------------------------------------------------
+struct StressSceneSettings
+{
+	int EntityCount = 1000;
+	int Distribution = STRESS_DISTRIBUTION_GRID;
+	int Motion = STRESS_MOTION_SPIN;
+	float Extent = 40.0f;		// Half-size of the (square) area entities fill
+	float MotionSpeed = 1.0f;
+	int PointLightCount = 0;
+	unsigned int Seed = 1;
+};
+
+// --------------------------------------------------------
+// Average CPU times at one entity count
+// --------------------------------------------------------
+struct StressTimingSample
+{
+	unsigned int EntityCount;
+	unsigned int Frames;
+	float UpdateMs;		// Game::Update, minus the snapshot
+	float CullMs;		// Transforms + frustum culling (PublishSnapshot)
+	float SubmitMs;		// Shadow + main pass draw submission
+};
+
+// --------------------------------------------------------
+// Generates (and animates) large numbers of entities from
+// the existing meshes & materials, and records how the CPU
+// cost of each subsystem grows with the entity count.
+//
+// Generated entities and lights are appended after the
+// hand-placed ones, so regenerating just trims the vectors
+// back and fills them again.
+// --------------------------------------------------------
+class StressScene
+{
+public:
+	StressScene();
+	~StressScene();
+
+	void Generate(
+		const StressSceneSettings& settings,
+		const std::vector<std::shared_ptr<Mesh>>& meshes,
+		const std::vector<std::shared_ptr<Material>>& materials,
+		std::vector<std::shared_ptr<GameEntity>>& entities,
+		std::vector<Light>& lights);
+	void Clear(std::vector<std::shared_ptr<GameEntity>>& entities, std::vector<Light>& lights);
+
+	// Moves every generated entity (in parallel) based on the total time
+	void Animate(float totalTime, std::vector<std::shared_ptr<GameEntity>>& entities);
+
+	unsigned int GetEntityCount();
+	const StressSceneSettings& GetSettings();
+
+	// Timing curves - call once per frame with the last frame's times
+	void RecordTiming(float updateMs, float cullMs, float submitMs);
+	const std::vector<StressTimingSample>& GetTimings();
+	void ClearTimings();
+	bool ExportTimingsCSV(const std::wstring& path);
+
+	// Automatic sweep through entity counts from 1k to 1M.  Returns
+	// true (and fills in the settings) when it's time to regenerate.
+	void StartSweep(const StressSceneSettings& settings);
+	void StopSweep();
+	bool IsSweeping();
+	bool UpdateSweep(StressSceneSettings& next);
+
+private:
+	StressSceneSettings settings;
+	size_t firstEntity;		// Index of the first generated entity
+	size_t firstLight;		// Index of the first generated light
+	unsigned int entityCount;
+	unsigned int lightCount;
+
+	// Per generated entity
+	struct MotionData
+	{
+		DirectX::XMFLOAT3 Origin;
+		float Phase;
+		float Speed;
+	};
+	std::vector<MotionData> motion;
+
+	// Timing
+	static const unsigned int WarmupFrames = 10;
+	unsigned int framesSinceGenerate;
+	std::vector<StressTimingSample> timings;
+
+	// Sweep
+	static const unsigned int SweepFramesPerStep = 60;
+	bool sweeping;
+	bool sweepStepStarted;
+	unsigned int sweepStep;
+};
@@ -0,0 +1,130 @@
+#include "TestFramework.h"
+#include "BoxBlur.h"
+#include <cmath>
+#include <cstdio>
+
+// Float sums of up to 41^2 values around 0.5
+static const float GoldenTolerance = 2e-5f;
+
+// --------------------------------------------------------
+// Small, with hard edges (4 texel checkers) and noise, so a
+// mistake in the window or at the borders shows up.  Data/
+// MakeBoxBlurGolden.py makes the same image.
+// --------------------------------------------------------
+static BlurImage MakeTestImage(unsigned int width, unsigned int height)
+{
+	BlurImage image;
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height * 4);
+
+	unsigned int seed = 12345;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			float checker = ((x / 4 + y / 4) & 1) ? 1.0f : 0.0f;
+			float* pixel = &image.Pixels[((size_t)y * width + x) * 4];
+			for (int c = 0; c < 4; c++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				pixel[c] = checker * 0.75f + (seed >> 8) / 16777216.0f * 0.25f;
+			}
+		}
+	}
+	return image;
+}
+
+// --------------------------------------------------------
+// Data/BoxBlurGolden.txt: the image size and radius count,
+// then each radius and its blurred image (worked out in
+// double precision, outside the engine)
+// --------------------------------------------------------
+struct GoldenBlur
+{
+	int Radius;
+	BlurImage Image;
+};
+
+static bool LoadGolden(std::vector<GoldenBlur>& golden)
+{
+	FILE* file = fopen(TEST_DATA_DIR "BoxBlurGolden.txt", "r");
+	if (!file)
+		return false;
+
+	unsigned int width = 0, height = 0, count = 0;
+	bool read = fscanf(file, "%u %u %u", &width, &height, &count) == 3;
+	golden.resize(read ? count : 0);
+	for (GoldenBlur& blur : golden)
+	{
+		read = read && fscanf(file, "%d", &blur.Radius) == 1;
+		blur.Image.Width = width;
+		blur.Image.Height = height;
+		blur.Image.Pixels.resize((size_t)width * height * 4);
+		for (float& value : blur.Image.Pixels)
+			read = read && fscanf(file, "%f", &value) == 1;
+	}
+	fclose(file);
+	return read && !golden.empty();
+}
+
+static void CheckAgainstGolden(void (*blur)(const BlurImage&, BlurImage&, int), const char* name)
+{
+	std::vector<GoldenBlur> golden;
+	CHECK(LoadGolden(golden));
+	for (const GoldenBlur& expected : golden)
+	{
+		BlurImage source = MakeTestImage(expected.Image.Width, expected.Image.Height);
+		BlurImage result;
+		blur(source, result, expected.Radius);
+		CHECK(result.Width == expected.Image.Width && result.Height == expected.Image.Height);
+
+		float error = GetMaxDifference(result, expected.Image);
+		if (error > GoldenTolerance)
+			printf("  %s, radius %d: max error %g\n", name, expected.Radius, error);
+		CHECK(error <= GoldenTolerance);
+	}
+}
+
+TEST(BruteForceMatchesGolden)
+{
+	CheckAgainstGolden(BoxBlurBruteForce, "Brute force");
+}
+
+TEST(SeparableMatchesGolden)
+{
+	CheckAgainstGolden(BoxBlurSeparable, "Separable");
+}
+
+TEST(SlidingWindowMatchesGolden)
+{
+	CheckAgainstGolden(BoxBlurSlidingWindow, "Sliding window");
+}
+
+TEST(VariantsAgreeOnOddSizes)
+{
+	// Sizes that aren't multiples of anything, up to the UI's biggest radius
+	const unsigned int sizes[][2] = { { 1, 1 }, { 7, 3 }, { 33, 17 }, { 130, 61 } };
+	for (const auto& size : sizes)
+	{
+		BlurImage source = MakeTestImage(size[0], size[1]);
+		for (int radius = 0; radius <= 10; radius++)
+		{
+			BlurImage bruteForce, separable, slidingWindow;
+			BoxBlurBruteForce(source, bruteForce, radius);
+			BoxBlurSeparable(source, separable, radius);
+			BoxBlurSlidingWindow(source, slidingWindow, radius);
+			CHECK(GetMaxDifference(bruteForce, separable) <= GoldenTolerance);
+			CHECK(GetMaxDifference(bruteForce, slidingWindow) <= GoldenTolerance);
+		}
+	}
+}
+
+TEST(Benchmark)
+{
+	BoxBlurBenchmarkResults results = RunBoxBlurBenchmark(320, 180, 10);
+	CHECK(results.SeparableMaxError <= GoldenTolerance);
+	CHECK(results.SlidingWindowMaxError <= GoldenTolerance);
+	printf("  320 x 180, radius 10: brute force %.2f ms, separable %.2f ms, sliding window %.2f ms\n",
+		results.BruteForceMs, results.SeparableMs, results.SlidingWindowMs);
+}
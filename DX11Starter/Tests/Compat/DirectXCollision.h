@@ -0,0 +1,19 @@
+#pragma once
+
+#include "DirectXMath.h"
+
+// --------------------------------------------------------
+// The one bounding volume the CPU-only engine code takes,
+// as plain data (see DirectXMath.h in this folder)
+// --------------------------------------------------------
+namespace DirectX
+{
+	struct BoundingSphere
+	{
+		XMFLOAT3 Center;
+		float Radius;
+
+		BoundingSphere() : Center(0, 0, 0), Radius(1.0f) {}
+		BoundingSphere(const XMFLOAT3& center, float radius) : Center(center), Radius(radius) {}
+	};
+}
@@ -0,0 +1,135 @@
+#include "TestFramework.h"
+#include "CubeShadowFaces.h"
+#include <cmath>
+
+using namespace DirectX;
+
+// Same small LCG everywhere, so failures repeat
+static float Random(unsigned int& state, float low, float high)
+{
+	state = state * 1664525u + 1013904223u;
+	return low + (high - low) * ((state >> 8) / 16777216.0f);
+}
+
+TEST(FaceOfDirection)
+{
+	CHECK(GetCubeFace(XMFLOAT3(1, 0, 0)) == 0);
+	CHECK(GetCubeFace(XMFLOAT3(-1, 0, 0)) == 1);
+	CHECK(GetCubeFace(XMFLOAT3(0, 1, 0)) == 2);
+	CHECK(GetCubeFace(XMFLOAT3(0, -1, 0)) == 3);
+	CHECK(GetCubeFace(XMFLOAT3(0, 0, 1)) == 4);
+	CHECK(GetCubeFace(XMFLOAT3(0, 0, -1)) == 5);
+	CHECK(GetCubeFace(XMFLOAT3(0.2f, -0.9f, 0.5f)) == 3);
+
+	// Ties go to the earlier axis, like the shader
+	CHECK(GetCubeFace(XMFLOAT3(1, 1, 1)) == 0);
+	CHECK(GetCubeFace(XMFLOAT3(0, -1, 1)) == 3);
+}
+
+TEST(FaceBasis)
+{
+	for (unsigned int f = 0; f < CUBE_FACE_COUNT; f++)
+	{
+		XMFLOAT3 forward, up;
+		GetCubeFaceBasis(f, forward, up);
+		CHECK(GetCubeFace(forward) == f);
+		CHECK_NEAR(forward.x * forward.x + forward.y * forward.y + forward.z * forward.z, 1.0f, 1e-6f);
+		CHECK_NEAR(up.x * up.x + up.y * up.y + up.z * up.z, 1.0f, 1e-6f);
+		CHECK_NEAR(forward.x * up.x + forward.y * up.y + forward.z * up.z, 0.0f, 1e-6f);
+	}
+}
+
+TEST(FaceMaskSimpleCases)
+{
+	XMFLOAT3 light(1, 2, 3);
+
+	// Well inside one face
+	CHECK(GetCubeFaceMask(light, 20.0f, BoundingSphere(XMFLOAT3(11, 2, 3), 1.0f)) == 1u << 0);
+	CHECK(GetCubeFaceMask(light, 20.0f, BoundingSphere(XMFLOAT3(1, 2, -7), 1.0f)) == 1u << 5);
+
+	// Straddling the +X / +Y edge
+	CHECK(GetCubeFaceMask(light, 20.0f, BoundingSphere(XMFLOAT3(11, 12, 3), 1.0f)) == ((1u << 0) | (1u << 2)));
+
+	// Out of range, just in range, and around the light itself
+	CHECK(GetCubeFaceMask(light, 5.0f, BoundingSphere(XMFLOAT3(11, 2, 3), 1.0f)) == 0);
+	CHECK(GetCubeFaceMask(light, 9.5f, BoundingSphere(XMFLOAT3(11, 2, 3), 1.0f)) == 1u << 0);
+	CHECK(GetCubeFaceMask(light, 5.0f, BoundingSphere(XMFLOAT3(1.5f, 2, 3), 1.0f)) == CUBE_FACES_ALL);
+}
+
+// --------------------------------------------------------
+// Brute force: points all through each sphere (and within
+// range of the light) land in faces by GetCubeFace(), which
+// is what the shader samples.  The mask must hold every one
+// of those faces, and shouldn't hold many more.
+// --------------------------------------------------------
+TEST(FaceMaskMatchesBruteForce)
+{
+	unsigned int state = 3;
+	XMFLOAT3 light(0, 0, 0);
+	const float range = 10.0f;
+	int missed = 0, extra = 0, spheres = 0;
+	for (int s = 0; s < 3000; s++)
+	{
+		BoundingSphere sphere(
+			XMFLOAT3(Random(state, -12, 12), Random(state, -12, 12), Random(state, -12, 12)),
+			Random(state, 0.1f, 3.0f));
+		unsigned int mask = GetCubeFaceMask(light, range, sphere);
+
+		unsigned int sampled = 0;
+		for (int p = 0; p < 2000; p++)
+		{
+			XMFLOAT3 d(Random(state, -1, 1), Random(state, -1, 1), Random(state, -1, 1));
+			if (d.x * d.x + d.y * d.y + d.z * d.z > 1.0f)
+				continue;
+
+			XMFLOAT3 point(
+				sphere.Center.x + d.x * sphere.Radius,
+				sphere.Center.y + d.y * sphere.Radius,
+				sphere.Center.z + d.z * sphere.Radius);
+			if (point.x * point.x + point.y * point.y + point.z * point.z >= range * range)
+				continue;
+			sampled |= 1u << GetCubeFace(point);
+		}
+
+		missed += (sampled & ~mask) != 0;
+		for (unsigned int f = 0; f < CUBE_FACE_COUNT; f++)
+			extra += ((mask & ~sampled) >> f) & 1;
+		spheres += sampled != 0;
+	}
+	CHECK(spheres > 500);
+	CHECK(missed == 0);
+
+	// Conservative near the frustum corners (and a sample can miss
+	// a thin sliver), but nowhere near every face every time
+	if (extra > spheres / 4)
+		printf("  %d extra faces over %d spheres\n", extra, spheres);
+	CHECK(extra <= spheres / 4);
+}
+
+TEST(CullSortsCasters)
+{
+	XMFLOAT3 light(0, 0, 0);
+	std::vector<BoundingSphere> casters;
+	std::vector<unsigned char> dynamic;
+	casters.push_back(BoundingSphere(XMFLOAT3(5, 0, 0), 1.0f));	dynamic.push_back(0);	// +X
+	casters.push_back(BoundingSphere(XMFLOAT3(0, 0, -5), 1.0f));	dynamic.push_back(1);	// -Z, moving
+	casters.push_back(BoundingSphere(XMFLOAT3(5, 5, 0), 1.0f));	dynamic.push_back(0);	// +X & +Y
+	casters.push_back(BoundingSphere(XMFLOAT3(50, 0, 0), 1.0f));	dynamic.push_back(1);	// Out of range
+
+	CubeFaceCasters result;
+	result.Casters[3].push_back(99);	// Leftovers from last time get cleared
+	CullCubeFaces(light, 10.0f, casters, dynamic, result);
+
+	CHECK(result.Mask == ((1u << 0) | (1u << 2) | (1u << 5)));
+	CHECK(result.DynamicMask == 1u << 5);
+	CHECK(result.Casters[0].size() == 2);
+	CHECK(result.Casters[0][0] == 0 && result.Casters[0][1] == 2);
+	CHECK(result.Casters[1].empty());
+	CHECK(result.Casters[2].size() == 1 && result.Casters[2][0] == 2);
+	CHECK(result.Casters[3].empty());
+	CHECK(result.Casters[4].empty());
+	CHECK(result.Casters[5].size() == 1 && result.Casters[5][0] == 1);
+
+	for (unsigned int f = 0; f < CUBE_FACE_COUNT; f++)
+		CHECK(result.Casters[f].empty() == !(result.Mask & (1u << f)));
+}
@@ -0,0 +1,48 @@
+# Writes BoxBlurGolden.txt - the box blurs of the BoxBlurTests
+# image, worked out in double precision independently of the
+# engine's code.  Only rerun it if the test image changes.
+import struct
+
+WIDTH, HEIGHT = 24, 16
+RADII = [0, 1, 3, 20]
+
+def to_float(x):
+    return struct.unpack('f', struct.pack('f', x))[0]
+
+# Same as MakeTestImage() in BoxBlurTests.cpp, float math and all
+def make_image():
+    seed = 12345
+    pixels = []
+    for y in range(HEIGHT):
+        for x in range(WIDTH):
+            checker = 1.0 if ((x // 4 + y // 4) & 1) else 0.0
+            for c in range(4):
+                seed = (seed * 1664525 + 1013904223) & 0xFFFFFFFF
+                noise = to_float(to_float((seed >> 8) / 16777216.0) * 0.25)
+                pixels.append(to_float(to_float(checker * 0.75) + noise))
+    return pixels
+
+# The whole (2r+1)^2 box, edges repeated like a clamp sampler
+def blur(pixels, radius):
+    result = []
+    count = (2 * radius + 1) ** 2
+    for y in range(HEIGHT):
+        for x in range(WIDTH):
+            sums = [0.0] * 4
+            for dy in range(-radius, radius + 1):
+                sy = min(max(y + dy, 0), HEIGHT - 1)
+                for dx in range(-radius, radius + 1):
+                    sx = min(max(x + dx, 0), WIDTH - 1)
+                    for c in range(4):
+                        sums[c] += pixels[(sy * WIDTH + sx) * 4 + c]
+            result.extend(s / count for s in sums)
+    return result
+
+image = make_image()
+with open('BoxBlurGolden.txt', 'w', newline='\n') as out:
+    out.write('%d %d %d\n' % (WIDTH, HEIGHT, len(RADII)))
+    for radius in RADII:
+        out.write('%d\n' % radius)
+        values = blur(image, radius)
+        for i in range(0, len(values), 8):
+            out.write(' '.join('%.8f' % v for v in values[i:i + 8]) + '\n')
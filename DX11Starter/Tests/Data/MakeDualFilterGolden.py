@@ -0,0 +1,111 @@
+# Writes DualFilterGolden.txt - the dual filter passes run on
+# the DualFilterTests image, worked out in double precision
+# independently of the engine's code.  Only rerun it if the
+# test image or the kernels change.
+import math
+import struct
+
+# Odd, so the half sizes round down and the passes sample at
+# positions that aren't on the texel grid
+WIDTH, HEIGHT = 25, 15
+
+def to_float(x):
+    return struct.unpack('f', struct.pack('f', x))[0]
+
+# Same as MakeTestImage() in DualFilterTests.cpp, float math and all
+def make_image(width, height):
+    seed = 12345
+    pixels = []
+    for y in range(height):
+        for x in range(width):
+            checker = 1.0 if ((x // 4 + y // 4) & 1) else 0.0
+            for c in range(4):
+                seed = (seed * 1664525 + 1013904223) & 0xFFFFFFFF
+                noise = to_float(to_float((seed >> 8) / 16777216.0) * 0.25)
+                pixels.append(to_float(to_float(checker * 0.75) + noise))
+    return (width, height, pixels)
+
+# Bilinear at a position in texels (0, 0 the top left corner),
+# edges clamped like ClampSampler
+def sample(image, x, y):
+    width, height, pixels = image
+    x -= 0.5
+    y -= 0.5
+    fx, fy = math.floor(x), math.floor(y)
+    tx, ty = x - fx, y - fy
+    def texel(sx, sy):
+        sx = min(max(sx, 0), width - 1)
+        sy = min(max(sy, 0), height - 1)
+        return pixels[(sy * width + sx) * 4:(sy * width + sx) * 4 + 4]
+    a, b = texel(fx, fy), texel(fx + 1, fy)
+    c, d = texel(fx, fy + 1), texel(fx + 1, fy + 1)
+    return [(a[i] * (1 - tx) + b[i] * tx) * (1 - ty) + (c[i] * (1 - tx) + d[i] * tx) * ty for i in range(4)]
+
+# The center 4 times plus the 4 diagonal corners, over 8
+def downsample(image, threshold):
+    width, height = max(image[0] // 2, 1), max(image[1] // 2, 1)
+    sx, sy = image[0] / width, image[1] / height
+    pixels = []
+    for y in range(height):
+        for x in range(width):
+            u, v = (x + 0.5) * sx, (y + 0.5) * sy
+            taps = [(0, 0)] * 4 + [(-1, -1), (1, -1), (-1, 1), (1, 1)]
+            total = [0.0] * 4
+            for dx, dy in taps:
+                s = sample(image, u + dx, v + dy)
+                total = [total[i] + s[i] for i in range(4)]
+            out = [t / 8 for t in total]
+            if threshold > 0:
+                brightness = max(out[0], out[1], out[2])
+                scale = max(brightness - threshold, 0.0) / max(brightness, 0.0001)
+                out = [out[0] * scale, out[1] * scale, out[2] * scale, out[3]]
+            pixels.extend(out[:3] + [1.0])
+    return (width, height, pixels)
+
+# The 4 edge taps once and the 4 half texel corners twice, over 12
+def upsample(image, width, height):
+    sx, sy = image[0] / width, image[1] / height
+    pixels = []
+    for y in range(height):
+        for x in range(width):
+            u, v = (x + 0.5) * sx, (y + 0.5) * sy
+            taps = [(-1, 0, 1), (1, 0, 1), (0, -1, 1), (0, 1, 1),
+                    (-0.5, -0.5, 2), (0.5, -0.5, 2), (-0.5, 0.5, 2), (0.5, 0.5, 2)]
+            total = [0.0] * 4
+            for dx, dy, weight in taps:
+                s = sample(image, u + dx, v + dy)
+                total = [total[i] + s[i] * weight for i in range(4)]
+            pixels.extend([t / 12 for t in total[:3]] + [1.0])
+    return (width, height, pixels)
+
+def pyramid(image, levels, threshold):
+    down = []
+    for i in range(levels):
+        down.append(downsample(down[-1] if down else image, threshold if i == 0 else 0.0))
+    for i in range(levels - 2, -1, -1):
+        down[i] = upsample(down[i + 1], down[i][0], down[i][1])
+    return upsample(down[0], image[0], image[1])
+
+def bloom(image, levels, threshold, intensity):
+    glow = pyramid(image, levels, threshold)
+    pixels = []
+    for i in range(0, len(image[2]), 4):
+        pixels.extend([image[2][i + c] + glow[2][i + c] * intensity for c in range(3)] + [image[2][i + 3]])
+    return (image[0], image[1], pixels)
+
+image = make_image(WIDTH, HEIGHT)
+small = make_image(12, 7)
+cases = [
+    ('Down', downsample(image, 0.0)),
+    ('DownThreshold', downsample(image, 0.6)),
+    ('Up', upsample(small, WIDTH, HEIGHT)),
+    ('Blur1', pyramid(image, 1, 0.0)),
+    ('Blur3', pyramid(image, 3, 0.0)),
+    ('Bloom2', bloom(image, 2, 0.6, 0.5)),
+]
+with open('DualFilterGolden.txt', 'w', newline='\n') as out:
+    out.write('%d %d %d\n' % (WIDTH, HEIGHT, len(cases)))
+    for name, (width, height, values) in cases:
+        out.write('%s %d %d\n' % (name, width, height))
+        for i in range(0, len(values), 8):
+            out.write(' '.join('%.8f' % v for v in values[i:i + 8]) + '\n')
@@ -0,0 +1,196 @@
+#include "TestFramework.h"
+#include "DualFilter.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// Float bilinear weights and sums of a few passes, around 0.5
+static const float GoldenTolerance = 2e-5f;
+
+// --------------------------------------------------------
+// Small and odd sized, with hard edges (4 texel checkers) and
+// noise, so a wrong tap, weight or edge clamp shows up.  Data/
+// MakeDualFilterGolden.py makes the same image.
+// --------------------------------------------------------
+static BlurImage MakeTestImage(unsigned int width, unsigned int height)
+{
+	BlurImage image;
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize((size_t)width * height * 4);
+
+	unsigned int seed = 12345;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			float checker = ((x / 4 + y / 4) & 1) ? 1.0f : 0.0f;
+			float* pixel = &image.Pixels[((size_t)y * width + x) * 4];
+			for (int c = 0; c < 4; c++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				pixel[c] = checker * 0.75f + (seed >> 8) / 16777216.0f * 0.25f;
+			}
+		}
+	}
+	return image;
+}
+
+// --------------------------------------------------------
+// Data/DualFilterGolden.txt: the test image size and case
+// count, then each case's name, size and expected image
+// (worked out in double precision, outside the engine).
+// Gives back the named case and the image it starts from.
+// --------------------------------------------------------
+static bool LoadGolden(const char* name, BlurImage& source, BlurImage& golden)
+{
+	FILE* file = fopen(TEST_DATA_DIR "DualFilterGolden.txt", "r");
+	if (!file)
+		return false;
+
+	unsigned int width = 0, height = 0, count = 0;
+	bool read = fscanf(file, "%u %u %u", &width, &height, &count) == 3;
+	bool found = false;
+	for (unsigned int i = 0; read && !found && i < count; i++)
+	{
+		char caseName[64] = {};
+		read = fscanf(file, "%63s %u %u", caseName, &golden.Width, &golden.Height) == 3;
+		golden.Pixels.resize(read ? (size_t)golden.Width * golden.Height * 4 : 0);
+		for (float& value : golden.Pixels)
+			read = read && fscanf(file, "%f", &value) == 1;
+		found = read && strcmp(caseName, name) == 0;
+	}
+	fclose(file);
+	if (found)
+		source = MakeTestImage(width, height);
+	return found;
+}
+
+static void CheckAgainstGolden(const char* name, const BlurImage& result, const BlurImage& expected)
+{
+	CHECK(result.Width == expected.Width && result.Height == expected.Height);
+	float error = GetMaxDifference(result, expected);
+	if (error > GoldenTolerance)
+		printf("  %s: max error %g\n", name, error);
+	CHECK(error <= GoldenTolerance);
+}
+
+TEST(DownsampleMatchesGolden)
+{
+	BlurImage source, expected, result;
+	CHECK(LoadGolden("Down", source, expected));
+	DualFilterDownsample(source, result, 0.0f);
+	CheckAgainstGolden("Down", result, expected);
+}
+
+TEST(ThresholdDownsampleMatchesGolden)
+{
+	BlurImage source, expected, result;
+	CHECK(LoadGolden("DownThreshold", source, expected));
+	DualFilterDownsample(source, result, 0.6f);
+	CheckAgainstGolden("DownThreshold", result, expected);
+}
+
+TEST(UpsampleMatchesGolden)
+{
+	// From a smaller image of its own, so it doesn't depend on
+	// the downsample being right
+	BlurImage source, expected, result;
+	CHECK(LoadGolden("Up", source, expected));
+	DualFilterUpsample(MakeTestImage(12, 7), result, source.Width, source.Height);
+	CheckAgainstGolden("Up", result, expected);
+}
+
+TEST(BlurMatchesGolden)
+{
+	const char* names[] = { "Blur1", "Blur3" };
+	const unsigned int levels[] = { 1, 3 };
+	for (int i = 0; i < 2; i++)
+	{
+		BlurImage source, expected, result;
+		CHECK(LoadGolden(names[i], source, expected));
+		DualFilterBlur(source, result, levels[i]);
+		CheckAgainstGolden(names[i], result, expected);
+	}
+}
+
+TEST(BloomMatchesGolden)
+{
+	BlurImage source, expected, result;
+	CHECK(LoadGolden("Bloom2", source, expected));
+	DualFilterBloom(source, result, 2, 0.6f, 0.5f);
+	CheckAgainstGolden("Bloom2", result, expected);
+}
+
+TEST(ZeroLevelsIsACopy)
+{
+	BlurImage source = MakeTestImage(9, 5);
+	BlurImage blurred, bloomed;
+	DualFilterBlur(source, blurred, 0);
+	DualFilterBloom(source, bloomed, 0, 0.5f, 1.0f);
+	CHECK(GetMaxDifference(source, blurred) == 0.0f);
+	CHECK(GetMaxDifference(source, bloomed) == 0.0f);
+}
+
+// --------------------------------------------------------
+// The cost models at 4K, against counts worked out by hand.
+// Pyramid levels are 3840x2160, 1920x1080, 960x540, 480x270,
+// 240x135 and 120x67 (2160 >> 5 rounds down):
+//
+//   L0 8294400  L1 2073600  L2 518400  L3 129600  L4 32400  L5 8040
+// --------------------------------------------------------
+TEST(DualFilterCostAt4K)
+{
+	// 5 levels, 8 byte (RGBA16F) texels, as in the UI
+	//  - Down: 5 taps x (L1..L5 = 2762040)        =  13810200
+	//  - Up:   8 taps x (L0..L4 = 11048400)       =  88387200
+	//  - Memory, each way: L0 + 2(L1..L4) + L5    =  13810440 texels
+	PostProcessCost cost = GetDualFilterBlurCost(3840, 2160, 5, 8);
+	CHECK(cost.Passes == 10);
+	CHECK(cost.Samples == 102197400ull);
+	CHECK(cost.SampledBytes == 102197400ull * 8);
+	CHECK(cost.MemoryBytes == 2 * 13810440ull * 8);
+
+	// Bloom's composite reads the full size image once more
+	PostProcessCost bloom = GetBloomCost(3840, 2160, 5, 8);
+	CHECK(bloom.Passes == 10);
+	CHECK(bloom.Samples == 102197400ull + 8294400);
+	CHECK(bloom.SampledBytes == (102197400ull + 8294400) * 8);
+	CHECK(bloom.MemoryBytes == (2 * 13810440ull + 8294400) * 8);
+
+	// No levels, no passes
+	PostProcessCost none = GetDualFilterBlurCost(3840, 2160, 0, 8);
+	CHECK(none.Passes == 0 && none.Samples == 0 && none.MemoryBytes == 0);
+	none = GetBloomCost(3840, 2160, 0, 8);
+	CHECK(none.Passes == 0 && none.Samples == 0 && none.MemoryBytes == 0);
+}
+
+TEST(BoxBlurCostAt4K)
+{
+	// Radius 10, 4 byte (RGBA8) texels, as in the UI
+	//  - Brute force: 21 x 21 = 441 taps per pixel, one pass
+	//  - Separable: 21 taps per pixel, two passes
+	PostProcessCost box = GetBoxBlurCost(3840, 2160, 10, 4);
+	CHECK(box.Passes == 1);
+	CHECK(box.Samples == 3657830400ull);
+	CHECK(box.SampledBytes == 14631321600ull);
+	CHECK(box.MemoryBytes == 2 * 8294400ull * 4);
+
+	PostProcessCost separable = GetSeparableBlurCost(3840, 2160, 10, 4);
+	CHECK(separable.Passes == 2);
+	CHECK(separable.Samples == 348364800ull);
+	CHECK(separable.SampledBytes == 1393459200ull);
+	CHECK(separable.MemoryBytes == 4 * 8294400ull * 4);
+
+	// The point of the pyramid: a wide blur in under 3% of the samples
+	PostProcessCost dual = GetDualFilterBlurCost(3840, 2160, 5, 8);
+	CHECK(dual.Samples * 35 < box.Samples);
+}
+
+TEST(Benchmark)
+{
+	DualFilterBenchmarkResults results = RunDualFilterBenchmark(320, 180, 4, 0.8f);
+	CHECK(fabsf(results.BlurMeanChange) < 0.01f);
+	printf("  320 x 180, 4 levels: blur %.2f ms, bloom %.2f ms, mean change %g\n",
+		results.BlurMs, results.BloomMs, results.BlurMeanChange);
+}
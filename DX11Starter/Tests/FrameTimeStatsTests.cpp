@@ -0,0 +1,182 @@
+#include "TestFramework.h"
+#include "FrameTimeStats.h"
+
+// Same small LCG everywhere, so failures repeat
+static unsigned int RandomIndex(unsigned int& state, unsigned int count)
+{
+	state = state * 1664525u + 1013904223u;
+	return (state >> 8) % count;
+}
+
+// The stats are big (a few thousand frames), so keep them off the stack
+static FrameTimeStats stats;
+
+static float GetHistogramTotal(const FrameTimeSummary& summary)
+{
+	float total = 0.0f;
+	for (unsigned int b = 0; b < FrameTimeSummary::HistogramBins; b++)
+		total += summary.Histogram[b];
+	return total;
+}
+
+TEST(EmptyRing)
+{
+	stats.Reset();
+	FrameTimeSummary summary;
+	stats.Calculate(summary);
+	CHECK(summary.FrameCount == 0);
+	CHECK(summary.Average == 0 && summary.P50 == 0 && summary.P99 == 0 && summary.Max == 0);
+	CHECK(GetHistogramTotal(summary) == 0);
+}
+
+TEST(NearestRankPercentiles)
+{
+	// 1 to 100 ms, shuffled: the nth percentile is exactly n ms
+	unsigned int order[100];
+	for (unsigned int i = 0; i < 100; i++)
+		order[i] = i + 1;
+	unsigned int state = 3;
+	for (unsigned int i = 99; i > 0; i--)
+	{
+		unsigned int j = RandomIndex(state, i + 1);
+		unsigned int swap = order[i];
+		order[i] = order[j];
+		order[j] = swap;
+	}
+
+	stats.Reset();
+	for (unsigned int ms : order)
+		stats.AddFrame(ms / 1000.0f);
+
+	FrameTimeSummary summary;
+	stats.Calculate(summary);
+	CHECK(summary.FrameCount == 100);
+	CHECK_NEAR(summary.Average, 50.5f, 1e-3f);
+	CHECK_NEAR(summary.P50, 50.0f, 1e-3f);
+	CHECK_NEAR(summary.P95, 95.0f, 1e-3f);
+	CHECK_NEAR(summary.P99, 99.0f, 1e-3f);
+	CHECK_NEAR(summary.Max, 100.0f, 1e-3f);
+}
+
+TEST(SmallCounts)
+{
+	// One frame is every percentile
+	stats.Reset();
+	stats.AddFrame(0.02f);
+	FrameTimeSummary summary;
+	stats.Calculate(summary);
+	CHECK_NEAR(summary.P50, 20.0f, 1e-3f);
+	CHECK_NEAR(summary.P99, 20.0f, 1e-3f);
+	CHECK_NEAR(summary.Max, 20.0f, 1e-3f);
+
+	// Three: the median's the middle one, and anything past
+	// two thirds is the slowest (nearest rank never interpolates)
+	stats.AddFrame(0.03f);
+	stats.AddFrame(0.01f);
+	stats.Calculate(summary);
+	CHECK_NEAR(summary.P50, 20.0f, 1e-3f);
+	CHECK_NEAR(summary.P95, 30.0f, 1e-3f);
+	CHECK_NEAR(summary.Average, 20.0f, 1e-3f);
+}
+
+TEST(StuttersShowInTheTail)
+{
+	// A steady 60 fps with 2% of frames at 100ms: the median and
+	// P95 don't notice, P99 and the max do
+	stats.Reset();
+	for (unsigned int i = 0; i < 1000; i++)
+		stats.AddFrame(i % 50 == 7 ? 0.1f : 1 / 60.0f);
+
+	FrameTimeSummary summary;
+	stats.Calculate(summary);
+	CHECK_NEAR(summary.P50, 1000 / 60.0f, 1e-3f);
+	CHECK_NEAR(summary.P95, 1000 / 60.0f, 1e-3f);
+	CHECK_NEAR(summary.P99, 100.0f, 1e-3f);
+	CHECK_NEAR(summary.Max, 100.0f, 1e-3f);
+	CHECK_NEAR(summary.Average, (980 * 1000 / 60.0f + 20 * 100.0f) / 1000, 1e-2f);
+}
+
+TEST(HistogramBins)
+{
+	// Two bins per doubling from 0.25ms
+	CHECK_NEAR(FrameTimeStats::GetBinStart(0), 0.25f, 1e-6f);
+	CHECK_NEAR(FrameTimeStats::GetBinStart(1), 0.25f * sqrtf(2.0f), 1e-6f);
+	CHECK_NEAR(FrameTimeStats::GetBinStart(4), 1.0f, 1e-6f);
+	CHECK_NEAR(FrameTimeStats::GetBinStart(12), 16.0f, 1e-4f);
+
+	// A frame a little past each bin's start lands in that bin
+	for (unsigned int b = 0; b < FrameTimeSummary::HistogramBins; b++)
+	{
+		stats.Reset();
+		stats.AddFrame(FrameTimeStats::GetBinStart(b) * 1.05f / 1000);
+		FrameTimeSummary summary;
+		stats.Calculate(summary);
+		CHECK(summary.Histogram[b] == 1.0f);
+		CHECK(GetHistogramTotal(summary) == 1.0f);
+	}
+
+	// Anything faster goes in the first, anything slower in the last
+	stats.Reset();
+	stats.AddFrame(0.0f);
+	stats.AddFrame(0.0001f);
+	stats.AddFrame(5.0f);
+	FrameTimeSummary summary;
+	stats.Calculate(summary);
+	CHECK(summary.Histogram[0] == 2.0f);
+	CHECK(summary.Histogram[FrameTimeSummary::HistogramBins - 1] == 1.0f);
+}
+
+TEST(HistogramMatchesFrames)
+{
+	// Random frame times: every frame counted once, in the bin
+	// whose range holds it
+	stats.Reset();
+	unsigned int state = 17;
+	for (unsigned int i = 0; i < 2000; i++)
+		stats.AddFrame((0.3f + RandomIndex(state, 100000) / 1000.0f) / 1000);
+
+	FrameTimeSummary summary;
+	stats.Calculate(summary);
+	CHECK(GetHistogramTotal(summary) == 2000.0f);
+
+	float expected[FrameTimeSummary::HistogramBins] = {};
+	for (unsigned int i = 0; i < stats.GetFrameCount(); i++)
+	{
+		float ms = stats.GetFrameTime(i);
+		unsigned int bin = 0;
+		while (bin + 1 < FrameTimeSummary::HistogramBins && ms >= FrameTimeStats::GetBinStart(bin + 1) * 1.0001f)
+			bin++;
+		expected[bin] += 1.0f;
+	}
+
+	// Brute force against the log2 in Calculate() can only
+	// disagree for a frame right on a bin edge
+	float misplaced = 0.0f;
+	for (unsigned int b = 0; b < FrameTimeSummary::HistogramBins; b++)
+		misplaced += fabsf(summary.Histogram[b] - expected[b]);
+	CHECK(misplaced <= 2.0f);
+}
+
+TEST(RingKeepsTheLatestFrames)
+{
+	// A slow start that's since scrolled out of the ring
+	stats.Reset();
+	for (unsigned int i = 0; i < 10; i++)
+		stats.AddFrame(1.0f);
+	for (unsigned int i = 0; i < FrameTimeStats::Capacity; i++)
+		stats.AddFrame((1 + i % 20) / 1000.0f);
+
+	CHECK(stats.GetFrameCount() == FrameTimeStats::Capacity);
+	CHECK(stats.GetTotalFrameCount() == FrameTimeStats::Capacity + 10);
+	CHECK_NEAR(stats.GetFrameTime(0), 1.0f, 1e-4f);
+	CHECK_NEAR(stats.GetFrameTime(FrameTimeStats::Capacity - 1), (FrameTimeStats::Capacity - 1) % 20 + 1.0f, 1e-4f);
+
+	FrameTimeSummary summary;
+	stats.Calculate(summary);
+	CHECK(summary.FrameCount == FrameTimeStats::Capacity);
+	CHECK_NEAR(summary.Max, 20.0f, 1e-3f);
+	CHECK(GetHistogramTotal(summary) == (float)FrameTimeStats::Capacity);
+
+	stats.Reset();
+	CHECK(stats.GetFrameCount() == 0 && stats.GetTotalFrameCount() == 0);
+}
@@ -0,0 +1,328 @@
+#include "TestFramework.h"
+#include "IBLBaker.h"
+#include "JobSystem.h"
+#include <DirectXMath.h>
+#include <cmath>
+#include <functional>
+
+using namespace DirectX;
+
+static const double Pi = 3.14159265358979323846;
+
+// The bake spreads rows across the workers, like in the game
+static void StartJobs()
+{
+	static bool started = false;
+	if (!started)
+		JobSystem::GetInstance().Initialize();
+	started = true;
+}
+
+// --------------------------------------------------------
+// Unit direction through the center of a texel, and the
+// solid angle the texel covers (D3D's face order &
+// orientation: +X, -X, +Y, -Y, +Z, -Z)
+// --------------------------------------------------------
+static void GetTexel(unsigned int face, unsigned int x, unsigned int y, unsigned int size, double direction[3], double& solidAngle)
+{
+	static const double axes[6][3][3] =
+	{
+		{ { 1, 0, 0 }, { 0, 0, -1 }, { 0, -1, 0 } },
+		{ { -1, 0, 0 }, { 0, 0, 1 }, { 0, -1, 0 } },
+		{ { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+		{ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, -1 } },
+		{ { 0, 0, 1 }, { 1, 0, 0 }, { 0, -1, 0 } },
+		{ { 0, 0, -1 }, { -1, 0, 0 }, { 0, -1, 0 } },
+	};
+
+	double s = (x + 0.5) * 2 / size - 1;
+	double t = (y + 0.5) * 2 / size - 1;
+	double length = sqrt(1 + s * s + t * t);
+	for (int i = 0; i < 3; i++)
+		direction[i] = (axes[face][0][i] + axes[face][1][i] * s + axes[face][2][i] * t) / length;
+
+	// Area on the face over distance cubed
+	double area = 4.0 / ((double)size * size);
+	solidAngle = area / (length * length * length);
+}
+
+static CubeImage MakeCube(unsigned int size, const std::function<XMFLOAT3(float, float, float)>& radiance)
+{
+	CubeImage cube;
+	cube.Size = size;
+	for (unsigned int f = 0; f < 6; f++)
+	{
+		cube.Faces[f].resize((size_t)size * size * 4);
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				double d[3], solidAngle;
+				GetTexel(f, x, y, size, d, solidAngle);
+				XMFLOAT3 color = radiance((float)d[0], (float)d[1], (float)d[2]);
+				float* texel = &cube.Faces[f][((size_t)y * size + x) * 4];
+				texel[0] = color.x;
+				texel[1] = color.y;
+				texel[2] = color.z;
+				texel[3] = 1.0f;
+			}
+		}
+	}
+	return cube;
+}
+
+// A sky gradient with a soft sun, bright enough to dominate
+static CubeImage MakeSky(unsigned int size)
+{
+	return MakeCube(size, [](float x, float y, float z) {
+		float sun = powf(fmaxf(0.0f, 0.6f * x + 0.8f * y), 8.0f) * 5.0f;
+		float sky = 0.6f + 0.4f * y;
+		return XMFLOAT3(sky * 0.4f + sun, sky * 0.6f + sun, sky + sun * 0.8f + 0.1f * z); });
+}
+
+// --------------------------------------------------------
+// Brute force: every source texel, weighted by the lobe
+// around the direction, in double precision
+// --------------------------------------------------------
+static void Integrate(const CubeImage& source, const std::function<double(const double*)>& lobe, double result[3])
+{
+	double total[3] = {};
+	double weights = 0;
+	for (unsigned int f = 0; f < 6; f++)
+	{
+		for (unsigned int y = 0; y < source.Size; y++)
+		{
+			for (unsigned int x = 0; x < source.Size; x++)
+			{
+				double l[3], solidAngle;
+				GetTexel(f, x, y, source.Size, l, solidAngle);
+				double weight = lobe(l) * solidAngle;
+				if (weight <= 0)
+					continue;
+
+				const float* texel = &source.Faces[f][((size_t)y * source.Size + x) * 4];
+				for (int c = 0; c < 3; c++)
+					total[c] += texel[c] * weight;
+				weights += weight;
+			}
+		}
+	}
+	for (int c = 0; c < 3; c++)
+		result[c] = total[c] / weights;
+}
+
+// Largest difference of a baked cube from the brute force one,
+// relative to the brute force value
+static double CheckCube(const CubeImage& source, const CubeImage& baked, const std::function<double(const double*, const double*)>& lobe)
+{
+	double worst = 0;
+	for (unsigned int f = 0; f < 6; f++)
+	{
+		for (unsigned int y = 0; y < baked.Size; y++)
+		{
+			for (unsigned int x = 0; x < baked.Size; x++)
+			{
+				double n[3], solidAngle;
+				GetTexel(f, x, y, baked.Size, n, solidAngle);
+				double expected[3];
+				Integrate(source, [&](const double* l) { return lobe(n, l); }, expected);
+
+				const float* texel = &baked.Faces[f][((size_t)y * baked.Size + x) * 4];
+				for (int c = 0; c < 3; c++)
+					worst = fmax(worst, fabs(texel[c] - expected[c]) / expected[c]);
+			}
+		}
+	}
+	return worst;
+}
+
+static double Dot(const double* a, const double* b)
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// GGX, roughness squared first like D_GGX() in the shaders
+static double D_GGX(double NdotH, double roughness)
+{
+	double a2 = roughness * roughness * roughness * roughness;
+	double denom = NdotH * NdotH * (a2 - 1) + 1;
+	return a2 / (Pi * denom * denom);
+}
+
+// Small enough to brute force: 16^2 source texels a face, and
+// enough samples that sampling noise is small next to the
+// error being checked for
+static IBLBakeSettings GetLowResSettings()
+{
+	IBLBakeSettings settings;
+	settings.SpecularSize = 8;
+	settings.SpecularMips = 3;		// Roughness 0, 0.5, 1
+	settings.SpecularSamples = 512;
+	settings.IrradianceSize = 4;
+	settings.IrradianceSamples = 512;
+	settings.LookUpSize = 10;
+	settings.LookUpSamples = 1024;
+	return settings;
+}
+
+// --------------------------------------------------------
+// A bake against brute force: irradiance is the cosine
+// weighted average of the sky around each normal, and each
+// rough specular mip the split sum's first half with
+// n = v = r - the sky over the GGX lobe's reflections,
+// weighted by NdotL
+// --------------------------------------------------------
+static void CheckBake(const IBLBakeSettings& settings, double irradianceTolerance, double specularTolerance)
+{
+	StartJobs();
+	CubeImage source = MakeSky(16);
+	IBLBakeResult result;
+	BakeIBL(source, settings, result);
+
+	CHECK(result.Irradiance.Size == 4);
+	double error = CheckCube(source, result.Irradiance, [](const double* n, const double* l) { return fmax(Dot(n, l), 0.0); });
+	printf("  Irradiance off by %.2f%%\n", error * 100);
+	CHECK(error <= irradianceTolerance);
+
+	CHECK(result.Specular.size() == 3);
+	const double roughnesses[] = { 0.5, 1.0 };
+	for (int i = 0; i < 2; i++)
+	{
+		double roughness = roughnesses[i];
+		const CubeImage& baked = result.Specular[i + 1];
+		CHECK(baked.Size == 8u >> (i + 1));
+		error = CheckCube(source, baked, [roughness](const double* n, const double* l) {
+			double NdotL = Dot(n, l);
+			if (NdotL <= 0)
+				return 0.0;
+			double h[3] = { n[0] + l[0], n[1] + l[1], n[2] + l[2] };
+			double NdotH = Dot(n, h) / sqrt(Dot(h, h));
+			return D_GGX(NdotH, roughness) * NdotL; });
+		printf("  Roughness %.1f off by %.2f%%\n", roughness, error * 100);
+		CHECK(error <= specularTolerance);
+	}
+}
+
+TEST(BakeMatchesBruteForce)
+{
+	CheckBake(GetLowResSettings(), 0.02, 0.03);
+}
+
+TEST(DefaultSampleCountsStayClose)
+{
+	// The game's sample counts: the cheap mips blur the sun a bit
+	IBLBakeSettings settings = GetLowResSettings();
+	settings.SpecularSamples = IBLBakeSettings().SpecularSamples;
+	settings.IrradianceSamples = IBLBakeSettings().IrradianceSamples;
+	CheckBake(settings, 0.04, 0.15);
+}
+
+TEST(MirrorMipIsTheSource)
+{
+	// Roughness 0 just resamples the source - at the same size,
+	// that's every texel exactly
+	StartJobs();
+	CubeImage source = MakeSky(8);
+	IBLBakeResult result;
+	BakeIBL(source, GetLowResSettings(), result);
+
+	const CubeImage& mirror = result.Specular[0];
+	CHECK(mirror.Size == 8);
+	float error = 0.0f;
+	for (int f = 0; f < 6; f++)
+	{
+		for (size_t i = 0; i < source.Faces[f].size(); i++)
+			error = fmaxf(error, fabsf(mirror.Faces[f][i] - source.Faces[f][i]));
+	}
+	CHECK(error <= 1e-5f);
+}
+
+// --------------------------------------------------------
+// The split sum's second half at one (NdotV, roughness), in
+// double precision over a fine grid of light directions:
+//
+//   scale = integral of D G (1 - Fc) / (4 NdotV)
+//   bias  = integral of D G Fc / (4 NdotV)
+//
+// with Fc = (1 - VdotH)^5 and Schlick-Smith G, k = a / 2
+// --------------------------------------------------------
+static void IntegrateLookUp(double NdotV, double roughness, double& scale, double& bias)
+{
+	double a = roughness * roughness;
+	double k = a / 2;
+	double v[3] = { sqrt(1 - NdotV * NdotV), 0, NdotV };
+	double gv = NdotV / (NdotV * (1 - k) + k);
+
+	const int thetaSteps = 1024;
+	const int phiSteps = 2048;
+	double dTheta = Pi / 2 / thetaSteps;
+	double dPhi = 2 * Pi / phiSteps;
+	scale = bias = 0;
+	for (int i = 0; i < thetaSteps; i++)
+	{
+		double theta = (i + 0.5) * dTheta;
+		double NdotL = cos(theta);
+		double gl = NdotL / (NdotL * (1 - k) + k);
+		for (int j = 0; j < phiSteps; j++)
+		{
+			double phi = (j + 0.5) * dPhi;
+			double l[3] = { sin(theta) * cos(phi), sin(theta) * sin(phi), NdotL };
+			double h[3] = { v[0] + l[0], v[1] + l[1], v[2] + l[2] };
+			double length = sqrt(Dot(h, h));
+			double NdotH = h[2] / length;
+			double VdotH = Dot(v, h) / length;
+
+			double fc = pow(1 - VdotH, 5);
+			double f = D_GGX(NdotH, roughness) * gv * gl / (4 * NdotV) * sin(theta) * dTheta * dPhi;
+			scale += f * (1 - fc);
+			bias += f * fc;
+		}
+	}
+}
+
+TEST(LookUpMatchesIntegral)
+{
+	StartJobs();
+	IBLBakeResult result;
+	BakeIBL(MakeSky(4), GetLowResSettings(), result);
+	CHECK(result.LookUpSize == 10);
+
+	// Texel centers: NdotV across, roughness down, (i + 0.5) / 10
+	const unsigned int points[][2] = { { 2, 2 }, { 5, 2 }, { 9, 2 }, { 2, 5 }, { 5, 5 }, { 9, 5 }, { 2, 9 }, { 5, 9 }, { 9, 9 } };
+	double worst = 0;
+	for (const auto& point : points)
+	{
+		double NdotV = (point[0] + 0.5) / 10;
+		double roughness = (point[1] + 0.5) / 10;
+		double scale, bias;
+		IntegrateLookUp(NdotV, roughness, scale, bias);
+
+		const float* baked = &result.LookUp[(point[1] * 10 + point[0]) * 2];
+		worst = fmax(worst, fabs(baked[0] - scale));
+		worst = fmax(worst, fabs(baked[1] - bias));
+	}
+	printf("  Look up table off by %g\n", worst);
+	CHECK(worst <= 0.01);
+}
+
+TEST(SmoothLookUpIsFresnel)
+{
+	// Nearly a mirror: h = n, so G = 1 and the visibility term
+	// is exactly 1, leaving scale = 1 - Fc and bias = Fc with
+	// VdotH = NdotV
+	StartJobs();
+	IBLBakeSettings settings = GetLowResSettings();
+	settings.LookUpSize = 64;	// First row is roughness 1/128
+	IBLBakeResult result;
+	BakeIBL(MakeSky(4), settings, result);
+
+	// Away from grazing, where even this little roughness tilts
+	// VdotH noticeably
+	for (unsigned int x = 4; x < 64; x += 7)
+	{
+		float NdotV = (x + 0.5f) / 64;
+		float fc = powf(1 - NdotV, 5);
+		CHECK_NEAR(result.LookUp[x * 2 + 0], 1 - fc, 2e-3f);
+		CHECK_NEAR(result.LookUp[x * 2 + 1], fc, 2e-3f);
+	}
+}
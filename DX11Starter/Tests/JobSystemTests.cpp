@@ -0,0 +1,189 @@
+#include "TestFramework.h"
+#include "JobSystem.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// --------------------------------------------------------
+// Stress tests for the scheduler.  They're also built with
+// ThreadSanitizer (JobSystemTests_TSan), which catches data
+// races that happen not to break the counts here.
+// --------------------------------------------------------
+static JobSystem& StartJobs()
+{
+	JobSystem& jobs = JobSystem::GetInstance();
+	jobs.Initialize(4);
+	return jobs;
+}
+
+// Every index of a ParallelFor is visited exactly once
+static bool CoversOnce(JobSystem& jobs, unsigned int count, unsigned int grain)
+{
+	std::unique_ptr<std::atomic<int>[]> visits(new std::atomic<int>[count]);
+	for (unsigned int i = 0; i < count; i++)
+		visits[i].store(0, std::memory_order_relaxed);
+
+	jobs.ParallelFor(count, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; i++)
+			visits[i].fetch_add(1, std::memory_order_relaxed);
+	}, grain);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (visits[i].load(std::memory_order_relaxed) != 1)
+			return false;
+	}
+	return true;
+}
+
+TEST(ParallelForCoversEveryIndex)
+{
+	JobSystem& jobs = StartJobs();
+	const unsigned int counts[] = { 1, 2, 7, 100, 4096, 100000 };
+	for (unsigned int count : counts)
+	{
+		CHECK(CoversOnce(jobs, count, 1));
+		CHECK(CoversOnce(jobs, count, 64));
+	}
+}
+
+// ParallelFors inside ParallelFors, as mip generation inside
+// parallel texture loading does
+TEST(NestedParallelFor)
+{
+	JobSystem& jobs = StartJobs();
+	std::atomic<unsigned int> total(0);
+	for (int round = 0; round < 20; round++)
+	{
+		jobs.ParallelFor(32, [&](unsigned int begin, unsigned int end) {
+			for (unsigned int i = begin; i < end; i++)
+			{
+				jobs.ParallelFor(100, [&](unsigned int b, unsigned int e) {
+					total.fetch_add(e - b, std::memory_order_relaxed);
+				});
+			}
+		});
+	}
+	CHECK(total.load() == 20u * 32u * 100u);
+}
+
+// A parent with many children (under the pool size) only
+// finishes once they all have
+TEST(ChildJobs)
+{
+	JobSystem& jobs = StartJobs();
+	static std::atomic<int> ran;
+	for (int round = 0; round < 50; round++)
+	{
+		ran.store(0);
+		Job* root = jobs.CreateJob([](Job*, const void*) {});
+		for (int i = 0; i < 2000; i++)
+		{
+			jobs.Run(jobs.CreateChildJob(root, [](Job*, const void*) {
+				ran.fetch_add(1, std::memory_order_relaxed); }));
+		}
+		jobs.Run(root);
+		jobs.Wait(root);
+		CHECK(jobs.IsComplete(root));
+		CHECK(ran.load() == 2000);
+	}
+}
+
+// --------------------------------------------------------
+// More outside threads than there are external slots (8),
+// all using the job system at once.  The ones without a
+// slot run their jobs inline instead of sharing a queue.
+// --------------------------------------------------------
+TEST(ManyExternalThreads)
+{
+	JobSystem& jobs = StartJobs();
+	const int threadCount = 20;
+	std::atomic<int> failures(0);
+	std::atomic<bool> go(false);
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads.push_back(std::thread([&]() {
+			while (!go.load())
+				std::this_thread::yield();
+
+			for (int round = 0; round < 50; round++)
+			{
+				std::atomic<unsigned int> sum(0);
+				jobs.ParallelFor(1000, [&](unsigned int begin, unsigned int end) {
+					for (unsigned int i = begin; i < end; i++)
+						sum.fetch_add(i, std::memory_order_relaxed);
+				}, 16);
+				if (sum.load() != 999u * 1000u / 2)
+					failures++;
+			}
+		}));
+	}
+	go = true;
+	for (std::thread& thread : threads)
+		thread.join();
+
+	CHECK(failures.load() == 0);
+}
+
+// Deleting the instance (as the game does on the way out)
+// lets GetInstance() make a working new one
+TEST(DeleteAndRecreate)
+{
+	for (int round = 0; round < 3; round++)
+	{
+		JobSystem* before = &StartJobs();
+		CHECK(CoversOnce(*before, 5000, 8));
+		delete before;
+
+		JobSystem& after = JobSystem::GetInstance();
+		after.Initialize(2);
+		CHECK(CoversOnce(after, 5000, 8));
+		after.Shutdown();
+	}
+
+	// Not initialized at all, everything runs inline
+	JobSystem& idle = JobSystem::GetInstance();
+	CHECK(CoversOnce(idle, 300, 1));
+	delete &idle;
+}
+
+// --------------------------------------------------------
+// The main thread held slot 0 before the instance was
+// recreated.  A new outside thread must not be handed that
+// same slot while main still thinks it owns it - two owners
+// of one deque is a race (which TSan reports) even when the
+// sums happen to come out right.
+// --------------------------------------------------------
+TEST(RecreateThenOutsideThread)
+{
+	for (int round = 0; round < 3; round++)
+	{
+		JobSystem* before = &StartJobs();
+		CHECK(CoversOnce(*before, 5000, 8));
+		delete before;
+
+		JobSystem& after = StartJobs();
+		std::atomic<int> failures(0);
+		std::atomic<bool> go(false);
+		std::thread outside([&]() {
+			while (!go.load())
+				std::this_thread::yield();
+			for (int i = 0; i < 50; i++)
+			{
+				if (!CoversOnce(after, 2000, 4))
+					failures++;
+			}
+		});
+
+		go = true;
+		for (int i = 0; i < 50; i++)
+		{
+			if (!CoversOnce(after, 2000, 4))
+				failures++;
+		}
+		outside.join();
+		CHECK(failures.load() == 0);
+	}
+}
@@ -0,0 +1,302 @@
+#include "TestFramework.h"
+#include "LightClusterBins.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Binning is spread across the job system, like in the game
+static void StartJobs()
+{
+	static bool started = false;
+	if (!started)
+		JobSystem::GetInstance().Initialize();
+	started = true;
+}
+
+// Same small LCG everywhere, so failures repeat
+static float Random(unsigned int& state, float low, float high)
+{
+	state = state * 1664525u + 1013904223u;
+	return low + (high - low) * ((state >> 8) / 16777216.0f);
+}
+
+// A left handed perspective projection, like XMMatrixPerspectiveFovLH()
+static XMFLOAT4X4 MakeProjection(float fov, float aspect, float nearZ, float farZ)
+{
+	XMFLOAT4X4 p = {};
+	float yScale = 1.0f / tanf(fov * 0.5f);
+	p._11 = yScale / aspect;
+	p._22 = yScale;
+	p._33 = farZ / (farZ - nearZ);
+	p._34 = 1.0f;
+	p._43 = -nearZ * farZ / (farZ - nearZ);
+	return p;
+}
+
+// Just a move, so world & view space only differ by an offset
+static XMFLOAT4X4 MakeView(const XMFLOAT3& cameraPosition)
+{
+	XMFLOAT4X4 v = {};
+	v._11 = v._22 = v._33 = v._44 = 1.0f;
+	v._41 = -cameraPosition.x;
+	v._42 = -cameraPosition.y;
+	v._43 = -cameraPosition.z;
+	return v;
+}
+
+static Light MakeLight(int type, const XMFLOAT3& position, float range)
+{
+	Light light = {};
+	light.Type = type;
+	light.Position = position;
+	light.Range = range;
+	light.Intensity = 1.0f;
+	light.Color = XMFLOAT3(1, 1, 1);
+	light.Direction = XMFLOAT3(0, 0, 1);
+	light.ShadowIndex = -1;
+	return light;
+}
+
+// --------------------------------------------------------
+// The cluster a view space point is in, worked out the way
+// the pixel shader does it: tile from the screen position,
+// slice from the depth
+// --------------------------------------------------------
+static unsigned int GetCluster(const XMFLOAT3& point, const XMFLOAT4X4& projection)
+{
+	float nearZ, farZ, clusterNear, depthScale;
+	LightClusterBins::GetSliceParams(projection, nearZ, farZ, clusterNear, depthScale);
+
+	float ndcX = point.x / point.z * projection._11 + projection._31;
+	float ndcY = point.y / point.z * projection._22 + projection._32;
+	unsigned int x = std::min((unsigned int)((ndcX + 1.0f) * 0.5f * LightClusterBins::CountX), LightClusterBins::CountX - 1);
+	unsigned int y = std::min((unsigned int)((1.0f - ndcY) * 0.5f * LightClusterBins::CountY), LightClusterBins::CountY - 1);
+	unsigned int z = LightClusterBins::GetSlice(point.z, clusterNear, depthScale);
+	return x + y * LightClusterBins::CountX + z * LightClusterBins::CountX * LightClusterBins::CountY;
+}
+
+// A random point in the view frustum
+static XMFLOAT3 RandomViewPoint(unsigned int& state, const XMFLOAT4X4& projection, float nearZ, float farZ)
+{
+	float ndcX = Random(state, -0.999f, 0.999f);
+	float ndcY = Random(state, -0.999f, 0.999f);
+	float depth = nearZ * powf(farZ / nearZ, Random(state, 0.001f, 0.999f));
+	return XMFLOAT3(ndcX * depth / projection._11, ndcY * depth / projection._22, depth);
+}
+
+static bool ListContains(const std::vector<ClusterRange>& ranges, const std::vector<unsigned int>& indices, unsigned int cluster, unsigned int light)
+{
+	const ClusterRange& range = ranges[cluster];
+	return std::find(indices.begin() + range.Offset, indices.begin() + range.Offset + range.Count, light) !=
+		indices.begin() + range.Offset + range.Count;
+}
+
+static float DistanceToBoxSq(const XMFLOAT3& p, const LightClusterBins::ClusterBounds& b)
+{
+	float dx = std::max(0.0f, std::max(b.Min.x - p.x, p.x - b.Max.x));
+	float dy = std::max(0.0f, std::max(b.Min.y - p.y, p.y - b.Max.y));
+	float dz = std::max(0.0f, std::max(b.Min.z - p.z, p.z - b.Max.z));
+	return dx * dx + dy * dy + dz * dz;
+}
+
+TEST(SliceParams)
+{
+	XMFLOAT4X4 projection = MakeProjection(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 100.0f);
+	float nearZ, farZ, clusterNear, depthScale;
+	LightClusterBins::GetSliceParams(projection, nearZ, farZ, clusterNear, depthScale);
+	CHECK_NEAR(nearZ, 0.1f, 1e-4f);
+	CHECK_NEAR(farZ, 100.0f, 0.05f);
+	CHECK_NEAR(clusterNear, 0.5f, 1e-6f);
+
+	// Slice 0 up to clusterNear, then exponential out to the far plane
+	CHECK(LightClusterBins::GetSlice(nearZ, clusterNear, depthScale) == 0);
+	CHECK(LightClusterBins::GetSlice(clusterNear * 0.99f, clusterNear, depthScale) == 0);
+	CHECK(LightClusterBins::GetSlice(clusterNear * 1.01f, clusterNear, depthScale) == 1);
+	CHECK(LightClusterBins::GetSlice(farZ * 0.99f, clusterNear, depthScale) == LightClusterBins::CountZ - 1);
+	CHECK(LightClusterBins::GetSlice(farZ * 10.0f, clusterNear, depthScale) == LightClusterBins::CountZ - 1);
+
+	unsigned int previous = 0;
+	for (float depth = nearZ; depth < farZ; depth *= 1.01f)
+	{
+		unsigned int slice = LightClusterBins::GetSlice(depth, clusterNear, depthScale);
+		CHECK(slice == previous || slice == previous + 1);
+		previous = slice;
+	}
+}
+
+TEST(ClusterBoundsHoldTheirPoints)
+{
+	XMFLOAT4X4 projection = MakeProjection(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 100.0f);
+	LightClusterBins bins;
+	bins.UpdateClusterBounds(projection);
+
+	// Slices meet end to end, from the near plane to the far one
+	const unsigned int sliceSize = LightClusterBins::CountX * LightClusterBins::CountY;
+	CHECK_NEAR(bins.GetClusterBounds(0).Min.z, 0.1f, 1e-4f);
+	CHECK_NEAR(bins.GetClusterBounds(LightClusterBins::ClusterCount - 1).Max.z, 100.0f, 0.05f);
+	for (unsigned int z = 1; z < LightClusterBins::CountZ; z++)
+		CHECK_NEAR(bins.GetClusterBounds(z * sliceSize).Min.z, bins.GetClusterBounds((z - 1) * sliceSize).Max.z, 1e-4f);
+
+	// Tile rows go top to bottom
+	CHECK(bins.GetClusterBounds(0).Min.y > bins.GetClusterBounds(sliceSize - 1).Max.y);
+	CHECK(bins.GetClusterBounds(0).Max.x < bins.GetClusterBounds(sliceSize - 1).Min.x);
+
+	// Any point in the frustum is in the box of the cluster the shader would pick
+	unsigned int state = 1;
+	int outside = 0;
+	for (int i = 0; i < 20000; i++)
+	{
+		XMFLOAT3 p = RandomViewPoint(state, projection, 0.1f, 100.0f);
+		const LightClusterBins::ClusterBounds& b = bins.GetClusterBounds(GetCluster(p, projection));
+		float slack = 1e-4f * p.z;
+		if (p.x < b.Min.x - slack || p.x > b.Max.x + slack ||
+			p.y < b.Min.y - slack || p.y > b.Max.y + slack ||
+			p.z < b.Min.z - slack || p.z > b.Max.z + slack)
+			outside++;
+	}
+	CHECK(outside == 0);
+}
+
+// --------------------------------------------------------
+// Bins a random scene, then checks it against brute force:
+//  - every point inside a light's range is in a cluster that
+//    lists that light (nothing visible goes missing)
+//  - every listed light really reaches its cluster's box
+//  - lists are packed in order, sorted, with no repeats
+// --------------------------------------------------------
+static void CheckAgainstBruteForce(unsigned int seed, const XMFLOAT3& cameraPosition, unsigned int lightCount, float maxRange)
+{
+	StartJobs();
+	const float nearZ = 0.1f, farZ = 100.0f;
+	XMFLOAT4X4 projection = MakeProjection(XM_PIDIV4, 16.0f / 9.0f, nearZ, farZ);
+	XMFLOAT4X4 view = MakeView(cameraPosition);
+
+	unsigned int state = seed;
+	std::vector<Light> lights;
+	for (unsigned int i = 0; i < lightCount; i++)
+	{
+		// A few of every type, some behind the camera or past the far plane
+		int type = i % 7 == 0 ? LIGHT_TYPE_DIRECTIONAL : (i % 2 ? LIGHT_TYPE_POINT : LIGHT_TYPE_SPOT);
+		XMFLOAT3 position(
+			cameraPosition.x + Random(state, -60.0f, 60.0f),
+			cameraPosition.y + Random(state, -35.0f, 35.0f),
+			cameraPosition.z + Random(state, -10.0f, 110.0f));
+		lights.push_back(MakeLight(type, position, Random(state, 0.5f, maxRange)));
+	}
+	lights.push_back(MakeLight(LIGHT_TYPE_POINT, cameraPosition, 3.0f));	// Around the camera
+	lights.push_back(MakeLight(LIGHT_TYPE_POINT, XMFLOAT3(0, 0, 20), 0.0f));	// No range at all
+
+	LightClusterBins bins;
+	std::vector<ClusterRange> ranges;
+	std::vector<unsigned int> indices;
+	bins.Bin(lights, view, projection, ranges, indices);
+	CHECK(ranges.size() == LightClusterBins::ClusterCount);
+
+	// Packing
+	unsigned int offset = 0;
+	for (const ClusterRange& range : ranges)
+	{
+		CHECK(range.Offset == offset);
+		for (unsigned int i = 1; i < range.Count; i++)
+			CHECK(indices[range.Offset + i - 1] < indices[range.Offset + i]);
+		offset += range.Count;
+	}
+	CHECK(offset == indices.size());
+
+	// Listed lights reach the box, and are only point & spot ones
+	int wrongBox = 0, wrongType = 0;
+	for (unsigned int c = 0; c < LightClusterBins::ClusterCount; c++)
+	{
+		for (unsigned int i = ranges[c].Offset; i < ranges[c].Offset + ranges[c].Count; i++)
+		{
+			const Light& light = lights[indices[i]];
+			XMFLOAT3 center(
+				light.Position.x - cameraPosition.x,
+				light.Position.y - cameraPosition.y,
+				light.Position.z - cameraPosition.z);
+			if (light.Type == LIGHT_TYPE_DIRECTIONAL || light.Range <= 0.0f)
+				wrongType++;
+			else if (DistanceToBoxSq(center, bins.GetClusterBounds(c)) > light.Range * light.Range * 1.0001f)
+				wrongBox++;
+		}
+	}
+	CHECK(wrongType == 0);
+	CHECK(wrongBox == 0);
+
+	// Points in range of each light (just inside it, so float
+	// rounding at the cluster edges doesn't matter) & on screen
+	int missing = 0, tested = 0;
+	for (unsigned int l = 0; l < lights.size(); l++)
+	{
+		const Light& light = lights[l];
+		if (light.Type == LIGHT_TYPE_DIRECTIONAL || light.Range <= 0.0f)
+			continue;
+
+		XMFLOAT3 center(
+			light.Position.x - cameraPosition.x,
+			light.Position.y - cameraPosition.y,
+			light.Position.z - cameraPosition.z);
+		for (int s = 0; s < 400; s++)
+		{
+			XMFLOAT3 p(
+				center.x + Random(state, -1.0f, 1.0f) * light.Range,
+				center.y + Random(state, -1.0f, 1.0f) * light.Range,
+				center.z + Random(state, -1.0f, 1.0f) * light.Range);
+			float dx = p.x - center.x, dy = p.y - center.y, dz = p.z - center.z;
+			if (dx * dx + dy * dy + dz * dz > light.Range * light.Range * 0.98f)
+				continue;
+			if (p.z < nearZ * 1.001f || p.z > farZ * 0.999f ||
+				fabsf(p.x / p.z * projection._11) > 0.999f || fabsf(p.y / p.z * projection._22) > 0.999f)
+				continue;
+
+			tested++;
+			if (!ListContains(ranges, indices, GetCluster(p, projection), l))
+				missing++;
+		}
+	}
+	CHECK(tested > 1000);
+	if (missing)
+		printf("  %d of %d points in range weren't in a cluster listing the light\n", missing, tested);
+	CHECK(missing == 0);
+}
+
+TEST(BinningMatchesBruteForce)
+{
+	CheckAgainstBruteForce(7, XMFLOAT3(0, 0, 0), 200, 8.0f);
+}
+
+TEST(BinningMatchesBruteForceBigLights)
+{
+	// Big spheres span many slices & reach the near plane
+	CheckAgainstBruteForce(11, XMFLOAT3(5, -3, 40), 60, 30.0f);
+}
+
+TEST(BinningReusesLists)
+{
+	// Binning a second time (fewer lights, new projection) starts fresh
+	StartJobs();
+	XMFLOAT4X4 view = MakeView(XMFLOAT3(0, 0, 0));
+	std::vector<Light> lights;
+	lights.push_back(MakeLight(LIGHT_TYPE_POINT, XMFLOAT3(0, 0, 10), 2.0f));
+	lights.push_back(MakeLight(LIGHT_TYPE_POINT, XMFLOAT3(3, 0, 10), 2.0f));
+
+	LightClusterBins bins;
+	std::vector<ClusterRange> ranges;
+	std::vector<unsigned int> indices;
+	bins.Bin(lights, view, MakeProjection(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 100.0f), ranges, indices);
+	size_t first = indices.size();
+	CHECK(first > 0);
+
+	lights.pop_back();
+	bins.Bin(lights, view, MakeProjection(XM_PIDIV2, 1.0f, 0.1f, 50.0f), ranges, indices);
+	CHECK(indices.size() > 0);
+	CHECK(indices.size() < first);
+	for (unsigned int index : indices)
+		CHECK(index == 0);
+
+	lights.clear();
+	bins.Bin(lights, view, MakeProjection(XM_PIDIV2, 1.0f, 0.1f, 50.0f), ranges, indices);
+	CHECK(indices.empty());
+}
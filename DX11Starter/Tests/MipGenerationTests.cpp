@@ -0,0 +1,287 @@
+#include "TestFramework.h"
+#include "MipGeneration.h"
+#include "JobSystem.h"
+#include <cmath>
+
+// Mips are made across the job system, like in the game
+static void StartJobs()
+{
+	static bool started = false;
+	if (!started)
+		JobSystem::GetInstance().Initialize();
+	started = true;
+}
+
+static TextureImage MakeImage(unsigned int width, unsigned int height, unsigned int channels)
+{
+	TextureImage image = {};
+	image.Width = width;
+	image.Height = height;
+	image.Channels = channels;
+	image.Pixels.resize((size_t)width * height * channels);
+	return image;
+}
+
+static unsigned char& Texel(TextureImage& image, unsigned int x, unsigned int y, unsigned int c)
+{
+	return image.Pixels[((size_t)y * image.Width + x) * image.Channels + c];
+}
+
+static MipSettings MakeSettings(int filter, bool sRGB)
+{
+	MipSettings settings;
+	settings.Filter = filter;
+	settings.SRGB = sRGB;
+	return settings;
+}
+
+TEST(ChainSizes)
+{
+	StartJobs();
+	std::vector<TextureImage> mips;
+	GenerateMips(MakeImage(64, 16, 4), MakeSettings(MIP_FILTER_KAISER, false), mips);
+
+	CHECK(mips.size() == 7);
+	for (size_t m = 0; m < mips.size(); m++)
+	{
+		CHECK(mips[m].Width == std::max(1u, 64u >> m));
+		CHECK(mips[m].Height == std::max(1u, 16u >> m));
+		CHECK(mips[m].Pixels.size() == (size_t)mips[m].Width * mips[m].Height * 4);
+	}
+}
+
+// --------------------------------------------------------
+// Flat images of every 8 bit value come back unchanged in
+// every mip, through sRGB decoding & encoding with both
+// filters - no code drifts up or down on the way
+// --------------------------------------------------------
+TEST(SRGBRoundTrip)
+{
+	StartJobs();
+	const int filters[] = { MIP_FILTER_BOX, MIP_FILTER_KAISER };
+	for (int filter : filters)
+	{
+		int mismatches = 0;
+		for (int value = 0; value < 256; value++)
+		{
+			TextureImage image = MakeImage(16, 16, 4);
+			for (unsigned char& p : image.Pixels)
+				p = (unsigned char)value;
+
+			std::vector<TextureImage> mips;
+			GenerateMips(image, MakeSettings(filter, true), mips);
+			for (const TextureImage& mip : mips)
+			{
+				for (unsigned char p : mip.Pixels)
+					mismatches += p != value ? 1 : 0;
+			}
+		}
+		CHECK(mismatches == 0);
+	}
+}
+
+// --------------------------------------------------------
+// Black & white texels average in linear light: half the
+// light, which is 188 in sRGB (not 128, as averaging the
+// encoded values would give)
+// --------------------------------------------------------
+TEST(SRGBAveragesLinearLight)
+{
+	StartJobs();
+	TextureImage image = MakeImage(8, 8, 4);
+	for (unsigned int y = 0; y < 8; y++)
+	{
+		for (unsigned int x = 0; x < 8; x++)
+		{
+			for (unsigned int c = 0; c < 3; c++)
+				Texel(image, x, y, c) = (x + y) % 2 ? 255 : 0;
+			Texel(image, x, y, 3) = 255;
+		}
+	}
+
+	std::vector<TextureImage> linear, encoded;
+	GenerateMips(image, MakeSettings(MIP_FILTER_BOX, true), linear);
+	GenerateMips(image, MakeSettings(MIP_FILTER_BOX, false), encoded);
+
+	CHECK(Texel(linear[1], 0, 0, 0) == 188);
+	CHECK(Texel(linear.back(), 0, 0, 0) == 188);
+	CHECK(Texel(encoded[1], 0, 0, 0) == 128);
+	CHECK(Texel(linear[1], 2, 3, 3) == 255);
+
+	// Gray images fill RGB and keep their one channel
+	TextureImage gray = MakeImage(4, 4, 1);
+	for (unsigned int i = 0; i < 16; i++)
+		gray.Pixels[i] = i % 2 ? 200 : 100;
+	std::vector<TextureImage> grayMips;
+	GenerateMips(gray, MakeSettings(MIP_FILTER_BOX, false), grayMips);
+	CHECK(grayMips[1].Channels == 1);
+	CHECK(grayMips[1].Pixels[0] == 150);
+}
+
+// --------------------------------------------------------
+// The Kaiser filter: its weights sum to one (a checkerboard
+// at the top's Nyquist limit filters to exactly gray), low
+// frequencies pass, and ones the smaller mip can't hold are
+// cut far more than the box filter cuts them (instead of
+// aliasing into coarser waves)
+// --------------------------------------------------------
+
+// Contrast (standard deviation) along one row
+static float RowDeviation(const TextureImage& image)
+{
+	float mean = 0.0f, variance = 0.0f;
+	for (unsigned int x = 0; x < image.Width; x++)
+		mean += image.Pixels[x * image.Channels] / (float)image.Width;
+	for (unsigned int x = 0; x < image.Width; x++)
+	{
+		float d = image.Pixels[x * image.Channels] - mean;
+		variance += d * d / image.Width;
+	}
+	return sqrtf(variance);
+}
+
+// How much of a wave period texels long (across a 96 texel
+// image) survives into the first mip, relative to the top
+static float WaveResponse(int filter, float period)
+{
+	const unsigned int width = 96;
+	TextureImage wave = MakeImage(width, 4, 4);
+	for (unsigned int x = 0; x < width; x++)
+	{
+		float value = 127.5f + 100.0f * cosf(2.0f * 3.14159265f * x / period);
+		for (unsigned int y = 0; y < 4; y++)
+			for (unsigned int c = 0; c < 4; c++)
+				Texel(wave, x, y, c) = (unsigned char)(value + 0.5f);
+	}
+
+	std::vector<TextureImage> mips;
+	GenerateMips(wave, MakeSettings(filter, false), mips);
+	return RowDeviation(mips[1]) / RowDeviation(wave);
+}
+
+TEST(KaiserFilter)
+{
+	StartJobs();
+	TextureImage checker = MakeImage(32, 32, 4);
+	for (unsigned int y = 0; y < 32; y++)
+		for (unsigned int x = 0; x < 32; x++)
+			for (unsigned int c = 0; c < 4; c++)
+				Texel(checker, x, y, c) = (x + y) % 2 ? 255 : 0;
+
+	std::vector<TextureImage> mips;
+	GenerateMips(checker, MakeSettings(MIP_FILTER_KAISER, false), mips);
+	for (size_t m = 1; m < mips.size(); m++)
+	{
+		for (unsigned char p : mips[m].Pixels)
+			CHECK(p == 127 || p == 128);
+	}
+
+	// Well below the mip's limit (4 texels of the top) both pass it
+	float boxLow = WaveResponse(MIP_FILTER_BOX, 32.0f);
+	float kaiserLow = WaveResponse(MIP_FILTER_KAISER, 32.0f);
+	CHECK(boxLow > 0.95f);
+	CHECK(kaiserLow > 0.95f);
+
+	// Past it, the box lets a good part of the wave through as
+	// an alias (cos(pi / period) of it), and the Kaiser far less
+	float boxHigh = WaveResponse(MIP_FILTER_BOX, 2.4f);
+	float kaiserHigh = WaveResponse(MIP_FILTER_KAISER, 2.4f);
+	printf("  Response at 32 texels: box %.3f, Kaiser %.3f; at 2.4 texels: box %.3f, Kaiser %.3f\n",
+		boxLow, kaiserLow, boxHigh, kaiserHigh);
+	CHECK_NEAR(boxHigh, cosf(3.14159265f / 2.4f), 0.02f);
+	CHECK(kaiserHigh < 0.1f);
+	CHECK(WaveResponse(MIP_FILTER_KAISER, 3.0f) < 0.5f * WaveResponse(MIP_FILTER_BOX, 3.0f));
+}
+
+// --------------------------------------------------------
+// Alpha tested foliage: with a cutoff, every mip lets the
+// same share of texels through as the top one, where plain
+// filtering thins it out
+// --------------------------------------------------------
+static float Coverage(const TextureImage& image, float cutoff)
+{
+	size_t passed = 0;
+	size_t count = (size_t)image.Width * image.Height;
+	for (size_t i = 0; i < count; i++)
+		passed += image.Pixels[i * 4 + 3] / 255.0f >= cutoff ? 1 : 0;
+	return (float)passed / count;
+}
+
+TEST(AlphaCoveragePreserved)
+{
+	StartJobs();
+
+	// Blades of grass: thin, soft edged stripes, with a little noise
+	TextureImage grass = MakeImage(128, 128, 4);
+	unsigned int seed = 99;
+	for (unsigned int y = 0; y < 128; y++)
+	{
+		for (unsigned int x = 0; x < 128; x++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			float stripe = 0.5f + 0.5f * cosf(2.0f * 3.14159265f * (x + y * 0.25f) / 6.0f);
+			float alpha = powf(stripe, 4.0f) + ((seed >> 24) / 255.0f - 0.5f) * 0.1f;
+			Texel(grass, x, y, 0) = 40;
+			Texel(grass, x, y, 1) = 160;
+			Texel(grass, x, y, 2) = 30;
+			Texel(grass, x, y, 3) = (unsigned char)(std::min(std::max(alpha, 0.0f), 1.0f) * 255.0f + 0.5f);
+		}
+	}
+
+	const float cutoff = 0.5f;
+	MipSettings plain = MakeSettings(MIP_FILTER_KAISER, true);
+	MipSettings preserved = plain;
+	preserved.AlphaCutoff = cutoff;
+
+	std::vector<TextureImage> plainMips, preservedMips;
+	GenerateMips(grass, plain, plainMips);
+	GenerateMips(grass, preserved, preservedMips);
+
+	float top = Coverage(grass, cutoff);
+	CHECK(top > 0.1f && top < 0.5f);
+	CHECK(Coverage(preservedMips[0], cutoff) == top);
+
+	// Down to 8x8, where a texel is 1/64th of it
+	float worstPlain = 0.0f;
+	for (size_t m = 1; m < preservedMips.size() && preservedMips[m].Width >= 8; m++)
+	{
+		CHECK_NEAR(Coverage(preservedMips[m], cutoff), top, 0.03f);
+		worstPlain = std::max(worstPlain, fabsf(Coverage(plainMips[m], cutoff) - top));
+
+		// Color isn't touched by it
+		CHECK(Texel(preservedMips[m], 1, 1, 1) == Texel(plainMips[m], 1, 1, 1));
+	}
+	printf("  Coverage %.3f at the top; plain mips drift up to %.3f\n", top, worstPlain);
+	CHECK(worstPlain > 0.1f);
+}
+
+// Normal maps come back unit length
+TEST(NormalsRenormalized)
+{
+	StartJobs();
+	TextureImage normals = MakeImage(16, 16, 4);
+	for (unsigned int y = 0; y < 16; y++)
+	{
+		for (unsigned int x = 0; x < 16; x++)
+		{
+			// Alternating tilts, which average to a short vector
+			float n[3] = { (x % 2 ? 0.6f : -0.6f), 0.0f, 0.8f };
+			for (unsigned int c = 0; c < 3; c++)
+				Texel(normals, x, y, c) = (unsigned char)((n[c] * 0.5f + 0.5f) * 255.0f + 0.5f);
+			Texel(normals, x, y, 3) = 255;
+		}
+	}
+
+	MipSettings settings = MakeSettings(MIP_FILTER_BOX, false);
+	settings.NormalMap = true;
+	std::vector<TextureImage> mips;
+	GenerateMips(normals, settings, mips);
+
+	for (size_t m = 1; m < mips.size(); m++)
+	{
+		float n[3];
+		for (unsigned int c = 0; c < 3; c++)
+			n[c] = Texel(mips[m], 0, 0, c) / 255.0f * 2.0f - 1.0f;
+		CHECK_NEAR(sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]), 1.0f, 0.01f);
+	}
+}
@@ -0,0 +1,206 @@
+#include "TestFramework.h"
+#include "RenderTargetPool.h"
+#include <algorithm>
+
+// DXGI_FORMAT values, like the post chain asks for
+#define FORMAT_R16G16B16A16_FLOAT	10
+#define FORMAT_R8G8B8A8_UNORM		28
+
+// Same small LCG everywhere, so failures repeat
+static unsigned int RandomIndex(unsigned int& state, unsigned int count)
+{
+	state = state * 1664525u + 1013904223u;
+	return (state >> 8) % count;
+}
+
+static RenderTargetRequest MakeRequest(unsigned int width, unsigned int height, unsigned int format, unsigned int firstUse, unsigned int lastUse)
+{
+	RenderTargetRequest request = { width, height, format, firstUse, lastUse };
+	return request;
+}
+
+// --------------------------------------------------------
+// Brute force checks of a plan: requests only share a slot
+// that matches them when they're never alive at once, each
+// slot's LastUse covers what's in it, and there are exactly
+// as many slots of each kind as requests of that kind alive
+// at the busiest step (the fewest any plan could use)
+// --------------------------------------------------------
+static void CheckPlan(const RenderTargetPool& pool, const std::vector<RenderTargetRequest>& requests)
+{
+	const std::vector<RenderTargetSlot>& slots = pool.GetSlots();
+	const std::vector<unsigned int>& assignments = pool.GetAssignments();
+	CHECK(assignments.size() == requests.size());
+
+	std::vector<bool> used(slots.size(), false);
+	for (size_t i = 0; i < requests.size(); i++)
+	{
+		CHECK(assignments[i] < slots.size());
+		const RenderTargetSlot& slot = slots[assignments[i]];
+		CHECK(slot.Width == requests[i].Width && slot.Height == requests[i].Height && slot.Format == requests[i].Format);
+		CHECK(slot.LastUse >= requests[i].LastUse);
+		used[assignments[i]] = true;
+
+		for (size_t j = 0; j < i; j++)
+		{
+			if (assignments[j] != assignments[i])
+				continue;
+
+			// Sharing a step counts as overlapping - one's read while the other's written
+			bool overlap = requests[i].FirstUse <= requests[j].LastUse && requests[j].FirstUse <= requests[i].LastUse;
+			CHECK(!overlap);
+		}
+	}
+	for (bool u : used)
+		CHECK(u);
+
+	unsigned int lastStep = 0;
+	for (const RenderTargetRequest& r : requests)
+		lastStep = std::max(lastStep, r.LastUse);
+
+	for (size_t s = 0; s < slots.size(); s++)
+	{
+		unsigned int kindSlots = 0;
+		for (const RenderTargetSlot& other : slots)
+			kindSlots += other.Width == slots[s].Width && other.Height == slots[s].Height && other.Format == slots[s].Format;
+
+		unsigned int busiest = 0;
+		for (unsigned int step = 0; step <= lastStep; step++)
+		{
+			unsigned int alive = 0;
+			for (const RenderTargetRequest& r : requests)
+			{
+				alive += r.Width == slots[s].Width && r.Height == slots[s].Height && r.Format == slots[s].Format &&
+					r.FirstUse <= step && step <= r.LastUse;
+			}
+			busiest = std::max(busiest, alive);
+		}
+		CHECK(kindSlots == busiest);
+	}
+}
+
+TEST(ChainPingPongs)
+{
+	// Each stage reads the one before it, and the last is copied
+	// out a step later - two textures however long the chain is
+	for (unsigned int stages = 1; stages <= 8; stages++)
+	{
+		std::vector<RenderTargetRequest> requests;
+		for (unsigned int s = 0; s < stages; s++)
+			requests.push_back(MakeRequest(1280, 720, FORMAT_R8G8B8A8_UNORM, s, s + 1));
+
+		RenderTargetPool pool;
+		pool.Plan(requests);
+		CheckPlan(pool, requests);
+		CHECK(pool.GetSlots().size() == std::min(stages, 2u));
+		for (unsigned int s = 0; s < stages; s++)
+			CHECK(pool.GetAssignments()[s] == s % 2);
+
+		unsigned long long texture = 1280ull * 720 * 4;
+		CHECK(pool.GetUnpooledBytes() == texture * stages);
+		CHECK(pool.GetPooledBytes() == texture * std::min(stages, 2u));
+	}
+}
+
+TEST(BloomPyramid)
+{
+	// Dual filter bloom: bright pass, three downsamples, three
+	// upsamples that each also read the matching downsample, then
+	// a full size composite, and a half size pass after that
+	const unsigned int w = 1920, h = 1080;
+	std::vector<RenderTargetRequest> requests;
+	requests.push_back(MakeRequest(w / 2, h / 2, FORMAT_R16G16B16A16_FLOAT, 0, 6));	// Bright, read by the last up
+	requests.push_back(MakeRequest(w / 4, h / 4, FORMAT_R16G16B16A16_FLOAT, 1, 5));	// Down 1
+	requests.push_back(MakeRequest(w / 8, h / 8, FORMAT_R16G16B16A16_FLOAT, 2, 4));	// Down 2
+	requests.push_back(MakeRequest(w / 16, h / 16, FORMAT_R16G16B16A16_FLOAT, 3, 4));	// Down 3
+	requests.push_back(MakeRequest(w / 8, h / 8, FORMAT_R16G16B16A16_FLOAT, 4, 5));	// Up 1
+	requests.push_back(MakeRequest(w / 4, h / 4, FORMAT_R16G16B16A16_FLOAT, 5, 6));	// Up 2
+	requests.push_back(MakeRequest(w / 2, h / 2, FORMAT_R16G16B16A16_FLOAT, 6, 7));	// Up 3, read by the composite
+	requests.push_back(MakeRequest(w / 2, h / 2, FORMAT_R16G16B16A16_FLOAT, 8, 9));	// Something after
+
+	RenderTargetPool pool;
+	pool.Plan(requests);
+	CheckPlan(pool, requests);
+
+	// Every level is still being read when its mirror up is
+	// written, so the pyramid can't share - but the pass after
+	// it reuses the first free half size texture
+	const std::vector<unsigned int>& a = pool.GetAssignments();
+	CHECK(a[0] != a[6]);
+	CHECK(a[1] != a[5]);
+	CHECK(a[2] != a[4]);
+	CHECK(pool.GetSlots().size() == 7);
+	CHECK(a[7] == a[0]);
+	CHECK(pool.GetUnpooledBytes() - pool.GetPooledBytes() == (unsigned long long)(w / 2) * (h / 2) * 8);
+}
+
+TEST(SizesAndFormatsNeverShare)
+{
+	std::vector<RenderTargetRequest> requests;
+	requests.push_back(MakeRequest(640, 360, FORMAT_R8G8B8A8_UNORM, 0, 0));
+	requests.push_back(MakeRequest(640, 360, FORMAT_R16G16B16A16_FLOAT, 1, 1));
+	requests.push_back(MakeRequest(320, 360, FORMAT_R8G8B8A8_UNORM, 2, 2));
+	requests.push_back(MakeRequest(640, 180, FORMAT_R8G8B8A8_UNORM, 3, 3));
+	requests.push_back(MakeRequest(640, 360, FORMAT_R8G8B8A8_UNORM, 4, 4));
+
+	RenderTargetPool pool;
+	pool.Plan(requests);
+	CheckPlan(pool, requests);
+	CHECK(pool.GetSlots().size() == 4);
+	CHECK(pool.GetAssignments()[4] == pool.GetAssignments()[0]);
+}
+
+TEST(RequestOrderDoesntMatter)
+{
+	// Requests out of step order still pack by first use
+	std::vector<RenderTargetRequest> requests;
+	requests.push_back(MakeRequest(100, 100, FORMAT_R8G8B8A8_UNORM, 4, 5));
+	requests.push_back(MakeRequest(100, 100, FORMAT_R8G8B8A8_UNORM, 0, 1));
+	requests.push_back(MakeRequest(100, 100, FORMAT_R8G8B8A8_UNORM, 2, 3));
+	requests.push_back(MakeRequest(100, 100, FORMAT_R8G8B8A8_UNORM, 1, 2));
+
+	RenderTargetPool pool;
+	pool.Plan(requests);
+	CheckPlan(pool, requests);
+	CHECK(pool.GetSlots().size() == 2);
+
+	// And the same requests plan the same way every time
+	std::vector<unsigned int> first = pool.GetAssignments();
+	pool.Plan(requests);
+	CHECK(pool.GetAssignments() == first);
+
+	pool.Plan(std::vector<RenderTargetRequest>());
+	CHECK(pool.GetSlots().empty());
+	CHECK(pool.GetAssignments().empty());
+	CHECK(pool.GetPooledBytes() == 0 && pool.GetUnpooledBytes() == 0);
+}
+
+TEST(RandomPlansAreMinimal)
+{
+	unsigned int state = 5;
+	const unsigned int sizes[3] = { 1920, 960, 480 };
+	const unsigned int formats[2] = { FORMAT_R8G8B8A8_UNORM, FORMAT_R16G16B16A16_FLOAT };
+	for (int trial = 0; trial < 300; trial++)
+	{
+		std::vector<RenderTargetRequest> requests;
+		unsigned int count = 1 + RandomIndex(state, 24);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int size = sizes[RandomIndex(state, 3)];
+			unsigned int first = RandomIndex(state, 16);
+			requests.push_back(MakeRequest(size, size / 2, formats[RandomIndex(state, 2)], first, first + RandomIndex(state, 5)));
+		}
+
+		RenderTargetPool pool;
+		pool.Plan(requests);
+		CheckPlan(pool, requests);
+	}
+}
+
+TEST(BytesPerPixel)
+{
+	CHECK(RenderTargetPool::GetBytesPerPixel(FORMAT_R16G16B16A16_FLOAT) == 8);
+	CHECK(RenderTargetPool::GetBytesPerPixel(26) == 4);		// R11G11B10_FLOAT
+	CHECK(RenderTargetPool::GetBytesPerPixel(FORMAT_R8G8B8A8_UNORM) == 4);
+	CHECK(RenderTargetPool::GetBytesPerPixel(0) == 0);
+}
@@ -0,0 +1,265 @@
+#include "TestFramework.h"
+#include "ShaderReflection.h"
+#include "ConstantBuffers.h"
+
+// --------------------------------------------------------
+// A shader's worth of reflection, like the pixel shader's:
+// a couple of buffers, textures & samplers
+// --------------------------------------------------------
+static ShaderReflectionData MakeReflection()
+{
+	ShaderReflectionData data;
+
+	ShaderReflectionBuffer perFrame = {};
+	perFrame.Name = "ExternalData";
+	perFrame.Type = 0;
+	perFrame.Size = 96;
+	perFrame.BindIndex = 0;
+	perFrame.Variables.push_back({ "colorTint", 0, 12 });
+	perFrame.Variables.push_back({ "roughness", 12, 4 });
+	perFrame.Variables.push_back({ "cameraPosition", 16, 12 });
+	perFrame.Variables.push_back({ "", 28, 4 });	// Empty names have to survive too
+	data.Buffers.push_back(perFrame);
+
+	ShaderReflectionBuffer lights = {};
+	lights.Name = "LightData";
+	lights.Type = 0;
+	lights.Size = 320;
+	lights.BindIndex = 1;
+	lights.Variables.push_back({ "lights", 0, 320 });
+	data.Buffers.push_back(lights);
+
+	data.Textures.push_back({ "AlbedoMap", 0 });
+	data.Textures.push_back({ "NormalMap", 1 });
+	data.Textures.push_back({ "ORMMap", 2 });
+	data.Samplers.push_back({ "BasicSampler", 0 });
+	data.Samplers.push_back({ "ShadowSampler", 1 });
+	return data;
+}
+
+static bool SameResources(const std::vector<ShaderReflectionResource>& a, const std::vector<ShaderReflectionResource>& b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i].Name != b[i].Name || a[i].BindIndex != b[i].BindIndex)
+			return false;
+	}
+	return true;
+}
+
+static bool SameReflection(const ShaderReflectionData& a, const ShaderReflectionData& b)
+{
+	if (a.Buffers.size() != b.Buffers.size())
+		return false;
+	for (size_t i = 0; i < a.Buffers.size(); i++)
+	{
+		const ShaderReflectionBuffer& x = a.Buffers[i];
+		const ShaderReflectionBuffer& y = b.Buffers[i];
+		if (x.Name != y.Name || x.Type != y.Type || x.Size != y.Size || x.BindIndex != y.BindIndex ||
+			x.Variables.size() != y.Variables.size())
+			return false;
+
+		for (size_t v = 0; v < x.Variables.size(); v++)
+		{
+			if (x.Variables[v].Name != y.Variables[v].Name ||
+				x.Variables[v].ByteOffset != y.Variables[v].ByteOffset ||
+				x.Variables[v].Size != y.Variables[v].Size)
+				return false;
+		}
+	}
+	return SameResources(a.Textures, b.Textures) && SameResources(a.Samplers, b.Samplers);
+}
+
+TEST(RoundTrip)
+{
+	ShaderReflectionData original = MakeReflection();
+	std::vector<unsigned char> bytes = SerializeShaderReflection(0x1234567890ABCDEFull, original);
+
+	ShaderReflectionData read;
+	CHECK(DeserializeShaderReflection(bytes.data(), bytes.size(), 0x1234567890ABCDEFull, read));
+	CHECK(SameReflection(original, read));
+
+	// And writing what was read gives back the same bytes
+	CHECK(SerializeShaderReflection(0x1234567890ABCDEFull, read) == bytes);
+}
+
+TEST(RoundTripEmpty)
+{
+	ShaderReflectionData original;
+	std::vector<unsigned char> bytes = SerializeShaderReflection(7, original);
+
+	ShaderReflectionData read = MakeReflection();
+	CHECK(DeserializeShaderReflection(bytes.data(), bytes.size(), 7, read));
+	CHECK(read.Buffers.empty() && read.Textures.empty() && read.Samplers.empty());
+}
+
+TEST(RejectsOtherShaders)
+{
+	std::vector<unsigned char> bytes = SerializeShaderReflection(1, MakeReflection());
+
+	ShaderReflectionData read;
+	CHECK(!DeserializeShaderReflection(bytes.data(), bytes.size(), 2, read));
+}
+
+TEST(RejectsOtherVersions)
+{
+	// The version follows the four byte magic
+	std::vector<unsigned char> bytes = SerializeShaderReflection(1, MakeReflection());
+	bytes[4]++;
+
+	ShaderReflectionData read;
+	CHECK(!DeserializeShaderReflection(bytes.data(), bytes.size(), 1, read));
+}
+
+TEST(RejectsTruncatedFiles)
+{
+	ShaderReflectionData original = MakeReflection();
+	std::vector<unsigned char> bytes = SerializeShaderReflection(1, original);
+
+	// Every shorter length fails, and doesn't touch the output
+	for (size_t size = 0; size < bytes.size(); size++)
+	{
+		ShaderReflectionData read = original;
+		CHECK(!DeserializeShaderReflection(bytes.data(), size, 1, read));
+		CHECK(SameReflection(original, read));
+	}
+}
+
+TEST(RejectsTrailingBytes)
+{
+	std::vector<unsigned char> bytes = SerializeShaderReflection(1, MakeReflection());
+	bytes.push_back(0);
+
+	ShaderReflectionData read;
+	CHECK(!DeserializeShaderReflection(bytes.data(), bytes.size(), 1, read));
+}
+
+TEST(RejectsHugeCounts)
+{
+	// A corrupt buffer count right after the header
+	std::vector<unsigned char> bytes = SerializeShaderReflection(1, MakeReflection());
+	bytes[16] = bytes[17] = bytes[18] = bytes[19] = 0xFF;
+
+	ShaderReflectionData read;
+	CHECK(!DeserializeShaderReflection(bytes.data(), bytes.size(), 1, read));
+}
+
+TEST(HashIsFNV1a)
+{
+	// Known FNV-1a 64 values
+	CHECK(HashShaderBytecode("", 0) == 0xCBF29CE484222325ull);
+	CHECK(HashShaderBytecode("a", 1) == 0xAF63DC4C8601EC8Cull);
+
+	unsigned char code[2] = { 1, 2 };
+	unsigned char other[2] = { 2, 1 };
+	CHECK(HashShaderBytecode(code, 2) != HashShaderBytecode(other, 2));
+}
+
+TEST(Tables)
+{
+	ShaderReflectionTables tables;
+	BuildShaderReflectionTables(MakeReflection(), tables);
+
+	CHECK(tables.BufferVariables.size() == 2);
+	CHECK(tables.BufferTable.at("LightData") == 1);
+	CHECK(tables.VarTable.at("cameraPosition").ByteOffset == 16);
+	CHECK(tables.VarTable.at("cameraPosition").ConstantBufferIndex == 0);
+	CHECK(tables.VarTable.at("lights").ConstantBufferIndex == 1);
+	CHECK(tables.ShaderResourceViews.size() == 3);
+	CHECK(tables.ShaderResourceViews[tables.TextureTable.at("ORMMap")].BindIndex == 2);
+	CHECK(tables.SamplerStates[tables.SamplerTable.at("ShadowSampler")].BindIndex == 1);
+}
+
+// --------------------------------------------------------
+// What D3D reflects for ExternalData in PixelShader.hlsl -
+// HLSL's packing, worked out by hand (uvScale would cross a
+// register after uvOffset, so it moves to the next one)
+// --------------------------------------------------------
+static ShaderReflectionTables MakePixelShaderTables()
+{
+	ShaderReflectionBuffer buffer = {};
+	buffer.Name = "ExternalData";
+	buffer.Size = 560;
+	buffer.Variables.push_back({ "colorTint", 0, 16 });
+	buffer.Variables.push_back({ "roughness", 16, 4 });
+	buffer.Variables.push_back({ "cameraPosition", 20, 12 });
+	buffer.Variables.push_back({ "ambientSH", 32, 144 });
+	buffer.Variables.push_back({ "numLights", 176, 4 });
+	buffer.Variables.push_back({ "uvOffset", 180, 8 });
+	buffer.Variables.push_back({ "uvScale", 192, 8 });
+	buffer.Variables.push_back({ "lights", 208, 320 });
+	buffer.Variables.push_back({ "fogColor", 528, 12 });
+	buffer.Variables.push_back({ "startFog", 540, 4 });
+	buffer.Variables.push_back({ "fullFog", 544, 4 });
+	buffer.Variables.push_back({ "fog", 548, 4 });
+
+	ShaderReflectionBuffer other = {};
+	other.Name = "OtherData";
+	other.Size = 16;
+	other.Variables.push_back({ "elsewhere", 0, 4 });
+
+	ShaderReflectionData data;
+	data.Buffers.push_back(buffer);
+	data.Buffers.push_back(other);
+
+	ShaderReflectionTables tables;
+	BuildShaderReflectionTables(data, tables);
+	return tables;
+}
+
+static bool Mentions(const std::string& message, const char* text)
+{
+	return message.find(text) != std::string::npos;
+}
+
+TEST(BufferLayoutMatchesShaders)
+{
+	ShaderReflectionTables tables = MakePixelShaderTables();
+	std::string problem = CheckShaderBufferLayout(tables, "ExternalData", sizeof(PBRPixelShaderData),
+		PBRPixelShaderDataFields, sizeof(PBRPixelShaderDataFields) / sizeof(PBRPixelShaderDataFields[0]));
+	if (!problem.empty())
+		printf("  %s\n", problem.c_str());
+	CHECK(problem.empty());
+}
+
+TEST(BufferLayoutNamesMovedField)
+{
+	// A pad dropped from the C++ side shifts everything after it
+	ShaderBufferField fields[] =
+	{
+		{ "Data::Roughness", "roughness", 16, 4 },
+		{ "Data::UVScale", "uvScale", 188, 8 },
+		{ "Data::Fog", "fog", 544, 4 },
+	};
+	std::string problem = CheckShaderBufferLayout(MakePixelShaderTables(), "ExternalData", 560, fields, 3);
+	CHECK(Mentions(problem, "Data::UVScale"));
+	CHECK(Mentions(problem, "188"));
+	CHECK(Mentions(problem, "192"));
+}
+
+TEST(BufferLayoutNamesResizedField)
+{
+	ShaderBufferField fields[] = { { "Data::CameraPosition", "cameraPosition", 20, 16 } };
+	std::string problem = CheckShaderBufferLayout(MakePixelShaderTables(), "ExternalData", 560, fields, 1);
+	CHECK(Mentions(problem, "Data::CameraPosition"));
+}
+
+TEST(BufferLayoutNamesMissingVariable)
+{
+	// Not in the shader at all, and in a different buffer
+	ShaderBufferField missing[] = { { "Data::Renamed", "colourTint", 0, 16 } };
+	CHECK(Mentions(CheckShaderBufferLayout(MakePixelShaderTables(), "ExternalData", 560, missing, 1), "Data::Renamed"));
+
+	ShaderBufferField elsewhere[] = { { "Data::Elsewhere", "elsewhere", 0, 4 } };
+	CHECK(Mentions(CheckShaderBufferLayout(MakePixelShaderTables(), "ExternalData", 560, elsewhere, 1), "Data::Elsewhere"));
+}
+
+TEST(BufferLayoutChecksSizeAndBuffer)
+{
+	ShaderBufferField fields[] = { { "Data::ColorTint", "colorTint", 0, 16 } };
+	CHECK(CheckShaderBufferLayout(MakePixelShaderTables(), "ExternalData", 560, fields, 1).empty());
+	CHECK(!CheckShaderBufferLayout(MakePixelShaderTables(), "ExternalData", 576, fields, 1).empty());
+	CHECK(Mentions(CheckShaderBufferLayout(MakePixelShaderTables(), "Missing", 560, fields, 1), "Missing"));
+}
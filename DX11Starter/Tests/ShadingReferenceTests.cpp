@@ -0,0 +1,106 @@
+#include "TestFramework.h"
+#include "ShadingReference.h"
+
+using namespace DirectX;
+
+// Odd, so every width has leftovers for the narrower ones
+static const unsigned int SampleCount = 10007;
+
+// ShadingReference.h's bound for batches against the scalar
+// functions (fused multiply-adds on near mirror highlights)
+static const float BatchTolerance = 1e-3f;
+
+TEST(GoldenValues)
+{
+	ShadingReferenceResults results = RunShadingReferenceCheck(16);
+	CHECK(results.GoldenCount > 0);
+	CHECK(results.GoldenFailures == 0);
+}
+
+TEST(DetectedWidth)
+{
+	unsigned int width = GetShadingBatchWidth();
+	CHECK(width == 4 || width == 8 || width == 16);
+	printf("  Widest path on this CPU: %u\n", width);
+}
+
+// --------------------------------------------------------
+// Each path this CPU can run, held to that width, against
+// the scalar functions
+// --------------------------------------------------------
+TEST(EveryWidthMatchesScalar)
+{
+	const unsigned int widths[] = { 1, 4, 8, 16 };
+	for (unsigned int width : widths)
+	{
+		if (width > GetShadingBatchWidth())
+			continue;
+
+		ShadingReferenceResults results = RunShadingReferenceCheck(SampleCount, width);
+		CHECK(results.BatchWidth == width);
+		CHECK(results.GoldenFailures == 0);
+		CHECK(results.BatchMaxError <= BatchTolerance);
+		printf("  %2u wide: max error %g\n", width, results.BatchMaxError);
+	}
+}
+
+// --------------------------------------------------------
+// Shading a range in pieces (as the job system does) only
+// touches those samples, and matches doing it all at once
+// --------------------------------------------------------
+TEST(SplitRanges)
+{
+	const size_t count = 53;
+	ShadingSamples samples;
+	std::vector<float>* channels[] = {
+		&samples.NormalX, &samples.NormalY, &samples.NormalZ,
+		&samples.ViewX, &samples.ViewY, &samples.ViewZ,
+		&samples.PositionX, &samples.PositionY, &samples.PositionZ,
+		&samples.Roughness, &samples.Metalness,
+		&samples.SurfaceR, &samples.SurfaceG, &samples.SurfaceB,
+		&samples.SpecularR, &samples.SpecularG, &samples.SpecularB };
+	for (std::vector<float>* channel : channels)
+		channel->resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		float t = (float)i / count;
+		samples.NormalX[i] = 0; samples.NormalY[i] = 1; samples.NormalZ[i] = 0;
+		samples.ViewX[i] = t * 0.6f; samples.ViewY[i] = 0.8f; samples.ViewZ[i] = 0;
+		samples.PositionX[i] = t * 4 - 2; samples.PositionY[i] = 0; samples.PositionZ[i] = 0;
+		samples.Roughness[i] = 0.2f + t * 0.7f;
+		samples.Metalness[i] = i % 2 ? 1.0f : 0.0f;
+		samples.SurfaceR[i] = samples.SurfaceG[i] = samples.SurfaceB[i] = 0.5f;
+		samples.SpecularR[i] = samples.SpecularG[i] = samples.SpecularB[i] = i % 2 ? 0.5f : SHADING_F0_NON_METAL;
+	}
+
+	std::vector<Light> lights(2);
+	lights[0].Type = LIGHT_TYPE_DIRECTIONAL;
+	lights[0].Direction = XMFLOAT3(0.3f, -1, 0.2f);
+	lights[0].Intensity = 1;
+	lights[0].Color = XMFLOAT3(1, 1, 1);
+	lights[1].Type = LIGHT_TYPE_POINT;
+	lights[1].Position = XMFLOAT3(0, 1, 0);
+	lights[1].Range = 5;
+	lights[1].Intensity = 2;
+	lights[1].Color = XMFLOAT3(1, 0.5f, 0.25f);
+
+	ShadingResult whole;
+	whole.R.resize(count); whole.G.resize(count); whole.B.resize(count);
+	ShadeSamples(samples, lights, whole, 0, count);
+
+	ShadingResult pieces;
+	pieces.R.assign(count, -1.0f); pieces.G.assign(count, -1.0f); pieces.B.assign(count, -1.0f);
+	ShadeSamples(samples, lights, pieces, 0, 19);
+	ShadeSamples(samples, lights, pieces, 19, 20);
+	ShadeSamples(samples, lights, pieces, 20, 50);
+	CHECK(pieces.R[50] == -1.0f && pieces.G[52] == -1.0f);
+	ShadeSamples(samples, lights, pieces, 50, count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		CHECK(whole.R[i] > 0);
+		CHECK_NEAR(pieces.R[i], whole.R[i], 1e-5f * whole.R[i]);
+		CHECK_NEAR(pieces.G[i], whole.G[i], 1e-5f * whole.G[i]);
+		CHECK_NEAR(pieces.B[i], whole.B[i], 1e-5f * whole.B[i]);
+	}
+}
@@ -0,0 +1,405 @@
+#include "TestFramework.h"
+#include "ShadowAtlasAllocator.h"
+#include <algorithm>
+
+// Same small LCG everywhere, so failures repeat
+static unsigned int RandomIndex(unsigned int& state, unsigned int count)
+{
+	state = state * 1664525u + 1013904223u;
+	return (state >> 8) % count;
+}
+
+static ShadowRequest MakeRequest(unsigned int lightIndex, int face, float importance, bool dynamic)
+{
+	ShadowRequest request = {};
+	request.LightIndex = lightIndex;
+	request.Face = face;
+	request.Importance = importance;
+	request.Dynamic = dynamic;
+	return request;
+}
+
+static const ShadowTile* FindTile(const ShadowAtlasAllocator& atlas, unsigned int lightIndex, int face)
+{
+	for (const ShadowTile& tile : atlas.GetTiles())
+	{
+		if (tile.LightIndex == lightIndex && tile.Face == face)
+			return &tile;
+	}
+	return nullptr;
+}
+
+// --------------------------------------------------------
+// Brute force checks of a layout: every tile is a power of
+// two between the min & max size, inside the atlas, and
+// overlaps no other tile.  Each request has at most one
+// tile, tiles come most important first, and whatever got
+// no tile is counted as dropped (and was less important
+// than everything that did get one).
+// --------------------------------------------------------
+static void CheckLayout(const ShadowAtlasAllocator& atlas, const std::vector<ShadowRequest>& requests, unsigned int maxTileSize, unsigned int minTileSize)
+{
+	const std::vector<ShadowTile>& tiles = atlas.GetTiles();
+	CHECK(tiles.size() + atlas.GetDroppedCount() == requests.size());
+
+	for (size_t i = 0; i < tiles.size(); i++)
+	{
+		const ShadowTile& tile = tiles[i];
+		CHECK(tile.Size >= minTileSize && tile.Size <= maxTileSize && (tile.Size & (tile.Size - 1)) == 0);
+		CHECK(tile.X + tile.Size <= atlas.GetAtlasSize() && tile.Y + tile.Size <= atlas.GetAtlasSize());
+		CHECK(i == 0 || tiles[i - 1].Importance >= tile.Importance);
+
+		for (size_t j = 0; j < i; j++)
+		{
+			const ShadowTile& other = tiles[j];
+			CHECK(other.LightIndex != tile.LightIndex || other.Face != tile.Face);
+			bool overlap = tile.X < other.X + other.Size && other.X < tile.X + tile.Size &&
+				tile.Y < other.Y + other.Size && other.Y < tile.Y + tile.Size;
+			CHECK(!overlap);
+		}
+	}
+
+	for (const ShadowRequest& request : requests)
+	{
+		if (FindTile(atlas, request.LightIndex, request.Face))
+			continue;
+		for (const ShadowTile& tile : tiles)
+			CHECK(tile.Importance >= request.Importance);
+	}
+}
+
+static unsigned long long GetTileArea(const ShadowAtlasAllocator& atlas)
+{
+	unsigned long long area = 0;
+	for (const ShadowTile& tile : atlas.GetTiles())
+		area += (unsigned long long)tile.Size * tile.Size;
+	return area;
+}
+
+TEST(TileSizes)
+{
+	// Nearest power of two to importance * max, in log terms
+	ShadowAtlasAllocator atlas(4096, 1024, 128);
+	CHECK(atlas.GetTileSize(1.0f) == 1024);
+	CHECK(atlas.GetTileSize(0.75f) == 1024);
+	CHECK(atlas.GetTileSize(0.6f) == 512);
+	CHECK(atlas.GetTileSize(0.3f) == 256);
+	CHECK(atlas.GetTileSize(0.01f) == 128);
+	CHECK(atlas.GetTileSize(0.0f) == 128);
+
+	// And the sizes are clamped to the atlas
+	ShadowAtlasAllocator small(256, 1024, 512);
+	CHECK(small.GetTileSize(1.0f) == 256);
+	CHECK(small.GetTileSize(0.0f) == 256);
+}
+
+TEST(RoomyAtlasGetsWantedSizes)
+{
+	ShadowAtlasAllocator atlas(4096, 1024, 128);
+	std::vector<ShadowRequest> requests;
+	for (unsigned int i = 0; i < 10; i++)
+		requests.push_back(MakeRequest(i, -1, 0.1f * (i + 1), true));
+	atlas.Allocate(requests);
+
+	CheckLayout(atlas, requests, 1024, 128);
+	CHECK(atlas.GetDroppedCount() == 0);
+	for (const ShadowRequest& request : requests)
+		CHECK(FindTile(atlas, request.LightIndex, -1)->Size == atlas.GetTileSize(request.Importance));
+}
+
+TEST(OverfullShrinksLeastImportantFirst)
+{
+	// Eight lights that want 1024 in a 2048 atlas: half of them at most
+	ShadowAtlasAllocator atlas(2048, 1024, 128);
+	std::vector<ShadowRequest> requests;
+	for (unsigned int i = 0; i < 8; i++)
+		requests.push_back(MakeRequest(i, -1, 1.0f - 0.01f * i, true));
+	atlas.Allocate(requests);
+
+	CheckLayout(atlas, requests, 1024, 128);
+	CHECK(atlas.GetDroppedCount() == 0);
+	CHECK(GetTileArea(atlas) <= 2048ull * 2048);
+	const std::vector<ShadowTile>& tiles = atlas.GetTiles();
+	for (size_t i = 1; i < tiles.size(); i++)
+		CHECK(tiles[i].Size <= tiles[i - 1].Size);
+	CHECK(tiles.front().Size == 1024);
+	CHECK(tiles.back().Size < 1024);
+
+	// Leftover space goes back to the most important: nothing
+	// could double without going over the atlas
+	unsigned long long spare = 2048ull * 2048 - GetTileArea(atlas);
+	for (const ShadowTile& tile : tiles)
+		CHECK(tile.Size == 1024 || (unsigned long long)tile.Size * tile.Size * 3 > spare);
+}
+
+TEST(DropsLeastImportantWhenFull)
+{
+	// Room for sixteen of the smallest tiles, and twenty lights
+	ShadowAtlasAllocator atlas(512, 256, 128);
+	std::vector<ShadowRequest> requests;
+	for (unsigned int i = 0; i < 20; i++)
+		requests.push_back(MakeRequest(i, -1, 0.05f * (20 - i), true));
+	atlas.Allocate(requests);
+
+	CheckLayout(atlas, requests, 256, 128);
+	CHECK(atlas.GetDroppedCount() == 4);
+	for (unsigned int i = 0; i < 20; i++)
+		CHECK((FindTile(atlas, i, -1) != nullptr) == (i < 16));
+
+	// Fewer lights, and nothing's dropped any more
+	requests.resize(12);
+	atlas.Allocate(requests);
+	CheckLayout(atlas, requests, 256, 128);
+	CHECK(atlas.GetDroppedCount() == 0);
+}
+
+TEST(LayoutIsStableWithHysteresis)
+{
+	ShadowAtlasAllocator atlas(4096, 1024, 128);
+	std::vector<ShadowRequest> requests;
+	requests.push_back(MakeRequest(0, -1, 0.25f, true));
+	requests.push_back(MakeRequest(1, -1, 0.9f, false));
+	requests.push_back(MakeRequest(2, 3, 0.5f, true));
+	atlas.Allocate(requests);
+	unsigned int version = atlas.GetLayoutVersion();
+	std::vector<ShadowTile> first = atlas.GetTiles();
+	CHECK(FindTile(atlas, 0, -1)->Size == 256);
+
+	// Nudging the importance past the next size's threshold isn't
+	// enough to repack - the tile stays put (and isn't fresh)
+	requests[0].Importance = 0.4f;
+	CHECK(atlas.GetTileSize(0.4f) == 512);
+	atlas.Allocate(requests);
+	CHECK(atlas.GetLayoutVersion() == version);
+	const ShadowTile* tile = FindTile(atlas, 0, -1);
+	CHECK(tile->Size == 256 && !tile->Fresh);
+	CHECK(tile->Importance == 0.4f);
+	for (const ShadowTile& old : first)
+	{
+		const ShadowTile* now = FindTile(atlas, old.LightIndex, old.Face);
+		CHECK(now && now->X == old.X && now->Y == old.Y && now->Size == old.Size);
+	}
+
+	// Going further does, and only the changed tile has to redraw
+	// if nothing else moved
+	requests[0].Importance = 0.6f;
+	atlas.Allocate(requests);
+	CHECK(atlas.GetLayoutVersion() == version + 1);
+	CHECK(FindTile(atlas, 0, -1)->Size == 512);
+	CHECK(FindTile(atlas, 0, -1)->Fresh);
+	CheckLayout(atlas, requests, 1024, 128);
+	for (const ShadowTile& old : first)
+	{
+		const ShadowTile* now = FindTile(atlas, old.LightIndex, old.Face);
+		bool moved = now->X != old.X || now->Y != old.Y || now->Size != old.Size;
+		CHECK(now->Fresh == moved);
+	}
+
+	// And back down again takes more than a small step too
+	requests[0].Importance = 0.35f;
+	atlas.Allocate(requests);
+	CHECK(atlas.GetLayoutVersion() == version + 1);
+	CHECK(FindTile(atlas, 0, -1)->Size == 512);
+}
+
+TEST(FreedSpaceIsReused)
+{
+	// Sixteen 256 tiles fill a 1024 atlas exactly
+	ShadowAtlasAllocator atlas(1024, 512, 64);
+	std::vector<ShadowRequest> requests;
+	for (unsigned int i = 0; i < 16; i++)
+		requests.push_back(MakeRequest(i, -1, 0.5f, true));
+	atlas.Allocate(requests);
+	CheckLayout(atlas, requests, 512, 64);
+	CHECK(atlas.GetDroppedCount() == 0);
+	CHECK(GetTileArea(atlas) == 1024ull * 1024);
+
+	// Every other light goes away, leaving holes all over the
+	// atlas: dropping lights repacks, so that's no problem
+	std::vector<ShadowRequest> half;
+	for (unsigned int i = 0; i < 16; i += 2)
+		half.push_back(requests[i]);
+	unsigned int version = atlas.GetLayoutVersion();
+	atlas.Allocate(half);
+	CHECK(atlas.GetLayoutVersion() == version + 1);
+	CheckLayout(atlas, half, 512, 64);
+	CHECK(atlas.GetTiles().size() == 8);
+	for (const ShadowTile& tile : atlas.GetTiles())
+		CHECK(tile.Size == 256);
+
+	// Two new lights at 512 fill the freed half exactly - no 512
+	// square would fit between the old tiles
+	half.push_back(MakeRequest(20, -1, 1.0f, true));
+	half.push_back(MakeRequest(21, -1, 1.0f, true));
+	atlas.Allocate(half);
+	CheckLayout(atlas, half, 512, 64);
+	CHECK(atlas.GetDroppedCount() == 0);
+	CHECK(FindTile(atlas, 20, -1)->Size == 512);
+	CHECK(FindTile(atlas, 21, -1)->Size == 512);
+	for (unsigned int i = 0; i < 16; i += 2)
+		CHECK(FindTile(atlas, i, -1)->Size == 256);
+	CHECK(GetTileArea(atlas) == 1024ull * 1024);
+}
+
+TEST(RandomScenesStayValid)
+{
+	// Lights (and point light faces) coming and going, with their
+	// importance drifting, over a few hundred frames
+	ShadowAtlasAllocator atlas(2048, 1024, 64);
+	unsigned int state = 11;
+	std::vector<ShadowRequest> lights;
+	for (int frame = 0; frame < 400; frame++)
+	{
+		if (lights.empty() || RandomIndex(state, 8) == 0)
+		{
+			unsigned int light = RandomIndex(state, 24);
+			bool point = RandomIndex(state, 3) == 0;
+			float importance = RandomIndex(state, 1000) / 1000.0f;
+			for (int f = point ? 0 : -1; f < (point ? 6 : 0); f++)
+				lights.push_back(MakeRequest(light, f, importance, true));
+		}
+		if (RandomIndex(state, 10) == 0)
+		{
+			unsigned int light = lights[RandomIndex(state, (unsigned int)lights.size())].LightIndex;
+			lights.erase(std::remove_if(lights.begin(), lights.end(),
+				[light](const ShadowRequest& r) { return r.LightIndex == light; }), lights.end());
+		}
+		for (ShadowRequest& light : lights)
+			light.Importance = std::min(1.0f, std::max(0.0f, light.Importance + (RandomIndex(state, 21) - 10.0f) / 200));
+
+		// Adding the same light twice would make duplicate keys
+		std::vector<ShadowRequest> requests;
+		for (const ShadowRequest& light : lights)
+		{
+			bool seen = false;
+			for (const ShadowRequest& r : requests)
+				seen = seen || (r.LightIndex == light.LightIndex && r.Face == light.Face);
+			if (!seen)
+				requests.push_back(light);
+		}
+
+		std::vector<ShadowTile> last = atlas.GetTiles();
+		unsigned int version = atlas.GetLayoutVersion();
+		atlas.Allocate(requests);
+		CheckLayout(atlas, requests, 1024, 64);
+
+		// No repack, no tile moved
+		if (atlas.GetLayoutVersion() == version)
+		{
+			for (const ShadowTile& tile : atlas.GetTiles())
+			{
+				auto old = std::find_if(last.begin(), last.end(), [&tile](const ShadowTile& t)
+					{ return t.LightIndex == tile.LightIndex && t.Face == tile.Face; });
+				CHECK(old != last.end() && old->X == tile.X && old->Y == tile.Y && old->Size == tile.Size);
+				CHECK(!tile.Fresh);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Two point lights' faces (the first light's moving, the
+// second's static) and two spot lights, for the scheduling
+// tests.  Faces are the most important on purpose - they
+// still mustn't take the "always update" slots.
+// --------------------------------------------------------
+static std::vector<ShadowRequest> MakeFaceScene()
+{
+	std::vector<ShadowRequest> requests;
+	for (int f = 0; f < 6; f++)
+	{
+		requests.push_back(MakeRequest(0, f, 0.9f, true));
+		requests.push_back(MakeRequest(1, f, 0.9f, false));
+	}
+	requests.push_back(MakeRequest(2, -1, 0.5f, true));
+	requests.push_back(MakeRequest(3, -1, 0.4f, true));
+	return requests;
+}
+
+TEST(FreshTilesAllUpdate)
+{
+	ShadowAtlasAllocator atlas(4096, 1024, 128);
+	std::vector<ShadowRequest> requests = MakeFaceScene();
+	atlas.Allocate(requests);
+	atlas.Schedule(0, 0, 0);
+
+	CHECK(atlas.GetTiles().size() == requests.size());
+	for (const ShadowTile& tile : atlas.GetTiles())
+		CHECK(tile.Fresh && tile.Update && tile.Age == 0);
+
+	// Same requests again - nothing moves, so nothing's fresh
+	unsigned int version = atlas.GetLayoutVersion();
+	atlas.Allocate(requests);
+	atlas.Schedule(0, 0, 0);
+	CHECK(atlas.GetLayoutVersion() == version);
+	for (const ShadowTile& tile : atlas.GetTiles())
+		CHECK(!tile.Fresh && !tile.Update && tile.Age == 1);
+}
+
+TEST(FacesShareTheirOwnBudget)
+{
+	ShadowAtlasAllocator atlas(4096, 1024, 128);
+	std::vector<ShadowRequest> requests = MakeFaceScene();
+	atlas.Allocate(requests);
+	atlas.Schedule(1, 0, 2);
+
+	// Six moving faces at two a frame: each face exactly once
+	// every three frames, the static faces never, and the most
+	// important spot light every frame
+	int faceUpdates[6] = {};
+	for (int frame = 0; frame < 12; frame++)
+	{
+		atlas.Allocate(requests);
+		atlas.Schedule(1, 0, 2);
+
+		int movingFaces = 0;
+		for (const ShadowTile& tile : atlas.GetTiles())
+		{
+			if (tile.Face >= 0 && tile.LightIndex == 0 && tile.Update)
+			{
+				movingFaces++;
+				faceUpdates[tile.Face]++;
+				CHECK(tile.Age == 0);
+			}
+			if (tile.Face >= 0 && tile.LightIndex == 1)
+				CHECK(!tile.Update);
+		}
+		CHECK(movingFaces == 2);
+		CHECK(FindTile(atlas, 2, -1)->Update);
+		CHECK(!FindTile(atlas, 3, -1)->Update);
+	}
+	for (int f = 0; f < 6; f++)
+		CHECK(faceUpdates[f] == 4);
+
+	// Nothing waits longer than a full round
+	for (const ShadowTile& tile : atlas.GetTiles())
+	{
+		if (tile.Face >= 0 && tile.LightIndex == 0)
+			CHECK(tile.Age < 3);
+	}
+}
+
+TEST(LightBudgetSkipsFaces)
+{
+	ShadowAtlasAllocator atlas(4096, 1024, 128);
+	std::vector<ShadowRequest> requests = MakeFaceScene();
+	atlas.Allocate(requests);
+	atlas.Schedule(0, 1, 0);
+
+	// No face budget: faces wait, and the two spot lights take turns
+	int spotUpdates[2] = {};
+	for (int frame = 0; frame < 6; frame++)
+	{
+		atlas.Allocate(requests);
+		atlas.Schedule(0, 1, 0);
+		for (const ShadowTile& tile : atlas.GetTiles())
+		{
+			if (tile.Face >= 0)
+				CHECK(!tile.Update);
+			else if (tile.Update)
+				spotUpdates[tile.LightIndex - 2]++;
+		}
+	}
+	CHECK(spotUpdates[0] == 3);
+	CHECK(spotUpdates[1] == 3);
+}
@@ -0,0 +1,285 @@
+#include "TestFramework.h"
+#include "JobSystem.h"
+#include "SimulationThread.h"
+#include "SnapshotChecksum.h"
+#include "TripleBuffer.h"
+#include <cstring>
+
+using namespace DirectX;
+
+// Fixed timestep, like benchmark mode
+static const float Timestep = 1.0f / 60.0f;
+static const unsigned int FrameCount = 300;
+
+static void StartJobs()
+{
+	static bool started = false;
+	if (!started)
+		JobSystem::GetInstance().Initialize();
+	started = true;
+}
+
+// --------------------------------------------------------
+// The parts of a SceneSnapshot the checksum covers
+// --------------------------------------------------------
+struct TestSnapshot
+{
+	unsigned long long FrameIndex = 0;
+	std::vector<XMFLOAT4X4> WorldMatrices;
+	std::vector<Light> Lights;
+	XMFLOAT4X4 CameraView = {};
+
+	unsigned int Checksum() const { return ChecksumSimulatedState(WorldMatrices, Lights, CameraView); }
+};
+
+// Scale, then rotate (pitch, then yaw), then translate - row vectors
+static XMFLOAT4X4 MakeWorld(const XMFLOAT3& position, const XMFLOAT3& rotation, const XMFLOAT3& scale)
+{
+	float sp = sinf(rotation.x), cp = cosf(rotation.x);
+	float sy = sinf(rotation.y), cy = cosf(rotation.y);
+	XMFLOAT4X4 m = {};
+	m._11 = scale.x * cy;		m._12 = 0;				m._13 = scale.x * -sy;
+	m._21 = scale.y * sp * sy;	m._22 = scale.y * cp;	m._23 = scale.y * sp * cy;
+	m._31 = scale.z * cp * sy;	m._32 = scale.z * -sp;	m._33 = scale.z * cp * cy;
+	m._41 = position.x;			m._42 = position.y;		m._43 = position.z;	m._44 = 1;
+	return m;
+}
+
+// --------------------------------------------------------
+// A stand-in for Game's scene, updated the same way: some
+// entities accumulate motion every step (so any step run
+// twice, skipped or reordered shows up), the rest are set
+// from the total time across the workers, then the results
+// are copied into the write buffer (across the workers
+// again) and published.
+// --------------------------------------------------------
+struct TestScene
+{
+	std::vector<XMFLOAT3> Positions;
+	std::vector<XMFLOAT3> Rotations;
+	std::vector<XMFLOAT3> Scales;
+	std::vector<Light> Lights;
+	XMFLOAT3 CameraPosition;
+	unsigned long long Frame = 0;
+
+	TripleBuffer<TestSnapshot> Snapshots;
+	std::vector<unsigned int> Published;	// Checksum of every published frame
+
+	TestScene()
+	{
+		for (unsigned int i = 0; i < 2000; i++)
+		{
+			Positions.push_back(XMFLOAT3((float)(i % 50), 0, (float)(i / 50)));
+			Rotations.push_back(XMFLOAT3(0, 0, 0));
+			Scales.push_back(XMFLOAT3(1, 1, 1));
+		}
+		for (int i = 0; i < 8; i++)
+		{
+			Light light = {};
+			light.Type = LIGHT_TYPE_POINT;
+			light.Range = 5.0f;
+			light.Intensity = 1.0f;
+			light.Color = XMFLOAT3(1, 1, 1);
+			light.ShadowIndex = -1;
+			Lights.push_back(light);
+		}
+		CameraPosition = XMFLOAT3(0, 5, -10);
+		Publish();
+	}
+
+	void Update(float deltaTime, float totalTime)
+	{
+		// Accumulated, like Game::Update()'s hand-placed entities
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			Rotations[i].y += (1.0f + i * 0.1f) * deltaTime;
+			Positions[i].x += 0.0003f * sinf(totalTime + i);
+			Scales[i].x *= 1.0f + 0.0005f * sinf(3.0f * totalTime);
+		}
+
+		// Set from the time, across the workers, like StressScene::Animate()
+		JobSystem::GetInstance().ParallelFor((unsigned int)Positions.size() - 16, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin + 16; i < end + 16; i++)
+			{
+				float t = i * 0.37f + totalTime * (0.5f + (i % 7) * 0.1f);
+				Positions[i].y = sinf(t) * 0.5f;
+				Rotations[i] = XMFLOAT3(t * 0.5f, t, 0.0f);
+			}
+		}, 64);
+
+		for (size_t i = 0; i < Lights.size(); i++)
+			Lights[i].Position = XMFLOAT3(cosf(totalTime + i) * 10, 2, sinf(totalTime + i) * 10);
+		CameraPosition.x += deltaTime;
+
+		Publish();
+	}
+
+	void Publish()
+	{
+		TestSnapshot& snapshot = Snapshots.GetWriteBuffer();
+		snapshot.FrameIndex = Frame++;
+		snapshot.WorldMatrices.resize(Positions.size());
+		JobSystem::GetInstance().ParallelFor((unsigned int)Positions.size(), [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+				snapshot.WorldMatrices[i] = MakeWorld(Positions[i], Rotations[i], Scales[i]);
+		}, 64);
+		snapshot.Lights = Lights;
+		snapshot.CameraView = MakeWorld(XMFLOAT3(-CameraPosition.x, -CameraPosition.y, -CameraPosition.z), XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1));
+
+		Published.push_back(snapshot.Checksum());
+		Snapshots.Publish();
+	}
+};
+
+// What the "renderer" saw of each frame it drew
+struct DrawnFrame
+{
+	unsigned long long FrameIndex;
+	unsigned int Checksum;
+	std::vector<XMFLOAT4X4> WorldMatrices;
+};
+
+static DrawnFrame Draw(TestScene& scene)
+{
+	const TestSnapshot& snapshot = scene.Snapshots.Acquire();
+
+	// Some work of the renderer's own on the workers, overlapping
+	// the simulation's when it's threaded
+	std::atomic<unsigned int> visible(0);
+	JobSystem::GetInstance().ParallelFor((unsigned int)snapshot.WorldMatrices.size(), [&](unsigned int begin, unsigned int end)
+	{
+		unsigned int count = 0;
+		for (unsigned int i = begin; i < end; i++)
+			count += snapshot.WorldMatrices[i]._42 > 0;
+		visible += count;
+	}, 64);
+
+	DrawnFrame drawn = { snapshot.FrameIndex, snapshot.Checksum(), snapshot.WorldMatrices };
+	return drawn;
+}
+
+static bool SameMatrices(const std::vector<XMFLOAT4X4>& a, const std::vector<XMFLOAT4X4>& b)
+{
+	return a.size() == b.size() && memcmp(&a[0], &b[0], sizeof(XMFLOAT4X4) * a.size()) == 0;
+}
+
+// --------------------------------------------------------
+// DXCore's loop both ways: Update() then Draw() on one
+// thread, or Update() on the simulation thread while the
+// last published frame is drawn.  Every simulated frame
+// must come out bit for bit the same.  The threaded
+// renderer draws the previous frame, or this one if the
+// simulation beat it to Acquire() - never anything older,
+// and never a mix of two frames.
+// --------------------------------------------------------
+TEST(ThreadedMatchesSerial)
+{
+	StartJobs();
+
+	TestScene serial;
+	std::vector<DrawnFrame> serialDrawn;
+	serialDrawn.push_back(Draw(serial));
+	for (unsigned int f = 1; f <= FrameCount; f++)
+	{
+		serial.Update(Timestep, f * Timestep);
+		serialDrawn.push_back(Draw(serial));
+	}
+
+	TestScene threaded;
+	std::vector<DrawnFrame> threadedDrawn;
+	SimulationThread simulation;
+	simulation.Start([&threaded](float dt, float tt) { threaded.Update(dt, tt); });
+	for (unsigned int f = 1; f <= FrameCount; f++)
+	{
+		simulation.Kick(Timestep, f * Timestep);
+		threadedDrawn.push_back(Draw(threaded));
+		simulation.Wait();
+	}
+	simulation.Stop();
+	threadedDrawn.push_back(Draw(threaded));
+
+	// Same state published every frame (frame 0 is the initial one)
+	CHECK(serial.Published.size() == FrameCount + 1);
+	CHECK(threaded.Published == serial.Published);
+	unsigned int firstDifference = 0;
+	while (firstDifference < serial.Published.size() && firstDifference < threaded.Published.size() &&
+		serial.Published[firstDifference] == threaded.Published[firstDifference])
+		firstDifference++;
+	if (firstDifference <= FrameCount)
+		printf("  First different frame: %u\n", firstDifference);
+
+	// Serial draws the frame it just simulated (after the initial one)
+	CHECK(serialDrawn.size() == FrameCount + 1);
+	for (unsigned int f = 0; f <= FrameCount; f++)
+	{
+		CHECK(serialDrawn[f].FrameIndex == f);
+		CHECK(serialDrawn[f].Checksum == serial.Published[f]);
+	}
+
+	// Threaded draws the one before, or this one, and what it draws
+	// of a frame matches the serial run's, checksum and transforms
+	CHECK(threadedDrawn.size() == FrameCount + 1);
+	for (unsigned int f = 1; f <= FrameCount; f++)
+	{
+		const DrawnFrame& drawn = threadedDrawn[f - 1];
+		CHECK(drawn.FrameIndex == f - 1 || drawn.FrameIndex == f);
+		if (drawn.FrameIndex > FrameCount)
+			continue;
+
+		const DrawnFrame& expected = serialDrawn[(size_t)drawn.FrameIndex];
+		CHECK(drawn.Checksum == expected.Checksum);
+		CHECK(SameMatrices(drawn.WorldMatrices, expected.WorldMatrices));
+	}
+	CHECK(threadedDrawn.back().FrameIndex == FrameCount);
+}
+
+TEST(ChecksumSeesEveryPart)
+{
+	// A change to any entity, light or the camera changes the checksum
+	TestSnapshot snapshot;
+	snapshot.WorldMatrices.resize(4, MakeWorld(XMFLOAT3(1, 2, 3), XMFLOAT3(0.1f, 0.2f, 0), XMFLOAT3(1, 1, 1)));
+	snapshot.Lights.resize(2, Light());
+	unsigned int base = snapshot.Checksum();
+	CHECK(snapshot.Checksum() == base);
+
+	TestSnapshot changed = snapshot;
+	changed.WorldMatrices[3]._43 += 1e-3f;
+	CHECK(changed.Checksum() != base);
+
+	changed = snapshot;
+	changed.Lights[1].Intensity = 2.0f;
+	CHECK(changed.Checksum() != base);
+
+	changed = snapshot;
+	changed.CameraView._41 = 1.0f;
+	CHECK(changed.Checksum() != base);
+
+	// The frame index (timing) isn't part of it
+	changed = snapshot;
+	changed.FrameIndex = 99;
+	CHECK(changed.Checksum() == base);
+}
+
+TEST(SimulationThreadRestarts)
+{
+	// Stop and start again, and Stop() twice, like DXCore's
+	// way out (Run() then the destructor)
+	int updates = 0;
+	float lastTime = 0;
+	SimulationThread simulation;
+	for (int round = 0; round < 3; round++)
+	{
+		simulation.Start([&](float, float tt) { updates++; lastTime = tt; });
+		for (int f = 0; f < 10; f++)
+		{
+			simulation.Kick(Timestep, (float)f);
+			simulation.Wait();
+			CHECK(lastTime == (float)f);
+		}
+		simulation.Stop();
+		simulation.Stop();
+	}
+	CHECK(updates == 30);
+}
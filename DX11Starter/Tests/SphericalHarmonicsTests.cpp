@@ -0,0 +1,160 @@
+#include "TestFramework.h"
+#include "SphericalHarmonics.h"
+#include "JobSystem.h"
+#include <cmath>
+#include <functional>
+
+using namespace DirectX;
+
+// Projection runs a face per job, like in the game
+static void StartJobs()
+{
+	static bool started = false;
+	if (!started)
+		JobSystem::GetInstance().Initialize();
+	started = true;
+}
+
+// --------------------------------------------------------
+// A cube with every texel set from its direction (D3D's
+// face order & orientation: +X, -X, +Y, -Y, +Z, -Z)
+// --------------------------------------------------------
+static CubeImage MakeCube(unsigned int size, const std::function<XMFLOAT3(float, float, float)>& radiance)
+{
+	static const float axes[6][3][3] =
+	{
+		{ { 1, 0, 0 }, { 0, 0, -1 }, { 0, -1, 0 } },
+		{ { -1, 0, 0 }, { 0, 0, 1 }, { 0, -1, 0 } },
+		{ { 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+		{ { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, -1 } },
+		{ { 0, 0, 1 }, { 1, 0, 0 }, { 0, -1, 0 } },
+		{ { 0, 0, -1 }, { -1, 0, 0 }, { 0, -1, 0 } },
+	};
+
+	CubeImage cube;
+	cube.Size = size;
+	for (unsigned int f = 0; f < 6; f++)
+	{
+		cube.Faces[f].resize((size_t)size * size * 4);
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				float s = (x + 0.5f) * 2 / size - 1;
+				float t = (y + 0.5f) * 2 / size - 1;
+				float d[3];
+				for (int i = 0; i < 3; i++)
+					d[i] = axes[f][0][i] + axes[f][1][i] * s + axes[f][2][i] * t;
+				float length = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+
+				XMFLOAT3 color = radiance(d[0] / length, d[1] / length, d[2] / length);
+				float* texel = &cube.Faces[f][((size_t)y * size + x) * 4];
+				texel[0] = color.x;
+				texel[1] = color.y;
+				texel[2] = color.z;
+				texel[3] = 1.0f;
+			}
+		}
+	}
+	return cube;
+}
+
+// Normals spread over the sphere
+static XMFLOAT3 GetNormal(unsigned int i, unsigned int count)
+{
+	float z = 1 - (i + 0.5f) * 2 / count;
+	float r = sqrtf(fmaxf(0.0f, 1 - z * z));
+	float phi = i * 2.39996323f;
+	return XMFLOAT3(r * cosf(phi), r * sinf(phi), z);
+}
+
+// --------------------------------------------------------
+// Skies whose irradiance (over pi) is known exactly, band
+// by band: L2 holds all of these without any loss, so only
+// the cube's texel sampling is left as error
+// --------------------------------------------------------
+static void CheckIrradiance(const AmbientSH& sh, const std::function<XMFLOAT3(const XMFLOAT3&)>& expected, float tolerance)
+{
+	float worst = 0.0f;
+	for (unsigned int i = 0; i < 64; i++)
+	{
+		XMFLOAT3 n = GetNormal(i, 64);
+		XMFLOAT3 value = EvaluateSH(sh, n);
+		XMFLOAT3 wanted = expected(n);
+		worst = fmaxf(worst, fabsf(value.x - wanted.x));
+		worst = fmaxf(worst, fabsf(value.y - wanted.y));
+		worst = fmaxf(worst, fabsf(value.z - wanted.z));
+	}
+	if (worst > tolerance)
+		printf("  Irradiance off by %g\n", worst);
+	CHECK(worst <= tolerance);
+}
+
+TEST(ConstantSky)
+{
+	StartJobs();
+	CubeImage cube = MakeCube(32, [](float, float, float) { return XMFLOAT3(0.5f, 1.0f, 2.0f); });
+	AmbientSH sh;
+	ProjectCubeToSH(cube, sh);
+
+	// All band 0: the radiance itself, everywhere
+	CHECK_NEAR(sh.Coefficients[0].x * 0.282095f, 0.5f, 1e-4f);
+	CHECK_NEAR(sh.Coefficients[0].y * 0.282095f, 1.0f, 1e-4f);
+	CHECK_NEAR(sh.Coefficients[0].z * 0.282095f, 2.0f, 1e-4f);
+	for (int k = 1; k < 9; k++)
+	{
+		CHECK_NEAR(sh.Coefficients[k].x, 0.0f, 1e-4f);
+		CHECK_NEAR(sh.Coefficients[k].y, 0.0f, 1e-4f);
+		CHECK_NEAR(sh.Coefficients[k].z, 0.0f, 1e-4f);
+	}
+	CheckIrradiance(sh, [](const XMFLOAT3&) { return XMFLOAT3(0.5f, 1.0f, 2.0f); }, 1e-4f);
+}
+
+TEST(LinearSky)
+{
+	// Radiance a + b.d averages to a + 2/3 b.n over a cosine lobe
+	StartJobs();
+	CubeImage cube = MakeCube(32, [](float x, float y, float z) {
+		return XMFLOAT3(1.0f + 0.5f * z, 1.0f - 0.25f * x, 1.0f + 0.75f * y); });
+	AmbientSH sh;
+	ProjectCubeToSH(cube, sh);
+	CheckIrradiance(sh, [](const XMFLOAT3& n) {
+		return XMFLOAT3(1.0f + 0.5f * n.z * 2 / 3, 1.0f - 0.25f * n.x * 2 / 3, 1.0f + 0.75f * n.y * 2 / 3); }, 2e-3f);
+}
+
+TEST(QuadraticSky)
+{
+	// z^2 is 1/3 in band 0 and 2/3 P2(z) in band 2 (scaled by 1/4),
+	// and xy is all band 2
+	StartJobs();
+	CubeImage cube = MakeCube(32, [](float x, float y, float z) {
+		return XMFLOAT3(z * z, x * y + 0.5f, x * x - y * y + 1.0f); });
+	AmbientSH sh;
+	ProjectCubeToSH(cube, sh);
+	CheckIrradiance(sh, [](const XMFLOAT3& n) {
+		return XMFLOAT3(
+			1.0f / 3 + (3 * n.z * n.z - 1) / 12,
+			n.x * n.y / 4 + 0.5f,
+			(n.x * n.x - n.y * n.y) / 4 + 1.0f); }, 2e-3f);
+}
+
+// --------------------------------------------------------
+// The in-game check, on a sky with a soft sun: the SSE
+// projection against double precision, and L2 irradiance
+// against integrating the cube directly (L2 rings a little
+// around the sun, about 4% here)
+// --------------------------------------------------------
+TEST(ReferenceCheck)
+{
+	StartJobs();
+	CubeImage cube = MakeCube(24, [](float x, float y, float z) {
+		float sun = powf(fmaxf(0.0f, 0.6f * x + 0.8f * y), 8.0f) * 5.0f;
+		float sky = 0.5f + 0.5f * y;
+		return XMFLOAT3(sky * 0.4f + sun, sky * 0.6f + sun, sky + sun * 0.8f + 0.1f * z); });
+
+	SHReferenceResults results = RunSHReferenceCheck(cube);
+	printf("  Coefficient error %g, irradiance error %g\n", results.CoefficientError, results.IrradianceError);
+	CHECK(results.NormalCount > 0);
+	CHECK(results.CoefficientError <= 1e-4f);
+	CHECK(results.IrradianceError <= 0.06f);
+}
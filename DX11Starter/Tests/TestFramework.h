@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+// --------------------------------------------------------
+// A tiny self-registering test runner, so the CPU side of
+// the engine can be checked without D3D (or a window).
+//
+//   TEST(Percentiles)
+//   {
+//       CHECK(stats.GetCount() == 10);
+//       CHECK_NEAR(stats.GetPercentile(0.5f), 5.0f, 0.01f);
+//   }
+//
+// Every test in an executable runs, and the process exits
+// non-zero if any check failed.
+// --------------------------------------------------------
+struct TestCase
+{
+	const char* Name;
+	void (*Function)();
+};
+
+inline std::vector<TestCase>& GetTestCases()
+{
+	static std::vector<TestCase> cases;
+	return cases;
+}
+
+// Checks that failed in the test currently running
+inline int& GetTestFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+struct TestRegistration
+{
+	TestRegistration(const char* name, void (*function)())
+	{
+		GetTestCases().push_back({ name, function });
+	}
+};
+
+#define TEST(name) \
+	static void Test_##name(); \
+	static TestRegistration testRegistration_##name(#name, &Test_##name); \
+	static void Test_##name()
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) \
+		{ \
+			printf("  %s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			GetTestFailures()++; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do { \
+		double testActual = (double)(actual); \
+		double testExpected = (double)(expected); \
+		if (!(std::fabs(testActual - testExpected) <= (double)(tolerance))) \
+		{ \
+			printf("  %s(%d): CHECK_NEAR(%s, %s) failed - %g vs %g (tolerance %g)\n", \
+				__FILE__, __LINE__, #actual, #expected, testActual, testExpected, (double)(tolerance)); \
+			GetTestFailures()++; \
+		} \
+	} while (0)
@@ -0,0 +1,31 @@
+#include "TestFramework.h"
+#include <cstring>
+
+// --------------------------------------------------------
+// Runs every registered test, or just the ones named on
+// the command line
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	int failedTests = 0;
+	int ran = 0;
+	for (const TestCase& test : GetTestCases())
+	{
+		bool wanted = argc < 2;
+		for (int i = 1; i < argc; i++)
+			wanted |= strcmp(argv[i], test.Name) == 0;
+		if (!wanted)
+			continue;
+
+		GetTestFailures() = 0;
+		test.Function();
+		ran++;
+
+		printf("[%s] %s\n", GetTestFailures() ? "FAIL" : " OK ", test.Name);
+		if (GetTestFailures())
+			failedTests++;
+	}
+
+	printf("%d of %d tests passed\n", ran - failedTests, ran);
+	return failedTests ? 1 : 0;
+}
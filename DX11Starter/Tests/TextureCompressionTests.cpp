@@ -0,0 +1,202 @@
+#include "TestFramework.h"
+#include "TextureCompression.h"
+#include "JobSystem.h"
+#include <cmath>
+#include <cstdio>
+
+// Rows of blocks are encoded across the workers, like in the game
+static void StartJobs()
+{
+	static bool started = false;
+	if (!started)
+		JobSystem::GetInstance().Initialize();
+	started = true;
+}
+
+// Decodes a single block (4x4 pixels)
+static TextureImage DecodeBlock(const unsigned char* block, int codec)
+{
+	std::vector<unsigned char> blocks(block, block + GetCodecBlockBytes(codec));
+	TextureImage decoded;
+	DecompressImage(blocks, codec, 4, 4, decoded);
+	return decoded;
+}
+
+static void CheckPixel(const TextureImage& image, unsigned int p, int r, int g, int b, int a)
+{
+	const unsigned char* pixel = &image.Pixels[p * 4];
+	bool same = pixel[0] == r && pixel[1] == g && pixel[2] == b && pixel[3] == a;
+	if (!same)
+		printf("  Pixel %u: %d %d %d %d, expected %d %d %d %d\n", p, pixel[0], pixel[1], pixel[2], pixel[3], r, g, b, a);
+	CHECK(same);
+}
+
+// --------------------------------------------------------
+// Blocks put together by hand from the layouts in the D3D
+// docs ("Texture Block Compression in Direct3D 11", and the
+// BC7 format mode reference), decoded to the values they
+// give there
+// --------------------------------------------------------
+TEST(DecodeKnownBC1)
+{
+	// Four color mode (color0 > color1): pure red & pure blue,
+	// then 2/3 red and 1/3 red - indices 0 1 2 3 across each row
+	const unsigned char fourColor[8] = { 0x00, 0xF8, 0x1F, 0x00, 0xE4, 0xE4, 0xE4, 0xE4 };
+	TextureImage decoded = DecodeBlock(fourColor, TEXTURE_CODEC_BC1);
+	for (unsigned int row = 0; row < 4; row++)
+	{
+		CheckPixel(decoded, row * 4 + 0, 255, 0, 0, 255);
+		CheckPixel(decoded, row * 4 + 1, 0, 0, 255, 255);
+		CheckPixel(decoded, row * 4 + 2, 170, 0, 85, 255);
+		CheckPixel(decoded, row * 4 + 3, 85, 0, 170, 255);
+	}
+
+	// Three color mode (color0 <= color1): 565 (0, 0, 31) and
+	// (16, 63, 0) - 5 & 6 bit values widen by repeating their
+	// top bits - then their average, then transparent black
+	const unsigned char threeColor[8] = { 0x1F, 0x00, 0xE0, 0x87, 0xE4, 0xE4, 0xE4, 0xE4 };
+	decoded = DecodeBlock(threeColor, TEXTURE_CODEC_BC1);
+	CheckPixel(decoded, 0, 0, 0, 255, 255);
+	CheckPixel(decoded, 1, 132, 255, 0, 255);
+	CheckPixel(decoded, 2, 66, 128, 128, 255);
+	CheckPixel(decoded, 3, 0, 0, 0, 0);
+}
+
+TEST(DecodeKnownBC4)
+{
+	// Eight value mode (value0 > value1): 200 & 100, then six
+	// steps between - indices 0 to 7, twice over
+	const unsigned char eightValue[8] = { 200, 100, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA };
+	const int eightValues[8] = { 200, 100, 186, 171, 157, 143, 129, 114 };
+	TextureImage decoded = DecodeBlock(eightValue, TEXTURE_CODEC_BC4);
+	for (unsigned int p = 0; p < 16; p++)
+		CheckPixel(decoded, p, eightValues[p & 7], 0, 0, 255);
+
+	// Six value mode (value0 <= value1): 50 & 250, four steps
+	// between, then 0 and 255
+	const unsigned char sixValue[8] = { 50, 250, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA };
+	const int sixValues[8] = { 50, 250, 90, 130, 170, 210, 0, 255 };
+	decoded = DecodeBlock(sixValue, TEXTURE_CODEC_BC4);
+	for (unsigned int p = 0; p < 16; p++)
+		CheckPixel(decoded, p, sixValues[p & 7], 0, 0, 255);
+}
+
+TEST(DecodeKnownBC7)
+{
+	// Mode 6: mode bits 0000001, then 7 bit endpoints R0 R1 G0
+	// G1 B0 B1 A0 A1 = 0 127 0 64 0 0 127 127, p-bits 1 1, and
+	// indices 0 to 15 (the first with its top bit dropped).  So
+	// the endpoints are (1, 1, 1, 255) and (255, 129, 1, 255),
+	// blended by the 4 bit weights 0 4 9 13 ... 60 64.
+	const unsigned char mode6[16] = {
+		0x40, 0xC0, 0x1F, 0x00, 0x04, 0x00, 0xFE, 0xFF,
+		0x11, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE };
+	const int red[16] = { 1, 17, 37, 53, 68, 84, 104, 120, 136, 152, 172, 188, 203, 219, 239, 255 };
+	const int green[16] = { 1, 9, 19, 27, 35, 43, 53, 61, 69, 77, 87, 95, 103, 111, 121, 129 };
+	TextureImage decoded = DecodeBlock(mode6, TEXTURE_CODEC_BC7);
+	for (unsigned int p = 0; p < 16; p++)
+		CheckPixel(decoded, p, red[p], green[p], 1, 255);
+}
+
+// --------------------------------------------------------
+// Smooth gradients, hard edged shapes and some noise, in
+// every channel - roughly what the codecs see in real
+// textures.  Odd sizes leave partial blocks at the edges.
+// --------------------------------------------------------
+static TextureImage MakeTestImage(unsigned int width, unsigned int height, unsigned int channels)
+{
+	TextureImage image;
+	image.Width = width;
+	image.Height = height;
+	image.Channels = channels;
+	image.Pixels.resize((size_t)width * height * channels);
+
+	unsigned int seed = 12345;
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			bool inside = ((x / 13 + y / 9) % 3) == 0;
+			for (unsigned int c = 0; c < channels; c++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				float gradient = (c & 1) ? (float)x / width : (float)y / height;
+				float value = 40.0f + 150.0f * gradient + (inside ? 50.0f : 0.0f) + (seed >> 8) % 9;
+				image.Pixels[((size_t)y * width + x) * channels + c] = (unsigned char)std::fmin(value, 255.0f);
+			}
+		}
+	}
+	return image;
+}
+
+static float RoundTrip(const TextureImage& image, int codec)
+{
+	std::vector<unsigned char> blocks;
+	CompressImage(image, codec, blocks);
+	CHECK(blocks.size() == (size_t)((image.Width + 3) / 4) * ((image.Height + 3) / 4) * GetCodecBlockBytes(codec));
+
+	TextureImage decoded;
+	DecompressImage(blocks, codec, image.Width, image.Height, decoded);
+	float psnr = MeasurePSNR(image, decoded, codec);
+	printf("  %s, %u x %u: %.1f dB\n", GetCodecName(codec), image.Width, image.Height, psnr);
+	return psnr;
+}
+
+TEST(RoundTripPSNR)
+{
+	// What each codec should manage at least (a couple of dB
+	// under what they do now): BC1 has 565 endpoints & 4 colors,
+	// BC4/BC5 8 bit endpoints & 8 values, and BC7 mode 6 fits
+	// all four (independently noisy) channels with one line of
+	// 16 colors
+	StartJobs();
+	const unsigned int sizes[][2] = { { 64, 64 }, { 37, 22 } };
+	for (const auto& size : sizes)
+	{
+		TextureImage color = MakeTestImage(size[0], size[1], 4);
+		TextureImage gray = MakeTestImage(size[0], size[1], 1);
+		CHECK(RoundTrip(color, TEXTURE_CODEC_BC1) >= 33.0f);
+		CHECK(RoundTrip(gray, TEXTURE_CODEC_BC4) >= 42.0f);
+		CHECK(RoundTrip(color, TEXTURE_CODEC_BC5) >= 42.0f);
+		CHECK(RoundTrip(color, TEXTURE_CODEC_BC7) >= 34.0f);
+	}
+}
+
+TEST(FlatBlocksAreExact)
+{
+	// A color that fits each codec's endpoints exactly comes
+	// back exactly: 565 (20, 40, 10) widened for BC1, any 8 bit
+	// values for BC4/BC5, and one low bit for all of BC7's
+	// channels
+	StartJobs();
+	const int codecs[] = { TEXTURE_CODEC_BC1, TEXTURE_CODEC_BC4, TEXTURE_CODEC_BC5, TEXTURE_CODEC_BC7 };
+	const unsigned char colors[][4] = { { 165, 162, 82, 255 }, { 77, 0, 0, 255 }, { 201, 13, 0, 255 }, { 165, 163, 83, 201 } };
+	for (int i = 0; i < 4; i++)
+	{
+		int codec = codecs[i];
+		TextureImage image;
+		image.Width = 8;
+		image.Height = 4;
+		image.Channels = 4;
+		for (unsigned int p = 0; p < 32; p++)
+			image.Pixels.insert(image.Pixels.end(), colors[i], colors[i] + 4);
+
+		std::vector<unsigned char> blocks;
+		CompressImage(image, codec, blocks);
+		TextureImage decoded;
+		DecompressImage(blocks, codec, image.Width, image.Height, decoded);
+		CHECK(MeasurePSNR(image, decoded, codec) == 99.0f);
+	}
+}
+
+TEST(Benchmark)
+{
+	StartJobs();
+	TextureCompressionBenchmarkResults results = RunTextureCompressionBenchmark(MakeTestImage(256, 256, 4));
+	CHECK(results.Rows.size() == TEXTURE_CODEC_COUNT);
+	for (const TextureCompressionBenchmarkRow& row : results.Rows)
+	{
+		CHECK(row.PSNR >= 33.0f);
+		printf("  %s: %.2f ms on one thread, %.2f ms on %u\n", GetCodecName(row.Codec), row.SingleThreadMs, row.MultiThreadMs, results.ThreadCount);
+	}
+}
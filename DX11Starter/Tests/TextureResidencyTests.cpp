@@ -0,0 +1,313 @@
+#include "TestFramework.h"
+#include "TextureResidency.h"
+#include <algorithm>
+
+using namespace DirectX;
+
+// A square BC7 texture's mips, down to 1x1
+static StreamingTextureDesc MakeDesc(unsigned int size)
+{
+	StreamingTextureDesc desc = {};
+	desc.Width = size;
+	desc.Height = size;
+	desc.BlockCompressed = true;
+	for (unsigned int mip = size; ; mip /= 2)
+	{
+		unsigned long long blocks = (mip + 3) / 4;
+		desc.MipBytes.push_back(blocks * blocks * 16);
+		if (mip == 1)
+			break;
+	}
+	return desc;
+}
+
+static unsigned long long GetBytes(const StreamingTextureDesc& desc, unsigned int mip)
+{
+	unsigned long long bytes = 0;
+	for (size_t m = mip; m < desc.MipBytes.size(); m++)
+		bytes += desc.MipBytes[m];
+	return bytes;
+}
+
+static TextureUse MakeUse(unsigned int texture, XMFLOAT3 center, float radius, float uvScale)
+{
+	TextureUse use = { texture, center, radius, uvScale };
+	return use;
+}
+
+// Looking down +Z from just in front of a point
+static StreamingView LookAt(XMFLOAT3 target, float distance)
+{
+	StreamingView view = {};
+	view.Position = XMFLOAT3(target.x, target.y, target.z - distance);
+	view.Forward = XMFLOAT3(0, 0, 1);
+	view.FieldOfView = 1.0472f;
+	view.Aspect = 16.0f / 9.0f;
+	view.ScreenHeight = 1080.0f;
+	return view;
+}
+
+// --------------------------------------------------------
+// Runs a residency engine frame by frame, finishing loads
+// after a fixed latency, and checks every frame that:
+//  - what's resident & loading never passes the budget
+//  - no texture drops below its tail, or has more than one
+//    load going, and loads in flight stay under the limit
+//  - evictions go least recently used first - a texture
+//    only loses mips once every texture used longer ago
+//    (that isn't loading) is down to its tail
+// --------------------------------------------------------
+struct StreamingRun
+{
+	TextureResidency Residency;
+	struct Pending { unsigned int Texture, Mip, Frame; };
+	std::vector<Pending> Loads;
+	std::vector<StreamingCommand> Commands;
+	unsigned int Frame = 0;
+	unsigned int LoadLatency = 3;
+	int Failures = 0;
+
+	StreamingRun(const StreamingSettings& settings) : Residency(settings) {}
+
+	void Step(const StreamingView& view, const std::vector<TextureUse>& uses)
+	{
+		for (size_t i = 0; i < Loads.size();)
+		{
+			if (Loads[i].Frame <= Frame)
+			{
+				Residency.LoadFinished(Loads[i].Texture, Loads[i].Mip, true);
+				Loads[i] = Loads.back();
+				Loads.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		Residency.Update(view, uses, Commands);
+		for (const StreamingCommand& command : Commands)
+		{
+			if (command.Load)
+				Loads.push_back({ command.Texture, command.Mip, Frame + LoadLatency });
+		}
+		Frame++;
+		Check();
+	}
+
+	void Check()
+	{
+		const std::vector<StreamedTexture>& textures = Residency.GetTextures();
+		const StreamingSettings& settings = Residency.GetSettings();
+		bool ok = Residency.GetCommittedBytes() <= settings.BudgetBytes && Loads.size() <= settings.MaxLoadsInFlight;
+
+		unsigned int loading = 0;
+		for (const StreamedTexture& texture : textures)
+		{
+			ok = ok && texture.Resident <= texture.TailMip && texture.Loading <= texture.Resident;
+			loading += texture.Loading != texture.Resident;
+		}
+		ok = ok && loading == Loads.size();
+
+		for (const StreamingCommand& command : Commands)
+		{
+			if (command.Load)
+				continue;
+
+			const StreamedTexture& evicted = textures[command.Texture];
+			for (const StreamedTexture& older : textures)
+			{
+				if (older.LastUsed < evicted.LastUsed && older.Loading == older.Resident)
+					ok = ok && older.Resident == older.TailMip;
+			}
+		}
+
+		if (!ok)
+		{
+			if (Failures == 0)
+				printf("  Frame %u: %llu of %llu bytes committed\n", Frame, Residency.GetCommittedBytes(), settings.BudgetBytes);
+			Failures++;
+		}
+	}
+};
+
+// --------------------------------------------------------
+// A grid of objects sharing a handful of textures of mixed
+// sizes, with a budget of a small share of everything (still
+// well over the tails) so the paths have to stream
+// --------------------------------------------------------
+static StreamingScene MakeScene()
+{
+	StreamingScene scene = {};
+	const unsigned int sizes[] = { 2048, 1024, 1024, 512, 512, 512, 256, 256, 2048, 1024, 512, 256 };
+	for (unsigned int size : sizes)
+		scene.Textures.push_back(MakeDesc(size));
+
+	for (int z = 0; z < 6; z++)
+	{
+		for (int x = 0; x < 6; x++)
+		{
+			unsigned int texture = (unsigned int)(x * 5 + z * 7) % scene.Textures.size();
+			float uvScale = 1.0f + (x + z) % 3;
+			scene.Uses.push_back(MakeUse(texture, XMFLOAT3(x * 10.0f, 0, z * 10.0f), 2.0f + (x % 2), uvScale));
+		}
+	}
+	scene.FieldOfView = 1.0472f;
+	scene.Aspect = 16.0f / 9.0f;
+	scene.ScreenHeight = 1080.0f;
+	return scene;
+}
+
+static StreamingSettings MakeSettings(const StreamingScene& scene, float budgetShare)
+{
+	unsigned long long full = 0;
+	for (const StreamingTextureDesc& desc : scene.Textures)
+		full += GetBytes(desc, 0);
+
+	StreamingSettings settings;
+	settings.BudgetBytes = (unsigned long long)(full * budgetShare);
+	settings.MaxLoadsInFlight = 2;
+	return settings;
+}
+
+TEST(PathsStayInBudget)
+{
+	StreamingScene scene = MakeScene();
+	for (int path = 0; path < STREAMING_PATH_COUNT; path++)
+	{
+		std::vector<StreamingView> views;
+		BuildStreamingPath(path, scene, 600, views);
+		CHECK(views.size() == 600);
+
+		StreamingRun run(MakeSettings(scene, 0.02f));
+		for (const StreamingTextureDesc& desc : scene.Textures)
+			run.Residency.AddTexture(desc);
+		for (const StreamingView& view : views)
+			run.Step(view, scene.Uses);
+		if (run.Failures)
+			printf("  %s: %d bad frames\n", GetStreamingPathName(path), run.Failures);
+		CHECK(run.Failures == 0);
+
+		// Held still, everything settles on what it asked for (when that fits)
+		for (int f = 0; f < 60; f++)
+			run.Step(views.back(), scene.Uses);
+		CHECK(run.Failures == 0);
+		CHECK(run.Loads.empty());
+		if (run.Residency.GetRequestedBytes() <= run.Residency.GetSettings().BudgetBytes)
+		{
+			for (const StreamedTexture& texture : run.Residency.GetTextures())
+				CHECK(texture.Resident <= texture.Requested);
+		}
+	}
+}
+
+TEST(SimulationMatchesBudget)
+{
+	// The in-game simulation, same scene - its own counters agree
+	StreamingScene scene = MakeScene();
+	StreamingSimulationResults results = RunStreamingSimulation(scene, MakeSettings(scene, 0.02f));
+	CHECK(results.Rows.size() == STREAMING_PATH_COUNT);
+	for (const StreamingSimulationResult& row : results.Rows)
+	{
+		CHECK(row.FramesOverBudget == 0);
+		CHECK(row.PeakBytes <= results.BudgetBytes);
+		CHECK(row.Evictions > 0);
+		CHECK(row.Path == STREAMING_PATH_ORBIT || row.Loads > 0);
+		printf("  %s: %.0f%% sharp, %u loads, %u evictions\n", GetStreamingPathName(row.Path), row.SharpUses * 100, row.Loads, row.Evictions);
+	}
+}
+
+// --------------------------------------------------------
+// Three same size textures far apart, with room for about
+// one and a half of them, and the camera moving between them
+// --------------------------------------------------------
+TEST(EvictsLeastRecentlyUsedFirst)
+{
+	StreamingTextureDesc desc = MakeDesc(512);
+	std::vector<TextureUse> uses;
+	uses.push_back(MakeUse(0, XMFLOAT3(0, 0, 0), 1.0f, 1.0f));
+	uses.push_back(MakeUse(1, XMFLOAT3(200, 0, 0), 1.0f, 1.0f));
+	uses.push_back(MakeUse(2, XMFLOAT3(-200, 0, 0), 1.0f, 1.0f));
+
+	StreamingSettings settings;
+	settings.BudgetBytes = GetBytes(desc, 0) * 3 / 2;
+	settings.MaxLoadsInFlight = 4;
+	StreamingRun run(settings);
+	for (int t = 0; t < 3; t++)
+		run.Residency.AddTexture(desc);
+	const std::vector<StreamedTexture>& textures = run.Residency.GetTextures();
+
+	// Everything starts resident, so seeing just the first one
+	// evicts the others - evenly, biggest mip first, as they're tied
+	run.Step(LookAt(uses[0].Center, 2.0f), uses);
+	CHECK(textures[0].Resident == 0);
+	CHECK(textures[1].Resident > 0 && textures[2].Resident > 0);
+	CHECK(std::max(textures[1].Resident, textures[2].Resident) - std::min(textures[1].Resident, textures[2].Resident) <= 1);
+
+	// Then the second: the third was used longest ago, so it goes
+	// all the way to its tail before the first loses anything
+	for (int f = 0; f < 10; f++)
+		run.Step(LookAt(uses[1].Center, 2.0f), uses);
+	CHECK(textures[1].Resident == 0);
+	CHECK(textures[2].Resident == textures[2].TailMip);
+	CHECK(textures[0].Resident < textures[0].TailMip);
+	CHECK(textures[0].Resident > 0);
+
+	// And the third: now the first is the oldest
+	for (int f = 0; f < 10; f++)
+		run.Step(LookAt(uses[2].Center, 2.0f), uses);
+	CHECK(textures[2].Resident == 0);
+	CHECK(textures[0].Resident == textures[0].TailMip);
+	CHECK(textures[1].Resident > 0 && textures[1].Resident < textures[1].TailMip);
+	CHECK(run.Failures == 0);
+}
+
+TEST(LoadsFurthestBehindFirst)
+{
+	StreamingTextureDesc desc = MakeDesc(512);
+	std::vector<TextureUse> uses;
+	uses.push_back(MakeUse(0, XMFLOAT3(0, 0, 0), 1.0f, 1.0f));
+	uses.push_back(MakeUse(1, XMFLOAT3(3, 0, 0), 1.0f, 1.0f));
+	uses.push_back(MakeUse(2, XMFLOAT3(-3, 0, 0), 1.0f, 1.0f));
+
+	// Plenty of room, one load at a time, and start everything at its tail
+	StreamingSettings settings;
+	settings.BudgetBytes = GetBytes(desc, 0) * 4;
+	settings.MaxLoadsInFlight = 1;
+	StreamingRun run(settings);
+	for (int t = 0; t < 3; t++)
+		run.Residency.AddTexture(desc);
+	StreamingSettings tiny = settings;
+	tiny.BudgetBytes = 0;
+	run.Residency.SetSettings(tiny);
+	run.Residency.Update(LookAt(XMFLOAT3(0, 0, 0), -10.0f), uses, run.Commands);
+	run.Residency.SetSettings(settings);
+	const std::vector<StreamedTexture>& textures = run.Residency.GetTextures();
+	for (const StreamedTexture& texture : textures)
+		CHECK(texture.Resident == texture.TailMip);
+
+	// The first two are in view (the second up close, so it asks for
+	// more), the third is behind the camera.  Loads go one at a time,
+	// straight to the mip asked for, furthest behind first.
+	std::vector<TextureUse> seen(uses.begin(), uses.begin() + 2);
+	seen[0].Center = XMFLOAT3(0, 0, 20);
+	seen[1].Center = XMFLOAT3(0.5f, 0, 0);
+	std::vector<unsigned int> order;
+	for (int f = 0; f < 20; f++)
+	{
+		run.Step(LookAt(XMFLOAT3(0, 0, 0), 3.0f), seen);
+		for (const StreamingCommand& command : run.Commands)
+		{
+			CHECK(command.Load);
+			CHECK(command.Mip == textures[command.Texture].Requested);
+			order.push_back(command.Texture);
+		}
+	}
+	CHECK(order.size() == 2);
+	CHECK(order.size() == 2 && order[0] == 1 && order[1] == 0);
+	CHECK(textures[0].Resident == textures[0].Requested);
+	CHECK(textures[1].Resident == textures[1].Requested);
+	CHECK(textures[1].Requested < textures[0].Requested);
+	CHECK(textures[2].Resident == textures[2].TailMip);
+	CHECK(run.Failures == 0);
+}
@@ -0,0 +1,84 @@
+#include "TestFramework.h"
+#include "TripleBuffer.h"
+#include <thread>
+
+// Two halves a torn read would give away
+struct Payload
+{
+	unsigned int Sequence;
+	unsigned int Check;
+};
+
+TEST(NothingPublished)
+{
+	TripleBuffer<int> buffer;
+	buffer.GetWriteBuffer() = 7;
+	const int& read = buffer.Acquire();
+	CHECK(read == 0);
+	CHECK(&buffer.Acquire() == &read);
+	CHECK(&buffer.GetReadBuffer() == &read);
+}
+
+TEST(AcquireGetsTheNewest)
+{
+	TripleBuffer<int> buffer;
+	buffer.GetWriteBuffer() = 1;
+	buffer.Publish();
+	CHECK(buffer.Acquire() == 1);
+
+	// Nothing new: the same slot again, untouched by the producer
+	buffer.GetWriteBuffer() = 2;
+	CHECK(buffer.Acquire() == 1);
+
+	// Two publishes between acquires: the older one is skipped
+	buffer.Publish();
+	buffer.GetWriteBuffer() = 3;
+	buffer.Publish();
+	CHECK(buffer.Acquire() == 3);
+	CHECK(buffer.GetReadBuffer() == 3);
+
+	// The three slots stay distinct the whole way through
+	for (int i = 4; i < 20; i++)
+	{
+		buffer.GetWriteBuffer() = i;
+		CHECK(&buffer.GetWriteBuffer() != &buffer.GetReadBuffer());
+		buffer.Publish();
+		if (i % 3 == 0)
+			CHECK(buffer.Acquire() == i);
+	}
+}
+
+TEST(ProducerAndConsumerThreads)
+{
+	// The consumer only ever sees whole payloads, in order, and
+	// ends up with the last one published
+	const unsigned int count = 200000;
+	TripleBuffer<Payload> buffer;
+
+	std::thread producer([&buffer, count]()
+	{
+		for (unsigned int i = 1; i <= count; i++)
+		{
+			Payload& payload = buffer.GetWriteBuffer();
+			payload.Sequence = i;
+			payload.Check = i * 2654435761u;
+			buffer.Publish();
+		}
+	});
+
+	unsigned int last = 0;
+	unsigned int seen = 0;
+	bool ok = true;
+	while (last < count)
+	{
+		const Payload& payload = buffer.Acquire();
+		ok = ok && payload.Check == payload.Sequence * 2654435761u && payload.Sequence >= last;
+		seen += payload.Sequence != last;
+		last = payload.Sequence;
+	}
+	producer.join();
+
+	CHECK(ok);
+	CHECK(last == count);
+	CHECK(seen > 0);
+}
@@ -0,0 +1,894 @@
+#include "TextureCompression.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <xmmintrin.h>
+
+const char* GetCodecName(int codec)
+{
+	switch (codec)
+	{
+	case TEXTURE_CODEC_BC1: return "BC1";
+	case TEXTURE_CODEC_BC4: return "BC4";
+	case TEXTURE_CODEC_BC5: return "BC5";
+	case TEXTURE_CODEC_BC7: return "BC7";
+	default: return "None";
+	}
+}
+
+unsigned int GetCodecBlockBytes(int codec)
+{
+	return (codec == TEXTURE_CODEC_BC1 || codec == TEXTURE_CODEC_BC4) ? 8 : 16;
+}
+
+// DXGI_FORMAT values, without needing the D3D headers here
+unsigned int GetCodecDXGIFormat(int codec, bool sRGB)
+{
+	switch (codec)
+	{
+	case TEXTURE_CODEC_BC1: return sRGB ? 72 : 71;
+	case TEXTURE_CODEC_BC4: return 80;
+	case TEXTURE_CODEC_BC5: return 83;
+	case TEXTURE_CODEC_BC7: return sRGB ? 99 : 98;
+	default: return 0;
+	}
+}
+
+int GetCodecFromDXGIFormat(unsigned int format, bool& sRGB)
+{
+	for (int codec = 0; codec < TEXTURE_CODEC_COUNT; codec++)
+	{
+		for (int s = 0; s < 2; s++)
+		{
+			if (GetCodecDXGIFormat(codec, s == 1) == format)
+			{
+				sRGB = (s == 1);
+				return codec;
+			}
+		}
+	}
+	return TEXTURE_CODEC_NONE;
+}
+
+static unsigned int BlockCount(unsigned int size)
+{
+	return std::max(1u, (size + 3) / 4);
+}
+
+// --------------------------------------------------------
+// A 4x4 block as floats, channel by channel (so four pixels
+// of one channel fill an SSE register).  Blocks hanging off
+// the edge repeat the last row & column, and one channel
+// images are gray.
+// --------------------------------------------------------
+struct Block
+{
+	float Values[4][16];	// [channel][pixel]
+};
+
+static void LoadBlock(const TextureImage& image, unsigned int blockX, unsigned int blockY, Block& block)
+{
+	for (unsigned int p = 0; p < 16; p++)
+	{
+		unsigned int x = std::min(blockX * 4 + (p & 3), image.Width - 1);
+		unsigned int y = std::min(blockY * 4 + (p >> 2), image.Height - 1);
+		const unsigned char* pixel = &image.Pixels[((size_t)y * image.Width + x) * image.Channels];
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			if (image.Channels == 1)
+				block.Values[c][p] = (c == 3) ? 255.0f : pixel[0];
+			else
+				block.Values[c][p] = (c < image.Channels) ? pixel[c] : 255.0f;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Picks the nearest palette entry (over the first few
+// channels) for every pixel, four at a time, and returns
+// the total squared error
+// --------------------------------------------------------
+static float FindIndices(const Block& block, const float palette[][4], unsigned int paletteSize, unsigned int firstChannel, unsigned int channelCount, unsigned char indices[16])
+{
+	float totalError = 0.0f;
+	for (unsigned int group = 0; group < 4; group++)
+	{
+		__m128 pixels[4];
+		for (unsigned int c = 0; c < channelCount; c++)
+			pixels[c] = _mm_loadu_ps(&block.Values[firstChannel + c][group * 4]);
+
+		__m128 bestError = _mm_set1_ps(FLT_MAX);
+		__m128 bestIndex = _mm_setzero_ps();
+		for (unsigned int i = 0; i < paletteSize; i++)
+		{
+			__m128 error = _mm_setzero_ps();
+			for (unsigned int c = 0; c < channelCount; c++)
+			{
+				__m128 diff = _mm_sub_ps(pixels[c], _mm_set1_ps(palette[i][c]));
+				error = _mm_add_ps(error, _mm_mul_ps(diff, diff));
+			}
+
+			__m128 closer = _mm_cmplt_ps(error, bestError);
+			bestError = _mm_min_ps(error, bestError);
+			bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float)i)), _mm_andnot_ps(closer, bestIndex));
+		}
+
+		float errors[4];
+		float best[4];
+		_mm_storeu_ps(errors, bestError);
+		_mm_storeu_ps(best, bestIndex);
+		for (unsigned int p = 0; p < 4; p++)
+		{
+			indices[group * 4 + p] = (unsigned char)best[p];
+			totalError += errors[p];
+		}
+	}
+	return totalError;
+}
+
+// --------------------------------------------------------
+// The line through the block's colors that fits them best:
+// the principal axis (by power iteration on the covariance),
+// clipped to the colors' projections onto it
+// --------------------------------------------------------
+static void FitEndpoints(const Block& block, unsigned int firstChannel, unsigned int channelCount, float low[4], float high[4])
+{
+	float mean[4] = {};
+	for (unsigned int c = 0; c < channelCount; c++)
+	{
+		for (unsigned int p = 0; p < 16; p++)
+			mean[c] += block.Values[firstChannel + c][p];
+		mean[c] /= 16.0f;
+	}
+
+	float covariance[4][4] = {};
+	for (unsigned int p = 0; p < 16; p++)
+	{
+		for (unsigned int i = 0; i < channelCount; i++)
+		{
+			for (unsigned int j = 0; j < channelCount; j++)
+			{
+				covariance[i][j] +=
+					(block.Values[firstChannel + i][p] - mean[i]) *
+					(block.Values[firstChannel + j][p] - mean[j]);
+			}
+		}
+	}
+
+	// Start from the widest channel, which is already close
+	float axis[4] = {};
+	unsigned int widest = 0;
+	for (unsigned int c = 1; c < channelCount; c++)
+	{
+		if (covariance[c][c] > covariance[widest][widest])
+			widest = c;
+	}
+	axis[widest] = 1.0f;
+	for (int iteration = 0; iteration < 6; iteration++)
+	{
+		float next[4] = {};
+		float length = 0.0f;
+		for (unsigned int i = 0; i < channelCount; i++)
+		{
+			for (unsigned int j = 0; j < channelCount; j++)
+				next[i] += covariance[i][j] * axis[j];
+			length += next[i] * next[i];
+		}
+		if (length < 1e-8f)
+			break;
+
+		length = 1.0f / sqrtf(length);
+		for (unsigned int c = 0; c < channelCount; c++)
+			axis[c] = next[c] * length;
+	}
+
+	float minT = 0.0f;
+	float maxT = 0.0f;
+	for (unsigned int p = 0; p < 16; p++)
+	{
+		float t = 0.0f;
+		for (unsigned int c = 0; c < channelCount; c++)
+			t += (block.Values[firstChannel + c][p] - mean[c]) * axis[c];
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	for (unsigned int c = 0; c < channelCount; c++)
+	{
+		low[c] = std::max(0.0f, std::min(255.0f, mean[c] + axis[c] * minT));
+		high[c] = std::max(0.0f, std::min(255.0f, mean[c] + axis[c] * maxT));
+	}
+}
+
+// --------------------------------------------------------
+// The endpoints that best reproduce the block for the given
+// indices, where weights[index] is how far that palette
+// entry is from low to high.  Returns false (leaving the
+// endpoints alone) if every pixel uses the same weight.
+// --------------------------------------------------------
+static bool RefineEndpoints(const Block& block, unsigned int firstChannel, unsigned int channelCount, const unsigned char indices[16], const float* weights, float low[4], float high[4])
+{
+	float lowLow = 0.0f, highHigh = 0.0f, lowHigh = 0.0f;
+	float lowSum[4] = {};
+	float highSum[4] = {};
+	for (unsigned int p = 0; p < 16; p++)
+	{
+		float w = weights[indices[p]];
+		float l = 1.0f - w;
+		lowLow += l * l;
+		highHigh += w * w;
+		lowHigh += l * w;
+		for (unsigned int c = 0; c < channelCount; c++)
+		{
+			lowSum[c] += l * block.Values[firstChannel + c][p];
+			highSum[c] += w * block.Values[firstChannel + c][p];
+		}
+	}
+
+	float determinant = lowLow * highHigh - lowHigh * lowHigh;
+	if (fabsf(determinant) < 1e-6f)
+		return false;
+
+	for (unsigned int c = 0; c < channelCount; c++)
+	{
+		low[c] = std::max(0.0f, std::min(255.0f, (lowSum[c] * highHigh - highSum[c] * lowHigh) / determinant));
+		high[c] = std::max(0.0f, std::min(255.0f, (highSum[c] * lowLow - lowSum[c] * lowHigh) / determinant));
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// BC1 - two 565 colors & 2 bit indices, always in its four
+// color mode (the first color is the larger)
+// --------------------------------------------------------
+static unsigned short Pack565(const float color[4])
+{
+	unsigned int r = (unsigned int)(color[0] * 31.0f / 255.0f + 0.5f);
+	unsigned int g = (unsigned int)(color[1] * 63.0f / 255.0f + 0.5f);
+	unsigned int b = (unsigned int)(color[2] * 31.0f / 255.0f + 0.5f);
+	return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+static void Unpack565(unsigned short packed, float color[4])
+{
+	unsigned int r = (packed >> 11) & 31;
+	unsigned int g = (packed >> 5) & 63;
+	unsigned int b = packed & 31;
+	color[0] = (float)((r << 3) | (r >> 2));
+	color[1] = (float)((g << 2) | (g >> 4));
+	color[2] = (float)((b << 3) | (b >> 2));
+	color[3] = 255.0f;
+}
+
+static void BC1Palette(unsigned short color0, unsigned short color1, float palette[4][4])
+{
+	Unpack565(color0, palette[0]);
+	Unpack565(color1, palette[1]);
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		if (color0 > color1)
+		{
+			palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+			palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2.0f;
+			palette[3][c] = 0.0f;
+		}
+	}
+}
+
+static void EncodeBC1(const Block& block, unsigned char* output)
+{
+	static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	float low[4], high[4];
+	FitEndpoints(block, 0, 3, low, high);
+
+	float bestError = FLT_MAX;
+	unsigned short bestColors[2] = {};
+	unsigned char bestIndices[16] = {};
+	for (int iteration = 0; iteration < 2; iteration++)
+	{
+		unsigned short color0 = Pack565(high);
+		unsigned short color1 = Pack565(low);
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		unsigned char indices[16] = {};
+		float error = 0.0f;
+		if (color0 == color1)
+		{
+			// Flat - every pixel is the first color
+			float palette[4][4];
+			BC1Palette(color0, color1, palette);
+			for (unsigned int p = 0; p < 16; p++)
+			{
+				for (unsigned int c = 0; c < 3; c++)
+					error += (block.Values[c][p] - palette[0][c]) * (block.Values[c][p] - palette[0][c]);
+			}
+		}
+		else
+		{
+			float palette[4][4];
+			BC1Palette(color0, color1, palette);
+			error = FindIndices(block, palette, 4, 0, 3, indices);
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			bestColors[0] = color0;
+			bestColors[1] = color1;
+			memcpy(bestIndices, indices, 16);
+		}
+
+		// Weights go from color 0 (high) to color 1 (low)
+		if (color0 == color1 || !RefineEndpoints(block, 0, 3, indices, weights, high, low))
+			break;
+	}
+
+	unsigned int packedIndices = 0;
+	for (unsigned int p = 0; p < 16; p++)
+		packedIndices |= (unsigned int)bestIndices[p] << (p * 2);
+
+	memcpy(output, &bestColors[0], 2);
+	memcpy(output + 2, &bestColors[1], 2);
+	memcpy(output + 4, &packedIndices, 4);
+}
+
+// --------------------------------------------------------
+// BC4 - two 8 bit values & 3 bit indices for one channel,
+// always in its eight value mode (the first value is the
+// larger) unless the block is flat
+// --------------------------------------------------------
+static void BC4Palette(unsigned int value0, unsigned int value1, float palette[8][4])
+{
+	palette[0][0] = (float)value0;
+	palette[1][0] = (float)value1;
+	if (value0 > value1)
+	{
+		for (unsigned int i = 2; i < 8; i++)
+			palette[i][0] = ((8 - i) * value0 + (i - 1) * value1) / 7.0f;
+	}
+	else
+	{
+		for (unsigned int i = 2; i < 6; i++)
+			palette[i][0] = ((6 - i) * value0 + (i - 1) * value1) / 5.0f;
+		palette[6][0] = 0.0f;
+		palette[7][0] = 255.0f;
+	}
+}
+
+static void EncodeBC4(const Block& block, unsigned int channel, unsigned char* output)
+{
+	static const float weights[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+
+	float high[4] = { 0.0f };
+	float low[4] = { 255.0f };
+	for (unsigned int p = 0; p < 16; p++)
+	{
+		high[0] = std::max(high[0], block.Values[channel][p]);
+		low[0] = std::min(low[0], block.Values[channel][p]);
+	}
+
+	float bestError = FLT_MAX;
+	unsigned int bestValues[2] = {};
+	unsigned char bestIndices[16] = {};
+	for (int iteration = 0; iteration < 2; iteration++)
+	{
+		unsigned int value0 = (unsigned int)(high[0] + 0.5f);
+		unsigned int value1 = (unsigned int)(low[0] + 0.5f);
+		if (value0 < value1)
+			std::swap(value0, value1);
+
+		unsigned char indices[16] = {};
+		float error = 0.0f;
+		if (value0 == value1)
+		{
+			for (unsigned int p = 0; p < 16; p++)
+				error += (block.Values[channel][p] - value0) * (block.Values[channel][p] - value0);
+		}
+		else
+		{
+			float palette[8][4];
+			BC4Palette(value0, value1, palette);
+			error = FindIndices(block, palette, 8, channel, 1, indices);
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			bestValues[0] = value0;
+			bestValues[1] = value1;
+			memcpy(bestIndices, indices, 16);
+		}
+
+		if (value0 == value1 || !RefineEndpoints(block, channel, 1, indices, weights, high, low))
+			break;
+	}
+
+	unsigned long long packedIndices = 0;
+	for (unsigned int p = 0; p < 16; p++)
+		packedIndices |= (unsigned long long)bestIndices[p] << (p * 3);
+
+	output[0] = (unsigned char)bestValues[0];
+	output[1] = (unsigned char)bestValues[1];
+	for (unsigned int i = 0; i < 6; i++)
+		output[2 + i] = (unsigned char)(packedIndices >> (i * 8));
+}
+
+// --------------------------------------------------------
+// BC7 mode 6 - one pair of 7 bit RGBA endpoints (plus a
+// shared low bit each) & 4 bit indices.  The other modes
+// split blocks into subsets, which is a lot more searching
+// for little gain on textures like these.
+// --------------------------------------------------------
+static const unsigned int BC7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static void BC7Palette(const unsigned int endpoint0[4], const unsigned int endpoint1[4], float palette[16][4])
+{
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		for (unsigned int c = 0; c < 4; c++)
+			palette[i][c] = (float)(((64 - BC7Weights[i]) * endpoint0[c] + BC7Weights[i] * endpoint1[c] + 32) >> 6);
+	}
+}
+
+// Nearest 7 bit value that, with the low bit, is close to value
+static unsigned int QuantizeBC7(float value, unsigned int pBit)
+{
+	int quantized = (int)floorf((value - pBit) / 2.0f + 0.5f);
+	quantized = std::max(0, std::min(127, quantized));
+	return ((unsigned int)quantized << 1) | pBit;
+}
+
+struct BitWriter
+{
+	unsigned char* Bytes;
+	unsigned int Position;
+
+	void Write(unsigned int value, unsigned int count)
+	{
+		for (unsigned int i = 0; i < count; i++, Position++)
+		{
+			if ((value >> i) & 1)
+				Bytes[Position >> 3] |= (unsigned char)(1 << (Position & 7));
+		}
+	}
+};
+
+struct BitReader
+{
+	const unsigned char* Bytes;
+	unsigned int Position;
+
+	unsigned int Read(unsigned int count)
+	{
+		unsigned int value = 0;
+		for (unsigned int i = 0; i < count; i++, Position++)
+			value |= (unsigned int)((Bytes[Position >> 3] >> (Position & 7)) & 1) << i;
+		return value;
+	}
+};
+
+static void EncodeBC7(const Block& block, unsigned char* output)
+{
+	static const float weights[16] = {
+		0 / 64.0f, 4 / 64.0f, 9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f,
+		34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 64 / 64.0f };
+
+	float low[4], high[4];
+	FitEndpoints(block, 0, 4, low, high);
+
+	float bestError = FLT_MAX;
+	unsigned int bestEndpoints[2][4] = {};
+	unsigned char bestIndices[16] = {};
+	for (int iteration = 0; iteration < 2; iteration++)
+	{
+		// Each endpoint's low bit is shared by its channels, so
+		// try every combination
+		bool improved = false;
+		for (unsigned int pBits = 0; pBits < 4; pBits++)
+		{
+			unsigned int endpoint0[4], endpoint1[4];
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				endpoint0[c] = QuantizeBC7(low[c], pBits & 1);
+				endpoint1[c] = QuantizeBC7(high[c], pBits >> 1);
+			}
+
+			float palette[16][4];
+			BC7Palette(endpoint0, endpoint1, palette);
+			unsigned char candidate[16];
+			float error = FindIndices(block, palette, 16, 0, 4, candidate);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(bestEndpoints[0], endpoint0, sizeof(endpoint0));
+				memcpy(bestEndpoints[1], endpoint1, sizeof(endpoint1));
+				memcpy(bestIndices, candidate, 16);
+				improved = true;
+			}
+		}
+
+		if (!improved || !RefineEndpoints(block, 0, 4, bestIndices, weights, low, high))
+			break;
+	}
+
+	// The first pixel's index is stored without its top bit,
+	// so it has to be in the bottom half - flip if it isn't
+	if (bestIndices[0] >= 8)
+	{
+		for (unsigned int c = 0; c < 4; c++)
+			std::swap(bestEndpoints[0][c], bestEndpoints[1][c]);
+		for (unsigned int p = 0; p < 16; p++)
+			bestIndices[p] = 15 - bestIndices[p];
+	}
+
+	memset(output, 0, 16);
+	BitWriter bits = { output, 0 };
+	bits.Write(1 << 6, 7);
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		bits.Write(bestEndpoints[0][c] >> 1, 7);
+		bits.Write(bestEndpoints[1][c] >> 1, 7);
+	}
+	bits.Write(bestEndpoints[0][0] & 1, 1);
+	bits.Write(bestEndpoints[1][0] & 1, 1);
+	for (unsigned int p = 0; p < 16; p++)
+		bits.Write(bestIndices[p], p == 0 ? 3 : 4);
+}
+
+// --------------------------------------------------------
+// Encodes rows [begin, end) of blocks
+// --------------------------------------------------------
+static void CompressBlockRows(const TextureImage& image, int codec, unsigned char* blocks, unsigned int begin, unsigned int end)
+{
+	unsigned int blocksWide = BlockCount(image.Width);
+	unsigned int blockBytes = GetCodecBlockBytes(codec);
+	for (unsigned int y = begin; y < end; y++)
+	{
+		for (unsigned int x = 0; x < blocksWide; x++)
+		{
+			Block block;
+			LoadBlock(image, x, y, block);
+
+			unsigned char* output = blocks + ((size_t)y * blocksWide + x) * blockBytes;
+			switch (codec)
+			{
+			case TEXTURE_CODEC_BC1: EncodeBC1(block, output); break;
+			case TEXTURE_CODEC_BC4: EncodeBC4(block, 0, output); break;
+			case TEXTURE_CODEC_BC5: EncodeBC4(block, 0, output); EncodeBC4(block, 1, output + 8); break;
+			case TEXTURE_CODEC_BC7: EncodeBC7(block, output); break;
+			}
+		}
+	}
+}
+
+void CompressImage(const TextureImage& image, int codec, std::vector<unsigned char>& blocks)
+{
+	unsigned int blocksHigh = BlockCount(image.Height);
+	blocks.resize((size_t)BlockCount(image.Width) * blocksHigh * GetCodecBlockBytes(codec));
+	JobSystem::GetInstance().ParallelFor(blocksHigh, [&](unsigned int begin, unsigned int end) {
+		CompressBlockRows(image, codec, blocks.data(), begin, end);
+	});
+}
+
+void CompressTexture(const std::vector<TextureImage>& mips, int codec, bool sRGB, CompressedTexture& result)
+{
+	PROFILE_FUNCTION();
+	result.Codec = codec;
+	result.SRGB = sRGB;
+	result.Width = mips.empty() ? 0 : mips[0].Width;
+	result.Height = mips.empty() ? 0 : mips[0].Height;
+	result.Mips.resize(mips.size());
+	for (size_t m = 0; m < mips.size(); m++)
+		CompressImage(mips[m], codec, result.Mips[m]);
+}
+
+// --------------------------------------------------------
+// Decoding, for checking the error
+// --------------------------------------------------------
+static void DecodeBC1(const unsigned char* input, float pixels[16][4])
+{
+	unsigned short color0, color1;
+	unsigned int indices;
+	memcpy(&color0, input, 2);
+	memcpy(&color1, input + 2, 2);
+	memcpy(&indices, input + 4, 4);
+
+	float palette[4][4];
+	BC1Palette(color0, color1, palette);
+	for (unsigned int p = 0; p < 16; p++)
+		memcpy(pixels[p], palette[(indices >> (p * 2)) & 3], sizeof(float) * 4);
+}
+
+static void DecodeBC4(const unsigned char* input, unsigned int channel, float pixels[16][4])
+{
+	unsigned long long indices = 0;
+	for (unsigned int i = 0; i < 6; i++)
+		indices |= (unsigned long long)input[2 + i] << (i * 8);
+
+	float palette[8][4];
+	BC4Palette(input[0], input[1], palette);
+	for (unsigned int p = 0; p < 16; p++)
+		pixels[p][channel] = palette[(indices >> (p * 3)) & 7][0];
+}
+
+static void DecodeBC7(const unsigned char* input, float pixels[16][4])
+{
+	BitReader bits = { input, 0 };
+	if (bits.Read(7) != (1 << 6))
+	{
+		// Not mode 6 - nothing here writes those
+		for (unsigned int p = 0; p < 16; p++)
+		{
+			pixels[p][0] = 255.0f; pixels[p][1] = 0.0f; pixels[p][2] = 255.0f; pixels[p][3] = 255.0f;
+		}
+		return;
+	}
+
+	unsigned int endpoint0[4], endpoint1[4];
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		endpoint0[c] = bits.Read(7) << 1;
+		endpoint1[c] = bits.Read(7) << 1;
+	}
+	unsigned int p0 = bits.Read(1);
+	unsigned int p1 = bits.Read(1);
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		endpoint0[c] |= p0;
+		endpoint1[c] |= p1;
+	}
+
+	float palette[16][4];
+	BC7Palette(endpoint0, endpoint1, palette);
+	for (unsigned int p = 0; p < 16; p++)
+		memcpy(pixels[p], palette[bits.Read(p == 0 ? 3 : 4)], sizeof(float) * 4);
+}
+
+void DecompressImage(const std::vector<unsigned char>& blocks, int codec, unsigned int width, unsigned int height, TextureImage& result)
+{
+	result.Width = width;
+	result.Height = height;
+	result.Channels = 4;
+	result.Pixels.assign((size_t)width * height * 4, 0);
+
+	unsigned int blocksWide = BlockCount(width);
+	unsigned int blockBytes = GetCodecBlockBytes(codec);
+	for (unsigned int by = 0; by < BlockCount(height); by++)
+	{
+		for (unsigned int bx = 0; bx < blocksWide; bx++)
+		{
+			const unsigned char* input = &blocks[((size_t)by * blocksWide + bx) * blockBytes];
+			float pixels[16][4] = {};
+			for (unsigned int p = 0; p < 16; p++)
+				pixels[p][3] = 255.0f;
+
+			switch (codec)
+			{
+			case TEXTURE_CODEC_BC1: DecodeBC1(input, pixels); break;
+			case TEXTURE_CODEC_BC4: DecodeBC4(input, 0, pixels); break;
+			case TEXTURE_CODEC_BC5: DecodeBC4(input, 0, pixels); DecodeBC4(input + 8, 1, pixels); break;
+			case TEXTURE_CODEC_BC7: DecodeBC7(input, pixels); break;
+			}
+
+			for (unsigned int p = 0; p < 16; p++)
+			{
+				unsigned int x = bx * 4 + (p & 3);
+				unsigned int y = by * 4 + (p >> 2);
+				if (x >= width || y >= height)
+					continue;
+
+				for (unsigned int c = 0; c < 4; c++)
+					result.Pixels[((size_t)y * width + x) * 4 + c] = (unsigned char)(pixels[p][c] + 0.5f);
+			}
+		}
+	}
+}
+
+float MeasurePSNR(const TextureImage& original, const TextureImage& decoded, int codec)
+{
+	unsigned int channels = 4;
+	switch (codec)
+	{
+	case TEXTURE_CODEC_BC1: channels = 3; break;
+	case TEXTURE_CODEC_BC4: channels = 1; break;
+	case TEXTURE_CODEC_BC5: channels = 2; break;
+	}
+
+	double squaredError = 0.0;
+	size_t pixelCount = (size_t)original.Width * original.Height;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		for (unsigned int c = 0; c < channels; c++)
+		{
+			// Same expansion as LoadBlock()
+			double expected = (original.Channels == 1)
+				? (c == 3 ? 255.0 : original.Pixels[i])
+				: (c < original.Channels ? original.Pixels[i * original.Channels + c] : 255.0);
+			double difference = expected - decoded.Pixels[i * decoded.Channels + c];
+			squaredError += difference * difference;
+		}
+	}
+
+	double meanSquaredError = squaredError / (pixelCount * channels);
+	if (meanSquaredError <= 0.0)
+		return 99.0f;
+	return (float)std::min(99.0, 10.0 * log10(255.0 * 255.0 / meanSquaredError));
+}
+
+// --------------------------------------------------------
+// DDS headers (see the DDS_HEADER & DDS_HEADER_DXT10 docs)
+// --------------------------------------------------------
+static const unsigned int DDSMagic = 0x20534444;		// "DDS "
+static const unsigned int DDSFourCCDX10 = 0x30315844;	// "DX10"
+
+struct DDSHeader
+{
+	unsigned int Size;
+	unsigned int Flags;
+	unsigned int Height;
+	unsigned int Width;
+	unsigned int PitchOrLinearSize;
+	unsigned int Depth;
+	unsigned int MipMapCount;
+	unsigned int Reserved1[11];
+	unsigned int PixelFormatSize;
+	unsigned int PixelFormatFlags;
+	unsigned int FourCC;
+	unsigned int PixelFormatUnused[5];
+	unsigned int Caps;
+	unsigned int Caps2;
+	unsigned int Caps3;
+	unsigned int Caps4;
+	unsigned int Reserved2;
+};
+
+struct DDSHeaderDX10
+{
+	unsigned int DXGIFormat;
+	unsigned int ResourceDimension;
+	unsigned int MiscFlag;
+	unsigned int ArraySize;
+	unsigned int MiscFlags2;
+};
+
+bool SaveDDS(const std::wstring& path, const CompressedTexture& texture)
+{
+	DDSHeader header = {};
+	header.Size = sizeof(DDSHeader);
+	header.Flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000;	// Caps, height, width, pixel format, mip count, linear size
+	header.Height = texture.Height;
+	header.Width = texture.Width;
+	header.PitchOrLinearSize = texture.Mips.empty() ? 0 : (unsigned int)texture.Mips[0].size();
+	header.MipMapCount = (unsigned int)texture.Mips.size();
+	header.PixelFormatSize = 32;
+	header.PixelFormatFlags = 0x4;	// FourCC
+	header.FourCC = DDSFourCCDX10;
+	header.Caps = 0x1000 | 0x400000 | 0x8;	// Texture, mipmap, complex
+
+	DDSHeaderDX10 header10 = {};
+	header10.DXGIFormat = GetCodecDXGIFormat(texture.Codec, texture.SRGB);
+	header10.ResourceDimension = 3;	// Texture2D
+	header10.ArraySize = 1;
+
+	// Only MSVC's streams take wide paths (the tests build elsewhere)
+#ifdef _MSC_VER
+	std::ofstream file(path, std::ios::binary);
+#else
+	std::ofstream file(std::string(path.begin(), path.end()), std::ios::binary);
+#endif
+	if (!file.is_open())
+		return false;
+
+	file.write((const char*)&DDSMagic, sizeof(DDSMagic));
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)&header10, sizeof(header10));
+	for (const std::vector<unsigned char>& mip : texture.Mips)
+		file.write((const char*)mip.data(), mip.size());
+	return file.good();
+}
+
+bool LoadDDS(const std::wstring& path, CompressedTexture& texture)
+{
+	return LoadDDS(path, texture, 0);
+}
+
+bool LoadDDS(const std::wstring& path, CompressedTexture& texture, unsigned int firstMip)
+{
+#ifdef _MSC_VER
+	std::ifstream file(path, std::ios::binary);
+#else
+	std::ifstream file(std::string(path.begin(), path.end()), std::ios::binary);
+#endif
+	if (!file.is_open())
+		return false;
+
+	unsigned int magic = 0;
+	DDSHeader header = {};
+	DDSHeaderDX10 header10 = {};
+	file.read((char*)&magic, sizeof(magic));
+	file.read((char*)&header, sizeof(header));
+	file.read((char*)&header10, sizeof(header10));
+	if (!file || magic != DDSMagic || header.Size != sizeof(DDSHeader) || header.FourCC != DDSFourCCDX10 ||
+		header10.ResourceDimension != 3 || header10.ArraySize != 1 || header.Width == 0 || header.Height == 0 ||
+		header.MipMapCount == 0 || header.MipMapCount > 16 || firstMip >= header.MipMapCount)
+		return false;
+
+	CompressedTexture loaded = {};
+	loaded.Codec = GetCodecFromDXGIFormat(header10.DXGIFormat, loaded.SRGB);
+	if (loaded.Codec == TEXTURE_CODEC_NONE)
+		return false;
+
+	// Mips are stored one after another, so the ones above
+	// firstMip are skipped over
+	unsigned int blockBytes = GetCodecBlockBytes(loaded.Codec);
+	loaded.Width = std::max(1u, header.Width >> firstMip);
+	loaded.Height = std::max(1u, header.Height >> firstMip);
+	loaded.Mips.resize(header.MipMapCount - firstMip);
+	for (unsigned int m = 0; m < header.MipMapCount; m++)
+	{
+		unsigned int width = std::max(1u, header.Width >> m);
+		unsigned int height = std::max(1u, header.Height >> m);
+		size_t size = (size_t)BlockCount(width) * BlockCount(height) * blockBytes;
+		if (m < firstMip)
+		{
+			file.seekg(size, std::ios::cur);
+			continue;
+		}
+
+		std::vector<unsigned char>& mip = loaded.Mips[m - firstMip];
+		mip.resize(size);
+		file.read((char*)mip.data(), mip.size());
+		if (!file)
+			return false;
+	}
+
+	texture = std::move(loaded);
+	return true;
+}
+
+// --------------------------------------------------------
+// Times each codec on the same image - once on this thread
+// alone, then spread across the job system
+// --------------------------------------------------------
+TextureCompressionBenchmarkResults RunTextureCompressionBenchmark(const TextureImage& source)
+{
+	TextureCompressionBenchmarkResults results = {};
+	results.Width = source.Width;
+	results.Height = source.Height;
+	results.ThreadCount = JobSystem::GetInstance().GetThreadCount();
+
+	for (int codec = 0; codec < TEXTURE_CODEC_COUNT; codec++)
+	{
+		TextureCompressionBenchmarkRow row = {};
+		row.Codec = codec;
+
+		std::vector<unsigned char> blocks((size_t)BlockCount(source.Width) * BlockCount(source.Height) * GetCodecBlockBytes(codec));
+		auto start = std::chrono::high_resolution_clock::now();
+		CompressBlockRows(source, codec, blocks.data(), 0, BlockCount(source.Height));
+		auto single = std::chrono::high_resolution_clock::now();
+		CompressImage(source, codec, blocks);
+		auto multi = std::chrono::high_resolution_clock::now();
+
+		row.SingleThreadMs = std::chrono::duration<double, std::milli>(single - start).count();
+		row.MultiThreadMs = std::chrono::duration<double, std::milli>(multi - single).count();
+		row.MegapixelsPerSecond = (double)source.Width * source.Height / (row.MultiThreadMs * 1000.0);
+
+		TextureImage decoded;
+		DecompressImage(blocks, codec, source.Width, source.Height, decoded);
+		row.PSNR = MeasurePSNR(source, decoded, codec);
+		results.Rows.push_back(row);
+	}
+
+	return results;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Bump whenever cooked textures would change, so old cached
+// DDS files are ignored
+#define TEXTURE_COOK_VERSION	2
+
+// Block compressed formats the cook step can write
+#define TEXTURE_CODEC_NONE		-1
+#define TEXTURE_CODEC_BC1		0	// RGB, 565 endpoints - 8 bytes per 4x4 block
+#define TEXTURE_CODEC_BC4		1	// One channel - 8 bytes per block
+#define TEXTURE_CODEC_BC5		2	// Two channels (a normal's x & y) - 16 bytes per block
+#define TEXTURE_CODEC_BC7		3	// RGBA, mode 6 only - 16 bytes per block
+#define TEXTURE_CODEC_COUNT		4
+
+// --------------------------------------------------------
+// An uncompressed image: 1 or 4 channels of 8 bits each,
+// rows top to bottom
+// --------------------------------------------------------
+struct TextureImage
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int Channels;
+	std::vector<unsigned char> Pixels;
+};
+
+// --------------------------------------------------------
+// A full mip chain of blocks - each mip's blocks are row by
+// row, the way both D3D and DDS files want them
+// --------------------------------------------------------
+struct CompressedTexture
+{
+	int Codec;
+	bool SRGB;
+	unsigned int Width;
+	unsigned int Height;
+	std::vector<std::vector<unsigned char>> Mips;
+};
+
+// --------------------------------------------------------
+// Results of RunTextureCompressionBenchmark() - one row
+// per codec, each encoding the same image
+// --------------------------------------------------------
+struct TextureCompressionBenchmarkRow
+{
+	int Codec;
+	double SingleThreadMs;
+	double MultiThreadMs;
+	double MegapixelsPerSecond;	// Multithreaded
+	float PSNR;					// Over the channels the codec keeps
+};
+
+struct TextureCompressionBenchmarkResults
+{
+	unsigned int Width;
+	unsigned int Height;
+	unsigned int ThreadCount;
+	std::vector<TextureCompressionBenchmarkRow> Rows;
+};
+
+// Names & sizes of each codec
+const char* GetCodecName(int codec);
+unsigned int GetCodecBlockBytes(int codec);
+unsigned int GetCodecDXGIFormat(int codec, bool sRGB);
+int GetCodecFromDXGIFormat(unsigned int format, bool& sRGB);	// TEXTURE_CODEC_NONE if it isn't one
+
+// --------------------------------------------------------
+// CPU block compression.  Rows of blocks are spread across
+// the job system, and each block picks its endpoints along
+// its colors' principal axis, then refines them by least
+// squares - palette indices are picked four pixels at a
+// time with SSE.
+// --------------------------------------------------------
+void CompressImage(const TextureImage& image, int codec, std::vector<unsigned char>& blocks);
+void CompressTexture(const std::vector<TextureImage>& mips, int codec, bool sRGB, CompressedTexture& result);
+
+// Back to 4 channel pixels, for measuring the error
+void DecompressImage(const std::vector<unsigned char>& blocks, int codec, unsigned int width, unsigned int height, TextureImage& result);
+
+// Peak signal to noise ratio in dB, over the channels the
+// codec keeps (higher is better - identical images give 99)
+float MeasurePSNR(const TextureImage& original, const TextureImage& decoded, int codec);
+
+// DDS files with a DX10 header and every mip - loading fails
+// (returns false) for anything this didn't write
+bool SaveDDS(const std::wstring& path, const CompressedTexture& texture);
+bool LoadDDS(const std::wstring& path, CompressedTexture& texture);
+
+// Just the mips from firstMip down, as a texture of their own
+// (the size of that mip) - for streaming in more detail
+bool LoadDDS(const std::wstring& path, CompressedTexture& texture, unsigned int firstMip);
+
+// Encodes the image with every codec, on one thread & all
+TextureCompressionBenchmarkResults RunTextureCompressionBenchmark(const TextureImage& source);
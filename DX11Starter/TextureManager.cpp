@@ -0,0 +1,627 @@
+#include "TextureManager.h"
+#include "JobSystem.h"
+#include "PathHelpers.h"
+#include "Profiler.h"
+#include "WICTextureLoader.h"
+#include <wincodec.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <fstream>
+
+TextureManager::TextureManager(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const TextureCookSettings& settings)
+	: device(device),
+	context(context),
+	settings(settings),
+	loadedCount(0),
+	pendingRequests(0),
+	stats()
+{
+}
+
+TextureManager::~TextureManager()
+{
+}
+
+// --------------------------------------------------------
+// Hands out the texture for a file, which is filled in by
+// the next LoadAll()
+// --------------------------------------------------------
+std::shared_ptr<Texture> TextureManager::Request(const std::wstring& path, int usage)
+{
+	requests.push_back(std::make_pair(path, usage));
+	pendingRequests++;
+
+	std::wstring canonical = CanonicalPath(path);
+	auto found = pathTable.find(canonical);
+	if (found != pathTable.end())
+		return entries[found->second].Handle;
+
+	Entry entry = {};
+	entry.Handle = std::make_shared<Texture>();
+	entry.Handle->Path = canonical;
+	entry.Usage = usage;
+	entry.Source = entries.size();
+	pathTable.insert(std::make_pair(canonical, entries.size()));
+	entries.push_back(entry);
+	return entry.Handle;
+}
+
+std::wstring TextureManager::CanonicalPath(const std::wstring& path)
+{
+	// Resolves the ..'s and turns every / into a \ - paths on
+	// Windows aren't case sensitive, so neither is the key
+	wchar_t full[MAX_PATH];
+	DWORD length = GetFullPathNameW(path.c_str(), MAX_PATH, full, nullptr);
+	std::wstring canonical = (length > 0 && length < MAX_PATH) ? std::wstring(full, length) : path;
+	for (wchar_t& c : canonical)
+		c = (wchar_t)std::towlower(c);
+	return canonical;
+}
+
+// --------------------------------------------------------
+// FNV-1a over a whole file
+// --------------------------------------------------------
+static unsigned long long HashFile(const std::vector<unsigned char>& file)
+{
+	unsigned long long hash = 14695981039346656037ull;
+	for (unsigned char b : file)
+	{
+		hash ^= b;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------
+// Decodes an image file that's already in memory with WIC,
+// on whichever thread this is.  Grayscale images stay one
+// channel; everything else becomes RGBA8, which (like the
+// DirectX Tool Kit's loader) is sRGB if the file says so.
+// --------------------------------------------------------
+static bool DecodeImage(const std::vector<unsigned char>& file, TextureImage& image, bool& sRGB)
+{
+	if (file.empty())
+		return false;
+
+	// Workers aren't in a COM apartment by default - this puts
+	// them in the shared one (and fails harmlessly on a thread
+	// that's already in another)
+	HRESULT com = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	bool decoded = false;
+	{
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		Microsoft::WRL::ComPtr<IWICStream> stream;
+		Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+		Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+		Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+		WICPixelFormatGUID sourceFormat = {};
+
+		if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()))) &&
+			SUCCEEDED(factory->CreateStream(stream.GetAddressOf())) &&
+			SUCCEEDED(stream->InitializeFromMemory((BYTE*)file.data(), (DWORD)file.size())) &&
+			SUCCEEDED(factory->CreateDecoderFromStream(stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf())) &&
+			SUCCEEDED(decoder->GetFrame(0, frame.GetAddressOf())) &&
+			SUCCEEDED(frame->GetSize(&image.Width, &image.Height)) &&
+			SUCCEEDED(frame->GetPixelFormat(&sourceFormat)))
+		{
+			bool gray = memcmp(&sourceFormat, &GUID_WICPixelFormat8bppGray, sizeof(GUID)) == 0;
+
+			// Same checks as the tool kit: a PNG's sRGB (or 2.2 gamma)
+			// chunk, or the color space anything else records
+			sRGB = false;
+			Microsoft::WRL::ComPtr<IWICMetadataQueryReader> metadata;
+			GUID container = {};
+			if (!gray &&
+				SUCCEEDED(frame->GetMetadataQueryReader(metadata.GetAddressOf())) &&
+				SUCCEEDED(metadata->GetContainerFormat(&container)))
+			{
+				PROPVARIANT value;
+				PropVariantInit(&value);
+				if (memcmp(&container, &GUID_ContainerFormatPng, sizeof(GUID)) == 0)
+				{
+					if (SUCCEEDED(metadata->GetMetadataByName(L"/sRGB/RenderingIntent", &value)) && value.vt == VT_UI1)
+						sRGB = true;
+					PropVariantClear(&value);
+					if (!sRGB && SUCCEEDED(metadata->GetMetadataByName(L"/gAMA/ImageGamma", &value)) && value.vt == VT_UI4)
+						sRGB = (value.uintVal == 45455);
+				}
+				else if (SUCCEEDED(metadata->GetMetadataByName(L"System.Image.ColorSpace", &value)) && value.vt == VT_UI2)
+				{
+					sRGB = (value.uiVal == 1);
+				}
+				PropVariantClear(&value);
+			}
+
+			image.Channels = gray ? 1 : 4;
+			image.Pixels.resize((size_t)image.Width * image.Height * image.Channels);
+
+			if (SUCCEEDED(factory->CreateFormatConverter(converter.GetAddressOf())) &&
+				SUCCEEDED(converter->Initialize(frame.Get(), gray ? GUID_WICPixelFormat8bppGray : GUID_WICPixelFormat32bppRGBA,
+					WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom)))
+			{
+				decoded = SUCCEEDED(converter->CopyPixels(nullptr, image.Width * image.Channels, (UINT)image.Pixels.size(), image.Pixels.data()));
+			}
+		}
+	}
+
+	if (SUCCEEDED(com))
+		CoUninitialize();
+	return decoded;
+}
+
+bool TextureManager::DecodeFile(const std::wstring& path, TextureImage& image, bool& sRGB)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.good())
+		return false;
+
+	std::vector<unsigned char> bytes((size_t)file.tellg());
+	file.seekg(0);
+	file.read((char*)bytes.data(), bytes.size());
+	return DecodeImage(bytes, image, sRGB);
+}
+
+// --------------------------------------------------------
+// Loads every file requested since the last call:
+//
+//  1. Read & hash each new file (in parallel)
+//  2. Match files with identical contents (serially - it's
+//     just a lookup per file)
+//  3. Load each unique image's cooked DDS, or decode (and
+//     maybe cook) it (in parallel)
+//  4. Create the textures and fill in every handle (on this
+//     thread, since it owns the context)
+// --------------------------------------------------------
+void TextureManager::LoadAll()
+{
+	PROFILE_FUNCTION();
+	auto start = std::chrono::high_resolution_clock::now();
+
+	JobSystem& jobs = JobSystem::GetInstance();
+	size_t first = loadedCount;
+	unsigned int newCount = (unsigned int)(entries.size() - first);
+
+	stats = {};
+	stats.Requested = pendingRequests;
+	stats.Files = newCount;
+	pendingRequests = 0;
+
+	// Read & hash
+	jobs.ParallelFor(newCount, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; i++)
+		{
+			Entry& entry = entries[first + i];
+			std::ifstream file(entry.Handle->Path, std::ios::binary | std::ios::ate);
+			if (!file.good())
+				continue;
+
+			entry.File.resize((size_t)file.tellg());
+			file.seekg(0);
+			file.read((char*)entry.File.data(), entry.File.size());
+			entry.Hash = HashFile(entry.File);
+		}
+	});
+	auto read = std::chrono::high_resolution_clock::now();
+
+	// Match contents - the first of each is the one decoded
+	std::unordered_map<unsigned long long, size_t> contentTable;
+	std::vector<unsigned int> unique;
+	for (size_t i = first; i < entries.size(); i++)
+	{
+		Entry& entry = entries[i];
+		if (!entry.File.empty())
+		{
+			// The same file used two ways is cooked twice
+			unsigned long long key = entry.Hash ^ ((unsigned long long)entry.Usage * 0x9E3779B97F4A7C15ull);
+			auto found = contentTable.find(key);
+			if (found != contentTable.end() && entries[found->second].Usage == entry.Usage && entries[found->second].File == entry.File)
+			{
+				entry.Source = found->second;
+				continue;
+			}
+			contentTable.insert(std::make_pair(key, i));
+		}
+		unique.push_back((unsigned int)i);
+	}
+	stats.Images = (unsigned int)unique.size();
+
+	// Decode (one image per job - cooking spreads each one's
+	// blocks out further)
+	jobs.ParallelFor((unsigned int)unique.size(), [&](unsigned int begin, unsigned int end) {
+		for (unsigned int u = begin; u < end; u++)
+			Prepare(entries[unique[u]]);
+	});
+	auto decode = std::chrono::high_resolution_clock::now();
+
+	// Upload, then share each view with its duplicates
+	for (unsigned int u : unique)
+	{
+		Entry& entry = entries[u];
+		if (entry.Decoded)
+		{
+			if (entry.Handle->FromCache)
+				stats.FromCache++;
+			else if (!entry.Cooked.Mips.empty())
+				stats.Cooked++;
+			Upload(entry);
+			stats.Bytes += entry.Handle->Bytes;
+		}
+		else
+		{
+			printf("Texture %ls could not be loaded\n", entry.Handle->Path.c_str());
+			stats.Failed++;
+		}
+	}
+	for (size_t i = first; i < entries.size(); i++)
+	{
+		Entry& entry = entries[i];
+		if (entry.Source == i)
+			continue;
+
+		std::wstring path = entry.Handle->Path;
+		*entry.Handle = *entries[entry.Source].Handle;
+		entry.Handle->Path = path;
+		entry.File.clear();
+		entry.File.shrink_to_fit();
+	}
+	loadedCount = entries.size();
+
+	// What the same textures would take as RGBA8, mips and all
+	for (unsigned int u : unique)
+	{
+		const Texture& texture = *entries[u].Handle;
+		for (unsigned int m = 0; m < texture.MipLevels; m++)
+			stats.UncompressedBytes += (unsigned long long)max(1u, texture.Width >> m) * max(1u, texture.Height >> m) * 4;
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	stats.ReadMs = std::chrono::duration<double, std::milli>(read - start).count();
+	stats.DecodeMs = std::chrono::duration<double, std::milli>(decode - read).count();
+	stats.UploadMs = std::chrono::duration<double, std::milli>(end - decode).count();
+	stats.TotalMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// --------------------------------------------------------
+// The codec a usage is cooked with, if any
+// --------------------------------------------------------
+int TextureManager::ChooseCodec(int usage) const
+{
+	if (!settings.Compress)
+		return TEXTURE_CODEC_NONE;
+
+	switch (usage)
+	{
+	case TEXTURE_USAGE_COLOR: return settings.ColorAsBC1 ? TEXTURE_CODEC_BC1 : TEXTURE_CODEC_BC7;
+	case TEXTURE_USAGE_NORMAL: return TEXTURE_CODEC_BC5;
+	case TEXTURE_USAGE_GRAYSCALE: return TEXTURE_CODEC_BC4;
+	case TEXTURE_USAGE_PACKED: return TEXTURE_CODEC_BC7;
+	default: return TEXTURE_CODEC_NONE;
+	}
+}
+
+// --------------------------------------------------------
+// How a usage's mips are filtered.  Color is sRGB encoded
+// whether or not the file says so (the shaders treat it as
+// gamma 2.2), and everything tiles, so filters wrap.
+// --------------------------------------------------------
+MipSettings TextureManager::ChooseMipSettings(int usage, bool sRGB) const
+{
+	MipSettings mipSettings;
+	mipSettings.Filter = settings.MipFilter;
+	mipSettings.SRGB = usage == TEXTURE_USAGE_COLOR || sRGB;
+	mipSettings.NormalMap = usage == TEXTURE_USAGE_NORMAL;
+	mipSettings.Wrap = true;
+	mipSettings.AlphaCutoff = usage == TEXTURE_USAGE_COLOR ? settings.AlphaCutoff : 0.0f;
+	return mipSettings;
+}
+
+// --------------------------------------------------------
+// Gets one unique image ready to upload (on a worker):
+//
+//  - Compressed usages load the cooked DDS named by the
+//    source's hash & codec, if there is one
+//  - Otherwise the file's decoded and its mips are made,
+//    then compressed ones are cooked (blocks & the DDS for
+//    next time)
+//  - Uncompressed ones (and sizes BC can't take) just keep
+//    the mips as they are
+// --------------------------------------------------------
+void TextureManager::Prepare(Entry& entry)
+{
+	Texture& texture = *entry.Handle;
+	int codec = ChooseCodec(entry.Usage);
+
+	std::wstring cookedPath;
+	if (codec != TEXTURE_CODEC_NONE && !entry.File.empty())
+	{
+		// The mips depend on how they're filtered too (a file's own
+		// sRGB flag is already covered by its hash)
+		MipSettings mipSettings = ChooseMipSettings(entry.Usage, false);
+		unsigned int alphaCutoff = 0;
+		memcpy(&alphaCutoff, &mipSettings.AlphaCutoff, sizeof(alphaCutoff));
+
+		unsigned long long hash = entry.Hash;
+		unsigned long long key[] = {
+			(unsigned long long)codec,
+			TEXTURE_COOK_VERSION,
+			(unsigned long long)mipSettings.Filter,
+			(unsigned long long)mipSettings.SRGB,
+			(unsigned long long)mipSettings.NormalMap,
+			(unsigned long long)mipSettings.Wrap,
+			alphaCutoff };
+		for (unsigned long long k : key)
+		{
+			hash ^= k;
+			hash *= 1099511628211ull;
+		}
+
+		wchar_t fileName[64];
+		swprintf(fileName, 64, L"Texture_%016llx.dds", hash);
+		cookedPath = FixPath(fileName);
+
+		if (settings.UseCache && LoadDDS(cookedPath, entry.Cooked) && entry.Cooked.Codec == codec)
+		{
+			texture.Width = entry.Cooked.Width;
+			texture.Height = entry.Cooked.Height;
+			texture.FromCache = true;
+			texture.CookedPath = cookedPath;
+			entry.Decoded = true;
+			entry.File.clear();
+			entry.File.shrink_to_fit();
+			return;
+		}
+		entry.Cooked = {};
+	}
+
+	TextureImage image = {};
+	bool sRGB = false;
+	entry.Decoded = DecodeImage(entry.File, image, sRGB);
+	entry.File.clear();
+	entry.File.shrink_to_fit();
+	if (!entry.Decoded)
+		return;
+
+	// Packed channels are data, whatever the file says
+	if (entry.Usage == TEXTURE_USAGE_PACKED)
+		sRGB = false;
+
+	texture.Width = image.Width;
+	texture.Height = image.Height;
+
+	std::vector<TextureImage> mips;
+	GenerateMips(image, ChooseMipSettings(entry.Usage, sRGB), mips);
+
+	// The top mip of a block compressed texture has to be
+	// whole blocks
+	if (codec != TEXTURE_CODEC_NONE && image.Width % 4 == 0 && image.Height % 4 == 0)
+	{
+		CompressTexture(mips, codec, sRGB, entry.Cooked);
+
+		TextureImage decoded;
+		DecompressImage(entry.Cooked.Mips[0], codec, image.Width, image.Height, decoded);
+		texture.PSNR = MeasurePSNR(image, decoded, codec);
+
+		if (settings.UseCache)
+		{
+			if (SaveDDS(cookedPath, entry.Cooked))
+				texture.CookedPath = cookedPath;
+			else
+				printf("Couldn't save cooked texture to %ls\n", cookedPath.c_str());
+		}
+	}
+	else
+	{
+		entry.Format = image.Channels == 1 ? DXGI_FORMAT_R8_UNORM : (sRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM);
+		entry.Mips = std::move(mips);
+	}
+}
+
+// --------------------------------------------------------
+// Creates the texture, with every mip from the start -
+// cooked ones straight from their blocks, and everything
+// else from its pixels
+// --------------------------------------------------------
+void TextureManager::Upload(Entry& entry)
+{
+	Texture& texture = *entry.Handle;
+
+	if (!entry.Cooked.Mips.empty())
+	{
+		const CompressedTexture& cooked = entry.Cooked;
+		unsigned int blockBytes = GetCodecBlockBytes(cooked.Codec);
+
+		std::vector<D3D11_SUBRESOURCE_DATA> data(cooked.Mips.size());
+		texture.Bytes = 0;
+		for (size_t m = 0; m < cooked.Mips.size(); m++)
+		{
+			data[m].pSysMem = cooked.Mips[m].data();
+			data[m].SysMemPitch = max(1u, ((cooked.Width >> m) + 3) / 4) * blockBytes;
+			texture.Bytes += cooked.Mips[m].size();
+		}
+
+		D3D11_TEXTURE2D_DESC desc = {};
+		desc.Width = cooked.Width;
+		desc.Height = cooked.Height;
+		desc.MipLevels = (UINT)cooked.Mips.size();
+		desc.ArraySize = 1;
+		desc.Format = (DXGI_FORMAT)GetCodecDXGIFormat(cooked.Codec, cooked.SRGB);
+		desc.SampleDesc.Count = 1;
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> resource;
+		if (SUCCEEDED(device->CreateTexture2D(&desc, data.data(), resource.GetAddressOf())) &&
+			SUCCEEDED(device->CreateShaderResourceView(resource.Get(), 0, texture.SRV.GetAddressOf())))
+		{
+			texture.Format = desc.Format;
+			texture.MipLevels = desc.MipLevels;
+		}
+		else
+		{
+			printf("Texture %ls could not be created\n", texture.Path.c_str());
+			stats.Failed++;
+		}
+
+		entry.Cooked.Mips.clear();
+		entry.Cooked.Mips.shrink_to_fit();
+		return;
+	}
+
+	std::vector<D3D11_SUBRESOURCE_DATA> data(entry.Mips.size());
+	texture.Bytes = 0;
+	for (size_t m = 0; m < entry.Mips.size(); m++)
+	{
+		const TextureImage& mip = entry.Mips[m];
+		data[m].pSysMem = mip.Pixels.data();
+		data[m].SysMemPitch = mip.Width * mip.Channels;
+		texture.Bytes += mip.Pixels.size();
+	}
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = texture.Width;
+	desc.Height = texture.Height;
+	desc.MipLevels = (UINT)entry.Mips.size();
+	desc.ArraySize = 1;
+	desc.Format = entry.Format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> resource;
+	if (SUCCEEDED(device->CreateTexture2D(&desc, data.data(), resource.GetAddressOf())) &&
+		SUCCEEDED(device->CreateShaderResourceView(resource.Get(), 0, texture.SRV.GetAddressOf())))
+	{
+		texture.Format = desc.Format;
+		texture.MipLevels = desc.MipLevels;
+	}
+	else
+	{
+		printf("Texture %ls could not be created\n", texture.Path.c_str());
+		stats.Failed++;
+	}
+
+	entry.Mips.clear();
+	entry.Mips.shrink_to_fit();
+}
+
+const TextureLoadStats& TextureManager::GetStats() const
+{
+	return stats;
+}
+
+std::vector<std::shared_ptr<Texture>> TextureManager::GetTextures() const
+{
+	std::vector<std::shared_ptr<Texture>> textures;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (entries[i].Source == i)
+			textures.push_back(entries[i].Handle);
+	}
+	return textures;
+}
+
+std::vector<std::vector<std::shared_ptr<Texture>>> TextureManager::GetTextureGroups() const
+{
+	std::vector<std::vector<std::shared_ptr<Texture>>> groups;
+	std::unordered_map<size_t, size_t> groupTable;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		auto found = groupTable.find(entries[i].Source);
+		if (found == groupTable.end())
+		{
+			found = groupTable.insert(std::make_pair(entries[i].Source, groups.size())).first;
+			groups.push_back(std::vector<std::shared_ptr<Texture>>());
+		}
+		groups[found->second].push_back(entries[i].Handle);
+	}
+	return groups;
+}
+
+const char* TextureManager::GetFormatName(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM: return "RGBA8";
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB: return "RGBA8 sRGB";
+	case DXGI_FORMAT_R8_UNORM: return "R8";
+	case DXGI_FORMAT_BC1_UNORM: return "BC1";
+	case DXGI_FORMAT_BC1_UNORM_SRGB: return "BC1 sRGB";
+	case DXGI_FORMAT_BC4_UNORM: return "BC4";
+	case DXGI_FORMAT_BC5_UNORM: return "BC5";
+	case DXGI_FORMAT_BC7_UNORM: return "BC7";
+	case DXGI_FORMAT_BC7_UNORM_SRGB: return "BC7 sRGB";
+	default: return "?";
+	}
+}
+
+// --------------------------------------------------------
+// Loads everything that's been requested again: once with
+// the tool kit's loader per request (what LoadMaterials()
+// did before there was a manager), and once through a new
+// manager with the same settings (so cooked textures come
+// from their DDS files).  The files are in the OS's cache
+// both times.
+// --------------------------------------------------------
+TextureLoadBenchmarkResults TextureManager::RunBenchmark()
+{
+	TextureLoadBenchmarkResults results = {};
+	results.Requested = (unsigned int)requests.size();
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (const std::pair<std::wstring, int>& request : requests)
+	{
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+		DirectX::CreateWICTextureFromFile(device.Get(), context.Get(), request.first.c_str(), nullptr, srv.GetAddressOf());
+	}
+	results.SerialMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	TextureManager manager(device, context, settings);
+	for (const std::pair<std::wstring, int>& request : requests)
+		manager.Request(request.first, request.second);
+	manager.LoadAll();
+	results.Manager = manager.GetStats();
+
+	return results;
+}
+
+// --------------------------------------------------------
+// Decodes the first (decent sized) color texture again, for
+// the benchmarks to work on
+// --------------------------------------------------------
+bool TextureManager::DecodeFirstColor(TextureImage& image, bool& sRGB) const
+{
+	for (const Entry& entry : entries)
+	{
+		if (entry.Usage == TEXTURE_USAGE_COLOR && DecodeFile(entry.Handle->Path, image, sRGB) && image.Width >= 256)
+			return true;
+	}
+	return false;
+}
+
+// Times every codec on the top mip
+TextureCompressionBenchmarkResults TextureManager::RunCompressionBenchmark()
+{
+	TextureImage image = {};
+	bool sRGB = false;
+	if (DecodeFirstColor(image, sRGB))
+		return RunTextureCompressionBenchmark(image);
+	return TextureCompressionBenchmarkResults();
+}
+
+// Times every mip filter on the whole chain (as color, the
+// way it's cooked)
+MipGenerationBenchmarkResults TextureManager::RunMipBenchmark()
+{
+	TextureImage image = {};
+	bool sRGB = false;
+	if (DecodeFirstColor(image, sRGB))
+		return RunMipGenerationBenchmark(image, true);
+	return MipGenerationBenchmarkResults();
+}
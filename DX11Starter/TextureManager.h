@@ -0,0 +1,168 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MipGeneration.h"
+#include "TextureCompression.h"
+
+// What a texture holds, which decides how it's cooked
+#define TEXTURE_USAGE_UNCOMPRESSED	0	// Left as RGBA8 (or R8)
+#define TEXTURE_USAGE_COLOR			1	// BC7 (or BC1)
+#define TEXTURE_USAGE_NORMAL		2	// BC5 - just x & y, the shaders rebuild z
+#define TEXTURE_USAGE_GRAYSCALE		3	// BC4 - just red
+#define TEXTURE_USAGE_PACKED		4	// BC7, never sRGB - a channel per map (like ORM, see TexturePacking.h)
+
+// --------------------------------------------------------
+// How (and whether) textures are block compressed, and
+// how their mips are made
+// --------------------------------------------------------
+struct TextureCookSettings
+{
+	bool Compress = true;
+	bool ColorAsBC1 = false;	// Half the size of BC7, but no alpha & more error
+	bool UseCache = true;		// Cooked DDS files next to the .exe, named by source, codec & mip settings
+	int MipFilter = MIP_FILTER_KAISER;
+	float AlphaCutoff = 0.0f;	// Alpha test value to keep color textures' coverage at in every mip (0 for none)
+};
+
+// --------------------------------------------------------
+// A texture handed out by the TextureManager.  The view is
+// empty until the manager's LoadAll() - every request for
+// the same image shares the same one.
+// --------------------------------------------------------
+struct Texture
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SRV;
+	std::wstring Path;		// Canonical path of the file it came from
+	std::wstring CookedPath;	// Its DDS file, if it's cooked & cached (empty otherwise)
+	unsigned int Width;
+	unsigned int Height;
+	DXGI_FORMAT Format;
+	unsigned int MipLevels;
+	unsigned long long Bytes;	// Every mip, on the GPU
+	float PSNR;				// Of the top mip, if it was cooked this run (0 otherwise)
+	bool FromCache;			// Loaded straight from a cooked DDS file
+};
+
+// --------------------------------------------------------
+// Timing & counts from the last TextureManager::LoadAll()
+// --------------------------------------------------------
+struct TextureLoadStats
+{
+	unsigned int Requested;	// Calls to Request(), duplicates included
+	unsigned int Files;		// Unique paths
+	unsigned int Images;	// Unique contents - what's actually decoded & uploaded
+	unsigned int Failed;
+	unsigned int Cooked;	// Compressed this time
+	unsigned int FromCache;
+	unsigned long long Bytes;				// Every unique texture, on the GPU
+	unsigned long long UncompressedBytes;	// The same, if they were all RGBA8
+	double ReadMs;			// Reading & hashing every file (in parallel)
+	double DecodeMs;		// Decoding (& cooking) each image, or loading its DDS (in parallel)
+	double UploadMs;		// Creating the textures (calling thread)
+	double TotalMs;
+};
+
+// --------------------------------------------------------
+// Results of TextureManager::RunBenchmark()
+// --------------------------------------------------------
+struct TextureLoadBenchmarkResults
+{
+	unsigned int Requested;
+	double SerialMs;		// CreateWICTextureFromFile() once per request, the way it used to be
+	TextureLoadStats Manager;
+};
+
+// --------------------------------------------------------
+// Loads textures for the whole scene at once:
+//
+//  - Request() each file up front, which gives back a shared
+//    handle (the same one for every path naming that file)
+//  - LoadAll() then reads & hashes the files, and decodes
+//    the unique images, across the job system - files with
+//    identical contents are only decoded once, and share
+//    a texture on the GPU
+//  - Every decoded image gets its mips on the CPU, filtered
+//    in linear space for color (MipGeneration.h)
+//  - Textures whose usage calls for it are then cooked:
+//    block compressed (TextureCompression.h) and saved as a
+//    DDS file, which later runs load directly
+//  - Only creating the textures happens on the calling thread
+// --------------------------------------------------------
+class TextureManager
+{
+public:
+	TextureManager(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		const TextureCookSettings& settings = TextureCookSettings());
+	~TextureManager();
+
+	// The first request for a path decides its usage
+	std::shared_ptr<Texture> Request(const std::wstring& path, int usage = TEXTURE_USAGE_UNCOMPRESSED);
+
+	// Loads everything requested since the last call
+	void LoadAll();
+	const TextureLoadStats& GetStats() const;
+
+	// Reloads every request both ways (serially & through a
+	// fresh manager) - the results are thrown away
+	TextureLoadBenchmarkResults RunBenchmark();
+
+	// Encodes the first color texture with every codec, or
+	// makes its mips with every filter
+	TextureCompressionBenchmarkResults RunCompressionBenchmark();
+	MipGenerationBenchmarkResults RunMipBenchmark();
+
+	// One handle per unique image
+	std::vector<std::shared_ptr<Texture>> GetTextures() const;
+
+	// Every handle, grouped by the image they share - anything
+	// replacing a view has to replace it in the whole group
+	std::vector<std::vector<std::shared_ptr<Texture>>> GetTextureGroups() const;
+	static const char* GetFormatName(DXGI_FORMAT format);
+
+	// Full path, lower case - the key requests are shared by
+	static std::wstring CanonicalPath(const std::wstring& path);
+
+	// Reads & decodes one image file on this thread, the same
+	// way LoadAll() does, for anything that needs the pixels
+	static bool DecodeFile(const std::wstring& path, TextureImage& image, bool& sRGB);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	TextureCookSettings settings;
+
+	// One per unique path
+	struct Entry
+	{
+		std::shared_ptr<Texture> Handle;
+		int Usage;
+		std::vector<unsigned char> File;
+		unsigned long long Hash;
+		size_t Source;						// Entry with the same contents that's actually decoded (may be this one)
+		std::vector<TextureImage> Mips;		// Decoded, with every mip - freed once uploaded
+		DXGI_FORMAT Format;					// RGBA8 (maybe sRGB) or R8 for grayscale files
+		CompressedTexture Cooked;			// Or the blocks, if it's compressed
+		bool Decoded;
+	};
+	std::vector<Entry> entries;
+	std::unordered_map<std::wstring, size_t> pathTable;
+	std::vector<std::pair<std::wstring, int>> requests;	// Every path (& usage) asked for, for the benchmark
+	size_t loadedCount;						// Entries before this are done
+	unsigned int pendingRequests;
+
+	TextureLoadStats stats;
+
+	int ChooseCodec(int usage) const;
+	MipSettings ChooseMipSettings(int usage, bool sRGB) const;
+	bool DecodeFirstColor(TextureImage& image, bool& sRGB) const;
+	void Prepare(Entry& entry);
+	void Upload(Entry& entry);
+};
@@ -0,0 +1,309 @@
+#include "TexturePacking.h"
+#include "TextureManager.h"
+#include "JobSystem.h"
+#include <wincodec.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cwctype>
+#include <map>
+
+// --------------------------------------------------------
+// Whether a lower case file name ends with a suffix, and
+// the prefix before it if so
+// --------------------------------------------------------
+static bool SplitSuffix(const std::wstring& name, const wchar_t* suffix, std::wstring& prefix)
+{
+	size_t length = wcslen(suffix);
+	if (name.size() <= length || name.compare(name.size() - length, length, suffix) != 0)
+		return false;
+	prefix = name.substr(0, name.size() - length);
+	return true;
+}
+
+// The directory with a separator on the end
+static std::wstring AsFolder(const std::wstring& directory)
+{
+	std::wstring folder = directory;
+	if (!folder.empty() && folder.back() != L'\\' && folder.back() != L'/')
+		folder += L"\\";
+	return folder;
+}
+
+void FindORMSources(const std::wstring& directory, const std::wstring& outputDirectory, std::vector<ORMSource>& sources)
+{
+	sources.clear();
+
+	std::wstring root = AsFolder(directory);
+	std::wstring output = AsFolder(outputDirectory);
+
+	WIN32_FIND_DATAW folder;
+	HANDLE folders = FindFirstFileW((root + L"*").c_str(), &folder);
+	if (folders == INVALID_HANDLE_VALUE)
+		return;
+
+	do
+	{
+		if (!(folder.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || folder.cFileName[0] == L'.')
+			continue;
+
+		// Every map in the folder, grouped by prefix (sorted, so
+		// the results are the same each run)
+		std::wstring path = root + folder.cFileName + L"\\";
+		std::map<std::wstring, ORMSource> found;
+		WIN32_FIND_DATAW file;
+		HANDLE files = FindFirstFileW((path + L"*.png").c_str(), &file);
+		if (files == INVALID_HANDLE_VALUE)
+			continue;
+
+		do
+		{
+			std::wstring name = file.cFileName;
+			for (wchar_t& c : name)
+				c = (wchar_t)std::towlower(c);
+
+			std::wstring prefix;
+			std::wstring* slot = nullptr;
+			if (SplitSuffix(name, L"_ao.png", prefix) || SplitSuffix(name, L"_occlusion.png", prefix))
+				slot = &found[prefix].Occlusion;
+			else if (SplitSuffix(name, L"_roughness.png", prefix))
+				slot = &found[prefix].Roughness;
+			else if (SplitSuffix(name, L"_metal.png", prefix) || SplitSuffix(name, L"_metalness.png", prefix))
+				slot = &found[prefix].Metalness;
+
+			if (slot)
+				*slot = path + file.cFileName;
+		} while (FindNextFileW(files, &file));
+		FindClose(files);
+
+		for (auto& f : found)
+		{
+			ORMSource& source = f.second;
+			if (source.Roughness.empty() && source.Metalness.empty())
+				continue;
+
+			// Every packed file shares the one output folder, so a
+			// name that's already been used elsewhere is skipped
+			source.Name = f.first;
+			source.Packed = output + f.first + L"_orm.png";
+			bool taken = false;
+			for (const ORMSource& other : sources)
+				taken |= other.Packed == source.Packed;
+			if (taken)
+			{
+				printf("Skipping %ls%ls - another material is already called that\n", path.c_str(), f.first.c_str());
+				continue;
+			}
+			sources.push_back(source);
+		}
+	} while (FindNextFileW(folders, &folder));
+	FindClose(folders);
+}
+
+// --------------------------------------------------------
+// One texel's value from a grayscale map, point sampled at
+// the same spot of the packed image
+// --------------------------------------------------------
+static unsigned char SampleMap(const TextureImage* map, unsigned int x, unsigned int y, unsigned int width, unsigned int height, unsigned char missing)
+{
+	if (!map)
+		return missing;
+
+	unsigned int mapX = (unsigned int)((unsigned long long)x * map->Width / width);
+	unsigned int mapY = (unsigned int)((unsigned long long)y * map->Height / height);
+	return map->Pixels[((size_t)mapY * map->Width + mapX) * map->Channels];
+}
+
+void PackORM(const TextureImage* occlusion, const TextureImage* roughness, const TextureImage* metalness, TextureImage& packed)
+{
+	const TextureImage* maps[3] = { occlusion, roughness, metalness };
+	const unsigned char missing[3] = { 255, 255, 0 };
+
+	packed.Width = 0;
+	packed.Height = 0;
+	for (const TextureImage* map : maps)
+	{
+		if (map && (unsigned long long)map->Width * map->Height > (unsigned long long)packed.Width * packed.Height)
+		{
+			packed.Width = map->Width;
+			packed.Height = map->Height;
+		}
+	}
+	packed.Channels = 4;
+	packed.Pixels.resize((size_t)packed.Width * packed.Height * 4);
+
+	JobSystem::GetInstance().ParallelFor(packed.Height, [&](unsigned int begin, unsigned int end) {
+		for (unsigned int y = begin; y < end; y++)
+		{
+			unsigned char* row = &packed.Pixels[(size_t)y * packed.Width * 4];
+			for (unsigned int x = 0; x < packed.Width; x++)
+			{
+				for (int c = 0; c < 3; c++)
+					row[x * 4 + c] = SampleMap(maps[c], x, y, packed.Width, packed.Height, missing[c]);
+				row[x * 4 + 3] = 255;
+			}
+		}
+	}, 16);
+}
+
+// --------------------------------------------------------
+// Writes RGBA8 pixels as a PNG with WIC, on whichever
+// thread this is (see DecodeImage() in TextureManager.cpp)
+// --------------------------------------------------------
+static bool SavePNG(const std::wstring& path, const TextureImage& image)
+{
+	HRESULT com = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	bool saved = false;
+	{
+		Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+		Microsoft::WRL::ComPtr<IWICStream> stream;
+		Microsoft::WRL::ComPtr<IWICBitmapEncoder> encoder;
+		Microsoft::WRL::ComPtr<IWICBitmapFrameEncode> frame;
+		WICPixelFormatGUID format = GUID_WICPixelFormat32bppRGBA;
+
+		saved =
+			SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()))) &&
+			SUCCEEDED(factory->CreateStream(stream.GetAddressOf())) &&
+			SUCCEEDED(stream->InitializeFromFilename(path.c_str(), GENERIC_WRITE)) &&
+			SUCCEEDED(factory->CreateEncoder(GUID_ContainerFormatPng, nullptr, encoder.GetAddressOf())) &&
+			SUCCEEDED(encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache)) &&
+			SUCCEEDED(encoder->CreateNewFrame(frame.GetAddressOf(), nullptr)) &&
+			SUCCEEDED(frame->Initialize(nullptr)) &&
+			SUCCEEDED(frame->SetSize(image.Width, image.Height)) &&
+			SUCCEEDED(frame->SetPixelFormat(&format)) &&
+			memcmp(&format, &GUID_WICPixelFormat32bppRGBA, sizeof(GUID)) == 0 &&
+			SUCCEEDED(frame->WritePixels(image.Height, image.Width * 4, (UINT)image.Pixels.size(), (BYTE*)image.Pixels.data())) &&
+			SUCCEEDED(frame->Commit()) &&
+			SUCCEEDED(encoder->Commit());
+	}
+
+	if (SUCCEEDED(com))
+		CoUninitialize();
+	return saved;
+}
+
+// Last write time of a file, or zero if it isn't there
+static unsigned long long GetWriteTime(const std::wstring& path)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (path.empty() || !GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+		return 0;
+	return ((unsigned long long)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+}
+
+// Every mip of a texture this size, cooked with a codec
+static unsigned long long GetCookedBytes(unsigned int width, unsigned int height, int codec)
+{
+	unsigned long long bytes = 0;
+	for (unsigned int m = 0; ; m++)
+	{
+		unsigned int mipWidth = max(1u, width >> m);
+		unsigned int mipHeight = max(1u, height >> m);
+		bytes += (unsigned long long)((mipWidth + 3) / 4) * ((mipHeight + 3) / 4) * GetCodecBlockBytes(codec);
+		if (mipWidth == 1 && mipHeight == 1)
+			return bytes;
+	}
+}
+
+// --------------------------------------------------------
+// Decodes, packs & saves one material's ORM texture
+// --------------------------------------------------------
+static void PackSource(const ORMSource& source, bool force, ORMPackRow& row)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	row.Name = source.Name;
+
+	const std::wstring* paths[3] = { &source.Occlusion, &source.Roughness, &source.Metalness };
+	unsigned long long newest = 0;
+	for (int c = 0; c < 3; c++)
+	{
+		if (paths[c]->empty())
+			continue;
+
+		unsigned long long written = GetWriteTime(*paths[c]);
+		newest = max(newest, written);
+		row.Maps++;
+	}
+	row.UpToDate = !force && GetWriteTime(source.Packed) >= newest;
+
+	// Up to date ones just need their size, from the packed file
+	TextureImage packed;
+	bool sRGB = false;
+	if (row.UpToDate)
+	{
+		row.UpToDate = TextureManager::DecodeFile(source.Packed, packed, sRGB);
+	}
+	if (!row.UpToDate)
+	{
+		TextureImage maps[3] = {};
+		const TextureImage* present[3] = {};
+		for (int c = 0; c < 3; c++)
+		{
+			if (paths[c]->empty())
+				continue;
+
+			if (!TextureManager::DecodeFile(*paths[c], maps[c], sRGB))
+			{
+				printf("Couldn't decode %ls\n", paths[c]->c_str());
+				row.Failed = true;
+				return;
+			}
+			present[c] = &maps[c];
+		}
+		PackORM(present[0], present[1], present[2], packed);
+	}
+	row.Width = packed.Width;
+	row.Height = packed.Height;
+
+	// The separate maps were BC4 (half a byte a texel), and the
+	// packed one is BC7 (a whole byte)
+	row.SeparateBytesPerPixel = row.Maps * GetCodecBlockBytes(TEXTURE_CODEC_BC4) / 16.0f;
+	row.PackedBytesPerPixel = GetCodecBlockBytes(TEXTURE_CODEC_BC7) / 16.0f;
+	row.SeparateBytes = row.Maps * GetCookedBytes(row.Width, row.Height, TEXTURE_CODEC_BC4);
+	row.PackedBytes = GetCookedBytes(row.Width, row.Height, TEXTURE_CODEC_BC7);
+
+	if (row.UpToDate)
+		return;
+
+	if (!SavePNG(source.Packed, packed))
+	{
+		printf("Couldn't save %ls\n", source.Packed.c_str());
+		row.Failed = true;
+		return;
+	}
+	row.Ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+ORMPackResults PackORMTextures(const std::wstring& directory, const std::wstring& outputDirectory, bool force)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	ORMPackResults results = {};
+	results.ThreadCount = JobSystem::GetInstance().GetThreadCount();
+
+	std::vector<ORMSource> sources;
+	FindORMSources(directory, outputDirectory, sources);
+	results.Rows.resize(sources.size());
+
+	JobSystem::GetInstance().ParallelFor((unsigned int)sources.size(), [&](unsigned int begin, unsigned int end) {
+		for (unsigned int i = begin; i < end; i++)
+			PackSource(sources[i], force, results.Rows[i]);
+	});
+
+	for (const ORMPackRow& row : results.Rows)
+	{
+		if (row.Failed)
+			results.Failed++;
+		else if (row.UpToDate)
+			results.UpToDate++;
+		else
+			results.Packed++;
+
+		if (!row.Failed)
+			results.SamplesSaved += row.Maps - 1;
+	}
+
+	results.TotalMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	return results;
+}
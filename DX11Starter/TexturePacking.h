@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "TextureCompression.h"
+
+// --------------------------------------------------------
+// The grayscale maps of one material that go into its ORM
+// texture - occlusion in red, roughness in green, metalness
+// in blue.  Any of them may be missing (empty).
+// --------------------------------------------------------
+struct ORMSource
+{
+	std::wstring Name;			// File prefix, like "bronze"
+	std::wstring Occlusion;		// <name>_ao.png or <name>_occlusion.png
+	std::wstring Roughness;		// <name>_roughness.png
+	std::wstring Metalness;		// <name>_metal.png or <name>_metalness.png
+	std::wstring Packed;		// <name>_orm.png, in the output directory
+};
+
+// --------------------------------------------------------
+// Results of PackORMTextures() - one row per material, and
+// what packing saves the normal mapped pixel shader: the
+// separate maps were each a sample of a BC4 texture, and
+// the packed one is a single BC7 sample
+// --------------------------------------------------------
+struct ORMPackRow
+{
+	std::wstring Name;
+	unsigned int Width;
+	unsigned int Height;
+	bool UpToDate;				// Packed file was newer than its sources, so it was left alone
+	bool Failed;
+	double Ms;					// Decoding, packing & saving (zero if up to date)
+	unsigned int Maps;			// Separate maps it replaces (2 or 3)
+	float SeparateBytesPerPixel;	// Texel bytes fetched per pixel before (top mip)
+	float PackedBytesPerPixel;	// And after
+	unsigned long long SeparateBytes;	// Every mip of every separate map, cooked
+	unsigned long long PackedBytes;		// Every mip of the packed one
+};
+
+struct ORMPackResults
+{
+	unsigned int ThreadCount;
+	unsigned int Packed;
+	unsigned int UpToDate;
+	unsigned int Failed;
+	double TotalMs;
+	unsigned int SamplesSaved;	// Per pixel, summed over the materials
+	std::vector<ORMPackRow> Rows;
+};
+
+// Every material folder under the directory (one level down)
+// with a roughness or metalness map, packing into the output
+// directory (names must be unique across folders)
+void FindORMSources(const std::wstring& directory, const std::wstring& outputDirectory, std::vector<ORMSource>& sources);
+
+// --------------------------------------------------------
+// Packs up to three grayscale images (red channel of RGBA
+// ones) into one RGBA8 image the size of the biggest, rows
+// spread across the job system.  Smaller ones are point
+// sampled; missing ones are white occlusion, fully rough
+// and not metal.
+// --------------------------------------------------------
+void PackORM(const TextureImage* occlusion, const TextureImage* roughness, const TextureImage* metalness, TextureImage& packed);
+
+// --------------------------------------------------------
+// The cook step: finds every material under the directory
+// and writes each one's ORM texture as a PNG in the output
+// directory - the one the cooked DDS files go in, next to
+// the .exe, so the source assets are never written to - one
+// material per job (only when a source is newer, unless
+// forced).  The texture manager then cooks the PNGs like any
+// other texture (TEXTURE_USAGE_PACKED).
+// --------------------------------------------------------
+ORMPackResults PackORMTextures(const std::wstring& directory, const std::wstring& outputDirectory, bool force = false);
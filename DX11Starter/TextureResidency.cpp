@@ -0,0 +1,451 @@
+#include "TextureResidency.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+
+static const float Pi = 3.14159265359f;
+
+static XMFLOAT3 Add(XMFLOAT3 a, XMFLOAT3 b) { return XMFLOAT3(a.x + b.x, a.y + b.y, a.z + b.z); }
+static XMFLOAT3 Subtract(XMFLOAT3 a, XMFLOAT3 b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+static float Dot(XMFLOAT3 a, XMFLOAT3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static XMFLOAT3 Normalize(XMFLOAT3 a)
+{
+	float length = sqrtf(Dot(a, a));
+	return XMFLOAT3(a.x / length, a.y / length, a.z / length);
+}
+
+TextureResidency::TextureResidency(const StreamingSettings& settings)
+	: settings(settings),
+	frame(0),
+	loadsInFlight(0)
+{
+}
+
+TextureResidency::~TextureResidency()
+{
+}
+
+unsigned int TextureResidency::AddTexture(const StreamingTextureDesc& desc)
+{
+	StreamedTexture texture = {};
+	texture.Desc = desc;
+	texture.TailMip = GetTailMip(desc, settings.TailSize);
+	texture.Resident = 0;
+	texture.Loading = 0;
+	texture.Requested = texture.TailMip;
+	texture.LastUsed = frame;
+	textures.push_back(texture);
+	return (unsigned int)textures.size() - 1;
+}
+
+void TextureResidency::SetSettings(const StreamingSettings& newSettings)
+{
+	settings = newSettings;
+	for (StreamedTexture& texture : textures)
+		texture.TailMip = GetTailMip(texture.Desc, settings.TailSize);
+}
+
+const StreamingSettings& TextureResidency::GetSettings() const { return settings; }
+const std::vector<StreamedTexture>& TextureResidency::GetTextures() const { return textures; }
+unsigned long long TextureResidency::GetFrame() const { return frame; }
+
+// Bytes of a mip & every smaller one
+unsigned long long TextureResidency::GetBytes(const StreamedTexture& texture, unsigned int mip)
+{
+	unsigned long long bytes = 0;
+	for (size_t m = mip; m < texture.Desc.MipBytes.size(); m++)
+		bytes += texture.Desc.MipBytes[m];
+	return bytes;
+}
+
+// --------------------------------------------------------
+// The first mip no bigger than the tail size - or the last
+// one whose size is still whole blocks, if that comes first
+// --------------------------------------------------------
+unsigned int TextureResidency::GetTailMip(const StreamingTextureDesc& desc, unsigned int tailSize)
+{
+	unsigned int count = (unsigned int)desc.MipBytes.size();
+	unsigned int mip = 0;
+	while (mip + 1 < count)
+	{
+		if (std::max(desc.Width >> mip, desc.Height >> mip) <= tailSize)
+			break;
+
+		unsigned int width = std::max(1u, desc.Width >> (mip + 1));
+		unsigned int height = std::max(1u, desc.Height >> (mip + 1));
+		if (desc.BlockCompressed && (width % 4 != 0 || height % 4 != 0))
+			break;
+		mip++;
+	}
+	return mip;
+}
+
+unsigned long long TextureResidency::GetCommittedBytes() const
+{
+	unsigned long long bytes = 0;
+	for (const StreamedTexture& texture : textures)
+		bytes += GetBytes(texture, std::min(texture.Resident, texture.Loading));
+	return bytes;
+}
+
+unsigned long long TextureResidency::GetRequestedBytes() const
+{
+	unsigned long long bytes = 0;
+	for (const StreamedTexture& texture : textures)
+		bytes += GetBytes(texture, texture.Requested);
+	return bytes;
+}
+
+unsigned long long TextureResidency::GetFullBytes() const
+{
+	unsigned long long bytes = 0;
+	for (const StreamedTexture& texture : textures)
+		bytes += GetBytes(texture, 0);
+	return bytes;
+}
+
+// --------------------------------------------------------
+// The projected diameter of the use's bounding sphere, in
+// pixels, against how many texels of the top mip stretch
+// across it (assuming its UVs span it once per repeat) -
+// each halving of the ratio is one more mip
+// --------------------------------------------------------
+int TextureResidency::GetRequiredMip(const StreamingTextureDesc& desc, const TextureUse& use, const StreamingView& view, float bias)
+{
+	XMFLOAT3 toCenter = Subtract(use.Center, view.Position);
+	float distance = sqrtf(Dot(toCenter, toCenter));
+	if (distance <= use.Radius)
+		return 0;
+
+	// Off screen?  Compared against the cone around the view's
+	// corners, widened by the sphere's own angular size
+	float tanHalfFov = tanf(view.FieldOfView * 0.5f);
+	float halfDiagonal = atanf(tanHalfFov * sqrtf(1 + view.Aspect * view.Aspect));
+	float cosAngle = Dot(toCenter, view.Forward) / distance;
+	float angle = acosf(std::min(std::max(cosAngle, -1.0f), 1.0f));
+	if (angle - asinf(use.Radius / distance) > halfDiagonal)
+		return -1;
+
+	float pixels = use.Radius / (distance * tanHalfFov) * view.ScreenHeight;
+	float texels = std::max(desc.Width, desc.Height) * use.UVScale;
+	float mip = floorf(log2f(texels / std::max(pixels, 1.0f)) + bias);
+	int last = (int)desc.MipBytes.size() - 1;
+	return std::min(std::max((int)mip, 0), last);
+}
+
+void TextureResidency::Update(const StreamingView& view, const std::vector<TextureUse>& uses, std::vector<StreamingCommand>& commands)
+{
+	commands.clear();
+	frame++;
+
+	// What's wanted
+	for (StreamedTexture& texture : textures)
+		texture.Requested = texture.TailMip;
+	for (const TextureUse& use : uses)
+	{
+		if (use.Texture >= textures.size())
+			continue;
+
+		StreamedTexture& texture = textures[use.Texture];
+		int mip = GetRequiredMip(texture.Desc, use, view, settings.MipBias);
+		if (mip < 0)
+			continue;
+
+		texture.Requested = std::min(texture.Requested, (unsigned int)mip);
+		texture.LastUsed = frame;
+	}
+
+	// Keep what's there (or on its way), plus anything asked for
+	unsigned int count = (unsigned int)textures.size();
+	targets.resize(count);
+	unsigned long long total = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const StreamedTexture& texture = textures[i];
+		targets[i] = std::min(texture.Requested, std::min(texture.Resident, texture.Loading));
+		total += GetBytes(texture, targets[i]);
+	}
+
+	// Then take mips away until it fits.  Loads in flight can't
+	// be called back, so their textures are left alone.  (A scan
+	// per mip dropped - fine for the few hundred textures a
+	// scene like this has.)
+	while (total > settings.BudgetBytes)
+	{
+		int victim = -1;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const StreamedTexture& texture = textures[i];
+			if (targets[i] >= texture.TailMip || texture.Loading != texture.Resident)
+				continue;
+
+			if (victim < 0)
+			{
+				victim = (int)i;
+				continue;
+			}
+
+			const StreamedTexture& best = textures[victim];
+			if (texture.LastUsed < best.LastUsed ||
+				(texture.LastUsed == best.LastUsed && texture.Desc.MipBytes[targets[i]] > best.Desc.MipBytes[targets[victim]]))
+				victim = (int)i;
+		}
+
+		if (victim < 0)
+			break;
+		total -= textures[victim].Desc.MipBytes[targets[victim]];
+		targets[victim]++;
+	}
+
+	// Evictions first, since they make the room loads need
+	std::vector<unsigned int> loads;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		StreamedTexture& texture = textures[i];
+		if (texture.Loading != texture.Resident)
+			continue;
+
+		if (targets[i] > texture.Resident)
+		{
+			StreamingCommand command = { i, targets[i], false };
+			commands.push_back(command);
+			texture.Resident = targets[i];
+			texture.Loading = targets[i];
+		}
+		else if (targets[i] < texture.Resident)
+		{
+			loads.push_back(i);
+		}
+	}
+
+	// Most recently used first, then whichever is furthest behind
+	std::sort(loads.begin(), loads.end(), [&](unsigned int a, unsigned int b) {
+		if (textures[a].LastUsed != textures[b].LastUsed)
+			return textures[a].LastUsed > textures[b].LastUsed;
+		unsigned int behindA = textures[a].Resident - targets[a];
+		unsigned int behindB = textures[b].Resident - targets[b];
+		return behindA != behindB ? behindA > behindB : a < b;
+	});
+	for (unsigned int i : loads)
+	{
+		if (loadsInFlight >= settings.MaxLoadsInFlight)
+			break;
+
+		StreamingCommand command = { i, targets[i], true };
+		commands.push_back(command);
+		textures[i].Loading = targets[i];
+		loadsInFlight++;
+	}
+}
+
+void TextureResidency::LoadFinished(unsigned int texture, unsigned int mip, bool succeeded)
+{
+	if (texture >= textures.size() || textures[texture].Loading != mip || mip == textures[texture].Resident)
+		return;
+
+	StreamedTexture& streamed = textures[texture];
+	if (succeeded)
+		streamed.Resident = mip;
+	streamed.Loading = streamed.Resident;
+	loadsInFlight--;
+}
+
+const char* GetStreamingPathName(int path)
+{
+	switch (path)
+	{
+	case STREAMING_PATH_ORBIT: return "Orbit";
+	case STREAMING_PATH_DOLLY: return "Dolly";
+	case STREAMING_PATH_TELEPORT: return "Teleport";
+	default: return "Unknown";
+	}
+}
+
+static StreamingView MakeView(const StreamingScene& scene, XMFLOAT3 position, XMFLOAT3 target)
+{
+	StreamingView view = {};
+	view.Position = position;
+	view.Forward = Normalize(Subtract(target, position));
+	view.FieldOfView = scene.FieldOfView;
+	view.Aspect = scene.Aspect;
+	view.ScreenHeight = scene.ScreenHeight;
+	return view;
+}
+
+// --------------------------------------------------------
+// Paths are sized by the box around every use, so the same
+// three work for any scene
+// --------------------------------------------------------
+void BuildStreamingPath(int path, const StreamingScene& scene, unsigned int frames, std::vector<StreamingView>& views)
+{
+	views.clear();
+	if (scene.Uses.empty() || frames == 0)
+		return;
+
+	XMFLOAT3 low(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 high(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (const TextureUse& use : scene.Uses)
+	{
+		low = XMFLOAT3(std::min(low.x, use.Center.x - use.Radius), std::min(low.y, use.Center.y - use.Radius), std::min(low.z, use.Center.z - use.Radius));
+		high = XMFLOAT3(std::max(high.x, use.Center.x + use.Radius), std::max(high.y, use.Center.y + use.Radius), std::max(high.z, use.Center.z + use.Radius));
+	}
+	XMFLOAT3 center((low.x + high.x) * 0.5f, (low.y + high.y) * 0.5f, (low.z + high.z) * 0.5f);
+	XMFLOAT3 extent = Subtract(high, low);
+	float size = std::max(sqrtf(Dot(extent, extent)) * 0.5f, 0.001f);
+
+	for (unsigned int f = 0; f < frames; f++)
+	{
+		float t = (float)f / frames;
+		switch (path)
+		{
+		case STREAMING_PATH_ORBIT:
+		{
+			float angle = t * 2 * Pi;
+			XMFLOAT3 offset(cosf(angle) * 2 * size, 0.3f * size, sinf(angle) * 2 * size);
+			views.push_back(MakeView(scene, Add(center, offset), center));
+			break;
+		}
+
+		case STREAMING_PATH_DOLLY:
+		{
+			XMFLOAT3 position = Add(center, XMFLOAT3(0, 0.1f * size, (t * 2 - 1) * 3 * size));
+			views.push_back(MakeView(scene, position, Add(position, XMFLOAT3(0, 0, 1))));
+			break;
+		}
+
+		default:
+		{
+			// A second far away, then a second right up against
+			// one of the uses (a different one each time)
+			unsigned int jump = f / 60;
+			if (jump % 2 == 0)
+			{
+				views.push_back(MakeView(scene, Add(center, XMFLOAT3(0, 0.5f * size, -3 * size)), center));
+			}
+			else
+			{
+				const TextureUse& use = scene.Uses[(jump * 7919) % scene.Uses.size()];
+				views.push_back(MakeView(scene, Add(use.Center, XMFLOAT3(0, 0, -2 * use.Radius)), use.Center));
+			}
+			break;
+		}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Runs the engine along the path as if each frame were
+// drawn: evictions happen at once, loads come back after
+// loadLatencyFrames, and every frame checks how many mips
+// short each use on screen is
+// --------------------------------------------------------
+StreamingSimulationResult SimulateStreaming(const StreamingScene& scene, const std::vector<StreamingView>& views, const StreamingSettings& settings, unsigned int loadLatencyFrames)
+{
+	StreamingSimulationResult result = {};
+	result.Frames = (unsigned int)views.size();
+
+	TextureResidency residency(settings);
+	for (const StreamingTextureDesc& desc : scene.Textures)
+		residency.AddTexture(desc);
+
+	struct PendingLoad
+	{
+		unsigned int Texture;
+		unsigned int Mip;
+		unsigned int Frame;
+	};
+	std::vector<PendingLoad> pending;
+	std::vector<StreamingCommand> commands;
+	double updateSeconds = 0;
+	unsigned long long onScreen = 0;
+	unsigned long long sharp = 0;
+	unsigned long long deficitSum = 0;
+
+	for (unsigned int f = 0; f < result.Frames; f++)
+	{
+		for (size_t i = 0; i < pending.size();)
+		{
+			if (pending[i].Frame <= f)
+			{
+				residency.LoadFinished(pending[i].Texture, pending[i].Mip, true);
+				pending[i] = pending.back();
+				pending.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		residency.Update(views[f], scene.Uses, commands);
+		updateSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		const std::vector<StreamedTexture>& textures = residency.GetTextures();
+		for (const StreamingCommand& command : commands)
+		{
+			if (command.Load)
+			{
+				const StreamedTexture& texture = textures[command.Texture];
+				for (unsigned int m = command.Mip; m < texture.Resident; m++)
+					result.LoadedBytes += texture.Desc.MipBytes[m];
+				PendingLoad load = { command.Texture, command.Mip, f + loadLatencyFrames };
+				pending.push_back(load);
+				result.Loads++;
+			}
+			else
+			{
+				result.Evictions++;
+			}
+		}
+
+		unsigned long long committed = residency.GetCommittedBytes();
+		result.PeakBytes = std::max(result.PeakBytes, committed);
+		if (committed > settings.BudgetBytes)
+			result.FramesOverBudget++;
+
+		for (const TextureUse& use : scene.Uses)
+		{
+			const StreamedTexture& texture = textures[use.Texture];
+			int mip = TextureResidency::GetRequiredMip(texture.Desc, use, views[f], settings.MipBias);
+			if (mip < 0)
+				continue;
+
+			unsigned int deficit = texture.Resident > (unsigned int)mip ? texture.Resident - mip : 0;
+			onScreen++;
+			sharp += deficit == 0 ? 1 : 0;
+			deficitSum += deficit;
+			result.WorstDeficit = std::max(result.WorstDeficit, deficit);
+		}
+	}
+
+	result.SharpUses = onScreen > 0 ? (float)sharp / onScreen : 1.0f;
+	result.AverageDeficit = onScreen > 0 ? (float)deficitSum / onScreen : 0.0f;
+	result.UpdateMicroseconds = result.Frames > 0 ? updateSeconds * 1000000.0 / result.Frames : 0.0;
+	return result;
+}
+
+StreamingSimulationResults RunStreamingSimulation(const StreamingScene& scene, const StreamingSettings& settings)
+{
+	StreamingSimulationResults results = {};
+	results.BudgetBytes = settings.BudgetBytes;
+
+	TextureResidency full(settings);
+	for (const StreamingTextureDesc& desc : scene.Textures)
+		full.AddTexture(desc);
+	results.FullBytes = full.GetFullBytes();
+
+	std::vector<StreamingView> views;
+	for (int path = 0; path < STREAMING_PATH_COUNT; path++)
+	{
+		BuildStreamingPath(path, scene, 600, views);
+		StreamingSimulationResult result = SimulateStreaming(scene, views, settings, 4);
+		result.Path = path;
+		results.Rows.push_back(result);
+	}
+
+	return results;
+}
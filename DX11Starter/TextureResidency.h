@@ -0,0 +1,189 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+// Synthetic camera paths for SimulateStreaming()
+#define STREAMING_PATH_ORBIT		0	// Circles the scene at a distance, looking in
+#define STREAMING_PATH_DOLLY		1	// Flies from far outside straight through the middle
+#define STREAMING_PATH_TELEPORT		2	// Jumps between far & close views - the worst case
+#define STREAMING_PATH_COUNT		3
+
+// --------------------------------------------------------
+// How much texture memory streaming may use, and how it
+// decides what each texture needs
+// --------------------------------------------------------
+struct StreamingSettings
+{
+	unsigned long long BudgetBytes = 16ull * 1024 * 1024;
+	unsigned int TailSize = 64;			// Mips this size & smaller are never evicted
+	float MipBias = 0.0f;				// Positive asks for blurrier mips
+	unsigned int MaxLoadsInFlight = 4;
+};
+
+// --------------------------------------------------------
+// A texture the residency engine tracks - its size & the
+// bytes of each mip, plus what's on the GPU & wanted
+// --------------------------------------------------------
+struct StreamingTextureDesc
+{
+	unsigned int Width;
+	unsigned int Height;
+	bool BlockCompressed;	// Smaller tops still have to be whole 4x4 blocks
+	std::vector<unsigned long long> MipBytes;
+};
+
+struct StreamedTexture
+{
+	StreamingTextureDesc Desc;
+	unsigned int TailMip;		// This & every smaller mip always stays resident
+	unsigned int Resident;		// Most detailed mip on the GPU
+	unsigned int Loading;		// Most detailed mip being loaded (Resident when nothing is)
+	unsigned int Requested;		// Most detailed mip anything on screen wanted last Update() (TailMip if nothing)
+	unsigned long long LastUsed;	// Last Update() it was on screen
+};
+
+// --------------------------------------------------------
+// One entity drawn with one texture - its world space
+// bounding sphere & how many times the texture repeats
+// across it
+// --------------------------------------------------------
+struct TextureUse
+{
+	unsigned int Texture;
+	DirectX::XMFLOAT3 Center;
+	float Radius;
+	float UVScale;
+};
+
+// --------------------------------------------------------
+// The camera, as far as streaming cares
+// --------------------------------------------------------
+struct StreamingView
+{
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMFLOAT3 Forward;	// Unit length
+	float FieldOfView;			// Vertical, radians
+	float Aspect;
+	float ScreenHeight;			// Pixels
+};
+
+// --------------------------------------------------------
+// What the caller has to do after Update(): evictions drop
+// a texture to Mip right away, and loads bring it up to Mip
+// in the background (report back with LoadFinished())
+// --------------------------------------------------------
+struct StreamingCommand
+{
+	unsigned int Texture;
+	unsigned int Mip;
+	bool Load;
+};
+
+// --------------------------------------------------------
+// Results of SimulateStreaming() - one camera path
+// --------------------------------------------------------
+struct StreamingSimulationResult
+{
+	int Path;
+	unsigned int Frames;
+	unsigned int Loads;
+	unsigned int Evictions;
+	unsigned long long LoadedBytes;
+	unsigned long long PeakBytes;
+	unsigned int FramesOverBudget;
+	float SharpUses;			// Share of on screen uses with at least the mip they asked for (0 - 1)
+	float AverageDeficit;		// Mips short of what was asked for, over on screen uses
+	unsigned int WorstDeficit;
+	double UpdateMicroseconds;	// Average per Update()
+};
+
+struct StreamingSimulationResults
+{
+	unsigned long long BudgetBytes;
+	unsigned long long FullBytes;	// Every mip of every texture
+	std::vector<StreamingSimulationResult> Rows;
+};
+
+// --------------------------------------------------------
+// A scene to simulate: the textures, what uses them, and
+// the screen they're seen on
+// --------------------------------------------------------
+struct StreamingScene
+{
+	std::vector<StreamingTextureDesc> Textures;
+	std::vector<TextureUse> Uses;
+	float FieldOfView;
+	float Aspect;
+	float ScreenHeight;
+};
+
+// --------------------------------------------------------
+// Decides which mips of each texture should be on the GPU:
+//
+//  - Every use on screen asks for the mip whose texels are
+//    about the size of a pixel, from the projected size of
+//    its bounding sphere - a texture wants the most detailed
+//    mip any of its uses asks for
+//  - Textures keep whatever they have as long as it fits
+//    (it may be needed again), and load more when asked
+//  - Over the budget, mips are dropped one at a time from
+//    the least recently used texture, and among textures on
+//    screen now, from whichever has the biggest top mip
+//
+// Loads are limited to a few at a time, most recently used
+// & furthest behind first, and counted against the budget
+// as soon as they start.
+//
+// No graphics API involved, so all of this can be checked
+// on the CPU alone (see SimulateStreaming()).
+// --------------------------------------------------------
+class TextureResidency
+{
+public:
+	TextureResidency(const StreamingSettings& settings = StreamingSettings());
+	~TextureResidency();
+
+	// Starts out fully resident - returns its index
+	unsigned int AddTexture(const StreamingTextureDesc& desc);
+
+	void SetSettings(const StreamingSettings& settings);
+	const StreamingSettings& GetSettings() const;
+
+	// Works out what's wanted & what fits this frame.  Evictions
+	// are assumed done by the next Update(); loads aren't until
+	// LoadFinished() says so.
+	void Update(const StreamingView& view, const std::vector<TextureUse>& uses, std::vector<StreamingCommand>& commands);
+	void LoadFinished(unsigned int texture, unsigned int mip, bool succeeded);
+
+	// The mip one use asks for, or -1 if it's off screen
+	static int GetRequiredMip(const StreamingTextureDesc& desc, const TextureUse& use, const StreamingView& view, float bias);
+
+	const std::vector<StreamedTexture>& GetTextures() const;
+	unsigned long long GetCommittedBytes() const;	// Resident, plus loads in flight
+	unsigned long long GetRequestedBytes() const;	// What every texture's requested mips would take
+	unsigned long long GetFullBytes() const;		// Every mip of every texture
+	unsigned long long GetFrame() const;
+
+private:
+	StreamingSettings settings;
+	std::vector<StreamedTexture> textures;
+	std::vector<unsigned int> targets;		// Scratch for Update()
+	unsigned long long frame;
+	unsigned int loadsInFlight;
+
+	static unsigned long long GetBytes(const StreamedTexture& texture, unsigned int mip);
+	static unsigned int GetTailMip(const StreamingTextureDesc& desc, unsigned int tailSize);
+};
+
+// --------------------------------------------------------
+// Synthetic camera paths around a scene's bounds, and a
+// frame by frame run of a TextureResidency along one, with
+// each load taking a few frames to come back
+// --------------------------------------------------------
+void BuildStreamingPath(int path, const StreamingScene& scene, unsigned int frames, std::vector<StreamingView>& views);
+StreamingSimulationResult SimulateStreaming(const StreamingScene& scene, const std::vector<StreamingView>& views, const StreamingSettings& settings, unsigned int loadLatencyFrames);
+
+// Every path, 600 frames each
+StreamingSimulationResults RunStreamingSimulation(const StreamingScene& scene, const StreamingSettings& settings);
+const char* GetStreamingPathName(int path);
@@ -0,0 +1,252 @@
+#include "TextureStreamer.h"
+#include "Profiler.h"
+#include <chrono>
+#include <cstdio>
+
+// Whole 4x4 blocks across a mip's width or height
+static unsigned int BlockCount(unsigned int size)
+{
+	return max(1u, (size + 3) / 4);
+}
+
+// --------------------------------------------------------
+// Tracks every cooked image the manager has loaded (all of
+// it resident to start with) and starts the loading thread
+// --------------------------------------------------------
+TextureStreamer::TextureStreamer(
+	Microsoft::WRL::ComPtr<ID3D11Device> device,
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+	const TextureManager& textureManager,
+	const StreamingSettings& settings)
+	: device(device),
+	context(context),
+	residency(settings),
+	stats(),
+	stopping(false)
+{
+	for (const std::vector<std::shared_ptr<Texture>>& group : textureManager.GetTextureGroups())
+	{
+		const Texture& texture = *group[0];
+		bool sRGB = false;
+		int codec = GetCodecFromDXGIFormat(texture.Format, sRGB);
+		if (texture.CookedPath.empty() || !texture.SRV || codec == TEXTURE_CODEC_NONE)
+			continue;
+
+		StreamingTextureDesc desc = {};
+		desc.Width = texture.Width;
+		desc.Height = texture.Height;
+		desc.BlockCompressed = true;
+		for (unsigned int m = 0; m < texture.MipLevels; m++)
+			desc.MipBytes.push_back((unsigned long long)BlockCount(texture.Width >> m) * BlockCount(texture.Height >> m) * GetCodecBlockBytes(codec));
+
+		StreamedImage image = {};
+		image.Handles = group;
+		image.Path = texture.CookedPath;
+		image.FirstMip = 0;
+		Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+		texture.SRV->GetResource(resource.GetAddressOf());
+		if (FAILED(resource.As(&image.Resource)))
+			continue;
+
+		unsigned int index = residency.AddTexture(desc);
+		for (const std::shared_ptr<Texture>& handle : group)
+			handleTable.insert(std::make_pair(handle.get(), index));
+		descs.push_back(desc);
+		images.push_back(image);
+	}
+
+	loader = std::thread(&TextureStreamer::LoaderLoop, this);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCV.notify_all();
+	loader.join();
+}
+
+int TextureStreamer::Find(const Texture* texture) const
+{
+	auto found = handleTable.find(texture);
+	return found == handleTable.end() ? -1 : (int)found->second;
+}
+
+// --------------------------------------------------------
+// Once a frame, before anything's drawn
+// --------------------------------------------------------
+void TextureStreamer::Update(const StreamingView& view, const std::vector<TextureUse>& uses)
+{
+	PROFILE_FUNCTION();
+
+	// Loads that came back since last frame
+	std::vector<LoadResult> results;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		results.swap(finishedLoads);
+	}
+	for (LoadResult& result : results)
+	{
+		bool succeeded = result.SRV != nullptr;
+		if (succeeded)
+		{
+			SetView(images[result.Texture], result.Resource, result.SRV, result.Mip);
+			stats.LoadMs += (result.Ms - stats.LoadMs) / (double)(stats.Loads + 1);
+			stats.Loads++;
+			stats.LoadedBytes += result.Bytes;
+		}
+		else
+		{
+			printf("Couldn't stream in mip %u of %ls\n", result.Mip, images[result.Texture].Path.c_str());
+			stats.FailedLoads++;
+		}
+		residency.LoadFinished(result.Texture, result.Mip, succeeded);
+	}
+
+	// Drop what doesn't fit now, and ask for what's missing
+	residency.Update(view, uses, commands);
+	bool queued = false;
+	for (const StreamingCommand& command : commands)
+	{
+		if (!command.Load)
+		{
+			Evict(command.Texture, command.Mip);
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(queueMutex);
+		LoadRequest request = { command.Texture, command.Mip, images[command.Texture].Path };
+		pendingLoads.push_back(request);
+		queued = true;
+	}
+	if (queued)
+		queueCV.notify_one();
+}
+
+// --------------------------------------------------------
+// Copies the mips from the given one down into a texture
+// just big enough for them.  The device is free threaded,
+// but only this thread touches the context.
+// --------------------------------------------------------
+void TextureStreamer::Evict(unsigned int texture, unsigned int mip)
+{
+	StreamedImage& image = images[texture];
+	if (mip <= image.FirstMip)
+		return;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	image.Resource->GetDesc(&desc);
+	unsigned int dropped = mip - image.FirstMip;
+	if (dropped >= desc.MipLevels)
+		return;
+
+	desc.Width = max(1u, desc.Width >> dropped);
+	desc.Height = max(1u, desc.Height >> dropped);
+	desc.MipLevels -= dropped;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+
+	// If this fails the old texture just stays (over budget, but
+	// correct), and the next load replaces it anyway
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> resource;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	if (FAILED(device->CreateTexture2D(&desc, 0, resource.GetAddressOf())))
+		return;
+	for (unsigned int m = 0; m < desc.MipLevels; m++)
+		context->CopySubresourceRegion(resource.Get(), m, 0, 0, 0, image.Resource.Get(), m + dropped, 0);
+	if (FAILED(device->CreateShaderResourceView(resource.Get(), 0, srv.GetAddressOf())))
+		return;
+
+	SetView(image, resource, srv, mip);
+	stats.Evictions++;
+}
+
+void TextureStreamer::SetView(StreamedImage& image, Microsoft::WRL::ComPtr<ID3D11Texture2D> resource, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, unsigned int firstMip)
+{
+	image.Resource = resource;
+	image.FirstMip = firstMip;
+	for (const std::shared_ptr<Texture>& handle : image.Handles)
+		handle->SRV = srv;
+}
+
+// --------------------------------------------------------
+// The loading thread: reads each request's mips straight
+// from the DDS file and creates the texture, then hands it
+// back for the next Update() to swap in
+// --------------------------------------------------------
+void TextureStreamer::LoaderLoop()
+{
+	while (true)
+	{
+		LoadRequest request;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCV.wait(lock, [&]() { return stopping || !pendingLoads.empty(); });
+			if (stopping)
+				return;
+			request = pendingLoads.front();
+			pendingLoads.pop_front();
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		LoadResult result = {};
+		result.Texture = request.Texture;
+		result.Mip = request.Mip;
+
+		CompressedTexture loaded = {};
+		if (LoadDDS(request.Path, loaded, request.Mip))
+		{
+			unsigned int blockBytes = GetCodecBlockBytes(loaded.Codec);
+			std::vector<D3D11_SUBRESOURCE_DATA> data(loaded.Mips.size());
+			for (size_t m = 0; m < loaded.Mips.size(); m++)
+			{
+				data[m].pSysMem = loaded.Mips[m].data();
+				data[m].SysMemPitch = BlockCount(loaded.Width >> m) * blockBytes;
+				result.Bytes += loaded.Mips[m].size();
+			}
+
+			D3D11_TEXTURE2D_DESC desc = {};
+			desc.Width = loaded.Width;
+			desc.Height = loaded.Height;
+			desc.MipLevels = (UINT)loaded.Mips.size();
+			desc.ArraySize = 1;
+			desc.Format = (DXGI_FORMAT)GetCodecDXGIFormat(loaded.Codec, loaded.SRGB);
+			desc.SampleDesc.Count = 1;
+			desc.Usage = D3D11_USAGE_IMMUTABLE;
+			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+			if (FAILED(device->CreateTexture2D(&desc, data.data(), result.Resource.GetAddressOf())) ||
+				FAILED(device->CreateShaderResourceView(result.Resource.Get(), 0, result.SRV.GetAddressOf())))
+			{
+				result.Resource.Reset();
+				result.SRV.Reset();
+			}
+		}
+		result.Ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+		std::lock_guard<std::mutex> lock(queueMutex);
+		finishedLoads.push_back(result);
+	}
+}
+
+void TextureStreamer::SetSettings(const StreamingSettings& settings)
+{
+	residency.SetSettings(settings);
+}
+
+const StreamingSettings& TextureStreamer::GetSettings() const { return residency.GetSettings(); }
+const TextureResidency& TextureStreamer::GetResidency() const { return residency; }
+const std::wstring& TextureStreamer::GetPath(unsigned int texture) const { return images[texture].Handles[0]->Path; }
+const TextureStreamingStats& TextureStreamer::GetStats() const { return stats; }
+
+StreamingScene TextureStreamer::MakeScene(const std::vector<TextureUse>& uses, float fieldOfView, float aspect, float screenHeight) const
+{
+	StreamingScene scene = {};
+	scene.Textures = descs;
+	scene.Uses = uses;
+	scene.FieldOfView = fieldOfView;
+	scene.Aspect = aspect;
+	scene.ScreenHeight = screenHeight;
+	return scene;
+}
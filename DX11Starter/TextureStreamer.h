@@ -0,0 +1,119 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "TextureManager.h"
+#include "TextureResidency.h"
+
+// --------------------------------------------------------
+// Counts since the streamer was made
+// --------------------------------------------------------
+struct TextureStreamingStats
+{
+	unsigned long long Loads;
+	unsigned long long FailedLoads;
+	unsigned long long Evictions;
+	unsigned long long LoadedBytes;
+	double LoadMs;				// Reading & creating each load, on average
+};
+
+// --------------------------------------------------------
+// Streams the mips of the TextureManager's cooked textures
+// in & out, as a TextureResidency decides:
+//
+//  - Loads go to a thread of their own, which reads the
+//    cooked DDS from the wanted mip down and creates a new
+//    texture from it
+//  - Evictions happen right away on the render thread, by
+//    copying the mips that stay into a smaller texture
+//
+// Either way every handle sharing that image gets the new
+// view, and materials bind whatever view their textures
+// have each frame.  Textures that weren't cooked (or aren't
+// cached) stay fully resident and aren't tracked.
+// --------------------------------------------------------
+class TextureStreamer
+{
+public:
+	TextureStreamer(
+		Microsoft::WRL::ComPtr<ID3D11Device> device,
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
+		const TextureManager& textureManager,
+		const StreamingSettings& settings = StreamingSettings());
+	~TextureStreamer();
+
+	// The residency index of a handle, or -1 if it isn't streamed
+	int Find(const Texture* texture) const;
+
+	// Swaps in finished loads, then evicts & queues loads for
+	// this frame's view (render thread)
+	void Update(const StreamingView& view, const std::vector<TextureUse>& uses);
+
+	void SetSettings(const StreamingSettings& settings);
+	const StreamingSettings& GetSettings() const;
+
+	const TextureResidency& GetResidency() const;
+	const std::wstring& GetPath(unsigned int texture) const;	// The image file it came from
+	const TextureStreamingStats& GetStats() const;
+
+	// The scene as the residency engine sees it, for simulating
+	// camera paths over the same textures
+	StreamingScene MakeScene(const std::vector<TextureUse>& uses, float fieldOfView, float aspect, float screenHeight) const;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	TextureResidency residency;
+	std::vector<StreamingTextureDesc> descs;
+	std::vector<StreamingCommand> commands;
+	TextureStreamingStats stats;
+
+	// One per image - whatever's on the GPU now starts at FirstMip
+	struct StreamedImage
+	{
+		std::vector<std::shared_ptr<Texture>> Handles;
+		std::wstring Path;		// Its cooked DDS file
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Resource;
+		unsigned int FirstMip;
+	};
+	std::vector<StreamedImage> images;
+	std::unordered_map<const Texture*, unsigned int> handleTable;
+
+	// The loading thread's queue & what it's finished, both
+	// guarded by the mutex
+	struct LoadRequest
+	{
+		unsigned int Texture;
+		unsigned int Mip;
+		std::wstring Path;
+	};
+	struct LoadResult
+	{
+		unsigned int Texture;
+		unsigned int Mip;
+		unsigned long long Bytes;
+		double Ms;
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Resource;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> SRV;
+	};
+	std::thread loader;
+	std::mutex queueMutex;
+	std::condition_variable queueCV;
+	std::deque<LoadRequest> pendingLoads;
+	std::vector<LoadResult> finishedLoads;
+	bool stopping;
+
+	void LoaderLoop();
+	void Evict(unsigned int texture, unsigned int mip);
+	void SetView(StreamedImage& image, Microsoft::WRL::ComPtr<ID3D11Texture2D> resource, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv, unsigned int firstMip);
+};
@@ -14,6 +14,8 @@ Transform::Transform()
 	
 	DirectX::XMStoreFloat4x4(&world, DirectX::XMMatrixIdentity());
 	DirectX::XMStoreFloat4x4(&worldInverseTranspose, DirectX::XMMatrixIdentity());
+
+	version = 0;
 }
 
 Transform::~Transform() 
@@ -46,6 +48,12 @@ void Transform::UpdateRightUpForward()
 	DirectX::XMStoreFloat3(&forward, DirectX::XMVector3Rotate(worldForward, rotVec));
 }
 
+void Transform::TrackChange(const DirectX::XMFLOAT3& before, const DirectX::XMFLOAT3& after)
+{
+	if (before.x != after.x || before.y != after.y || before.z != after.z)
+		version++;
+}
+
 
 // ----------------------
 // SETTERS
@@ -53,34 +61,46 @@ void Transform::UpdateRightUpForward()
 
 void Transform::SetPosition(float x, float y, float z)
 {
+	DirectX::XMFLOAT3 before = position;
 	position = { x, y, z };
+	TrackChange(before, position);
 }
 
 void Transform::SetPosition(DirectX::XMFLOAT3 position)
 {
+	DirectX::XMFLOAT3 before = this->position;
 	this->position = position;
+	TrackChange(before, this->position);
 }
 
 void Transform::SetRotation(float pitch, float yaw, float roll)
 {
+	DirectX::XMFLOAT3 before = rotation;
 	rotation = { pitch, yaw, roll };
+	TrackChange(before, rotation);
 	UpdateRightUpForward();
 }
 
 void Transform::SetRotation(DirectX::XMFLOAT3 rotation)
 {
+	DirectX::XMFLOAT3 before = this->rotation;
 	this->rotation = rotation;
+	TrackChange(before, this->rotation);
 	UpdateRightUpForward();
 }
 
 void Transform::SetScale(float x, float y, float z)
 {
+	DirectX::XMFLOAT3 before = scale;
 	scale = { x, y, z };
+	TrackChange(before, scale);
 }
 
 void Transform::SetScale(DirectX::XMFLOAT3 scale)
 {
+	DirectX::XMFLOAT3 before = this->scale;
 	this->scale = scale;
+	TrackChange(before, this->scale);
 }
 
 
@@ -130,6 +150,11 @@ DirectX::XMFLOAT3 Transform::GetForward()
 	return forward;
 }
 
+unsigned int Transform::GetVersion()
+{
+	return version;
+}
+
 
 
 // ----------------------
@@ -138,62 +163,76 @@ DirectX::XMFLOAT3 Transform::GetForward()
 
 void Transform::MoveAbsolute(float x, float y, float z)
 {
+	DirectX::XMFLOAT3 before = position;
 	DirectX::XMVECTOR posVec = DirectX::XMLoadFloat3(&position);
 	DirectX::XMVECTOR offsetVec = DirectX::XMVectorSet(x, y, z, 0.0f);
 	posVec = DirectX::XMVectorAdd(posVec, offsetVec);
 	DirectX::XMStoreFloat3(&position, posVec);
+	TrackChange(before, position);
 }
 
 void Transform::MoveAbsolute(DirectX::XMFLOAT3 offset)
 {
+	DirectX::XMFLOAT3 before = position;
 	DirectX::XMVECTOR posVec = DirectX::XMLoadFloat3(&position);
 	DirectX::XMVECTOR offsetVec = DirectX::XMLoadFloat3(&offset);
 	posVec = DirectX::XMVectorAdd(posVec, offsetVec);
 	DirectX::XMStoreFloat3(&position, posVec);
+	TrackChange(before, position);
 }
 
 void Transform::Rotate(float pitch, float yaw, float roll)
 {
+	DirectX::XMFLOAT3 before = rotation;
 	DirectX::XMVECTOR rotVec = DirectX::XMLoadFloat3(&rotation);
 	DirectX::XMVECTOR offsetVec = DirectX::XMVectorSet(pitch, yaw, roll, 0.0f);
 	rotVec = DirectX::XMVectorAdd(rotVec, offsetVec);
 	DirectX::XMStoreFloat3(&rotation, rotVec);
 
+	TrackChange(before, rotation);
 	UpdateRightUpForward();
 }
 
 void Transform::Rotate(DirectX::XMFLOAT3 rotation)
 {
+	DirectX::XMFLOAT3 before = this->rotation;
 	DirectX::XMVECTOR rotVec = DirectX::XMLoadFloat3(&(this->rotation));
 	DirectX::XMVECTOR offsetVec = DirectX::XMLoadFloat3(&rotation);
 	rotVec = DirectX::XMVectorAdd(rotVec, offsetVec);
 	DirectX::XMStoreFloat3(&(this->rotation), rotVec);
 
+	TrackChange(before, this->rotation);
 	UpdateRightUpForward();
 }
 
 void Transform::Scale(float x, float y, float z)
 {
+	DirectX::XMFLOAT3 before = scale;
 	DirectX::XMVECTOR scaleVec = DirectX::XMLoadFloat3(&scale);
 	DirectX::XMVECTOR offsetVec = DirectX::XMVectorSet(x, y, z, 1.0f);
 	scaleVec = DirectX::XMVectorMultiply(scaleVec, offsetVec);
 	DirectX::XMStoreFloat3(&scale, scaleVec);
+	TrackChange(before, scale);
 }
 
 void Transform::Scale(DirectX::XMFLOAT3 scale)
 {
+	DirectX::XMFLOAT3 before = this->scale;
 	DirectX::XMVECTOR scaleVec = DirectX::XMLoadFloat3(&(this->scale));
 	DirectX::XMVECTOR offsetVec = DirectX::XMLoadFloat3(&scale);
 	scaleVec = DirectX::XMVectorMultiply(scaleVec, offsetVec);
 	DirectX::XMStoreFloat3(&(this->scale), scaleVec);
+	TrackChange(before, this->scale);
 }
 
 void Transform::MoveRelative(float x, float y, float z) 
 {
+	DirectX::XMFLOAT3 before = position;
 	DirectX::XMVECTOR posVec = DirectX::XMLoadFloat3(&position);
 	DirectX::XMVECTOR absOffsetVec = DirectX::XMVectorSet(x, y, z, 1.0f);
 	DirectX::XMVECTOR rotVec = DirectX::XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
 	DirectX::XMVECTOR relOffsetVec = DirectX::XMVector3Rotate(absOffsetVec, rotVec);
 	posVec = DirectX::XMVectorAdd(posVec, relOffsetVec);
 	DirectX::XMStoreFloat3(&position, posVec);
+	TrackChange(before, position);
 }
\ No newline at end of file
@@ -29,6 +29,10 @@ public:
 	DirectX::XMFLOAT3 GetUp();
 	DirectX::XMFLOAT3 GetForward();
 
+	// Goes up every time the position, rotation or scale
+	// actually changes, so callers can tell if they're stale
+	unsigned int GetVersion();
+
 	// Transformers
 	void MoveAbsolute(float x, float y, float z);
 	void MoveAbsolute(DirectX::XMFLOAT3 offset);
@@ -52,6 +56,9 @@ private:
 	DirectX::XMFLOAT4X4 world;
 	DirectX::XMFLOAT4X4 worldInverseTranspose;
 
+	unsigned int version;
+
 	void CalculateWorldMatrices();
 	void UpdateRightUpForward();
+	void TrackChange(const DirectX::XMFLOAT3& before, const DirectX::XMFLOAT3& after);
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+
+// --------------------------------------------------------
+// A lock-free triple buffer for handing data from exactly
+// one producer thread to exactly one consumer thread.
+//
+// - The producer fills GetWriteBuffer() and calls Publish()
+// - The consumer calls Acquire() to get the newest published
+//   buffer, which stays valid until its next Acquire() call
+// - Neither side ever blocks or waits on the other
+// - Until the first Publish(), Acquire() returns a value
+//   initialized T
+// --------------------------------------------------------
+template<typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() :
+		buffers(),
+		writeIndex(0),
+		readIndex(1),
+		middle(2)
+	{
+	}
+
+	// Producer side: the slot currently being filled
+	T& GetWriteBuffer() { return buffers[writeIndex]; }
+
+	// Producer side: hands the filled slot to the consumer
+	// and takes back whichever slot was waiting in the middle
+	void Publish()
+	{
+		unsigned int old = middle.exchange(writeIndex | FreshBit, std::memory_order_acq_rel);
+		writeIndex = old & IndexMask;
+	}
+
+	// Consumer side: swaps in the newest published slot (if any)
+	// and returns it.  Returns the same slot again if nothing new
+	// has been published since the last call.
+	const T& Acquire()
+	{
+		if (middle.load(std::memory_order_relaxed) & FreshBit)
+		{
+			unsigned int old = middle.exchange(readIndex, std::memory_order_acq_rel);
+			readIndex = old & IndexMask;
+		}
+		return buffers[readIndex];
+	}
+
+	// Consumer side: the slot returned by the last Acquire()
+	const T& GetReadBuffer() const { return buffers[readIndex]; }
+
+private:
+	static const unsigned int IndexMask = 0x3;
+	static const unsigned int FreshBit = 0x4;
+
+	T buffers[3];
+
+	// Each index is only ever touched by one side, so keep
+	// them on separate cache lines to avoid false sharing
+	alignas(64) unsigned int writeIndex;
+	alignas(64) unsigned int readIndex;
+	alignas(64) std::atomic<unsigned int> middle;
+};
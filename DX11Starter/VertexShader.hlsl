@@ -1,14 +1,13 @@
 #include "ShaderIncludes.hlsli"
 
-// Struct representing data from a constant buffer
+// Struct representing data from a constant buffer - mirrored by
+// VertexShaderData in ConstantBuffers.h, so keep the two in sync
 cbuffer ExternalData : register(b0)
 {
     matrix world;
     matrix view;
     matrix projection;
     matrix worldInvTranspose;
-    matrix lightView;
-    matrix lightProjection;
 }
 
 // --------------------------------------------------------
@@ -29,8 +28,5 @@ VertexToPixel main( VertexShaderInput input )
     output.normal = mul((float3x3)worldInvTranspose, input.normal);
     output.worldPosition = mul(world, float4(input.localPosition, 1.0f)).xyz;
     
-    matrix shadowWVP = mul(lightProjection, mul(lightView, world));
-    output.shadowMapPos = mul(shadowWVP, float4(input.localPosition, 1.0f));
-    
 	return output;
 }
\ No newline at end of file